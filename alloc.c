@@ -0,0 +1,425 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "stats.h"
+#include "alloc.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Index of the empty tree. Element 0 of the pool is never used as a run (its maxLength stays 0)
+ */
+#define ALLOC_NIL (0u)
+
+/*
+ *Number of nodes added to the pool when it is full
+ */
+#define ALLOC_POOL_STEP (1024u)
+
+/*
+ *Run of free clusters. The runs are kept in a treap ordered by first cluster, each node knowing the
+ *largest run of its subtree : a run of a given length is found without visiting the other ones
+ */
+typedef struct
+{
+    uint32_t start;     /*First free cluster of the run (key of the tree)*/
+    uint32_t length;    /*Number of free clusters*/
+    uint32_t maxLength; /*Largest length in the subtree*/
+    uint32_t priority;  /*Random priority, a parent has a higher priority than its children*/
+    uint32_t left;      /*Runs starting before (ALLOC_NIL : none). Next released node when in the free list*/
+    uint32_t right;     /*Runs starting after*/
+} ALLOC_Node_struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static ALLOC_Node_struct_t *s_Node = NULL; /*Pool of nodes, nodes are linked by index (the pool may move)*/
+static uint32_t s_SumNode = 0;             /*Elements of the pool used (element 0 included)*/
+static uint32_t s_MaxNode = 0;             /*Capacity of the pool*/
+static uint32_t s_FreeNode = ALLOC_NIL;    /*Released nodes*/
+static uint32_t s_Root = ALLOC_NIL;        /*Root of the tree*/
+static uint32_t s_SumExtent = 0;           /*Number of runs in the tree*/
+static uint32_t s_Seed = 0x9e3779b9u;      /*State of the priority generator*/
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  ALLOC_NewNode
+ * @brief Take a node from the released ones or from the pool
+ * @param[in] start first cluster of the run
+ * @param[in] length number of clusters
+ * @return uint32_t Returns the node or ALLOC_NIL if memory is missing
+ */
+static uint32_t ALLOC_NewNode(const uint32_t start, const uint32_t length);
+
+/**  ALLOC_DeleteNode
+ * @brief Give a node back
+ * @param[in] node node
+ * @return none
+ */
+static void ALLOC_DeleteNode(const uint32_t node);
+
+/**  ALLOC_Update
+ * @brief Compute the largest length of a subtree from its children
+ * @param[in] node node
+ * @return none
+ */
+static void ALLOC_Update(const uint32_t node);
+
+/**  ALLOC_Merge
+ * @brief Join two trees, every run of left starting before the runs of right
+ * @param[in] left tree
+ * @param[in] right tree
+ * @return uint32_t Returns the joined tree
+ */
+static uint32_t ALLOC_Merge(const uint32_t left, const uint32_t right);
+
+/**  ALLOC_Split
+ * @brief Cut a tree into the runs starting before key and the other ones
+ * @param[in] tree tree
+ * @param[in] key first cluster
+ * @param[out] left runs starting before key
+ * @param[out] right runs starting at or after key
+ * @return none
+ */
+static void ALLOC_Split(const uint32_t tree, const uint32_t key, uint32_t *const left, uint32_t *const right);
+
+/**  ALLOC_FindFirst
+ * @brief Find the first run starting at or after key with at least sumCluster clusters
+ * @param[in] tree tree
+ * @param[in] key first cluster
+ * @param[in] sumCluster number of clusters
+ * @return uint32_t Returns the node or ALLOC_NIL
+ */
+static uint32_t ALLOC_FindFirst(const uint32_t tree, const uint32_t key, const uint32_t sumCluster);
+
+/**  ALLOC_Take
+ * @brief Remove the first clusters of a run from the tree
+ * @param[in] node run
+ * @param[in] sumCluster number of clusters taken (<= length of run)
+ * @return none
+ */
+static void ALLOC_Take(const uint32_t node, const uint32_t sumCluster);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool ALLOC_Build(const uint32_t *const fat, const uint32_t firstCluster, const uint32_t endCluster)
+{
+    bool status = true; /*return value */
+    uint32_t cluster = firstCluster;
+    uint32_t start = 0;
+    uint32_t node = ALLOC_NIL;
+
+    ALLOC_DeInit();
+    while ((true == status) && (cluster < endCluster))
+    {
+        if (0 == fat[cluster])
+        {
+            start = cluster;
+            while ((cluster < endCluster) && (0 == fat[cluster]))
+            {
+                cluster++;
+            }
+            /*Runs come in order : each one is joined on the right of the tree*/
+            node = ALLOC_NewNode(start, cluster - start);
+            status = (ALLOC_NIL != node);
+            s_Root = ALLOC_Merge(s_Root, node);
+        }
+        else
+        {
+            cluster++;
+        }
+    }
+
+    return status;
+}
+
+bool ALLOC_Allocate(const uint32_t sumCluster, const uint32_t goal, uint32_t *const start, uint32_t *const length)
+{
+    bool status = (ALLOC_NIL != s_Root) && (0 != sumCluster); /*return value */
+    uint32_t node = ALLOC_NIL;
+
+    if (true == status)
+    {
+        /*The run starting at goal continues the chain of the caller*/
+        node = s_Root;
+        while ((ALLOC_NIL != goal) && (ALLOC_NIL != node) && (goal != s_Node[node].start))
+        {
+            node = (goal < s_Node[node].start) ? s_Node[node].left : s_Node[node].right;
+        }
+        if ((ALLOC_NIL == goal) || (ALLOC_NIL == node))
+        {
+            node = ALLOC_FindFirst(s_Root, goal, sumCluster);
+        }
+        if (ALLOC_NIL == node)
+        {
+            node = ALLOC_FindFirst(s_Root, 0, sumCluster);
+        }
+        if (ALLOC_NIL == node)
+        {
+            /*No run is long enough : the largest one keeps the number of pieces low*/
+            node = ALLOC_FindFirst(s_Root, 0, s_Node[s_Root].maxLength);
+        }
+
+        *start = s_Node[node].start;
+        *length = (s_Node[node].length < sumCluster) ? s_Node[node].length : sumCluster;
+        ALLOC_Take(node, *length);
+    }
+
+    return status;
+}
+
+bool ALLOC_Release(const uint32_t start, const uint32_t length)
+{
+    bool status = true; /*return value */
+    uint32_t left = ALLOC_NIL;
+    uint32_t right = ALLOC_NIL;
+    uint32_t neighbour = ALLOC_NIL;
+    uint32_t node = ALLOC_NIL;
+    uint32_t first = start;
+    uint32_t sumCluster = length;
+
+    ALLOC_Split(s_Root, start, &left, &right);
+
+    /*Join the run ending at start*/
+    neighbour = left;
+    while ((ALLOC_NIL != neighbour) && (ALLOC_NIL != s_Node[neighbour].right))
+    {
+        neighbour = s_Node[neighbour].right;
+    }
+    if ((ALLOC_NIL != neighbour) && ((s_Node[neighbour].start + s_Node[neighbour].length) == first))
+    {
+        first = s_Node[neighbour].start;
+        sumCluster += s_Node[neighbour].length;
+        ALLOC_Split(left, first, &left, &node);
+        ALLOC_DeleteNode(node);
+    }
+
+    /*Join the run starting at the end*/
+    neighbour = right;
+    while ((ALLOC_NIL != neighbour) && (ALLOC_NIL != s_Node[neighbour].left))
+    {
+        neighbour = s_Node[neighbour].left;
+    }
+    if ((ALLOC_NIL != neighbour) && ((first + sumCluster) == s_Node[neighbour].start))
+    {
+        sumCluster += s_Node[neighbour].length;
+        ALLOC_Split(right, s_Node[neighbour].start + 1u, &node, &right);
+        ALLOC_DeleteNode(node);
+    }
+
+    node = ALLOC_NewNode(first, sumCluster);
+    status = (ALLOC_NIL != node);
+    s_Root = ALLOC_Merge(ALLOC_Merge(left, node), right);
+
+    return status;
+}
+
+uint32_t ALLOC_GetLargest(void)
+{
+    return (NULL != s_Node) ? s_Node[s_Root].maxLength : 0u;
+}
+
+uint32_t ALLOC_GetSumExtent(void)
+{
+    return s_SumExtent;
+}
+
+void ALLOC_DeInit(void)
+{
+    free(s_Node);
+    s_Node = NULL;
+    s_SumNode = 0;
+    s_MaxNode = 0;
+    s_FreeNode = ALLOC_NIL;
+    s_Root = ALLOC_NIL;
+    s_SumExtent = 0;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static uint32_t ALLOC_NewNode(const uint32_t start, const uint32_t length)
+{
+    uint32_t node = ALLOC_NIL; /*return value */
+    ALLOC_Node_struct_t *pool = NULL;
+
+    if (ALLOC_NIL != s_FreeNode)
+    {
+        node = s_FreeNode;
+        s_FreeNode = s_Node[node].left;
+    }
+    else
+    {
+        if (s_SumNode == s_MaxNode)
+        {
+            pool = (ALLOC_Node_struct_t *)STATS_Realloc(s_Node, (s_MaxNode + ALLOC_POOL_STEP) * sizeof(ALLOC_Node_struct_t));
+            if (NULL != pool)
+            {
+                if (0 == s_MaxNode)
+                {
+                    /*Element 0 : the empty tree*/
+                    pool[ALLOC_NIL].maxLength = 0;
+                    s_SumNode = 1;
+                }
+                s_Node = pool;
+                s_MaxNode += ALLOC_POOL_STEP;
+            }
+        }
+        if (s_SumNode < s_MaxNode)
+        {
+            node = s_SumNode;
+            s_SumNode++;
+        }
+    }
+
+    if (ALLOC_NIL != node)
+    {
+        /*xorshift32*/
+        s_Seed ^= s_Seed << 13u;
+        s_Seed ^= s_Seed >> 17u;
+        s_Seed ^= s_Seed << 5u;
+        s_Node[node].start = start;
+        s_Node[node].length = length;
+        s_Node[node].maxLength = length;
+        s_Node[node].priority = s_Seed;
+        s_Node[node].left = ALLOC_NIL;
+        s_Node[node].right = ALLOC_NIL;
+        s_SumExtent++;
+    }
+
+    return node;
+}
+
+static void ALLOC_DeleteNode(const uint32_t node)
+{
+    s_Node[node].left = s_FreeNode;
+    s_FreeNode = node;
+    s_SumExtent--;
+}
+
+static void ALLOC_Update(const uint32_t node)
+{
+    uint32_t maxLength = s_Node[node].length;
+
+    if (s_Node[s_Node[node].left].maxLength > maxLength)
+    {
+        maxLength = s_Node[s_Node[node].left].maxLength;
+    }
+    if (s_Node[s_Node[node].right].maxLength > maxLength)
+    {
+        maxLength = s_Node[s_Node[node].right].maxLength;
+    }
+    s_Node[node].maxLength = maxLength;
+}
+
+static uint32_t ALLOC_Merge(const uint32_t left, const uint32_t right)
+{
+    uint32_t tree = ALLOC_NIL; /*return value */
+
+    if (ALLOC_NIL == left)
+    {
+        tree = right;
+    }
+    else if (ALLOC_NIL == right)
+    {
+        tree = left;
+    }
+    else if (s_Node[left].priority > s_Node[right].priority)
+    {
+        s_Node[left].right = ALLOC_Merge(s_Node[left].right, right);
+        ALLOC_Update(left);
+        tree = left;
+    }
+    else
+    {
+        s_Node[right].left = ALLOC_Merge(left, s_Node[right].left);
+        ALLOC_Update(right);
+        tree = right;
+    }
+
+    return tree;
+}
+
+static void ALLOC_Split(const uint32_t tree, const uint32_t key, uint32_t *const left, uint32_t *const right)
+{
+    uint32_t child = ALLOC_NIL;
+
+    if (ALLOC_NIL == tree)
+    {
+        *left = ALLOC_NIL;
+        *right = ALLOC_NIL;
+    }
+    else if (s_Node[tree].start < key)
+    {
+        ALLOC_Split(s_Node[tree].right, key, &child, right);
+        s_Node[tree].right = child;
+        ALLOC_Update(tree);
+        *left = tree;
+    }
+    else
+    {
+        ALLOC_Split(s_Node[tree].left, key, left, &child);
+        s_Node[tree].left = child;
+        ALLOC_Update(tree);
+        *right = tree;
+    }
+}
+
+static uint32_t ALLOC_FindFirst(const uint32_t tree, const uint32_t key, const uint32_t sumCluster)
+{
+    uint32_t node = ALLOC_NIL; /*return value */
+
+    /*A subtree without a run long enough is not visited*/
+    if ((ALLOC_NIL != tree) && (s_Node[tree].maxLength >= sumCluster))
+    {
+        if (s_Node[tree].start >= key)
+        {
+            node = ALLOC_FindFirst(s_Node[tree].left, key, sumCluster);
+            if ((ALLOC_NIL == node) && (s_Node[tree].length >= sumCluster))
+            {
+                node = tree;
+            }
+        }
+        if (ALLOC_NIL == node)
+        {
+            node = ALLOC_FindFirst(s_Node[tree].right, key, sumCluster);
+        }
+    }
+
+    return node;
+}
+
+static void ALLOC_Take(const uint32_t node, const uint32_t sumCluster)
+{
+    const uint32_t start = s_Node[node].start;
+    uint32_t left = ALLOC_NIL;
+    uint32_t middle = ALLOC_NIL;
+    uint32_t right = ALLOC_NIL;
+
+    ALLOC_Split(s_Root, start, &left, &right);
+    ALLOC_Split(right, start + 1u, &middle, &right);
+    if (s_Node[node].length > sumCluster)
+    {
+        /*The rest of the run keeps its place in the order*/
+        s_Node[node].start += sumCluster;
+        s_Node[node].length -= sumCluster;
+        ALLOC_Update(node);
+        s_Root = ALLOC_Merge(ALLOC_Merge(left, node), right);
+    }
+    else
+    {
+        ALLOC_DeleteNode(node);
+        s_Root = ALLOC_Merge(left, right);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Goal of ALLOC_Allocate when the caller has no preferred place
+ */
+#define ALLOC_NO_GOAL (0u)
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  ALLOC_Build
+ * @brief Build the index of free extents (runs of free clusters) from a decoded FAT, in one pass
+ * @param[in] fat   Elements of the FAT
+ * @param[in] firstCluster   First cluster of the data region (2)
+ * @param[in] endCluster   Cluster after the data region
+ * @return bool Returns true if success
+ */
+bool ALLOC_Build(const uint32_t *const fat, const uint32_t firstCluster, const uint32_t endCluster);
+
+/**  ALLOC_Allocate
+ * @brief Take one run of free clusters out of the index, in O(log n) :
+ *        the run starting at goal if there is one (the chain stays contiguous),
+ *        else the first run of sumCluster clusters at or after goal, else the first one before goal,
+ *        else the largest run (the caller asks again for the rest)
+ * @param[in] sumCluster   Number of clusters wanted (the size of the whole file when it is known)
+ * @param[in] goal   Preferred first cluster (ALLOC_NO_GOAL : none)
+ * @param[out] start   First cluster of the run
+ * @param[out] length   Number of clusters of the run (<= sumCluster)
+ * @return bool Returns false if there is no free cluster
+ */
+bool ALLOC_Allocate(const uint32_t sumCluster, const uint32_t goal, uint32_t *const start, uint32_t *const length);
+
+/**  ALLOC_Release
+ * @brief Give a run of clusters back to the index, merged with its free neighbours
+ * @param[in] start   First cluster of the run
+ * @param[in] length   Number of clusters
+ * @return bool Returns false if memory is missing (the run is lost until the next ALLOC_Build)
+ */
+bool ALLOC_Release(const uint32_t start, const uint32_t length);
+
+/**  ALLOC_GetLargest
+ * @brief Get the length of the largest free run
+ * @return uint32_t Number of clusters (0 : the volume is full)
+ */
+uint32_t ALLOC_GetLargest(void);
+
+/**  ALLOC_GetSumExtent
+ * @brief Get the number of free runs in the index
+ * @return uint32_t Number of runs
+ */
+uint32_t ALLOC_GetSumExtent(void);
+
+/**  ALLOC_DeInit
+ * @brief Release the index
+ * @return none
+ */
+void ALLOC_DeInit(void);
+
+#endif /*__ALLOC_H__*/
@@ -6,8 +6,69 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
 #include "mystring.h"
+#include "hal.h"
 #include "fatfs.h"
+#include "index.h"
+#include "table.h"
+#include "checksum.h"
+#include "hash.h"
+#include "fsck.h"
+#include "frag.h"
+#include "defrag.h"
+#include "mkfs.h"
+#include "compact.h"
+#include "recover.h"
+#include "bench.h"
+#include "micro.h"
+#include "stats.h"
+#include "prefetch.h"
+#include "server.h"
+#include "zimage.h"
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Size of the buffer used to format listings before they are written to stdout
+ */
+#define APP_OUTPUT_BUFFER_SIZE (64u * 1024u)
+
+/*
+ *Longest line the listing can produce (long file name included)
+ */
+#define APP_OUTPUT_LINE_MAX (1024u)
+
+/*
+ *Maximum size of a path built by the application
+ */
+#define APP_PATH_MAX (4096u)
+
+/*
+ *Size of the chunks read from a host file by "put"
+ */
+#define APP_PUT_CHUNK_SIZE (1024u * 1024u)
+
+/*
+ *Command of the command line
+ */
+typedef struct
+{
+    const char *name;                                   /*Name of the command*/
+    int sumArgument;                                    /*Minimum number of arguments after the name*/
+    const char *usage;                                  /*Arguments shown in the help*/
+    int (*handler)(const int argc, char *const argv[]); /*argv[0] is the first argument after the name*/
+} APP_Command_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static uint8_t s_OutputBuffer[APP_OUTPUT_BUFFER_SIZE]; /*Reusable buffer for formatted output*/
+static uint32_t s_OutputLength = 0;                    /*Number of bytes waiting in s_OutputBuffer*/
 
 /*******************************************************************************
  * Prototypes
@@ -20,6 +81,13 @@
  */
 static uint16_t APP_ShowInfo(const FATFS_ListEntry_struct_t *const headNodeEntry);
 
+/**  APP_PrefetchFolders
+ * @brief      Start reading the sub folders of a listing in the background while the user is choosing
+ * @param[in] headNodeEntry  head of list entries
+ * @return none
+ */
+static void APP_PrefetchFolders(const FATFS_ListEntry_struct_t *const headNodeEntry);
+
 /**  APP_Selection
  * @brief      Get User Choices
  * @param[in] sumSeclect  The maximum number of choices the user can select
@@ -36,6 +104,260 @@ static uint16_t APP_Selection(const uint16_t sumSeclect);
  */
 static uint32_t APP_SelectiontHandler(const uint16_t select, const FATFS_ListEntry_struct_t *const headNodeEntry, bool *const subDriect);
 
+/**  APP_Print
+ * @brief      Format text into the output buffer. The buffer is written to stdout when it is nearly full
+ * @param[in] format  printf format string
+ * @return none
+ */
+static void APP_Print(const char *const format, ...);
+
+/**  APP_Flush
+ * @brief      Write all buffered output to stdout
+ * @return none
+ */
+static void APP_Flush(void);
+
+/**  APP_WriteData
+ * @brief      Write a chunk of file data straight to stdout (used as FATFS_DataCallback_t)
+ * @param[in] data  chunk of file data
+ * @param[in] size  size of chunk
+ * @param[in] context  unused
+ * @return bool Returns true if the whole chunk was written
+ */
+static bool APP_WriteData(const uint8_t *const data, const uint32_t size, void *const context);
+
+/**  APP_GetIndexPath
+ * @brief      Path of the index file of an image ("<image>.idx")
+ * @param[in] imagePath  path of image
+ * @param[out] indexPath  receiver, APP_PATH_MAX bytes
+ * @return none
+ */
+static void APP_GetIndexPath(const char *const imagePath, char *const indexPath);
+
+/**  APP_ParseSize
+ * @brief      Read a size with an optional K, M, G or T suffix (powers of 1024)
+ * @param[in] text  size
+ * @return uint64_t Size in bytes (0 if the text is not a size)
+ */
+static uint64_t APP_ParseSize(const char *const text);
+
+/**  APP_CommandIndex
+ * @brief      "index <image>" : build the index file of an image
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandIndex(const int argc, char *const argv[]);
+
+/**  APP_CommandStat
+ * @brief      "stat <image> <path>" : show an entry and its extents. Uses the index file when it is valid
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandStat(const int argc, char *const argv[]);
+
+/**  APP_CommandQuery
+ * @brief      "query <image> [options]" : filter and sort all entries of the volume
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandQuery(const int argc, char *const argv[]);
+
+/**  APP_PrintMatch
+ * @brief      Print one entry found by FATFS_Find (used as FATFS_FindCallback_t)
+ * @param[in] path  path of entry
+ * @param[in] entry  entry
+ * @param[in] context  number of entries found (uint32_t)
+ * @return bool Returns true to continue the search
+ */
+static bool APP_PrintMatch(const uint8_t *const path, const FATFS_Entry_Struct_t *const entry, void *const context);
+
+/**  APP_CommandFind
+ * @brief      "find <image> <pattern> [--threads N]" : print entries matching a wildcard pattern
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if at least one entry matches
+ */
+static int APP_CommandFind(const int argc, char *const argv[]);
+
+/**  APP_CommandHash
+ * @brief      "hash <image> [--crc32c] [--threads N]" : print the manifest "digest  path" of all files (SHA-256 by default)
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if every file was hashed
+ */
+static int APP_CommandHash(const int argc, char *const argv[]);
+
+/**  APP_PrintProblem
+ * @brief      Print one problem found by FSCK_Check (used as FSCK_Callback_t)
+ * @param[in] problem  problem
+ * @param[in] path  entry concerned
+ * @param[in] cluster  cluster concerned
+ * @param[in] value  value read in the FAT
+ * @param[in] context  unused
+ * @return none
+ */
+static void APP_PrintProblem(const FSCK_Problem_t problem, const uint8_t *const path, const uint32_t cluster, const uint32_t value, void *const context);
+
+/**  APP_CommandFsck
+ * @brief      "fsck <image> [--threads N]" : check the consistency of the volume
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if no problem was found
+ */
+static int APP_CommandFsck(const int argc, char *const argv[]);
+
+/**  APP_CommandDf
+ * @brief      "df <image> [--scan]" : show free, used and bad space of the volume
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandDf(const int argc, char *const argv[]);
+
+/**  APP_CommandFrag
+ * @brief      "frag <image> [--top N] [--threads N]" : show the fragmentation of the volume and the worst entries
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandFrag(const int argc, char *const argv[]);
+
+/**  APP_CommandDefrag
+ * @brief      "defrag <image> <output>" : write a copy of the image where every folder and file is contiguous
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandDefrag(const int argc, char *const argv[]);
+
+/**  APP_CommandPut
+ * @brief      "put <image> <path> <file> [<path> <file>...]" : copy host files into the image (an existing file is replaced)
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandPut(const int argc, char *const argv[]);
+
+/**  APP_CommandChange
+ * @brief      "mkdir|rm|rmdir <image> <path>..." and "truncate <image> <path> <size>" : change entries of the image
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments, argv[-1] is the name of the command
+ * @return int Returns 0 if success
+ */
+static int APP_CommandChange(const int argc, char *const argv[]);
+
+/**  APP_CommandMkfs
+ * @brief      "mkfs <image> <size> [--fat 12|16|32] [--cluster BYTES] [--sector BYTES] [--label NAME]" : create an empty (sparse) image
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandMkfs(const int argc, char *const argv[]);
+
+/**  APP_CommandCompact
+ * @brief      "compact <image>" : punch holes in the image where clusters are free
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandCompact(const int argc, char *const argv[]);
+
+/**  APP_CommandCompress
+ * @brief      "compress <image> <output> [--block BYTES] [--level 1-9]" : write a compressed image that every read only command can open
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandCompress(const int argc, char *const argv[]);
+
+/**  APP_PrintCandidate
+ * @brief      Print one entry found by RECOVER_Scan and write its data to the extraction folder (used as RECOVER_Callback_t)
+ * @param[in] candidate  entry
+ * @param[in] context  extraction folder (NULL : print only)
+ * @return bool Returns true to continue the scan
+ */
+static bool APP_PrintCandidate(const RECOVER_Candidate_Struct_t *const candidate, void *const context);
+
+/**  APP_CommandRecover
+ * @brief      "recover <image> [--extract <folder>]" : list deleted entries and entries of orphaned folders, and copy their data
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if the whole image was scanned
+ */
+static int APP_CommandRecover(const int argc, char *const argv[]);
+
+/**  APP_CommandBench
+ * @brief      "bench <image> [--generate] [shape options] [--iterations N]" : generate an image of a shape and time reading it (JSON)
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandBench(const int argc, char *const argv[]);
+
+/**  APP_CommandMicrobench
+ * @brief      "microbench [--fat 12|16|32] [--files N] [--iterations N]" : time the decode routines of fatfs on an image in memory (JSON)
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandMicrobench(const int argc, char *const argv[]);
+
+/**  APP_CommandServe
+ * @brief      "serve <image> <socket>" : mount the image once and answer list, stat and read requests on a Unix socket
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if the daemon stopped on a signal
+ */
+static int APP_CommandServe(const int argc, char *const argv[]);
+
+/**  APP_PrintRemoteEntry
+ * @brief      Print one reply line of the daemon as a listing line or as stat (used as SERVER_LineCallback_t)
+ * @param[in] line  reply line
+ * @param[in] context  true for stat (bool)
+ * @return bool Returns true
+ */
+static bool APP_PrintRemoteEntry(const char *const line, void *const context);
+
+/**  APP_CommandRemote
+ * @brief      "remote <socket> ls|stat|cat <path>" : ask a daemon started by "serve" (file data is read from the image it passes)
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success
+ */
+static int APP_CommandRemote(const int argc, char *const argv[]);
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static const APP_Command_Struct_t s_Commands[] = {
+    {"index", 1, "<image>", APP_CommandIndex},
+    {"stat", 2, "<image> <path>", APP_CommandStat},
+    {"query", 1, "<image> [--min-size N] [--max-size N] [--after YYYY-MM-DD] [--before YYYY-MM-DD] [--files|--dirs] [--sort size|date|name] [--desc] [--limit N]", APP_CommandQuery},
+    {"find", 2, "<image> <pattern> [--threads N]", APP_CommandFind},
+    {"hash", 1, "<image> [--crc32c] [--threads N]", APP_CommandHash},
+    {"fsck", 1, "<image> [--threads N]", APP_CommandFsck},
+    {"df", 1, "<image> [--scan]", APP_CommandDf},
+    {"frag", 1, "<image> [--top N] [--threads N]", APP_CommandFrag},
+    {"defrag", 2, "<image> <output>", APP_CommandDefrag},
+    {"put", 3, "<image> <path> <file> [<path> <file>...]", APP_CommandPut},
+    {"mkdir", 2, "<image> <path>...", APP_CommandChange},
+    {"rm", 2, "<image> <path>...", APP_CommandChange},
+    {"rmdir", 2, "<image> <path>...", APP_CommandChange},
+    {"truncate", 3, "<image> <path> <size>", APP_CommandChange},
+    {"mkfs", 2, "<image> <size> [--fat 12|16|32] [--cluster BYTES] [--sector BYTES] [--label NAME]", APP_CommandMkfs},
+    {"compact", 1, "<image>", APP_CommandCompact},
+    {"compress", 2, "<image> <output> [--block BYTES] [--level 1-9]", APP_CommandCompress},
+    {"recover", 1, "<image> [--extract <folder>]", APP_CommandRecover},
+    {"bench", 1, "<image> [--generate] [--fat 12|16|32] [--size SIZE] [--cluster BYTES] [--files N] [--depth N] [--width N] [--file-size BYTES] [--fragments N] [--seed N] [--long-names] [--iterations N]", APP_CommandBench},
+    {"microbench", 0, "[--fat 12|16|32] [--files N] [--iterations N]", APP_CommandMicrobench},
+    {"serve", 2, "<image> <socket>", APP_CommandServe},
+    {"remote", 3, "<socket> ls|stat|cat <path>", APP_CommandRemote},
+};
+
 /*******************************************************************************
  * Code
  ******************************************************************************/
@@ -55,6 +377,8 @@ void APP_MainMenu(void)
     if (false != check)
     {
         headNodeEntry = FATFS_ReadDirectory(0); /*Read root directory*/
+        (void)PREFETCH_Init(); /*Without the thread folders are only read when they are opened*/
+        APP_PrefetchFolders(headNodeEntry);
     }
     else
     {
@@ -69,6 +393,7 @@ void APP_MainMenu(void)
             select = APP_Selection(sumSeclect);       /*User enters selection*/
             if (select == sumSeclect)                 /*Exit the program*/
             {
+                PREFETCH_DeInit();
                 FATFS_DeInit();
                 break;
             }
@@ -78,13 +403,16 @@ void APP_MainMenu(void)
 
                 if (true == subDriect)
                 {
+                    PREFETCH_Cancel(); /*The other folders of the listing are no longer visible*/
                     headNodeEntry = FATFS_ReadDirectory(locationForReadEntry);
                     if (NULL == headNodeEntry)
                     {
                         printf("Error file");
+                        PREFETCH_DeInit();
                         FATFS_DeInit();
                         break;
                     }
+                    APP_PrefetchFolders(headNodeEntry);
                 }
                 else
                 {
@@ -99,6 +427,105 @@ void APP_MainMenu(void)
     }
 }
 
+int APP_CommandLine(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    uint32_t i = 0;   /*Index of command*/
+    char **arguments = NULL; /*Arguments without --stats, --trace and --direct*/
+    const char *tracePath = NULL;
+    uint64_t values[STATS_SUM_COUNTER];
+    STATS_Latency_Struct_t latency;
+    int sumArgument = 0;
+    int argument = 0;
+    bool isStats = false;
+
+    /*--stats, --trace and --direct are accepted by every command, anywhere after the name of command*/
+    arguments = (char **)malloc((size_t)argc * sizeof(char *));
+    for (argument = 0; (NULL != arguments) && (argument < argc); argument++)
+    {
+        if ((2 <= argument) && (0 == strcmp(argv[argument], "--stats")))
+        {
+            isStats = true;
+        }
+        else if ((2 <= argument) && ((argument + 1) < argc) && (0 == strcmp(argv[argument], "--trace")))
+        {
+            tracePath = argv[++argument];
+        }
+        else if ((2 <= argument) && (0 == strcmp(argv[argument], "--direct")))
+        {
+            HAL_SetDirect(true);
+        }
+        else
+        {
+            arguments[sumArgument++] = argv[argument];
+        }
+    }
+
+    for (i = 0; (NULL != arguments) && (i < (sizeof(s_Commands) / sizeof(s_Commands[0]))); i++)
+    {
+        if (0 == strcmp(arguments[1], s_Commands[i].name))
+        {
+            break;
+        }
+    }
+
+    if (NULL == arguments)
+    {
+        printf("Not enough memory\n");
+    }
+    else if ((sizeof(s_Commands) / sizeof(s_Commands[0])) == i)
+    {
+        printf("Usage :\n");
+        for (i = 0; i < (sizeof(s_Commands) / sizeof(s_Commands[0])); i++)
+        {
+            printf("  %s %s %s\n", arguments[0], s_Commands[i].name, s_Commands[i].usage);
+        }
+        printf("Every command accepts --stats : print the I/O and cache counters of the volume and the latencies on stderr\n");
+        printf("          and --trace <file> : write the operations as Chrome trace event JSON\n");
+        printf("          and --direct : read images with O_DIRECT (one pass scans do not fill the page cache)\n");
+    }
+    else if ((sumArgument - 2) < s_Commands[i].sumArgument)
+    {
+        printf("Usage : %s %s %s\n", arguments[0], s_Commands[i].name, s_Commands[i].usage);
+    }
+    else if ((NULL != tracePath) && (false == STATS_StartTrace(0)))
+    {
+        printf("Not enough memory\n");
+    }
+    else
+    {
+        STATS_Reset(); /*--stats covers the whole command, every mount included*/
+        exitCode = s_Commands[i].handler(sumArgument - 2, &arguments[2]);
+        if ((NULL != tracePath) && (false == STATS_WriteTrace((const uint8_t *)tracePath)))
+        {
+            printf("Can not write %s\n", tracePath);
+            exitCode = 1;
+        }
+        if (true == isStats)
+        {
+            /*On stderr : the output of the command (JSON, digests) stays usable*/
+            STATS_Get(values);
+            for (i = 0; i < STATS_SUM_COUNTER; i++)
+            {
+                fprintf(stderr, "%-24s %llu\n", STATS_GetName((STATS_Counter_t)i), (unsigned long long)values[i]);
+            }
+            fprintf(stderr, "%-16s %10s %10s %10s %10s %10s %10s %10s\n", "latency (us)", "calls", "mean", "p50", "p90", "p99", "p99.9", "max");
+            for (i = 0; i < STATS_SUM_OPERATION; i++)
+            {
+                STATS_GetLatency((STATS_Operation_t)i, &latency);
+                if (0 != latency.sumCall)
+                {
+                    fprintf(stderr, "%-16s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", STATS_GetOperationName((STATS_Operation_t)i),
+                            (unsigned long long)latency.sumCall, latency.mean / 1e3, latency.p50 / 1e3, latency.p90 / 1e3, latency.p99 / 1e3, latency.p999 / 1e3, latency.max / 1e3);
+                }
+            }
+        }
+    }
+    free(arguments);
+
+    return exitCode;
+}
+
 /************************************************************************************
  * Static function
  *************************************************************************************/
@@ -113,7 +540,7 @@ static uint16_t APP_ShowInfo(const FATFS_ListEntry_struct_t *const headNodeEntry
     uint16_t yearConvert = 0;
 
     temp = headNodeEntry;
-    printf("\n\n%-6s%-12s%-24s%-15s%-10s\n", "No", "Name", "Date modifiled", "Type", "Size");
+    APP_Print("\n\n%-6s%-12s%-24s%-15s%-10s\n", "No", "Name", "Date modifiled", "Type", "Size");
     while (NULL != temp)
     {
         i++;
@@ -137,28 +564,46 @@ static uint16_t APP_ShowInfo(const FATFS_ListEntry_struct_t *const headNodeEntry
             MYSTRING_MyMemCpy(file, 7, attributes); /*size of file string  = 7*/
         }
 
-        /*Show information*/
-        printf("%-6d", i);
-        printf("%-8s   ", temp->entry.shortFileName);
-        printf("%.2d/%.2d/%.4d %.2d:%.2d         ", temp->entry.lastModDate.month, temp->entry.lastModDate.day, yearConvert, temp->entry.lastModTime.hours, temp->entry.lastModTime.minutes);
-        printf("%-15s", attributes);
-        printf("%-10d ", temp->entry.fileSize);
-        if (0 != temp->entry.longFileName[0])
-        {
-            printf("%s\n", temp->entry.longFileName);
-        }
-        else
-        {
-            printf("\n");
-        }
+        /*Show information (one formatted line per entry)*/
+        APP_Print("%-6d%-8s   %.2d/%.2d/%.4d %.2d:%.2d         %-15s%-10d %s\n", i, temp->entry.shortFileName,
+                  temp->entry.lastModDate.month, temp->entry.lastModDate.day, yearConvert, temp->entry.lastModTime.hours, temp->entry.lastModTime.minutes,
+                  attributes, temp->entry.fileSize, temp->entry.longFileName);
         temp = temp->next;
     }
     i = i + 1;
-    printf("\n%d  : Exit Program\n", i);
+    APP_Print("\n%d  : Exit Program\n", i);
+    APP_Flush();
 
     return i;
 }
 
+static void APP_PrefetchFolders(const FATFS_ListEntry_struct_t *const headNodeEntry)
+{
+    const FATFS_ListEntry_struct_t *temp = NULL;
+    uint32_t *folders = NULL;
+    uint32_t sumFolder = 0;
+
+    for (temp = headNodeEntry; NULL != temp; temp = temp->next)
+    {
+        sumFolder++;
+    }
+    folders = (uint32_t *)malloc((sumFolder + 1u) * sizeof(uint32_t));
+    sumFolder = 0;
+    /*In the order of the listing : "." and ".." are already read*/
+    for (temp = headNodeEntry; (NULL != folders) && (NULL != temp); temp = temp->next)
+    {
+        if ((0 != (temp->entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)) && ('.' != temp->entry.shortFileName[0]) && (2u <= temp->entry.firstCluster))
+        {
+            folders[sumFolder++] = temp->entry.firstCluster;
+        }
+    }
+    if (NULL != folders)
+    {
+        PREFETCH_Folders(folders, sumFolder, PREFETCH_BUDGET_DEFAULT);
+    }
+    free(folders);
+}
+
 static uint16_t APP_Selection(const uint16_t sumSeclect)
 {
     uint8_t checkSeclect[MYSTRING_CHARACTERS_LIMIT];
@@ -195,7 +640,6 @@ static uint16_t APP_Selection(const uint16_t sumSeclect)
 
 static uint32_t APP_SelectiontHandler(const uint16_t select, const FATFS_ListEntry_struct_t *const headNodeEntry, bool *const subDriect)
 {
-    uint8_t *buffer = NULL;
     uint16_t i = 0;
     uint32_t locationReturn = 0;
     uint32_t positionOfcluster = 0;
@@ -212,16 +656,13 @@ static uint32_t APP_SelectiontHandler(const uint16_t select, const FATFS_ListEnt
         if (0 != temp->entry.fileSize)
         {
             positionOfcluster = temp->entry.firstCluster;
-            FATFS_ReadData(positionOfcluster, temp->entry.fileSize, &buffer);
 
             printf("\n");
-            for (i = 0; i < temp->entry.fileSize; i++)
+            if (false == FATFS_StreamData(positionOfcluster, temp->entry.fileSize, APP_WriteData, NULL))
             {
-                printf("%c", buffer[i]);
+                printf("\nError file");
             }
-            printf("%.*s", temp->entry.fileSize, buffer);
-
-            buffer= (uint8_t *)realloc(buffer,0);
+            fflush(stdout);
         }
         else
         {
@@ -242,3 +683,1273 @@ static uint32_t APP_SelectiontHandler(const uint16_t select, const FATFS_ListEnt
 
     return locationForReadEntry;
 }
+
+static void APP_Print(const char *const format, ...)
+{
+    va_list args;
+    int32_t sizeOfString = 0;
+
+    if ((APP_OUTPUT_BUFFER_SIZE - s_OutputLength) < APP_OUTPUT_LINE_MAX)
+    {
+        APP_Flush();
+    }
+
+    va_start(args, format);
+    sizeOfString = vsnprintf((char *)&s_OutputBuffer[s_OutputLength], APP_OUTPUT_BUFFER_SIZE - s_OutputLength, format, args);
+    va_end(args);
+
+    if (0 < sizeOfString)
+    {
+        if ((uint32_t)sizeOfString >= (APP_OUTPUT_BUFFER_SIZE - s_OutputLength))
+        {
+            /*Truncated by vsnprintf: keep what fits*/
+            sizeOfString = APP_OUTPUT_BUFFER_SIZE - s_OutputLength - 1u;
+        }
+        s_OutputLength += sizeOfString;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+}
+
+static void APP_Flush(void)
+{
+    if (0 != s_OutputLength)
+    {
+        fwrite(s_OutputBuffer, sizeof(uint8_t), s_OutputLength, stdout);
+        s_OutputLength = 0;
+    }
+    fflush(stdout);
+}
+
+static bool APP_WriteData(const uint8_t *const data, const uint32_t size, void *const context)
+{
+    (void)context;
+
+    return (size == fwrite(data, sizeof(uint8_t), size, stdout));
+}
+
+static void APP_GetIndexPath(const char *const imagePath, char *const indexPath)
+{
+    snprintf(indexPath, APP_PATH_MAX, "%s.idx", imagePath);
+}
+
+static uint64_t APP_ParseSize(const char *const text)
+{
+    char *end = NULL;
+    uint64_t size = strtoull(text, &end, 0);
+
+    switch (*end)
+    {
+    case 'T':
+    case 't':
+        size <<= 10u;
+        /*fall through*/
+    case 'G':
+    case 'g':
+        size <<= 10u;
+        /*fall through*/
+    case 'M':
+    case 'm':
+        size <<= 10u;
+        /*fall through*/
+    case 'K':
+    case 'k':
+        size <<= 10u;
+        end++;
+        break;
+    default:
+        break;
+    }
+    if ((end == text) || (0 != *end))
+    {
+        size = 0;
+    }
+
+    return size;
+}
+
+static int APP_CommandIndex(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    char indexPath[APP_PATH_MAX];
+
+    (void)argc;
+    APP_GetIndexPath(argv[0], indexPath);
+    if (false == FATFS_Init((const uint8_t *)argv[0]))
+    {
+        printf("Can not open FAT file\n");
+    }
+    else
+    {
+        if (true == INDEX_Build((const uint8_t *)argv[0], (const uint8_t *)indexPath))
+        {
+            printf("%s\n", indexPath);
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not write %s\n", indexPath);
+        }
+        FATFS_DeInit();
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandStat(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    char indexPath[APP_PATH_MAX];
+    INDEX_Handle_Struct_t handle;
+    FATFS_Entry_Struct_t entry;
+    uint8_t shortName[FATFS_SHORT_NAME_SIZE];
+    uint32_t node = 0;
+    uint32_t i = 0;
+    uint32_t cluster = 0;
+    uint32_t nextCluster = 0;
+    uint32_t sumCluster = 0;
+    FATFS_VolumeInfo_Struct_t info;
+
+    (void)argc;
+    APP_GetIndexPath(argv[0], indexPath);
+    if (true == INDEX_Open(&handle, (const uint8_t *)argv[0], (const uint8_t *)indexPath))
+    {
+        /*Fast path : everything comes from the mapped index*/
+        node = INDEX_Lookup(&handle, (const uint8_t *)argv[1]);
+        if (INDEX_NOT_FOUND != node)
+        {
+            APP_Print("Name     : %s\nType     : %s\nSize     : %u\nCluster  : %u\nExtents  :", INDEX_GetName(&handle, node),
+                      (0 != (handle.node[node].attributes & FATFS_ATTRIBUTE_DIRECTORY)) ? "Folder" : "File", handle.node[node].fileSize, handle.node[node].firstCluster);
+            for (i = 0; i < handle.node[node].sumExtent; i++)
+            {
+                APP_Print(" %u+%u", handle.extent[handle.node[node].firstExtent + i].startCluster, handle.extent[handle.node[node].firstExtent + i].sumCluster);
+            }
+            APP_Print("\n");
+            exitCode = 0;
+        }
+        INDEX_Close(&handle);
+    }
+    else if (true == FATFS_Init((const uint8_t *)argv[0]))
+    {
+        /*No valid index : parse the image*/
+        if (true == FATFS_Lookup((const uint8_t *)argv[1], &entry))
+        {
+            FATFS_GetShortName(&entry, shortName);
+            APP_Print("Name     : %s\nType     : %s\nSize     : %u\nCluster  : %u\nExtents  :", (0 != entry.longFileName[0]) ? entry.longFileName : shortName,
+                      (0 != (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)) ? "Folder" : "File", entry.fileSize, entry.firstCluster);
+            FATFS_GetVolumeInfo(&info);
+            cluster = entry.firstCluster;
+            sumCluster = 0;
+            while ((2u <= cluster) && (sumCluster < info.totalClusters))
+            {
+                /*Count the clusters of one run*/
+                i = 1;
+                while ((true == FATFS_GetNextCluster(cluster, &nextCluster)) && ((cluster + 1u) == nextCluster))
+                {
+                    cluster = nextCluster;
+                    i++;
+                }
+                APP_Print(" %u+%u", cluster + 1u - i, i);
+                sumCluster += i;
+                cluster = (true == FATFS_GetNextCluster(cluster, &nextCluster)) ? nextCluster : 0;
+            }
+            APP_Print("\n");
+            exitCode = 0;
+        }
+        FATFS_DeInit();
+    }
+    else
+    {
+        printf("Can not open FAT file\n");
+    }
+
+    if (0 != exitCode)
+    {
+        APP_Print("%s : not found\n", argv[1]);
+    }
+    APP_Flush();
+
+    return exitCode;
+}
+
+static int APP_CommandQuery(const int argc, char *const argv[])
+{
+    int exitCode = 0; /*return value */
+    char indexPath[APP_PATH_MAX];
+    uint8_t path[APP_PATH_MAX];
+    INDEX_Handle_Struct_t handle;
+    TABLE_Table_Struct_t table;
+    TABLE_Filter_Struct_t filter;
+    TABLE_SortKey_t key = TABLE_SORT_NAME;
+    bool sort = false;
+    bool descending = false;
+    bool status = true;
+    uint32_t limit = 0xffffffffu;
+    uint32_t *rows = NULL;
+    uint32_t sumSelected = 0;
+    uint32_t i = 0;
+    uint32_t year = 0;
+    uint32_t month = 0;
+    uint32_t day = 0;
+    int argument = 0;
+
+    /*Options*/
+    TABLE_InitFilter(&filter);
+    for (argument = 1; (true == status) && (argument < argc); argument++)
+    {
+        if ((0 == strcmp(argv[argument], "--min-size")) && ((argument + 1) < argc))
+        {
+            argument++;
+            filter.minSize = strtoul(argv[argument], NULL, 0);
+        }
+        else if ((0 == strcmp(argv[argument], "--max-size")) && ((argument + 1) < argc))
+        {
+            argument++;
+            filter.maxSize = strtoul(argv[argument], NULL, 0);
+        }
+        else if (((0 == strcmp(argv[argument], "--after")) || (0 == strcmp(argv[argument], "--before"))) && ((argument + 1) < argc) &&
+                 (3 == sscanf(argv[argument + 1], "%u-%u-%u", &year, &month, &day)) && (1980u <= year))
+        {
+            if (0 == strcmp(argv[argument], "--after"))
+            {
+                filter.modifiedAfter = TABLE_PACK_DATE(year, month, day);
+            }
+            else
+            {
+                filter.modifiedBefore = TABLE_PACK_DATE(year, month, day) | 0xffffu; /*Whole day*/
+            }
+            argument++;
+        }
+        else if (0 == strcmp(argv[argument], "--files"))
+        {
+            filter.attributesMask = FATFS_ATTRIBUTE_DIRECTORY;
+            filter.attributesValue = 0;
+        }
+        else if (0 == strcmp(argv[argument], "--dirs"))
+        {
+            filter.attributesMask = FATFS_ATTRIBUTE_DIRECTORY;
+            filter.attributesValue = FATFS_ATTRIBUTE_DIRECTORY;
+        }
+        else if ((0 == strcmp(argv[argument], "--sort")) && ((argument + 1) < argc))
+        {
+            argument++;
+            sort = true;
+            key = (0 == strcmp(argv[argument], "size")) ? TABLE_SORT_SIZE : ((0 == strcmp(argv[argument], "date")) ? TABLE_SORT_MODIFIED : TABLE_SORT_NAME);
+        }
+        else if (0 == strcmp(argv[argument], "--desc"))
+        {
+            descending = true;
+        }
+        else if ((0 == strcmp(argv[argument], "--limit")) && ((argument + 1) < argc))
+        {
+            argument++;
+            limit = strtoul(argv[argument], NULL, 0);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    /*Build the table from the index if it is valid, else from the image*/
+    if (true == status)
+    {
+        APP_GetIndexPath(argv[0], indexPath);
+        if (true == INDEX_Open(&handle, (const uint8_t *)argv[0], (const uint8_t *)indexPath))
+        {
+            status = TABLE_BuildFromIndex(&table, &handle);
+            INDEX_Close(&handle);
+        }
+        else if (true == FATFS_Init((const uint8_t *)argv[0]))
+        {
+            status = TABLE_Build(&table);
+            FATFS_DeInit();
+        }
+        else
+        {
+            printf("Can not open FAT file\n");
+            status = false;
+        }
+    }
+
+    if (true == status)
+    {
+        rows = (uint32_t *)malloc((size_t)table.sumRow * sizeof(uint32_t));
+        status = (NULL != rows);
+        if (true == status)
+        {
+            sumSelected = TABLE_Select(&table, &filter, rows);
+            if (true == sort)
+            {
+                status = TABLE_Sort(&table, rows, sumSelected, key, descending);
+            }
+        }
+        for (i = 0; (true == status) && (i < sumSelected) && (i < limit); i++)
+        {
+            TABLE_GetPath(&table, rows[i], path, sizeof(path));
+            APP_Print("%-10u %04u-%02u-%02u %02u:%02u  %s%s\n", table.size[rows[i]], 1980u + (table.modified[rows[i]] >> 25u), (table.modified[rows[i]] >> 21u) & 0x0fu,
+                      (table.modified[rows[i]] >> 16u) & 0x1fu, (table.modified[rows[i]] >> 11u) & 0x1fu, (table.modified[rows[i]] >> 5u) & 0x3fu, path,
+                      (0 != (table.attributes[rows[i]] & FATFS_ATTRIBUTE_DIRECTORY)) ? "/" : "");
+        }
+        APP_Flush();
+        free(rows);
+        TABLE_Free(&table);
+    }
+
+    if (false == status)
+    {
+        exitCode = 1;
+    }
+
+    return exitCode;
+}
+
+static bool APP_PrintMatch(const uint8_t *const path, const FATFS_Entry_Struct_t *const entry, void *const context)
+{
+    (*(uint32_t *)context)++;
+    APP_Print("%-10u %s%s\n", entry->fileSize, path, (0 != (entry->attributes & FATFS_ATTRIBUTE_DIRECTORY)) ? "/" : "");
+
+    return true;
+}
+
+static int APP_CommandFind(const int argc, char *const argv[])
+{
+    int exitCode = 1;        /*return value */
+    uint32_t sumThread = 0;  /*0 : one thread per CPU*/
+    uint32_t sumMatch = 0;
+    bool status = true;
+    int argument = 0;
+
+    for (argument = 2; (true == status) && (argument < argc); argument++)
+    {
+        if ((0 == strcmp(argv[argument], "--threads")) && ((argument + 1) < argc))
+        {
+            argument++;
+            sumThread = strtoul(argv[argument], NULL, 0);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    if (true == status)
+    {
+        if (true == FATFS_Init((const uint8_t *)argv[0]))
+        {
+            if (false == FATFS_Find(0, (const uint8_t *)argv[1], sumThread, APP_PrintMatch, &sumMatch))
+            {
+                printf("Invalid pattern %s\n", argv[1]);
+            }
+            APP_Flush();
+            FATFS_DeInit();
+            if (0 != sumMatch)
+            {
+                exitCode = 0;
+            }
+        }
+        else
+        {
+            printf("Can not open FAT file\n");
+        }
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandHash(const int argc, char *const argv[])
+{
+    int exitCode = 0; /*return value */
+    uint8_t path[APP_PATH_MAX];
+    char digest[CHECKSUM_SHA256_SIZE * 2u + 1u];
+    TABLE_Table_Struct_t table;
+    TABLE_Filter_Struct_t filter;
+    HASH_Digest_Struct_t *digests = NULL;
+    uint32_t *rows = NULL;
+    uint32_t algorithms = HASH_ALGORITHM_SHA256;
+    uint32_t sumThread = 0; /*0 : one thread per CPU*/
+    uint32_t sumSelected = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    bool status = true;
+    int argument = 0;
+
+    for (argument = 1; (true == status) && (argument < argc); argument++)
+    {
+        if (0 == strcmp(argv[argument], "--crc32c"))
+        {
+            algorithms = HASH_ALGORITHM_CRC32C;
+        }
+        else if ((0 == strcmp(argv[argument], "--threads")) && ((argument + 1) < argc))
+        {
+            argument++;
+            sumThread = strtoul(argv[argument], NULL, 0);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    if ((true == status) && (false == FATFS_Init((const uint8_t *)argv[0])))
+    {
+        printf("Can not open FAT file\n");
+        status = false;
+    }
+    if (true == status)
+    {
+        status = TABLE_Build(&table);
+        if (true == status)
+        {
+            rows = (uint32_t *)malloc((size_t)table.sumRow * sizeof(uint32_t));
+            digests = (HASH_Digest_Struct_t *)malloc((size_t)table.sumRow * sizeof(HASH_Digest_Struct_t));
+            status = (NULL != rows) && (NULL != digests);
+        }
+        if (true == status)
+        {
+            TABLE_InitFilter(&filter);
+            filter.attributesMask = FATFS_ATTRIBUTE_DIRECTORY;
+            filter.attributesValue = 0;
+            sumSelected = TABLE_Select(&table, &filter, rows);
+            status = HASH_Files(&table, rows, sumSelected, algorithms, sumThread, digests);
+
+            /*Manifest in directory order*/
+            for (i = 0; i < sumSelected; i++)
+            {
+                TABLE_GetPath(&table, rows[i], path, sizeof(path));
+                if (false == digests[rows[i]].isValid)
+                {
+                    APP_Print("%-64s  %s\n", "ERROR", path);
+                }
+                else if (HASH_ALGORITHM_CRC32C == algorithms)
+                {
+                    APP_Print("%08x  %s\n", digests[rows[i]].crc32c, path);
+                }
+                else
+                {
+                    for (j = 0; j < CHECKSUM_SHA256_SIZE; j++)
+                    {
+                        snprintf(&digest[2u * j], 3u, "%02x", digests[rows[i]].sha256[j]);
+                    }
+                    APP_Print("%s  %s\n", digest, path);
+                }
+            }
+            APP_Flush();
+        }
+        free(digests);
+        free(rows);
+        TABLE_Free(&table);
+        FATFS_DeInit();
+    }
+
+    if (false == status)
+    {
+        exitCode = 1;
+    }
+
+    return exitCode;
+}
+
+static void APP_PrintProblem(const FSCK_Problem_t problem, const uint8_t *const path, const uint32_t cluster, const uint32_t value, void *const context)
+{
+    (void)context;
+    switch (problem)
+    {
+    case FSCK_PROBLEM_CROSS_LINK:
+        APP_Print("%s : cross-linked at cluster %u\n", path, cluster);
+        break;
+    case FSCK_PROBLEM_LOOP:
+        APP_Print("%s : chain loops back to cluster %u\n", path, cluster);
+        break;
+    case FSCK_PROBLEM_BAD_CHAIN:
+        APP_Print("%s : chain broken at cluster %u (next 0x%x)\n", path, cluster, value);
+        break;
+    case FSCK_PROBLEM_SIZE:
+        APP_Print("%s : size does not match chain of %u clusters\n", path, value);
+        break;
+    case FSCK_PROBLEM_LOST:
+        APP_Print("lost chain at cluster %u\n", cluster);
+        break;
+    case FSCK_PROBLEM_FAT_MISMATCH:
+        APP_Print("FAT copy %u differs from sector %u\n", value, cluster);
+        break;
+    default:
+        break;
+    }
+}
+
+static int APP_CommandFsck(const int argc, char *const argv[])
+{
+    int exitCode = 1;        /*return value */
+    FSCK_Report_Struct_t report;
+    uint32_t sumThread = 0;  /*0 : one thread per CPU*/
+    bool status = true;
+    int argument = 0;
+
+    for (argument = 1; (true == status) && (argument < argc); argument++)
+    {
+        if ((0 == strcmp(argv[argument], "--threads")) && ((argument + 1) < argc))
+        {
+            argument++;
+            sumThread = strtoul(argv[argument], NULL, 0);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    if ((true == status) && (false == FATFS_Init((const uint8_t *)argv[0])))
+    {
+        printf("Can not open FAT file\n");
+        status = false;
+    }
+    if (true == status)
+    {
+        if (true == FSCK_Check(sumThread, &report, APP_PrintProblem, NULL))
+        {
+            APP_Print("%u files, %u folders, %u clusters used\n", report.sumFile, report.sumFolder, report.sumClusterUsed);
+            APP_Print("%u cross-linked, %u loops, %u broken chains, %u size mismatches\n", report.sumCrossLink, report.sumLoop, report.sumBadChain, report.sumSizeMismatch);
+            APP_Print("%u lost clusters in %u chains, %u FAT sectors differ\n", report.sumLostCluster, report.sumLostChain, report.sumFatMismatchSector);
+            if ((0 == report.sumCrossLink) && (0 == report.sumLoop) && (0 == report.sumBadChain) && (0 == report.sumSizeMismatch) && (0 == report.sumLostCluster) &&
+                (0 == report.sumFatMismatchSector))
+            {
+                exitCode = 0;
+            }
+        }
+        else
+        {
+            APP_Print("Check failed\n");
+        }
+        APP_Flush();
+        FATFS_DeInit();
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandDf(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    FATFS_Stats_Struct_t stats;
+    bool scanFat = (2 <= argc) && (0 == strcmp(argv[1], "--scan"));
+
+    if (true == FATFS_Init((const uint8_t *)argv[0]))
+    {
+        if (true == FATFS_GetStats(&stats, scanFat))
+        {
+            printf("Cluster size : %u bytes\n", stats.bytePerCluster);
+            printf("Total        : %u clusters (%llu bytes)\n", stats.totalClusters, (unsigned long long)stats.totalClusters * stats.bytePerCluster);
+            printf("Used         : %u clusters (%llu bytes)\n", stats.usedClusters, (unsigned long long)stats.usedClusters * stats.bytePerCluster);
+            printf("Free         : %u clusters (%llu bytes)%s\n", stats.freeClusters, (unsigned long long)stats.freeClusters * stats.bytePerCluster,
+                   (true == stats.isFromFsInfo) ? " from FSInfo" : "");
+            if (FATFS_STATS_UNKNOWN != stats.badClusters)
+            {
+                printf("Bad          : %u clusters\n", stats.badClusters);
+                printf("Largest free : %u clusters\n", stats.largestFreeRun);
+            }
+            if (FATFS_STATS_UNKNOWN != stats.nextFreeCluster)
+            {
+                printf("Next free    : cluster %u\n", stats.nextFreeCluster);
+            }
+            exitCode = 0;
+        }
+        FATFS_DeInit();
+    }
+    else
+    {
+        printf("Can not open FAT file\n");
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandFrag(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    static const char *const bucketName[FRAG_HISTOGRAM_SIZE] = {"1", "2", "3-4", "5-8", "9-16", "17-32", "33-64", ">64"};
+    uint8_t path[APP_PATH_MAX];
+    TABLE_Table_Struct_t table;
+    FRAG_Report_Struct_t report;
+    FRAG_File_Struct_t *worst = NULL;
+    uint32_t sumWorst = 0;
+    uint32_t maxWorst = 20;
+    uint32_t sumThread = 0; /*0 : one thread per CPU*/
+    uint32_t i = 0;
+    bool status = true;
+    int argument = 0;
+
+    for (argument = 1; (true == status) && (argument < argc); argument++)
+    {
+        if ((0 == strcmp(argv[argument], "--top")) && ((argument + 1) < argc))
+        {
+            argument++;
+            maxWorst = strtoul(argv[argument], NULL, 0);
+        }
+        else if ((0 == strcmp(argv[argument], "--threads")) && ((argument + 1) < argc))
+        {
+            argument++;
+            sumThread = strtoul(argv[argument], NULL, 0);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    if ((true == status) && (false == FATFS_Init((const uint8_t *)argv[0])))
+    {
+        printf("Can not open FAT file\n");
+        status = false;
+    }
+    if (true == status)
+    {
+        if ((true == TABLE_Build(&table)) && (true == FRAG_Analyze(&table, sumThread, &report)))
+        {
+            APP_Print("Entries with clusters : %u, fragmented : %u (%.1f%%)\n", report.sumEntry, report.sumFragmented,
+                      (0 != report.sumEntry) ? (100.0 * report.sumFragmented / report.sumEntry) : 0.0);
+            APP_Print("Extents : %llu, average run : %.1f clusters\n", (unsigned long long)report.sumExtent,
+                      (0 != report.sumExtent) ? ((double)report.sumCluster / report.sumExtent) : 0.0);
+            if (0 != report.sumLooping)
+            {
+                APP_Print("Looping chains (not counted, see fsck) : %u\n", report.sumLooping);
+            }
+            if (0 != report.sumTooLong)
+            {
+                APP_Print("Chains longer than the size of the file (counted up to the size, see fsck) : %u\n", report.sumTooLong);
+            }
+            APP_Print("\n%-8s%s\n", "Extents", "Entries");
+            for (i = 0; i < FRAG_HISTOGRAM_SIZE; i++)
+            {
+                APP_Print("%-8s%u\n", bucketName[i], report.histogram[i]);
+            }
+
+            worst = (FRAG_File_Struct_t *)malloc(((size_t)maxWorst + 1u) * sizeof(FRAG_File_Struct_t));
+            if (NULL != worst)
+            {
+                sumWorst = FRAG_GetWorst(&report, worst, maxWorst);
+            }
+            if (0 != sumWorst)
+            {
+                APP_Print("\n%-10s%-10s%-12s%s\n", "Extents", "Clusters", "Avg run", "Path");
+            }
+            for (i = 0; i < sumWorst; i++)
+            {
+                TABLE_GetPath(&table, worst[i].row, path, sizeof(path));
+                APP_Print("%-10u%-10u%-12.1f%s%s\n", worst[i].sumExtent, worst[i].sumCluster, (double)worst[i].sumCluster / worst[i].sumExtent, path,
+                          (0 != (table.attributes[worst[i].row] & FATFS_ATTRIBUTE_DIRECTORY)) ? "/" : "");
+            }
+            APP_Flush();
+            free(worst);
+            FRAG_Free(&report);
+            exitCode = 0;
+        }
+        TABLE_Free(&table);
+        FATFS_DeInit();
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandDefrag(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+
+    (void)argc;
+    if (true == FATFS_Init((const uint8_t *)argv[0]))
+    {
+        if (true == DEFRAG_Rewrite((const uint8_t *)argv[0], (const uint8_t *)argv[1]))
+        {
+            printf("Wrote %s\n", argv[1]);
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not write %s (run fsck on the image)\n", argv[1]);
+        }
+        FATFS_DeInit();
+    }
+    else
+    {
+        printf("Can not open FAT file\n");
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandPut(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    FILE *file = NULL;
+    uint8_t *buffer = NULL;
+    size_t sizeOfRead = 0;
+    long sizeOfFile = 0;
+    bool status = true;
+    int i = 0;
+    char indexPath[APP_PATH_MAX];
+
+    buffer = (uint8_t *)malloc(APP_PUT_CHUNK_SIZE);
+    if ((NULL != buffer) && (true == FATFS_InitWritable((const uint8_t *)argv[0])))
+    {
+        /*All files share one mount : the FAT and folders are written once, at the end*/
+        for (i = 1; (true == status) && ((i + 1) < argc); i += 2)
+        {
+            file = fopen(argv[i + 1], "rb");
+            status = (NULL != file) && ((true == FATFS_CreateFile((const uint8_t *)argv[i])) || (true == FATFS_TruncateFile((const uint8_t *)argv[i], 0)));
+            /*The size of the host file is the hint : the whole file gets one run of clusters when the volume has one*/
+            if ((true == status) && (0 == fseek(file, 0, SEEK_END)))
+            {
+                sizeOfFile = ftell(file);
+                status = (0 <= sizeOfFile) && (0xffffffffL >= sizeOfFile) && (true == FATFS_PreallocateFile((const uint8_t *)argv[i], (uint32_t)sizeOfFile)) &&
+                         (0 == fseek(file, 0, SEEK_SET));
+            }
+            while ((true == status) && (0 != (sizeOfRead = fread(buffer, 1, APP_PUT_CHUNK_SIZE, file))))
+            {
+                status = FATFS_AppendFile((const uint8_t *)argv[i], buffer, (uint32_t)sizeOfRead);
+            }
+            if (NULL != file)
+            {
+                fclose(file);
+            }
+            if (false == status)
+            {
+                printf("Can not copy %s to %s\n", argv[i + 1], argv[i]);
+            }
+        }
+        if ((true == status) && (true == FATFS_Flush()))
+        {
+            exitCode = 0;
+        }
+        FATFS_DeInit();
+        /*The folders changed : the index is out of date*/
+        APP_GetIndexPath(argv[0], indexPath);
+        remove(indexPath);
+    }
+    else
+    {
+        printf("Can not open FAT file\n");
+    }
+    free(buffer);
+
+    return exitCode;
+}
+
+static int APP_CommandChange(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    const char *command = argv[-1];
+    const char *path = NULL; /*Last path changed*/
+    bool status = true;
+    int i = 0;
+    char indexPath[APP_PATH_MAX];
+
+    if (true == FATFS_InitWritable((const uint8_t *)argv[0]))
+    {
+        for (i = 1; (true == status) && (i < argc); i++)
+        {
+            path = argv[i];
+            if (0 == strcmp(command, "mkdir"))
+            {
+                status = FATFS_CreateDirectory((const uint8_t *)argv[i]);
+            }
+            else if (0 == strcmp(command, "rm"))
+            {
+                status = FATFS_DeleteFile((const uint8_t *)argv[i]);
+            }
+            else if (0 == strcmp(command, "rmdir"))
+            {
+                status = FATFS_RemoveDirectory((const uint8_t *)argv[i]);
+            }
+            else
+            {
+                status = FATFS_TruncateFile((const uint8_t *)argv[i], (uint32_t)strtoul(argv[i + 1], NULL, 0));
+                break; /*truncate <image> <path> <size>*/
+            }
+        }
+        if (false == status)
+        {
+            printf("Can not %s %s\n", command, path);
+        }
+        if ((true == FATFS_Flush()) && (true == status))
+        {
+            exitCode = 0;
+        }
+        FATFS_DeInit();
+        /*The folders changed : the index is out of date*/
+        APP_GetIndexPath(argv[0], indexPath);
+        remove(indexPath);
+    }
+    else
+    {
+        printf("Can not open FAT file\n");
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandMkfs(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    MKFS_Options_Struct_t options;
+    uint64_t sizeOfCluster = 0;
+    bool status = true;
+    int argument = 0;
+
+    MKFS_InitOptions(&options, APP_ParseSize(argv[1]));
+    status = (0 != options.sizeOfVolume);
+    if (false == status)
+    {
+        printf("Invalid size %s\n", argv[1]);
+    }
+    for (argument = 2; (true == status) && (argument < argc); argument++)
+    {
+        if ((0 == strcmp(argv[argument], "--fat")) && ((argument + 1) < argc))
+        {
+            argument++;
+            options.fatType = (uint8_t)strtoul(argv[argument], NULL, 0);
+        }
+        else if ((0 == strcmp(argv[argument], "--cluster")) && ((argument + 1) < argc))
+        {
+            argument++;
+            sizeOfCluster = APP_ParseSize(argv[argument]);
+        }
+        else if ((0 == strcmp(argv[argument], "--sector")) && ((argument + 1) < argc))
+        {
+            argument++;
+            options.bytePerSector = (uint16_t)strtoul(argv[argument], NULL, 0);
+        }
+        else if ((0 == strcmp(argv[argument], "--label")) && ((argument + 1) < argc))
+        {
+            argument++;
+            strncpy((char *)options.label, argv[argument], sizeof(options.label) - 1u);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+    if ((true == status) && (0 != sizeOfCluster))
+    {
+        /*The cluster size is given in bytes, the boot sector counts it in sectors*/
+        status = (0 != options.bytePerSector) && (0 == (sizeOfCluster % options.bytePerSector)) && (128u >= (sizeOfCluster / options.bytePerSector));
+        options.sectorPerCluster = (true == status) ? (uint8_t)(sizeOfCluster / options.bytePerSector) : 0;
+    }
+
+    if (true == status)
+    {
+        if (true == MKFS_Format((const uint8_t *)argv[0], &options))
+        {
+            printf("Wrote %s\n", argv[0]);
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not create %s (the size does not fit the FAT type or the cluster size)\n", argv[0]);
+        }
+    }
+    else
+    {
+        printf("Usage : mkfs <image> <size> [--fat 12|16|32] [--cluster BYTES] [--sector BYTES] [--label NAME]\n");
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandCompact(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    COMPACT_Report_Struct_t report;
+
+    (void)argc;
+    if (true == FATFS_Init((const uint8_t *)argv[0]))
+    {
+        if (true == COMPACT_PunchFreeClusters((const uint8_t *)argv[0], &report))
+        {
+            printf("Punched %llu bytes in %u runs, disk used : %llu -> %llu bytes\n", (unsigned long long)report.sumBytePunched, report.sumRun,
+                   (unsigned long long)report.sizeBefore, (unsigned long long)report.sizeAfter);
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not punch holes in %s (the host file system may not support it)\n", argv[0]);
+        }
+        FATFS_DeInit();
+    }
+    else
+    {
+        printf("Can not open FAT file\n");
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandCompress(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    uint64_t sizeOfBlock = ZIMAGE_BLOCK_DEFAULT;
+    int level = 6;
+    bool status = true;
+    int argument = 0;
+
+    for (argument = 2; (true == status) && (argument < argc); argument++)
+    {
+        if ((0 == strcmp(argv[argument], "--block")) && ((argument + 1) < argc))
+        {
+            argument++;
+            sizeOfBlock = APP_ParseSize(argv[argument]);
+            status = (ZIMAGE_BLOCK_MIN <= sizeOfBlock) && (sizeOfBlock <= ZIMAGE_BLOCK_MAX);
+        }
+        else if ((0 == strcmp(argv[argument], "--level")) && ((argument + 1) < argc))
+        {
+            argument++;
+            level = (int)strtol(argv[argument], NULL, 0);
+            status = (1 <= level) && (level <= 9);
+        }
+        else
+        {
+            status = false;
+        }
+        if (false == status)
+        {
+            printf("Invalid option %s\n", argv[argument]);
+        }
+    }
+
+    if (true == status)
+    {
+        if (true == ZIMAGE_Convert((const uint8_t *)argv[0], (const uint8_t *)argv[1], (uint32_t)sizeOfBlock, level))
+        {
+            printf("Wrote %s\n", argv[1]);
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not compress %s to %s\n", argv[0], argv[1]);
+        }
+    }
+    else
+    {
+        printf("Usage : compress <image> <output> [--block BYTES] [--level 1-9]\n");
+    }
+
+    return exitCode;
+}
+
+static bool APP_PrintCandidate(const RECOVER_Candidate_Struct_t *const candidate, void *const context)
+{
+    const char *folder = (const char *)context;
+    char path[APP_PATH_MAX];
+    const char *state = ((0 != candidate->sumCluster) && (0 == candidate->sumExtent)) ? " (lost)" : ""; /*Data needed but not found*/
+
+    if ((NULL != folder) && (0 == (candidate->attributes & FATFS_ATTRIBUTE_DIRECTORY)) && ((0 != candidate->sumExtent) || (0 == candidate->fileSize)))
+    {
+        /*The first cluster keeps the names unique*/
+        snprintf(path, sizeof(path), "%s/%u_%s", folder, candidate->firstCluster, candidate->name);
+        state = (true == RECOVER_Extract(candidate, (const uint8_t *)path)) ? " (extracted)" : " (write error)";
+    }
+    APP_Print("%s %-10u %-10u %-7u %s%s%s\n", (true == candidate->isDeleted) ? "deleted" : "orphan ", candidate->firstCluster, candidate->fileSize,
+              candidate->sumExtent, candidate->name, (0 != (candidate->attributes & FATFS_ATTRIBUTE_DIRECTORY)) ? "/" : "", state);
+
+    return true;
+}
+
+static int APP_CommandRecover(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    RECOVER_Report_Struct_t report;
+    const char *folder = NULL;
+    bool status = true;
+    int argument = 0;
+
+    for (argument = 1; (true == status) && (argument < argc); argument++)
+    {
+        if ((0 == strcmp(argv[argument], "--extract")) && ((argument + 1) < argc))
+        {
+            argument++;
+            folder = argv[argument];
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    if ((true == status) && (true == FATFS_Init((const uint8_t *)argv[0])))
+    {
+        APP_Print("state   cluster    size       extents name\n");
+        status = RECOVER_Scan(APP_PrintCandidate, (void *)folder, &report);
+        APP_Print("Read %llu bytes, %u folder clusters (%u orphaned), %u candidates\n", (unsigned long long)report.sumByteRead, report.sumFolderCluster,
+                  report.sumOrphanCluster, report.sumCandidate);
+        APP_Flush();
+        if (true == status)
+        {
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not read the image\n");
+        }
+        FATFS_DeInit();
+    }
+    else if (true == status)
+    {
+        printf("Can not open FAT file\n");
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandBench(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    BENCH_Shape_Struct_t shape;
+    uint64_t sizeOfCluster = 0;
+    uint32_t sumIteration = 5;
+    bool isGenerated = false;
+    bool status = true;
+    int argument = 0;
+
+    BENCH_InitShape(&shape);
+    for (argument = 1; (true == status) && (argument < argc); argument++)
+    {
+        if (0 == strcmp(argv[argument], "--generate"))
+        {
+            isGenerated = true;
+        }
+        else if (0 == strcmp(argv[argument], "--long-names"))
+        {
+            shape.isLongName = true;
+        }
+        else if ((argument + 1) >= argc)
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+        else if (0 == strcmp(argv[argument], "--fat"))
+        {
+            shape.volume.fatType = (uint8_t)strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--size"))
+        {
+            shape.volume.sizeOfVolume = APP_ParseSize(argv[++argument]);
+        }
+        else if (0 == strcmp(argv[argument], "--cluster"))
+        {
+            sizeOfCluster = APP_ParseSize(argv[++argument]);
+            shape.volume.sectorPerCluster = (uint8_t)(((sizeOfCluster / shape.volume.bytePerSector) <= 128u) ? (sizeOfCluster / shape.volume.bytePerSector) : 0);
+        }
+        else if (0 == strcmp(argv[argument], "--files"))
+        {
+            shape.sumFile = strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--depth"))
+        {
+            shape.depth = strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--width"))
+        {
+            shape.width = strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--file-size"))
+        {
+            shape.sizeOfFile = (uint32_t)APP_ParseSize(argv[++argument]);
+        }
+        else if (0 == strcmp(argv[argument], "--fragments"))
+        {
+            shape.sumFragment = strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--seed"))
+        {
+            shape.seed = strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--iterations"))
+        {
+            sumIteration = strtoul(argv[++argument], NULL, 0);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    if ((true == status) && (true == isGenerated) && (false == BENCH_Generate((const uint8_t *)argv[0], &shape)))
+    {
+        printf("Can not generate %s (the files may not fit the size)\n", argv[0]);
+        status = false;
+    }
+    if (true == status)
+    {
+        if (true == BENCH_Run((const uint8_t *)argv[0], (true == isGenerated) ? &shape : NULL, sumIteration))
+        {
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not benchmark %s\n", argv[0]);
+        }
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandMicrobench(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    uint8_t fatType = 32;
+    uint32_t sumFile = 0;
+    uint32_t sumIteration = 20;
+    bool status = true;
+    int argument = 0;
+
+    /*No image : the arguments start with the options*/
+    for (argument = 0; (true == status) && (argument < argc); argument++)
+    {
+        if ((argument + 1) >= argc)
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+        else if (0 == strcmp(argv[argument], "--fat"))
+        {
+            fatType = (uint8_t)strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--files"))
+        {
+            sumFile = strtoul(argv[++argument], NULL, 0);
+        }
+        else if (0 == strcmp(argv[argument], "--iterations"))
+        {
+            sumIteration = strtoul(argv[++argument], NULL, 0);
+        }
+        else
+        {
+            printf("Invalid option %s\n", argv[argument]);
+            status = false;
+        }
+    }
+
+    if (0 == sumFile)
+    {
+        /*The 4 MiB image of fat 12 holds about 200 files of 16 KiB*/
+        sumFile = (12u == fatType) ? 150u : 2000u;
+    }
+    if (true == status)
+    {
+        if (true == MICRO_Run(fatType, sumFile, sumIteration))
+        {
+            exitCode = 0;
+        }
+        else
+        {
+            printf("Can not run the micro benchmarks (the files may not fit the image)\n");
+        }
+    }
+
+    return exitCode;
+}
+
+static int APP_CommandServe(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+
+    (void)argc;
+    if (true == SERVER_Run((const uint8_t *)argv[0], (const uint8_t *)argv[1]))
+    {
+        exitCode = 0;
+    }
+    else
+    {
+        printf("Can not serve %s on %s\n", argv[0], argv[1]);
+    }
+
+    return exitCode;
+}
+
+static bool APP_PrintRemoteEntry(const char *const line, void *const context)
+{
+    unsigned int attributes = 0;
+    unsigned int fileSize = 0;
+    unsigned int firstCluster = 0;
+    int name = 0;
+
+    if (3 > sscanf(line, "ENTRY %x %u %u %n", &attributes, &fileSize, &firstCluster, &name) || (0 == name))
+    {
+        APP_Print("%s\n", line); /*ERROR line*/
+    }
+    else if (true == *(const bool *)context)
+    {
+        APP_Print("Name     : %s\nType     : %s\nSize     : %u\nCluster  : %u\n", &line[name],
+                  (0 != (attributes & FATFS_ATTRIBUTE_DIRECTORY)) ? "Folder" : "File", fileSize, firstCluster);
+    }
+    else
+    {
+        APP_Print("%-10s %10u  %s\n", (0 != (attributes & FATFS_ATTRIBUTE_DIRECTORY)) ? "<DIR>" : "", fileSize, &line[name]);
+    }
+
+    return true;
+}
+
+static int APP_CommandRemote(const int argc, char *const argv[])
+{
+    int exitCode = 1; /*return value */
+    char request[APP_PATH_MAX];
+    int connection = -1;
+    int imageDescriptor = -1;
+    uint32_t sizeOfCluster = 0;
+    bool isStat = false;
+    bool status = true;
+
+    (void)argc;
+    status = (0 == strcmp(argv[1], "ls")) || (0 == strcmp(argv[1], "stat")) || (0 == strcmp(argv[1], "cat"));
+    if (false == status)
+    {
+        printf("Invalid request %s\n", argv[1]);
+    }
+    else
+    {
+        connection = SERVER_Connect((const uint8_t *)argv[0], &imageDescriptor, &sizeOfCluster);
+        status = (0 <= connection);
+        if (false == status)
+        {
+            printf("Can not connect to %s\n", argv[0]);
+        }
+    }
+
+    if (true == status)
+    {
+        if (0 == strcmp(argv[1], "cat"))
+        {
+            status = SERVER_ReadFile(connection, imageDescriptor, (const uint8_t *)argv[2], APP_WriteData, NULL);
+        }
+        else
+        {
+            isStat = (0 == strcmp(argv[1], "stat"));
+            snprintf(request, sizeof(request), "%s %s", (true == isStat) ? "STAT" : "LIST", argv[2]);
+            status = SERVER_Request(connection, request, APP_PrintRemoteEntry, &isStat);
+            APP_Flush();
+        }
+        if (false == status)
+        {
+            fflush(stdout);
+            fprintf(stderr, "%s : can not %s\n", argv[2], argv[1]);
+        }
+        SERVER_Disconnect(connection, imageDescriptor);
+    }
+    exitCode = (true == status) ? 0 : 1;
+
+    return exitCode;
+}
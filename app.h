@@ -11,4 +11,12 @@
  */
 void APP_MainMenu(void);
 
+/**  APP_CommandLine
+ * @brief      Run a command given on the command line ("fat <command> <image> ...")
+ * @param[in] argc  Number of arguments
+ * @param[in] argv  Arguments
+ * @return int Returns 0 if success (exit code of the program)
+ */
+int APP_CommandLine(const int argc, char *const argv[]);
+
 #endif /*__APP_H__*/
@@ -0,0 +1,395 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hal.h"
+#include "fatfs.h"
+#include "stats.h"
+#include "async.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *States of a request
+ */
+#define ASYNC_STATE_START (0u) /*Folder : open the iterator. File : find the cluster of the offset (no read)*/
+#define ASYNC_STATE_READ (1u)  /*Folder : parse one block. File : read one contiguous run*/
+
+#define ASYNC_FIRST_MAX_ENTRY (16u) /*Entries allocated for a folder before growing*/
+
+/*
+ *FIFO of requests (linked by next)
+ */
+typedef struct
+{
+    ASYNC_Request_Struct_t *head;
+    ASYNC_Request_Struct_t *tail;
+} ASYNC_Queue_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static pthread_t *s_Threads = NULL;
+static uint32_t s_SumThread = 0;
+static bool s_IsStopping = false;
+
+static pthread_mutex_t s_Lock = PTHREAD_MUTEX_INITIALIZER; /*Protects the queues and the counts*/
+static pthread_cond_t s_Work = PTHREAD_COND_INITIALIZER;   /*A request is waiting for a thread*/
+static pthread_cond_t s_Done = PTHREAD_COND_INITIALIZER;   /*A request completed*/
+
+static ASYNC_Queue_Struct_t s_Pending = {NULL, NULL};   /*Requests waiting for their next step*/
+static ASYNC_Queue_Struct_t s_Completed = {NULL, NULL}; /*Completed requests waiting for ASYNC_Poll*/
+
+static uint32_t s_SumRunning = 0; /*Requests submitted and not completed*/
+static uint32_t s_SumWaiting = 0; /*Requests without callback submitted and not polled*/
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  ASYNC_Push
+ * @brief Add a request at the end of a queue (the lock is held)
+ * @param[in,out] queue   Queue
+ * @param[in,out] request   Request
+ * @return none
+ */
+static void ASYNC_Push(ASYNC_Queue_Struct_t *const queue, ASYNC_Request_Struct_t *const request);
+
+/**  ASYNC_Pop
+ * @brief Take the first request of a queue (the lock is held)
+ * @param[in,out] queue   Queue
+ * @return ASYNC_Request_Struct_t* Returns the request or NULL if the queue is empty
+ */
+static ASYNC_Request_Struct_t *ASYNC_Pop(ASYNC_Queue_Struct_t *const queue);
+
+/**  ASYNC_Step
+ * @brief Advance a request by one state (at most one read)
+ * @param[in,out] request   Request
+ * @param[in] scratch   Buffer of the thread for reads not aligned on the range
+ * @param[in] sizeOfScratch   Size of scratch
+ * @return bool Returns true when the request is done (request->status is set)
+ */
+static bool ASYNC_Step(ASYNC_Request_Struct_t *const request, uint8_t *const scratch, const uint32_t sizeOfScratch);
+
+/**  ASYNC_Worker
+ * @brief Thread : take requests in turn and advance them by one step
+ * @param[in] argument   unused
+ * @return void* Returns NULL
+ */
+static void *ASYNC_Worker(void *argument);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool ASYNC_Init(const uint32_t sumThread)
+{
+    const uint32_t sumWanted = (0 != sumThread) ? sumThread : 1u;
+
+    if (NULL == s_Threads)
+    {
+        s_IsStopping = false;
+        s_Threads = (pthread_t *)STATS_Malloc(sumWanted * sizeof(pthread_t));
+        for (s_SumThread = 0; (NULL != s_Threads) && (s_SumThread < sumWanted); s_SumThread++)
+        {
+            if (0 != pthread_create(&s_Threads[s_SumThread], NULL, ASYNC_Worker, NULL))
+            {
+                break; /*Run with the threads started*/
+            }
+        }
+        if ((NULL != s_Threads) && (0 == s_SumThread))
+        {
+            free(s_Threads);
+            s_Threads = NULL;
+        }
+    }
+
+    return (NULL != s_Threads);
+}
+
+bool ASYNC_Submit(ASYNC_Request_Struct_t *const request)
+{
+    bool status = (NULL != s_Threads); /*return value */
+
+    if (true == status)
+    {
+        request->status = false;
+        request->sizeRead = 0;
+        request->entries = NULL;
+        request->sumEntry = 0;
+        request->state = ASYNC_STATE_START;
+        request->sizeDone = 0;
+        request->maxEntry = 0;
+        request->begin = STATS_Begin();
+        request->next = NULL;
+
+        pthread_mutex_lock(&s_Lock);
+        s_SumRunning++;
+        s_SumWaiting += (NULL == request->callback) ? 1u : 0u;
+        ASYNC_Push(&s_Pending, request);
+        pthread_cond_signal(&s_Work);
+        pthread_mutex_unlock(&s_Lock);
+    }
+
+    return status;
+}
+
+ASYNC_Request_Struct_t *ASYNC_Poll(const bool isWait)
+{
+    ASYNC_Request_Struct_t *request = NULL; /*return value */
+
+    pthread_mutex_lock(&s_Lock);
+    while ((true == isWait) && (NULL == s_Completed.head) && (0 != s_SumWaiting))
+    {
+        pthread_cond_wait(&s_Done, &s_Lock);
+    }
+    request = ASYNC_Pop(&s_Completed);
+    s_SumWaiting -= (NULL != request) ? 1u : 0u;
+    pthread_mutex_unlock(&s_Lock);
+
+    return request;
+}
+
+void ASYNC_Release(ASYNC_Request_Struct_t *const request)
+{
+    free(request->entries);
+    request->entries = NULL;
+    request->sumEntry = 0;
+    request->maxEntry = 0;
+}
+
+void ASYNC_DeInit(void)
+{
+    uint32_t i = 0;
+
+    if (NULL != s_Threads)
+    {
+        pthread_mutex_lock(&s_Lock);
+        while (0 != s_SumRunning)
+        {
+            pthread_cond_wait(&s_Done, &s_Lock);
+        }
+        s_IsStopping = true;
+        pthread_cond_broadcast(&s_Work);
+        pthread_mutex_unlock(&s_Lock);
+        for (i = 0; i < s_SumThread; i++)
+        {
+            pthread_join(s_Threads[i], NULL);
+        }
+        free(s_Threads);
+        s_Threads = NULL;
+        s_SumThread = 0;
+    }
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void ASYNC_Push(ASYNC_Queue_Struct_t *const queue, ASYNC_Request_Struct_t *const request)
+{
+    request->next = NULL;
+    if (NULL == queue->tail)
+    {
+        queue->head = request;
+    }
+    else
+    {
+        queue->tail->next = request;
+    }
+    queue->tail = request;
+}
+
+static ASYNC_Request_Struct_t *ASYNC_Pop(ASYNC_Queue_Struct_t *const queue)
+{
+    ASYNC_Request_Struct_t *request = queue->head; /*return value */
+
+    if (NULL != request)
+    {
+        queue->head = request->next;
+        if (NULL == queue->head)
+        {
+            queue->tail = NULL;
+        }
+        request->next = NULL;
+    }
+
+    return request;
+}
+
+static bool ASYNC_Step(ASYNC_Request_Struct_t *const request, uint8_t *const scratch, const uint32_t sizeOfScratch)
+{
+    bool isDone = false; /*return value */
+    FATFS_VolumeInfo_Struct_t info;
+    const FATFS_Entry_Struct_t *entry = NULL;
+    FATFS_Entry_Struct_t *grown = NULL;
+    uint32_t sizeOfCluster = 0;
+    uint32_t inCluster = 0;   /*Offset of the range in the first cluster of the run*/
+    uint32_t startCluster = 0;
+    uint32_t sumCluster = 0;
+    uint32_t nextCluster = 0;
+    uint32_t sizeOfRun = 0;
+    uint32_t sizeToCopy = 0;
+    uint8_t *target = NULL;
+    uint32_t i = 0;
+
+    FATFS_GetVolumeInfo(&info);
+    sizeOfCluster = (uint32_t)info.bytePerSector * info.sectorPerCluster;
+
+    if (ASYNC_READ_DIRECTORY == request->type)
+    {
+        if (ASYNC_STATE_START == request->state)
+        {
+            request->status = FATFS_DirOpen(&request->dir, request->firstCluster);
+            request->state = ASYNC_STATE_READ;
+            isDone = (false == request->status);
+        }
+        else
+        {
+            /*Entries of one block : the next call of FATFS_DirNext would read*/
+            do
+            {
+                entry = FATFS_DirNext(&request->dir);
+                if ((NULL != entry) && (request->sumEntry == request->maxEntry))
+                {
+                    request->maxEntry = (0 != request->maxEntry) ? (request->maxEntry * 2u) : ASYNC_FIRST_MAX_ENTRY;
+                    grown = (FATFS_Entry_Struct_t *)STATS_Realloc(request->entries, request->maxEntry * sizeof(FATFS_Entry_Struct_t));
+                    request->status = (NULL != grown);
+                    request->entries = (NULL != grown) ? grown : request->entries;
+                }
+                if ((NULL != entry) && (true == request->status))
+                {
+                    request->entries[request->sumEntry++] = *entry;
+                }
+            } while ((NULL != entry) && (true == request->status) && (request->dir.index < request->dir.sizeOfData));
+            isDone = (NULL == entry) || (false == request->status);
+            if (true == isDone)
+            {
+                FATFS_DirClose(&request->dir);
+            }
+        }
+    }
+    else if (ASYNC_STATE_START == request->state)
+    {
+        /*Follow the chain up to the cluster of the offset : the FAT is in memory*/
+        request->cluster = request->firstCluster;
+        request->status = (0 != sizeOfCluster);
+        for (i = 0; (true == request->status) && (i < (request->offset / sizeOfCluster)); i++)
+        {
+            request->status = FATFS_GetNextCluster(request->cluster, &request->cluster);
+        }
+        request->state = ASYNC_STATE_READ;
+        isDone = (false == request->status) || (0 == request->size);
+    }
+    else
+    {
+        /*One run of contiguous clusters, no more than the range and the scratch buffer*/
+        inCluster = (request->offset + request->sizeDone) % sizeOfCluster;
+        startCluster = request->cluster;
+        sumCluster = 1;
+        nextCluster = startCluster;
+        while (((sumCluster + 1u) * sizeOfCluster <= sizeOfScratch) && ((sumCluster * sizeOfCluster - inCluster) < (request->size - request->sizeDone)) &&
+               (true == FATFS_GetNextCluster(nextCluster, &nextCluster)) && ((startCluster + sumCluster) == nextCluster))
+        {
+            sumCluster++;
+        }
+        sizeOfRun = sumCluster * sizeOfCluster;
+        sizeToCopy = (((sizeOfRun - inCluster) < (request->size - request->sizeDone)) ? (sizeOfRun - inCluster) : (request->size - request->sizeDone));
+
+        /*Straight into the buffer of the caller when the run is aligned on the range and fits*/
+        target = ((0 == inCluster) && (sizeOfRun <= (request->size - request->sizeDone))) ? &request->buffer[request->sizeDone] : scratch;
+        request->status = ((int32_t)sizeOfRun == HAL_ReadMultiSector(info.locationOfData + (startCluster - 2u) * info.sectorPerCluster, sumCluster * info.sectorPerCluster, target));
+        if ((true == request->status) && (scratch == target))
+        {
+            memcpy(&request->buffer[request->sizeDone], &scratch[inCluster], sizeToCopy);
+        }
+        if (true == request->status)
+        {
+            request->sizeDone += sizeToCopy;
+            request->sizeRead = request->sizeDone;
+        }
+        isDone = (false == request->status) || (request->sizeDone == request->size);
+        if (false == isDone)
+        {
+            /*The range goes on : the chain must too*/
+            request->status = FATFS_GetNextCluster(startCluster + sumCluster - 1u, &request->cluster);
+            isDone = (false == request->status);
+        }
+    }
+
+    return isDone;
+}
+
+static void *ASYNC_Worker(void *argument)
+{
+    ASYNC_Request_Struct_t *request = NULL;
+    FATFS_VolumeInfo_Struct_t info;
+    uint8_t *scratch = NULL;
+    uint32_t sizeOfScratch = 0;
+    bool isDone = false;
+
+    (void)argument;
+    FATFS_GetVolumeInfo(&info);
+    sizeOfScratch = (uint32_t)info.bytePerSector * info.sectorPerCluster;
+    sizeOfScratch = (sizeOfScratch < ASYNC_MAX_RUN_BYTE) ? ASYNC_MAX_RUN_BYTE : sizeOfScratch;
+    scratch = (uint8_t *)HAL_AllocBuffer(sizeOfScratch);
+
+    pthread_mutex_lock(&s_Lock);
+    while ((false == s_IsStopping) || (NULL != s_Pending.head))
+    {
+        request = ASYNC_Pop(&s_Pending);
+        if (NULL == request)
+        {
+            pthread_cond_wait(&s_Work, &s_Lock);
+        }
+        else
+        {
+            pthread_mutex_unlock(&s_Lock);
+            if (NULL == scratch)
+            {
+                request->status = false;
+                isDone = true;
+            }
+            else
+            {
+                isDone = ASYNC_Step(request, scratch, sizeOfScratch);
+            }
+
+            if (false == isDone)
+            {
+                /*Back at the end of the queue : every request advances in turn*/
+                pthread_mutex_lock(&s_Lock);
+                ASYNC_Push(&s_Pending, request);
+            }
+            else
+            {
+                STATS_End((ASYNC_READ_DIRECTORY == request->type) ? STATS_OPERATION_READ_DIRECTORY : STATS_OPERATION_FILE_READ, request->begin);
+                if (NULL != request->callback)
+                {
+                    /*The caller may release the request in the callback : it is not used after*/
+                    request->callback(request, request->context);
+                    pthread_mutex_lock(&s_Lock);
+                }
+                else
+                {
+                    pthread_mutex_lock(&s_Lock);
+                    ASYNC_Push(&s_Completed, request);
+                }
+                s_SumRunning--;
+                pthread_cond_broadcast(&s_Done);
+            }
+        }
+    }
+    pthread_mutex_unlock(&s_Lock);
+    free(scratch);
+
+    return NULL;
+}
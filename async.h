@@ -0,0 +1,98 @@
+#ifndef __ASYNC_H__
+#define __ASYNC_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Kinds of request
+ */
+typedef enum
+{
+    ASYNC_READ_DIRECTORY = 0, /*All entries of a folder*/
+    ASYNC_READ_FILE = 1       /*A range of bytes of a file*/
+} ASYNC_Type_t;
+
+/*
+ *Most bytes read by one step of a file request (one contiguous run of clusters)
+ */
+#define ASYNC_MAX_RUN_BYTE (256u * 1024u)
+
+struct __ASYNC_Request_struct_t;
+
+/*
+ *Called on a worker thread when a request is done (instead of queuing it for ASYNC_Poll). It must not block long :
+ *other requests wait for the thread
+ */
+typedef void (*ASYNC_Callback_t)(struct __ASYNC_Request_struct_t *const request, void *const context);
+
+/*
+ *Request, owned by the caller from ASYNC_Submit until it completes. Fields marked "set by async" are only
+ *valid after completion
+ */
+typedef struct __ASYNC_Request_struct_t
+{
+    ASYNC_Type_t type;
+    uint32_t firstCluster;         /*Folder (0 : root) or file*/
+    uint32_t offset;               /*File : first byte of the range*/
+    uint32_t size;                 /*File : bytes wanted (the range must be within the size of file)*/
+    uint8_t *buffer;               /*File : receiver, size bytes*/
+    ASYNC_Callback_t callback;     /*NULL : the request is queued for ASYNC_Poll*/
+    void *context;                 /*Given to callback*/
+
+    bool status;                   /*Set by async : true if the whole request was done*/
+    uint32_t sizeRead;             /*Set by async : file bytes copied to buffer*/
+    FATFS_Entry_Struct_t *entries; /*Set by async : entries of the folder (released by ASYNC_Release)*/
+    uint32_t sumEntry;
+
+    /*State of the request, used by async*/
+    uint8_t state;
+    uint32_t cluster;              /*Next cluster to read*/
+    uint32_t sizeDone;
+    uint32_t maxEntry;
+    uint64_t begin;                /*Time of submit (latency includes the wait in the queue)*/
+    FATFS_Dir_Struct_t dir;
+    struct __ASYNC_Request_struct_t *next;
+} ASYNC_Request_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  ASYNC_Init
+ * @brief Start the worker threads. The volume must be mounted until ASYNC_DeInit and not changed meanwhile
+ * @param[in] sumThread   Number of threads (0 : 1)
+ * @return bool Returns false if no thread could be started
+ */
+bool ASYNC_Init(const uint32_t sumThread);
+
+/**  ASYNC_Submit
+ * @brief Queue a request and return at once. The request advances one read at a time, in turn with the other
+ *        requests, so many requests can be outstanding on few threads
+ * @param[in,out] request   Request (type, clusters, range, buffer, callback set by the caller)
+ * @return bool Returns false if async is not started
+ */
+bool ASYNC_Submit(ASYNC_Request_Struct_t *const request);
+
+/**  ASYNC_Poll
+ * @brief Take a completed request (requests without callback)
+ * @param[in] isWait   true : wait until a request completes (returns NULL only if none is outstanding)
+ * @return ASYNC_Request_Struct_t* Returns the request or NULL
+ */
+ASYNC_Request_Struct_t *ASYNC_Poll(const bool isWait);
+
+/**  ASYNC_Release
+ * @brief Release the entries of a completed folder request
+ * @param[in,out] request   Request
+ * @return none
+ */
+void ASYNC_Release(ASYNC_Request_Struct_t *const request);
+
+/**  ASYNC_DeInit
+ * @brief Wait for every outstanding request and stop the threads
+ * @return none
+ */
+void ASYNC_DeInit(void);
+
+#endif /*__ASYNC_H__*/
@@ -0,0 +1,628 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fatfs.h"
+#include "mkfs.h"
+#include "async.h"
+#include "bench.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Files written in turn when files are fragmented
+ */
+#define BENCH_BATCH (8u)
+
+/*
+ *Random bytes written into files (each file starts at its own offset)
+ */
+#define BENCH_DATA_SIZE (1024u * 1024u)
+
+/*
+ *Longest path of a generated entry, most folders of a generated tree
+ */
+#define BENCH_PATH_SIZE (256u)
+#define BENCH_MAX_FOLDER (100000u)
+
+#define BENCH_SIZE_NAME_OF_CACHE (2u)
+
+/*
+ *Asynchronous reads : threads of async and requests outstanding at once
+ */
+#define BENCH_ASYNC_THREAD (4u)
+#define BENCH_ASYNC_OUTSTANDING (256u)
+
+/*
+ *Benchmarks, in the order they run
+ */
+typedef enum
+{
+    BENCH_MOUNT = 0,
+    BENCH_LIST_ROOT,
+    BENCH_TREE_WALK,
+    BENCH_SEQUENTIAL_READ,
+    BENCH_RANDOM_READ,
+    BENCH_ASYNC_READ,
+    BENCH_SUM_BENCHMARK
+} BENCH_Benchmark_Enum_t;
+
+/*
+ *File found by the walk
+ */
+typedef struct
+{
+    uint32_t firstCluster;
+    uint32_t fileSize;
+} BENCH_File_Struct_t;
+
+/*
+ *Files of the image, in tree order
+ */
+typedef struct
+{
+    BENCH_File_Struct_t *files;
+    uint32_t sumFile;
+    uint32_t maxFile;  /*Size of files*/
+    uint32_t sumEntry; /*Files and folders*/
+} BENCH_Tree_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static const char *const s_NameOfBenchmark[BENCH_SUM_BENCHMARK] = {"mount", "list_root", "tree_walk", "sequential_read", "random_read", "async_read"};
+static const char *const s_NameOfCache[BENCH_SIZE_NAME_OF_CACHE] = {"cold", "warm"};
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  BENCH_Random
+ * @brief Next number of a xorshift generator
+ * @param[in,out] state   State of the generator (not 0)
+ * @return uint32_t Random number
+ */
+static uint32_t BENCH_Random(uint32_t *const state);
+
+/**  BENCH_GetTime
+ * @brief Read the monotonic clock
+ * @return double Time in seconds
+ */
+static double BENCH_GetTime(void);
+
+/**  BENCH_DropCache
+ * @brief Ask the kernel to forget the pages of the image (they are clean, nothing is written)
+ * @param[in] imagePath   Path of the image
+ * @return none
+ */
+static void BENCH_DropCache(const uint8_t *const imagePath);
+
+/**  BENCH_Walk
+ * @brief Read every folder of the mounted volume and list the files
+ * @param[out] tree   Files in tree order (files is grown as needed)
+ * @return bool Returns false if memory is missing
+ */
+static bool BENCH_Walk(BENCH_Tree_Struct_t *const tree);
+
+/**  BENCH_CountData
+ * @brief Count the bytes read (used as FATFS_DataCallback_t)
+ * @param[in] data  chunk of file data
+ * @param[in] size  size of chunk
+ * @param[in,out] context  number of bytes (uint64_t)
+ * @return bool Returns true
+ */
+static bool BENCH_CountData(const uint8_t *const data, const uint32_t size, void *const context);
+
+/**  BENCH_ReadAsync
+ * @brief Read all files in the shuffled order with async, BENCH_ASYNC_OUTSTANDING requests at once
+ * @param[in] tree   Files of the image
+ * @param[in] order   Order of the reads
+ * @param[out] sumItem   Files read
+ * @param[out] sumByte   Bytes of file data read
+ * @return bool Returns false if async could not start or a read failed
+ */
+static bool BENCH_ReadAsync(const BENCH_Tree_Struct_t *const tree, const uint32_t *const order, uint32_t *const sumItem, uint64_t *const sumByte);
+
+/**  BENCH_RunOnce
+ * @brief Run one iteration of a benchmark (the volume is mounted except for BENCH_MOUNT)
+ * @param[in] imagePath   Path of the image
+ * @param[in] benchmark   Benchmark
+ * @param[in] tree   Files of the image
+ * @param[in] order   Order of the random reads
+ * @param[out] sumItem   Entries or files processed
+ * @param[out] sumByte   Bytes of file data read
+ * @return bool Returns false if the benchmark failed
+ */
+static bool BENCH_RunOnce(const uint8_t *const imagePath, const BENCH_Benchmark_Enum_t benchmark, const BENCH_Tree_Struct_t *const tree,
+                          const uint32_t *const order, uint32_t *const sumItem, uint64_t *const sumByte);
+
+/**  BENCH_CompareTime
+ * @brief Order times, shortest first (used by qsort)
+ * @param[in] first time
+ * @param[in] second time
+ * @return int Returns the order
+ */
+static int BENCH_CompareTime(const void *first, const void *second);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+void BENCH_InitShape(BENCH_Shape_Struct_t *const shape)
+{
+    memset(shape, 0, sizeof(BENCH_Shape_Struct_t));
+    MKFS_InitOptions(&shape->volume, 256u * 1024u * 1024u);
+    shape->volume.fatType = 32u;
+    shape->sumFile = 1000u;
+    shape->depth = 2u;
+    shape->width = 4u;
+    shape->sizeOfFile = 64u * 1024u;
+    shape->sumFragment = 1u;
+    shape->seed = 1u;
+}
+
+bool BENCH_Generate(const uint8_t *const imagePath, const BENCH_Shape_Struct_t *const shape)
+{
+    bool status = true; /*return value */
+    char (*folders)[BENCH_PATH_SIZE] = NULL;
+    char (*paths)[BENCH_PATH_SIZE] = NULL; /*Files of the batch*/
+    char path[BENCH_PATH_SIZE];
+    uint8_t *data = NULL;
+    uint32_t sizes[BENCH_BATCH];
+    uint32_t written[BENCH_BATCH];
+    uint32_t random = (0 != shape->seed) ? shape->seed : 1u;
+    uint32_t sumFolder = 1;
+    uint32_t sumLevel = 1; /*Folders of the last level*/
+    uint32_t sizeOfBatch = (1u < shape->sumFragment) ? BENCH_BATCH : 1u;
+    uint32_t sumInBatch = 0;
+    uint32_t sizeOfWrite = 0;
+    uint32_t target = 0;
+    uint32_t piece = 0;
+    uint32_t first = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    /*Folders of the tree : 1 + width + width^2 ...*/
+    for (i = 0; (i < shape->depth) && (sumFolder <= BENCH_MAX_FOLDER); i++)
+    {
+        sumLevel *= shape->width;
+        sumFolder += sumLevel;
+    }
+    status = (sumFolder <= BENCH_MAX_FOLDER) && (0 != shape->sumFragment) && (true == MKFS_Format(imagePath, &shape->volume));
+    if (true == status)
+    {
+        folders = calloc(sumFolder, BENCH_PATH_SIZE);
+        paths = calloc(BENCH_BATCH, BENCH_PATH_SIZE);
+        data = (uint8_t *)malloc(BENCH_DATA_SIZE);
+        status = (NULL != folders) && (NULL != paths) && (NULL != data) && (true == FATFS_InitWritable(imagePath));
+    }
+
+    if (true == status)
+    {
+        for (i = 0; i < BENCH_DATA_SIZE; i++)
+        {
+            data[i] = (uint8_t)BENCH_Random(&random);
+        }
+        /*Breadth first : folder i gets the next width folders, until the last level is full*/
+        j = 1;
+        for (i = 0; (true == status) && (j < sumFolder); i++)
+        {
+            for (piece = 0; (true == status) && (piece < shape->width); piece++)
+            {
+                snprintf(path, BENCH_PATH_SIZE, "%s/d%u", folders[i], piece);
+                memcpy(folders[j], path, BENCH_PATH_SIZE);
+                status = FATFS_CreateDirectory((const uint8_t *)folders[j]);
+                j++;
+            }
+        }
+    }
+
+    /*Files of a batch go to different folders, their pieces are appended in turn*/
+    for (first = 0; (true == status) && (first < shape->sumFile); first += sizeOfBatch)
+    {
+        sumInBatch = ((shape->sumFile - first) < sizeOfBatch) ? (shape->sumFile - first) : sizeOfBatch;
+        for (j = 0; (true == status) && (j < sumInBatch); j++)
+        {
+            snprintf(paths[j], BENCH_PATH_SIZE, (true == shape->isLongName) ? "%s/Benchmark file number %07u.bin" : "%s/f%07u.bin", folders[(first + j) % sumFolder], first + j);
+            sizes[j] = shape->sizeOfFile / 2u + ((0 != shape->sizeOfFile) ? (BENCH_Random(&random) % (shape->sizeOfFile + 1u)) : 0);
+            written[j] = 0;
+            status = FATFS_CreateFile((const uint8_t *)paths[j]);
+        }
+        for (piece = 1; (true == status) && (piece <= shape->sumFragment); piece++)
+        {
+            for (j = 0; (true == status) && (j < sumInBatch); j++)
+            {
+                target = (uint32_t)(((uint64_t)sizes[j] * piece) / shape->sumFragment);
+                while ((true == status) && (written[j] < target))
+                {
+                    sizeOfWrite = ((target - written[j]) < (BENCH_DATA_SIZE / 2u)) ? (target - written[j]) : (BENCH_DATA_SIZE / 2u);
+                    status = FATFS_AppendFile((const uint8_t *)paths[j], &data[((first + j) * 4099u + written[j]) % (BENCH_DATA_SIZE / 2u)], sizeOfWrite);
+                    written[j] += sizeOfWrite;
+                }
+            }
+        }
+    }
+
+    if (NULL != data)
+    {
+        status = (true == FATFS_Flush()) && (true == status);
+        FATFS_DeInit();
+    }
+    free(folders);
+    free(paths);
+    free(data);
+
+    return status;
+}
+
+bool BENCH_Run(const uint8_t *const imagePath, const BENCH_Shape_Struct_t *const shape, const uint32_t sumIteration)
+{
+    bool status = true; /*return value */
+    BENCH_Tree_Struct_t tree;
+    FATFS_VolumeInfo_Struct_t info;
+    uint32_t *order = NULL;
+    double *times = NULL;
+    double start = 0;
+    double median = 0;
+    uint64_t sumByte = 0;
+    uint32_t sumItem = 0;
+    uint32_t random = 1;
+    uint32_t temp = 0;
+    uint32_t cache = 0;
+    uint32_t benchmark = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    bool isFirst = true;
+
+    memset(&tree, 0, sizeof(tree));
+    times = (double *)malloc(((0 != sumIteration) ? sumIteration : 1u) * sizeof(double));
+    status = (NULL != times) && (0 != sumIteration) && (true == FATFS_Init(imagePath));
+    if (true == status)
+    {
+        FATFS_GetVolumeInfo(&info);
+        status = BENCH_Walk(&tree);
+        FATFS_DeInit();
+    }
+    if (true == status)
+    {
+        /*Random reads : the same shuffled order for every build*/
+        random = ((NULL != shape) && (0 != shape->seed)) ? shape->seed : 1u;
+        order = (uint32_t *)malloc(((0 != tree.sumFile) ? tree.sumFile : 1u) * sizeof(uint32_t));
+        status = (NULL != order);
+        for (i = 0; (true == status) && (i < tree.sumFile); i++)
+        {
+            order[i] = i;
+        }
+        for (i = tree.sumFile; (true == status) && (1u < i); i--)
+        {
+            j = BENCH_Random(&random) % i;
+            temp = order[i - 1u];
+            order[i - 1u] = order[j];
+            order[j] = temp;
+        }
+    }
+
+    if (true == status)
+    {
+        printf("{\n  \"image\": \"%s\",\n", imagePath);
+        if (NULL != shape)
+        {
+            printf("  \"shape\": {\"size\": %llu, \"files\": %u, \"depth\": %u, \"width\": %u, \"file_size\": %u, \"fragments\": %u, \"seed\": %u, \"long_names\": %s},\n",
+                   (unsigned long long)shape->volume.sizeOfVolume, shape->sumFile, shape->depth, shape->width, shape->sizeOfFile, shape->sumFragment, shape->seed,
+                   (true == shape->isLongName) ? "true" : "false");
+        }
+        printf("  \"fat\": %u,\n  \"cluster\": %u,\n  \"iterations\": %u,\n  \"files\": %u,\n  \"entries\": %u,\n  \"results\": [", info.fatType,
+               (uint32_t)info.bytePerSector * info.sectorPerCluster, sumIteration, tree.sumFile, tree.sumEntry);
+    }
+    for (cache = 0; (true == status) && (cache < BENCH_SIZE_NAME_OF_CACHE); cache++)
+    {
+        for (benchmark = 0; (true == status) && (benchmark < BENCH_SUM_BENCHMARK); benchmark++)
+        {
+            if (BENCH_MOUNT != benchmark)
+            {
+                status = FATFS_Init(imagePath);
+            }
+            if ((true == status) && (1u == cache))
+            {
+                /*Warm : one run not timed fills the page cache*/
+                status = BENCH_RunOnce(imagePath, (BENCH_Benchmark_Enum_t)benchmark, &tree, order, &sumItem, &sumByte);
+            }
+            for (i = 0; (true == status) && (i < sumIteration); i++)
+            {
+                if (0 == cache)
+                {
+                    BENCH_DropCache(imagePath);
+                }
+                start = BENCH_GetTime();
+                status = BENCH_RunOnce(imagePath, (BENCH_Benchmark_Enum_t)benchmark, &tree, order, &sumItem, &sumByte);
+                times[i] = BENCH_GetTime() - start;
+            }
+            if (BENCH_MOUNT != benchmark)
+            {
+                FATFS_DeInit();
+            }
+            if (true == status)
+            {
+                qsort(times, sumIteration, sizeof(double), BENCH_CompareTime);
+                median = times[sumIteration / 2u];
+                printf("%s\n    {\"name\": \"%s\", \"cache\": \"%s\", \"median_seconds\": %.6f, \"min_seconds\": %.6f, \"items\": %u, \"bytes\": %llu, \"mib_per_second\": %.1f}",
+                       (true == isFirst) ? "" : ",", s_NameOfBenchmark[benchmark], s_NameOfCache[cache], median, times[0], sumItem,
+                       (unsigned long long)sumByte, (0 < median) ? ((double)sumByte / median / (1024.0 * 1024.0)) : 0.0);
+                isFirst = false;
+            }
+        }
+    }
+    if (false == isFirst)
+    {
+        printf("\n  ]\n}\n");
+    }
+    free(tree.files);
+    free(order);
+    free(times);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static uint32_t BENCH_Random(uint32_t *const state)
+{
+    *state ^= *state << 13u;
+    *state ^= *state >> 17u;
+    *state ^= *state << 5u;
+
+    return *state;
+}
+
+static double BENCH_GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void BENCH_DropCache(const uint8_t *const imagePath)
+{
+    int fileDescriptor = open((const char *)imagePath, O_RDONLY);
+
+    if (0 <= fileDescriptor)
+    {
+        /*Only a hint : pages of another process (or dirty pages) may stay*/
+        (void)posix_fadvise(fileDescriptor, 0, 0, POSIX_FADV_DONTNEED);
+        close(fileDescriptor);
+    }
+}
+
+static bool BENCH_Walk(BENCH_Tree_Struct_t *const tree)
+{
+    bool status = true; /*return value */
+    FATFS_VolumeInfo_Struct_t info;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *entry = NULL;
+    BENCH_File_Struct_t *files = NULL;
+    uint32_t *stack = NULL; /*Folders not read yet*/
+    uint32_t sumStack = 1;
+    uint32_t maxStack = 0;
+    uint32_t sumFolderRead = 0;
+    uint32_t *grown = NULL;
+
+    FATFS_GetVolumeInfo(&info);
+    tree->sumFile = 0;
+    tree->sumEntry = 0;
+    maxStack = 64u;
+    stack = (uint32_t *)malloc(maxStack * sizeof(uint32_t));
+    status = (NULL != stack);
+    if (true == status)
+    {
+        stack[0] = 0; /*Root*/
+    }
+
+    /*A looping tree can not have more folders than clusters*/
+    while ((true == status) && (0 != sumStack) && (sumFolderRead <= info.totalClusters))
+    {
+        sumStack--;
+        sumFolderRead++;
+        if (true == FATFS_DirOpen(&dir, stack[sumStack]))
+        {
+            entry = FATFS_DirNext(&dir);
+            while ((true == status) && (NULL != entry))
+            {
+                if (('.' != entry->shortFileName[0]) && (0xe5u != entry->shortFileName[0]) && (0 == (entry->attributes & 0x08u)))
+                {
+                    tree->sumEntry++;
+                    if (0 != (entry->attributes & FATFS_ATTRIBUTE_DIRECTORY))
+                    {
+                        if (sumStack == maxStack)
+                        {
+                            grown = (uint32_t *)realloc(stack, 2u * maxStack * sizeof(uint32_t));
+                            status = (NULL != grown);
+                            stack = (true == status) ? grown : stack;
+                            maxStack *= 2u;
+                        }
+                        if (true == status)
+                        {
+                            stack[sumStack] = entry->firstCluster;
+                            sumStack++;
+                        }
+                    }
+                    else
+                    {
+                        if (tree->sumFile == tree->maxFile)
+                        {
+                            files = (BENCH_File_Struct_t *)realloc(tree->files, ((0 != tree->maxFile) ? (2u * tree->maxFile) : 256u) * sizeof(BENCH_File_Struct_t));
+                            status = (NULL != files);
+                            if (true == status)
+                            {
+                                tree->files = files;
+                                tree->maxFile = (0 != tree->maxFile) ? (2u * tree->maxFile) : 256u;
+                            }
+                        }
+                        if (true == status)
+                        {
+                            tree->files[tree->sumFile].firstCluster = entry->firstCluster;
+                            tree->files[tree->sumFile].fileSize = entry->fileSize;
+                            tree->sumFile++;
+                        }
+                    }
+                }
+                entry = FATFS_DirNext(&dir);
+            }
+            FATFS_DirClose(&dir);
+        }
+    }
+    free(stack);
+
+    return status;
+}
+
+static bool BENCH_CountData(const uint8_t *const data, const uint32_t size, void *const context)
+{
+    (void)data;
+    *(uint64_t *)context += size;
+
+    return true;
+}
+
+static bool BENCH_ReadAsync(const BENCH_Tree_Struct_t *const tree, const uint32_t *const order, uint32_t *const sumItem, uint64_t *const sumByte)
+{
+    bool status = true; /*return value */
+    ASYNC_Request_Struct_t *requests = NULL;
+    ASYNC_Request_Struct_t *request = NULL;
+    uint32_t *sizes = NULL; /*Size of the buffer of each request*/
+    uint8_t *grown = NULL;
+    uint32_t next = 0;
+    uint32_t i = 0;
+
+    requests = (ASYNC_Request_Struct_t *)calloc(BENCH_ASYNC_OUTSTANDING, sizeof(ASYNC_Request_Struct_t));
+    sizes = (uint32_t *)calloc(BENCH_ASYNC_OUTSTANDING, sizeof(uint32_t));
+    status = (NULL != requests) && (NULL != sizes) && (true == ASYNC_Init(BENCH_ASYNC_THREAD));
+
+    /*Fill every slot, then give each completed slot the next file*/
+    for (i = 0; (true == status) && (i < BENCH_ASYNC_OUTSTANDING); i++)
+    {
+        requests[i].type = ASYNC_READ_FILE;
+    }
+    request = (true == status) ? &requests[0] : NULL;
+    while (NULL != request)
+    {
+        if ((true == status) && (next < tree->sumFile))
+        {
+            i = (uint32_t)(request - requests);
+            if (sizes[i] < tree->files[order[next]].fileSize)
+            {
+                grown = (uint8_t *)realloc(request->buffer, tree->files[order[next]].fileSize);
+                status = (NULL != grown);
+                request->buffer = (true == status) ? grown : request->buffer;
+                sizes[i] = (true == status) ? tree->files[order[next]].fileSize : sizes[i];
+            }
+            if (true == status)
+            {
+                request->firstCluster = tree->files[order[next]].firstCluster;
+                request->offset = 0;
+                request->size = tree->files[order[next]].fileSize;
+                status = ASYNC_Submit(request);
+                next++;
+            }
+        }
+        /*Slots never used are taken first, then the completed ones*/
+        if ((next < BENCH_ASYNC_OUTSTANDING) && (next < tree->sumFile) && (true == status))
+        {
+            request = &requests[next];
+        }
+        else
+        {
+            request = ASYNC_Poll(true);
+            if (NULL != request)
+            {
+                status = status && request->status;
+                *sumByte += request->sizeRead;
+                (*sumItem)++;
+            }
+        }
+    }
+    ASYNC_DeInit();
+    for (i = 0; (NULL != requests) && (i < BENCH_ASYNC_OUTSTANDING); i++)
+    {
+        free(requests[i].buffer);
+    }
+    free(requests);
+    free(sizes);
+
+    return status;
+}
+
+static bool BENCH_RunOnce(const uint8_t *const imagePath, const BENCH_Benchmark_Enum_t benchmark, const BENCH_Tree_Struct_t *const tree,
+                          const uint32_t *const order, uint32_t *const sumItem, uint64_t *const sumByte)
+{
+    bool status = true; /*return value */
+    BENCH_Tree_Struct_t walk;
+    const FATFS_ListEntry_struct_t *node = NULL;
+    const BENCH_File_Struct_t *file = NULL;
+    uint32_t i = 0;
+
+    *sumItem = 0;
+    *sumByte = 0;
+    switch (benchmark)
+    {
+    case BENCH_MOUNT:
+        status = FATFS_Init(imagePath);
+        if (true == status)
+        {
+            FATFS_DeInit();
+            *sumItem = 1;
+        }
+        break;
+    case BENCH_LIST_ROOT:
+        for (node = FATFS_ReadDirectory(0); NULL != node; node = node->next)
+        {
+            (*sumItem)++;
+        }
+        break;
+    case BENCH_TREE_WALK:
+        memset(&walk, 0, sizeof(walk));
+        status = BENCH_Walk(&walk);
+        *sumItem = walk.sumEntry;
+        free(walk.files);
+        break;
+    case BENCH_ASYNC_READ:
+        status = BENCH_ReadAsync(tree, order, sumItem, sumByte);
+        break;
+    default:
+        /*Sequential : tree order, random : shuffled order*/
+        for (i = 0; (true == status) && (i < tree->sumFile); i++)
+        {
+            file = &tree->files[(BENCH_SEQUENTIAL_READ == benchmark) ? i : order[i]];
+            if (0 != file->fileSize)
+            {
+                status = FATFS_StreamData(file->firstCluster, file->fileSize, BENCH_CountData, sumByte);
+            }
+            (*sumItem)++;
+        }
+        break;
+    }
+
+    return status;
+}
+
+static int BENCH_CompareTime(const void *first, const void *second)
+{
+    const double firstTime = *(const double *)first;
+    const double secondTime = *(const double *)second;
+
+    return (firstTime > secondTime) - (firstTime < secondTime);
+}
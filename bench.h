@@ -0,0 +1,55 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Shape of a generated image (mkfs.h gives MKFS_Options_Struct_t)
+ */
+typedef struct
+{
+    MKFS_Options_Struct_t volume; /*Size, FAT type and cluster size*/
+    uint32_t sumFile;             /*Files, spread over all folders*/
+    uint32_t depth;               /*Levels of folders under the root (0 : every file in the root)*/
+    uint32_t width;               /*Sub folders of each folder*/
+    uint32_t sizeOfFile;          /*Mean size in bytes, sizes are drawn between half and one and a half of it*/
+    uint32_t sumFragment;         /*Pieces of each file, written in turn with the other files of its batch (1 : contiguous files)*/
+    uint32_t seed;                /*Seed of sizes, data and the order of random reads*/
+    bool isLongName;              /*true : file names need long file name entries*/
+} BENCH_Shape_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  BENCH_InitShape
+ * @brief Set the default shape : 256 MiB FAT32, 1000 files of 64 KiB in 2 levels of 4 folders, no fragmentation
+ * @param[out] shape   Shape
+ * @return none
+ */
+void BENCH_InitShape(BENCH_Shape_Struct_t *const shape);
+
+/**  BENCH_Generate
+ * @brief Create an image (MKFS_Format) and fill it with the folders and files of a shape. The image must not be mounted
+ * @param[in] imagePath   Path of the image (replaced if it exists)
+ * @param[in] shape   Shape
+ * @return bool Returns false if the volume is too small or the image could not be written
+ */
+bool BENCH_Generate(const uint8_t *const imagePath, const BENCH_Shape_Struct_t *const shape);
+
+/**  BENCH_Run
+ * @brief Time mount (FATFS_Init), listing of the root (FATFS_ReadDirectory), walk of the whole tree, sequential reads
+ *        of all files (tree order), random reads (shuffled order) and the same reads through async (many requests
+ *        outstanding on a few threads), with a cold page cache (image dropped
+ *        with POSIX_FADV_DONTNEED before each iteration) and a warm one. Results are printed on stdout as JSON.
+ *        The image must not be mounted
+ * @param[in] imagePath   Path of the image
+ * @param[in] shape   Shape printed with the results (NULL : the image was not generated)
+ * @param[in] sumIteration   Timed iterations of each benchmark (the median and the minimum are printed)
+ * @return bool Returns false if the image could not be mounted or read
+ */
+bool BENCH_Run(const uint8_t *const imagePath, const BENCH_Shape_Struct_t *const shape, const uint32_t sumIteration);
+
+#endif /*__BENCH_H__*/
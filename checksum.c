@@ -0,0 +1,435 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#include "checksum.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Reversed polynomial of CRC32C
+ */
+#define CHECKSUM_CRC32C_POLYNOMIAL (0x82f63b78u)
+
+/*
+ *Number of tables used to process 8 bytes per step (slicing by 8)
+ */
+#define CHECKSUM_SUM_TABLE (8u)
+
+/*
+ *Size in bytes of a SHA-256 block
+ */
+#define CHECKSUM_SHA256_BLOCK (64u)
+
+#define CHECKSUM_ROTATE_RIGHT(value, bit) (((value) >> (bit)) | ((value) << (32u - (bit))))
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static uint32_t s_TableCrc32c[CHECKSUM_SUM_TABLE][256]; /*Tables of CRC32C*/
+static pthread_once_t s_InitOnce = PTHREAD_ONCE_INIT;  /*Tables and CPU features are set up once, by the first caller of any thread*/
+static bool s_HasCrc32cInstruction = false;            /*true if the CPU has SSE4.2*/
+static bool s_HasShaInstruction = false;               /*true if the CPU has the SHA extensions*/
+
+/*
+ *Round constants of SHA-256
+ */
+static const uint32_t s_Sha256Constant[64] = {
+    0x428a2f98u, 0x71374491u, 0xb5c0fbcfu, 0xe9b5dba5u, 0x3956c25bu, 0x59f111f1u, 0x923f82a4u, 0xab1c5ed5u,
+    0xd807aa98u, 0x12835b01u, 0x243185beu, 0x550c7dc3u, 0x72be5d74u, 0x80deb1feu, 0x9bdc06a7u, 0xc19bf174u,
+    0xe49b69c1u, 0xefbe4786u, 0x0fc19dc6u, 0x240ca1ccu, 0x2de92c6fu, 0x4a7484aau, 0x5cb0a9dcu, 0x76f988dau,
+    0x983e5152u, 0xa831c66du, 0xb00327c8u, 0xbf597fc7u, 0xc6e00bf3u, 0xd5a79147u, 0x06ca6351u, 0x14292967u,
+    0x27b70a85u, 0x2e1b2138u, 0x4d2c6dfcu, 0x53380d13u, 0x650a7354u, 0x766a0abbu, 0x81c2c92eu, 0x92722c85u,
+    0xa2bfe8a1u, 0xa81a664bu, 0xc24b8b70u, 0xc76c51a3u, 0xd192e819u, 0xd6990624u, 0xf40e3585u, 0x106aa070u,
+    0x19a4c116u, 0x1e376c08u, 0x2748774cu, 0x34b0bcb5u, 0x391c0cb3u, 0x4ed8aa4au, 0x5b9cca4fu, 0x682e6ff3u,
+    0x748f82eeu, 0x78a5636fu, 0x84c87814u, 0x8cc70208u, 0x90befffau, 0xa4506cebu, 0xbef9a3f7u, 0xc67178f2u};
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  CHECKSUM_InitTable
+ * @brief Compute the tables of CRC32C and detect the instructions of the CPU
+ * @return none
+ */
+static void CHECKSUM_InitTable(void);
+
+/**  CHECKSUM_Crc32cSoftware
+ * @brief Update a CRC32C with tables (slicing by 8)
+ * @param[in] crc   Inverted CRC
+ * @param[in] data   Block of data
+ * @param[in] size   Size of block
+ * @return uint32_t Returns the inverted CRC
+ */
+static uint32_t CHECKSUM_Crc32cSoftware(uint32_t crc, const uint8_t *const data, const size_t size);
+
+/**  CHECKSUM_Sha256Software
+ * @brief Hash complete blocks with plain C
+ * @param[in,out] state   Hash
+ * @param[in] data   Blocks
+ * @param[in] sumBlock   Number of blocks
+ * @return none
+ */
+static void CHECKSUM_Sha256Software(uint32_t *const state, const uint8_t *data, size_t sumBlock);
+
+#if defined(__x86_64__)
+/**  CHECKSUM_Crc32cHardware
+ * @brief Update a CRC32C with the SSE4.2 crc32 instruction (8 bytes per instruction)
+ * @param[in] crc   Inverted CRC
+ * @param[in] data   Block of data
+ * @param[in] size   Size of block
+ * @return uint32_t Returns the inverted CRC
+ */
+static uint32_t CHECKSUM_Crc32cHardware(uint32_t crc, const uint8_t *const data, const size_t size);
+
+/**  CHECKSUM_Sha256Hardware
+ * @brief Hash complete blocks with the SHA extensions
+ * @param[in,out] state   Hash
+ * @param[in] data   Blocks
+ * @param[in] sumBlock   Number of blocks
+ * @return none
+ */
+static void CHECKSUM_Sha256Hardware(uint32_t *const state, const uint8_t *data, size_t sumBlock);
+#endif
+
+/**  CHECKSUM_Sha256Blocks
+ * @brief Hash complete blocks with the fastest code the CPU can run
+ * @param[in,out] state   Hash
+ * @param[in] data   Blocks
+ * @param[in] sumBlock   Number of blocks
+ * @return none
+ */
+static void CHECKSUM_Sha256Blocks(uint32_t *const state, const uint8_t *data, size_t sumBlock);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+uint32_t CHECKSUM_Crc32c(uint32_t crc, const uint8_t *const data, const size_t size)
+{
+    pthread_once(&s_InitOnce, CHECKSUM_InitTable);
+
+#if defined(__x86_64__)
+    if (true == s_HasCrc32cInstruction)
+    {
+        crc = ~CHECKSUM_Crc32cHardware(~crc, data, size);
+    }
+    else
+#endif
+    {
+        crc = ~CHECKSUM_Crc32cSoftware(~crc, data, size);
+    }
+
+    return crc;
+}
+
+void CHECKSUM_Sha256Init(CHECKSUM_Sha256_Struct_t *const context)
+{
+    pthread_once(&s_InitOnce, CHECKSUM_InitTable);
+
+    context->state[0] = 0x6a09e667u;
+    context->state[1] = 0xbb67ae85u;
+    context->state[2] = 0x3c6ef372u;
+    context->state[3] = 0xa54ff53au;
+    context->state[4] = 0x510e527fu;
+    context->state[5] = 0x9b05688cu;
+    context->state[6] = 0x1f83d9abu;
+    context->state[7] = 0x5be0cd19u;
+    context->sumByte = 0;
+    context->sizeOfBlock = 0;
+}
+
+void CHECKSUM_Sha256Update(CHECKSUM_Sha256_Struct_t *const context, const uint8_t *const data, const size_t size)
+{
+    size_t i = 0; /*Index value*/
+    size_t sizeToCopy = 0;
+
+    context->sumByte += size;
+
+    /*Complete the pending block first*/
+    if (0 != context->sizeOfBlock)
+    {
+        sizeToCopy = CHECKSUM_SHA256_BLOCK - context->sizeOfBlock;
+        if (size < sizeToCopy)
+        {
+            sizeToCopy = size;
+        }
+        memcpy(&context->block[context->sizeOfBlock], data, sizeToCopy);
+        context->sizeOfBlock += sizeToCopy;
+        i = sizeToCopy;
+        if (CHECKSUM_SHA256_BLOCK == context->sizeOfBlock)
+        {
+            CHECKSUM_Sha256Blocks(context->state, context->block, 1u);
+            context->sizeOfBlock = 0;
+        }
+    }
+
+    /*Hash complete blocks straight from data*/
+    if ((size - i) >= CHECKSUM_SHA256_BLOCK)
+    {
+        CHECKSUM_Sha256Blocks(context->state, &data[i], (size - i) / CHECKSUM_SHA256_BLOCK);
+        i += ((size - i) / CHECKSUM_SHA256_BLOCK) * CHECKSUM_SHA256_BLOCK;
+    }
+
+    /*Keep the rest for the next call*/
+    if (i < size)
+    {
+        memcpy(context->block, &data[i], size - i);
+        context->sizeOfBlock = size - i;
+    }
+}
+
+void CHECKSUM_Sha256Final(CHECKSUM_Sha256_Struct_t *const context, uint8_t *const digest)
+{
+    uint64_t sumBit = context->sumByte * 8u;
+    uint32_t i = 0; /*Index value*/
+
+    /*Padding : 0x80, zeros, then the length in bits (big endian)*/
+    context->block[context->sizeOfBlock] = 0x80u;
+    context->sizeOfBlock++;
+    if (context->sizeOfBlock > (CHECKSUM_SHA256_BLOCK - 8u))
+    {
+        memset(&context->block[context->sizeOfBlock], 0, CHECKSUM_SHA256_BLOCK - context->sizeOfBlock);
+        CHECKSUM_Sha256Blocks(context->state, context->block, 1u);
+        context->sizeOfBlock = 0;
+    }
+    memset(&context->block[context->sizeOfBlock], 0, CHECKSUM_SHA256_BLOCK - 8u - context->sizeOfBlock);
+    for (i = 0; i < 8u; i++)
+    {
+        context->block[CHECKSUM_SHA256_BLOCK - 1u - i] = (uint8_t)(sumBit >> (8u * i));
+    }
+    CHECKSUM_Sha256Blocks(context->state, context->block, 1u);
+
+    for (i = 0; i < 8u; i++)
+    {
+        digest[4u * i] = (uint8_t)(context->state[i] >> 24u);
+        digest[4u * i + 1u] = (uint8_t)(context->state[i] >> 16u);
+        digest[4u * i + 2u] = (uint8_t)(context->state[i] >> 8u);
+        digest[4u * i + 3u] = (uint8_t)context->state[i];
+    }
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void CHECKSUM_InitTable(void)
+{
+    uint32_t i = 0; /*Index value*/
+    uint32_t j = 0; /*Index value*/
+    uint32_t crc = 0;
+#if defined(__x86_64__)
+    uint32_t eax = 0;
+    uint32_t ebx = 0;
+    uint32_t ecx = 0;
+    uint32_t edx = 0;
+#endif
+
+    for (i = 0; i < 256u; i++)
+    {
+        crc = i;
+        for (j = 0; j < 8u; j++)
+        {
+            crc = (crc >> 1u) ^ ((0u != (crc & 1u)) ? CHECKSUM_CRC32C_POLYNOMIAL : 0u);
+        }
+        s_TableCrc32c[0][i] = crc;
+    }
+    for (i = 0; i < 256u; i++)
+    {
+        for (j = 1; j < CHECKSUM_SUM_TABLE; j++)
+        {
+            s_TableCrc32c[j][i] = (s_TableCrc32c[j - 1u][i] >> 8u) ^ s_TableCrc32c[0][s_TableCrc32c[j - 1u][i] & 0xffu];
+        }
+    }
+
+#if defined(__x86_64__)
+    /*SSE4.2 : leaf 1, ecx bit 20. SHA : leaf 7, ebx bit 29 (its code also needs SSE4.1 : leaf 1, ecx bit 19)*/
+    if (0 != __get_cpuid(1u, &eax, &ebx, &ecx, &edx))
+    {
+        s_HasCrc32cInstruction = (0 != (ecx & (1u << 20u)));
+        s_HasShaInstruction = (0 != (ecx & (1u << 19u)));
+    }
+    if ((true == s_HasShaInstruction) && (0 != __get_cpuid_count(7u, 0u, &eax, &ebx, &ecx, &edx)))
+    {
+        s_HasShaInstruction = (0 != (ebx & (1u << 29u)));
+    }
+    else
+    {
+        s_HasShaInstruction = false;
+    }
+#endif
+}
+
+static uint32_t CHECKSUM_Crc32cSoftware(uint32_t crc, const uint8_t *const data, const size_t size)
+{
+    size_t i = 0; /*Index value*/
+    uint32_t low = 0;
+    uint32_t high = 0;
+
+    /*8 bytes per step*/
+    for (i = 0; (i + 8u) <= size; i += 8u)
+    {
+        low = crc ^ ((uint32_t)data[i] | ((uint32_t)data[i + 1u] << 8u) | ((uint32_t)data[i + 2u] << 16u) | ((uint32_t)data[i + 3u] << 24u));
+        high = (uint32_t)data[i + 4u] | ((uint32_t)data[i + 5u] << 8u) | ((uint32_t)data[i + 6u] << 16u) | ((uint32_t)data[i + 7u] << 24u);
+        crc = s_TableCrc32c[7][low & 0xffu] ^ s_TableCrc32c[6][(low >> 8u) & 0xffu] ^ s_TableCrc32c[5][(low >> 16u) & 0xffu] ^ s_TableCrc32c[4][low >> 24u] ^
+              s_TableCrc32c[3][high & 0xffu] ^ s_TableCrc32c[2][(high >> 8u) & 0xffu] ^ s_TableCrc32c[1][(high >> 16u) & 0xffu] ^ s_TableCrc32c[0][high >> 24u];
+    }
+    /*Remaining bytes*/
+    for (; i < size; i++)
+    {
+        crc = s_TableCrc32c[0][(crc ^ data[i]) & 0xffu] ^ (crc >> 8u);
+    }
+
+    return crc;
+}
+
+static void CHECKSUM_Sha256Software(uint32_t *const state, const uint8_t *data, size_t sumBlock)
+{
+    uint32_t word[64];
+    uint32_t value[8]; /*a..h*/
+    uint32_t temp1 = 0;
+    uint32_t temp2 = 0;
+    uint32_t i = 0; /*Index value*/
+
+    while (0 != sumBlock)
+    {
+        for (i = 0; i < 16u; i++)
+        {
+            word[i] = ((uint32_t)data[4u * i] << 24u) | ((uint32_t)data[4u * i + 1u] << 16u) | ((uint32_t)data[4u * i + 2u] << 8u) | (uint32_t)data[4u * i + 3u];
+        }
+        for (i = 16; i < 64u; i++)
+        {
+            temp1 = CHECKSUM_ROTATE_RIGHT(word[i - 15u], 7u) ^ CHECKSUM_ROTATE_RIGHT(word[i - 15u], 18u) ^ (word[i - 15u] >> 3u);
+            temp2 = CHECKSUM_ROTATE_RIGHT(word[i - 2u], 17u) ^ CHECKSUM_ROTATE_RIGHT(word[i - 2u], 19u) ^ (word[i - 2u] >> 10u);
+            word[i] = word[i - 16u] + temp1 + word[i - 7u] + temp2;
+        }
+
+        memcpy(value, state, sizeof(value));
+        for (i = 0; i < 64u; i++)
+        {
+            temp1 = value[7] + (CHECKSUM_ROTATE_RIGHT(value[4], 6u) ^ CHECKSUM_ROTATE_RIGHT(value[4], 11u) ^ CHECKSUM_ROTATE_RIGHT(value[4], 25u)) +
+                    ((value[4] & value[5]) ^ (~value[4] & value[6])) + s_Sha256Constant[i] + word[i];
+            temp2 = (CHECKSUM_ROTATE_RIGHT(value[0], 2u) ^ CHECKSUM_ROTATE_RIGHT(value[0], 13u) ^ CHECKSUM_ROTATE_RIGHT(value[0], 22u)) +
+                    ((value[0] & value[1]) ^ (value[0] & value[2]) ^ (value[1] & value[2]));
+            value[7] = value[6];
+            value[6] = value[5];
+            value[5] = value[4];
+            value[4] = value[3] + temp1;
+            value[3] = value[2];
+            value[2] = value[1];
+            value[1] = value[0];
+            value[0] = temp1 + temp2;
+        }
+        for (i = 0; i < 8u; i++)
+        {
+            state[i] += value[i];
+        }
+
+        data += CHECKSUM_SHA256_BLOCK;
+        sumBlock--;
+    }
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t CHECKSUM_Crc32cHardware(uint32_t crc, const uint8_t *const data, const size_t size)
+{
+    size_t i = 0; /*Index value*/
+    uint64_t crc64 = 0;
+    uint64_t value = 0;
+
+    /*Align the 8 bytes loads*/
+    for (; (i < size) && (0 != (((uintptr_t)&data[i]) & 7u)); i++)
+    {
+        crc = _mm_crc32_u8(crc, data[i]);
+    }
+    crc64 = crc;
+    for (; (i + 8u) <= size; i += 8u)
+    {
+        memcpy(&value, &data[i], sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+    }
+    crc = (uint32_t)crc64;
+    for (; i < size; i++)
+    {
+        crc = _mm_crc32_u8(crc, data[i]);
+    }
+
+    return crc;
+}
+
+__attribute__((target("sha,sse4.1"))) static void CHECKSUM_Sha256Hardware(uint32_t *const state, const uint8_t *data, size_t sumBlock)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+    __m128i message[4]; /*Last 16 words of the message schedule*/
+    __m128i abef;
+    __m128i cdgh;
+    __m128i saveAbef;
+    __m128i saveCdgh;
+    __m128i temp;
+    uint32_t i = 0; /*Group of 4 rounds*/
+
+    /*The instructions keep the state as ABEF and CDGH*/
+    temp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+    cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+    abef = _mm_alignr_epi8(temp, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, temp, 0xf0);
+
+    while (0 != sumBlock)
+    {
+        saveAbef = abef;
+        saveCdgh = cdgh;
+        for (i = 0; i < 16u; i++)
+        {
+            if (i < 4u)
+            {
+                message[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&data[16u * i]), byteSwap);
+            }
+            else
+            {
+                /*w[t] = s1(w[t-2]) + w[t-7] + s0(w[t-15]) + w[t-16], 4 words at a time*/
+                temp = _mm_sha256msg1_epu32(message[i & 3u], message[(i + 1u) & 3u]);
+                temp = _mm_add_epi32(temp, _mm_alignr_epi8(message[(i + 3u) & 3u], message[(i + 2u) & 3u], 4));
+                message[i & 3u] = _mm_sha256msg2_epu32(temp, message[(i + 3u) & 3u]);
+            }
+            temp = _mm_add_epi32(message[i & 3u], _mm_loadu_si128((const __m128i *)&s_Sha256Constant[4u * i]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, temp);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(temp, 0x0e));
+        }
+        abef = _mm_add_epi32(abef, saveAbef);
+        cdgh = _mm_add_epi32(cdgh, saveCdgh);
+
+        data += CHECKSUM_SHA256_BLOCK;
+        sumBlock--;
+    }
+
+    temp = _mm_shuffle_epi32(abef, 0x1b);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(temp, cdgh, 0xf0));
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(cdgh, temp, 8));
+}
+#endif
+
+static void CHECKSUM_Sha256Blocks(uint32_t *const state, const uint8_t *data, size_t sumBlock)
+{
+#if defined(__x86_64__)
+    if (true == s_HasShaInstruction)
+    {
+        CHECKSUM_Sha256Hardware(state, data, sumBlock);
+    }
+    else
+#endif
+    {
+        CHECKSUM_Sha256Software(state, data, sumBlock);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef __CHECKSUM_H__
+#define __CHECKSUM_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Size in bytes of a SHA-256 digest
+ */
+#define CHECKSUM_SHA256_SIZE (32u)
+
+/*
+ *SHA-256 computed over several blocks of data
+ */
+typedef struct
+{
+    uint32_t state[8];    /*Hash of the complete blocks*/
+    uint64_t sumByte;     /*Number of bytes hashed so far*/
+    uint8_t block[64];    /*Incomplete block*/
+    uint32_t sizeOfBlock; /*Number of bytes in block*/
+} CHECKSUM_Sha256_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  CHECKSUM_Crc32c
+ * @brief Update a CRC32C (Castagnoli) with a block of data. Uses the SSE4.2 instruction when the CPU has it
+ * @param[in] crc   CRC of the previous blocks (0 for the first block)
+ * @param[in] data   Block of data
+ * @param[in] size   Size of block
+ * @return uint32_t Returns the CRC of all blocks so far
+ */
+uint32_t CHECKSUM_Crc32c(uint32_t crc, const uint8_t *const data, const size_t size);
+
+/**  CHECKSUM_Sha256Init
+ * @brief Start a SHA-256
+ * @param[out] context   SHA-256
+ * @return none
+ */
+void CHECKSUM_Sha256Init(CHECKSUM_Sha256_Struct_t *const context);
+
+/**  CHECKSUM_Sha256Update
+ * @brief Hash a block of data. Uses the SHA extensions when the CPU has them
+ * @param[in,out] context   SHA-256
+ * @param[in] data   Block of data
+ * @param[in] size   Size of block
+ * @return none
+ */
+void CHECKSUM_Sha256Update(CHECKSUM_Sha256_Struct_t *const context, const uint8_t *const data, const size_t size);
+
+/**  CHECKSUM_Sha256Final
+ * @brief Finish a SHA-256
+ * @param[in,out] context   SHA-256
+ * @param[out] digest   Receiver, CHECKSUM_SHA256_SIZE bytes
+ * @return none
+ */
+void CHECKSUM_Sha256Final(CHECKSUM_Sha256_Struct_t *const context, uint8_t *const digest);
+
+#endif /*__CHECKSUM_H__*/
@@ -0,0 +1,120 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "hal.h"
+#include "fatfs.h"
+#include "compact.h"
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  COMPACT_Punch
+ * @brief Punch one range of the image
+ * @param[in] fileDescriptor   Image
+ * @param[in] offset   Offset in bytes
+ * @param[in] size   Size in bytes
+ * @param[out] report   Runs and bytes punched
+ * @return bool Returns true if success
+ */
+static bool COMPACT_Punch(const int fileDescriptor, const uint64_t offset, const uint64_t size, COMPACT_Report_Struct_t *const report);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool COMPACT_PunchFreeClusters(const uint8_t *const imagePath, COMPACT_Report_Struct_t *const report)
+{
+    bool status = true; /*return value */
+    FATFS_VolumeInfo_Struct_t info;
+    struct stat imageStat;
+    uint64_t sizeOfCluster = 0;
+    uint64_t endOfData = 0;
+    uint32_t endCluster = 0;
+    uint32_t firstFree = 0; /*First cluster of the run being measured (0 : none)*/
+    uint32_t nextCluster = 0;
+    uint32_t cluster = 0;
+    int fileDescriptor = -1;
+
+    memset(report, 0, sizeof(COMPACT_Report_Struct_t));
+    FATFS_GetVolumeInfo(&info);
+    sizeOfCluster = (uint64_t)info.bytePerSector * info.sectorPerCluster;
+    endCluster = info.totalClusters + 2u;
+    /*Clusters of a compressed image are not at their offset in the file*/
+    fileDescriptor = (false == HAL_IsCompressed()) ? open((const char *)imagePath, O_RDWR) : -1;
+    status = (0 <= fileDescriptor) && (0 == fstat(fileDescriptor, &imageStat));
+    if (true == status)
+    {
+        report->sizeBefore = (uint64_t)imageStat.st_blocks * 512u;
+    }
+
+    /*One system call per run of free clusters : a free element ends the run only when the next one is used*/
+    for (cluster = 2; (true == status) && (cluster <= endCluster); cluster++)
+    {
+        nextCluster = 1;
+        if (cluster < endCluster)
+        {
+            (void)FATFS_GetNextCluster(cluster, &nextCluster);
+        }
+        if ((0 == nextCluster) && (0 == firstFree))
+        {
+            firstFree = cluster;
+        }
+        else if ((0 != nextCluster) && (0 != firstFree))
+        {
+            status = COMPACT_Punch(fileDescriptor, (uint64_t)info.locationOfData * info.bytePerSector + (firstFree - 2u) * sizeOfCluster,
+                                   (cluster - firstFree) * sizeOfCluster, report);
+            firstFree = 0;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    /*Sectors after the last cluster belong to no cluster*/
+    endOfData = (uint64_t)info.locationOfData * info.bytePerSector + info.totalClusters * sizeOfCluster;
+    if ((true == status) && (endOfData < (uint64_t)imageStat.st_size))
+    {
+        status = COMPACT_Punch(fileDescriptor, endOfData, (uint64_t)imageStat.st_size - endOfData, report);
+    }
+
+    if (true == status)
+    {
+        status = (0 == fsync(fileDescriptor)) && (0 == fstat(fileDescriptor, &imageStat));
+        report->sizeAfter = (uint64_t)imageStat.st_blocks * 512u;
+    }
+    if (0 <= fileDescriptor)
+    {
+        close(fileDescriptor);
+    }
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static bool COMPACT_Punch(const int fileDescriptor, const uint64_t offset, const uint64_t size, COMPACT_Report_Struct_t *const report)
+{
+    bool status = true; /*return value */
+
+    /*Parts of host blocks at both ends are written with zeros by the host file system*/
+    status = (0 == fallocate(fileDescriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)offset, (off_t)size));
+    if (true == status)
+    {
+        report->sumRun++;
+        report->sumBytePunched += size;
+    }
+
+    return status;
+}
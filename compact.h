@@ -0,0 +1,33 @@
+#ifndef __COMPACT_H__
+#define __COMPACT_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Result of a compaction
+ */
+typedef struct
+{
+    uint32_t sumRun;        /*Runs of free clusters punched (one system call each)*/
+    uint64_t sumBytePunched; /*Bytes of the data region given back to the host file system*/
+    uint64_t sizeBefore;    /*Bytes stored on the host disk before*/
+    uint64_t sizeAfter;     /*Bytes stored on the host disk after*/
+} COMPACT_Report_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  COMPACT_PunchFreeClusters
+ * @brief Turn every run of free clusters of the mounted volume into a hole of the image (fallocate PUNCH_HOLE, size kept),
+ *        with the sectors after the last cluster. Free clusters read back as zeros, so deleted data can not be recovered after.
+ *        The volume must be mounted with FATFS_Init
+ * @param[in] imagePath   Path of the mounted image
+ * @param[out] report   Runs and bytes punched
+ * @return bool Returns false if the image could not be opened, is compressed or the host file system has no holes
+ */
+bool COMPACT_PunchFreeClusters(const uint8_t *const imagePath, COMPACT_Report_Struct_t *const report);
+
+#endif /*__COMPACT_H__*/
@@ -0,0 +1,571 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "hal.h"
+#include "fatfs.h"
+#include "stats.h"
+#include "defrag.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Size of the buffer merging consecutive writes of the new image
+ */
+#define DEFRAG_WRITE_BUFFER_SIZE (8u * 1024u * 1024u)
+
+/*
+ *Deepest folder copied
+ */
+#define DEFRAG_MAX_DEPTH (256u)
+
+/*
+ *Directory entry
+ */
+#define DEFRAG_SIZE_ENTRY (32u)
+#define DEFRAG_ATTRIBUTE_OFFSET (11u)
+#define DEFRAG_HIGH_CLUSTER_OFFSET (20u)
+#define DEFRAG_LOW_CLUSTER_OFFSET (26u)
+#define DEFRAG_FILE_SIZE_OFFSET (28u)
+#define DEFRAG_ATTRIBUTE_LONG_FILE_NAME (0x0fu)
+#define DEFRAG_ATTRIBUTE_VOLUME_LABEL (0x08u)
+#define DEFRAG_DELETED_ENTRY (0xe5u)
+
+/*
+ *Fields of the reserved sectors updated in the new image
+ */
+#define DEFRAG_ROOT_CLUSTER_OFFSET (44u)
+#define DEFRAG_FS_INFO_SECTOR_OFFSET (48u)
+#define DEFRAG_FS_INFO_LEAD_SIGNATURE (0x41615252u)
+#define DEFRAG_FS_INFO_FREE_COUNT_OFFSET (488u)
+#define DEFRAG_FS_INFO_NEXT_FREE_OFFSET (492u)
+
+#define DEFRAG_READ_2_BYTES(address) ((uint32_t)(address)[0] | ((uint32_t)(address)[1] << 8u))
+#define DEFRAG_READ_4_BYTES(address) (DEFRAG_READ_2_BYTES(address) | (DEFRAG_READ_2_BYTES(&(address)[2]) << 16u))
+
+/*
+ *State of a rewrite
+ */
+typedef struct
+{
+    FATFS_VolumeInfo_Struct_t info;
+    int fileDescriptor;      /*New image*/
+    uint32_t *fat;           /*FAT of the new image*/
+    uint32_t nextCluster;    /*First cluster not given yet in the new image*/
+    uint32_t endOfChain;     /*End of chain mark*/
+    uint32_t badCluster;     /*Bad cluster mark*/
+    uint32_t sizeOfCluster;  /*Size in bytes of a cluster*/
+    uint8_t *visited;        /*Bitmap of folders already copied (old clusters), to stop on a looping tree*/
+    uint8_t *buffer;         /*Consecutive bytes waiting to be written*/
+    uint32_t sizeOfBuffer;   /*Number of bytes in buffer*/
+    uint64_t offsetOfBuffer; /*Offset of buffer in the new image*/
+    uint64_t offset;         /*Where the file being copied goes next*/
+    bool status;             /*Cleared by a write error*/
+} DEFRAG_Rewrite_Struct_t;
+
+/*
+ *Folder read into memory
+ */
+typedef struct
+{
+    uint8_t *data;
+    uint32_t size;
+} DEFRAG_Folder_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  DEFRAG_Write
+ * @brief Write bytes to the new image. Consecutive writes are merged into large ones
+ * @param[in] rewrite state of the rewrite
+ * @param[in] offset offset in the new image
+ * @param[in] data bytes
+ * @param[in] size number of bytes
+ * @return none
+ */
+static void DEFRAG_Write(DEFRAG_Rewrite_Struct_t *const rewrite, const uint64_t offset, const uint8_t *data, uint32_t size);
+
+/**  DEFRAG_Flush
+ * @brief Write the waiting bytes to the new image
+ * @param[in] rewrite state of the rewrite
+ * @return none
+ */
+static void DEFRAG_Flush(DEFRAG_Rewrite_Struct_t *const rewrite);
+
+/**  DEFRAG_CopyData
+ * @brief Write a chunk of file at the current place of the new image (used as FATFS_DataCallback_t)
+ * @param[in] data chunk
+ * @param[in] size size of chunk
+ * @param[in] context state of the rewrite
+ * @return bool Returns false after a write error
+ */
+static bool DEFRAG_CopyData(const uint8_t *const data, const uint32_t size, void *const context);
+
+/**  DEFRAG_ReadFolder
+ * @brief Append a chunk of folder to memory (used as FATFS_DataCallback_t)
+ * @param[in] data chunk
+ * @param[in] size size of chunk
+ * @param[in] context folder (DEFRAG_Folder_Struct_t)
+ * @return bool true
+ */
+static bool DEFRAG_ReadFolder(const uint8_t *const data, const uint32_t size, void *const context);
+
+/**  DEFRAG_ChainLength
+ * @brief Count the clusters of a chain of the mounted volume
+ * @param[in] rewrite state of the rewrite
+ * @param[in] firstCluster first cluster
+ * @return uint32_t Returns the number of clusters (a looping chain is cut at the number of clusters of the volume)
+ */
+static uint32_t DEFRAG_ChainLength(const DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t firstCluster);
+
+/**  DEFRAG_Allocate
+ * @brief Give contiguous clusters of the new image and chain them in its FAT. Bad clusters are kept out
+ * @param[in] rewrite state of the rewrite
+ * @param[in] sumCluster number of clusters
+ * @param[out] firstCluster first cluster given
+ * @return bool Returns false if the new image is full
+ */
+static bool DEFRAG_Allocate(DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t sumCluster, uint32_t *const firstCluster);
+
+/**  DEFRAG_CopyFolder
+ * @brief Copy a folder and everything below it. The folder takes its clusters first, then each entry in order
+ * @param[in] rewrite state of the rewrite
+ * @param[in] oldCluster first cluster of folder in the mounted volume (0 : root of fat 12/16)
+ * @param[in] newParent first cluster of the parent in the new image (0 : root)
+ * @param[out] newCluster first cluster of folder in the new image (0 for the root of fat 12/16)
+ * @param[in] depth depth of folder
+ * @return bool Returns true if success
+ */
+static bool DEFRAG_CopyFolder(DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t oldCluster, const uint32_t newParent, uint32_t *const newCluster, const uint32_t depth);
+
+/**  DEFRAG_SetCluster
+ * @brief Set the first cluster of a directory entry
+ * @param[in] rewrite state of the rewrite
+ * @param[out] entry directory entry
+ * @param[in] cluster first cluster
+ * @return none
+ */
+static void DEFRAG_SetCluster(const DEFRAG_Rewrite_Struct_t *const rewrite, uint8_t *const entry, const uint32_t cluster);
+
+/**  DEFRAG_WriteSystemArea
+ * @brief Write the reserved sectors (root cluster and FSInfo updated) and every copy of the new FAT
+ * @param[in] rewrite state of the rewrite
+ * @param[in] rootCluster first cluster of root in the new image (fat 32)
+ * @return bool Returns true if success
+ */
+static bool DEFRAG_WriteSystemArea(DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t rootCluster);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool DEFRAG_Rewrite(const uint8_t *const imagePath, const uint8_t *const outputPath)
+{
+    bool status = true; /*return value */
+    DEFRAG_Rewrite_Struct_t rewrite;
+    struct stat imageStat;
+    uint8_t temporaryPath[4096];
+    uint32_t rootCluster = 0;
+    uint32_t i = 0; /*Index value*/
+
+    memset(&rewrite, 0, sizeof(rewrite));
+    FATFS_GetVolumeInfo(&rewrite.info);
+    rewrite.fileDescriptor = -1;
+    rewrite.nextCluster = 2;
+    rewrite.endOfChain = (32u == rewrite.info.fatType) ? 0x0fffffffu : ((16u == rewrite.info.fatType) ? 0xffffu : 0xfffu);
+    rewrite.badCluster = rewrite.endOfChain - 8u;
+    rewrite.sizeOfCluster = (uint32_t)rewrite.info.bytePerSector * rewrite.info.sectorPerCluster;
+    rewrite.status = true;
+    rewrite.fat = (uint32_t *)STATS_Calloc(rewrite.info.totalClusters + 2u, sizeof(uint32_t));
+    rewrite.visited = (uint8_t *)STATS_Calloc((rewrite.info.totalClusters + 2u) / 8u + 1u, sizeof(uint8_t));
+    rewrite.buffer = (uint8_t *)STATS_Malloc(DEFRAG_WRITE_BUFFER_SIZE);
+    status = (NULL != rewrite.fat) && (NULL != rewrite.visited) && (NULL != rewrite.buffer) && (0 == stat((const char *)imagePath, &imageStat));
+
+    /*Write to a temporary file then rename, so the output is never a partial image*/
+    if (true == status)
+    {
+        snprintf((char *)temporaryPath, sizeof(temporaryPath), "%s.tmp", outputPath);
+        rewrite.fileDescriptor = open((const char *)temporaryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        /*Same size as the image, unused clusters stay holes*/
+        status = (0 <= rewrite.fileDescriptor) && (0 == ftruncate(rewrite.fileDescriptor, imageStat.st_size));
+    }
+
+    if (true == status)
+    {
+        /*Bad clusters stay bad, the first two elements are copied*/
+        for (i = 0; i < (rewrite.info.totalClusters + 2u); i++)
+        {
+            (void)FATFS_GetNextCluster(i, &rewrite.fat[i]);
+            if ((2u <= i) && (rewrite.badCluster != rewrite.fat[i]))
+            {
+                rewrite.fat[i] = 0;
+            }
+        }
+        status = DEFRAG_CopyFolder(&rewrite, rewrite.info.rootCluster, 0, &rootCluster, 0);
+        DEFRAG_Flush(&rewrite);
+        status = (true == status) && (true == rewrite.status) && (true == DEFRAG_WriteSystemArea(&rewrite, rootCluster));
+    }
+
+    if (0 <= rewrite.fileDescriptor)
+    {
+        status = (0 == close(rewrite.fileDescriptor)) && (true == status);
+        if (true == status)
+        {
+            status = (0 == rename((const char *)temporaryPath, (const char *)outputPath));
+        }
+        else
+        {
+            unlink((const char *)temporaryPath);
+        }
+    }
+    free(rewrite.buffer);
+    free(rewrite.visited);
+    free(rewrite.fat);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void DEFRAG_Write(DEFRAG_Rewrite_Struct_t *const rewrite, const uint64_t offset, const uint8_t *data, uint32_t size)
+{
+    uint64_t position = offset;
+    uint32_t sizeToCopy = 0;
+
+    while ((true == rewrite->status) && (0 != size))
+    {
+        if ((position != (rewrite->offsetOfBuffer + rewrite->sizeOfBuffer)) || (DEFRAG_WRITE_BUFFER_SIZE == rewrite->sizeOfBuffer))
+        {
+            DEFRAG_Flush(rewrite);
+            rewrite->offsetOfBuffer = position;
+        }
+        sizeToCopy = DEFRAG_WRITE_BUFFER_SIZE - rewrite->sizeOfBuffer;
+        if (size < sizeToCopy)
+        {
+            sizeToCopy = size;
+        }
+        memcpy(&rewrite->buffer[rewrite->sizeOfBuffer], data, sizeToCopy);
+        rewrite->sizeOfBuffer += sizeToCopy;
+        data += sizeToCopy;
+        position += sizeToCopy;
+        size -= sizeToCopy;
+    }
+}
+
+static void DEFRAG_Flush(DEFRAG_Rewrite_Struct_t *const rewrite)
+{
+    uint32_t sumByte = 0;
+    ssize_t sizeOfWrite = 0;
+
+    while ((true == rewrite->status) && (sumByte < rewrite->sizeOfBuffer))
+    {
+        sizeOfWrite = pwrite(rewrite->fileDescriptor, &rewrite->buffer[sumByte], rewrite->sizeOfBuffer - sumByte, (off_t)(rewrite->offsetOfBuffer + sumByte));
+        if (0 >= sizeOfWrite)
+        {
+            rewrite->status = false;
+        }
+        else
+        {
+            sumByte += sizeOfWrite;
+        }
+    }
+    rewrite->offsetOfBuffer += rewrite->sizeOfBuffer;
+    rewrite->sizeOfBuffer = 0;
+}
+
+static bool DEFRAG_CopyData(const uint8_t *const data, const uint32_t size, void *const context)
+{
+    DEFRAG_Rewrite_Struct_t *const rewrite = (DEFRAG_Rewrite_Struct_t *)context;
+
+    DEFRAG_Write(rewrite, rewrite->offset, data, size);
+    rewrite->offset += size;
+
+    return rewrite->status;
+}
+
+static bool DEFRAG_ReadFolder(const uint8_t *const data, const uint32_t size, void *const context)
+{
+    DEFRAG_Folder_Struct_t *const folder = (DEFRAG_Folder_Struct_t *)context;
+
+    memcpy(&folder->data[folder->size], data, size);
+    folder->size += size;
+
+    return true;
+}
+
+static uint32_t DEFRAG_ChainLength(const DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t firstCluster)
+{
+    uint32_t sumCluster = 1; /*return value */
+    uint32_t cluster = firstCluster;
+
+    while ((true == FATFS_GetNextCluster(cluster, &cluster)) && (sumCluster < rewrite->info.totalClusters))
+    {
+        sumCluster++;
+    }
+
+    return sumCluster;
+}
+
+static bool DEFRAG_Allocate(DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t sumCluster, uint32_t *const firstCluster)
+{
+    bool status = true; /*return value */
+    uint32_t start = rewrite->nextCluster;
+    uint32_t i = 0; /*Index value*/
+
+    /*Move the run after any bad cluster it would cover*/
+    for (i = 0; (true == status) && (i < sumCluster); i++)
+    {
+        if ((start + i) >= (rewrite->info.totalClusters + 2u))
+        {
+            status = false;
+        }
+        else if (rewrite->badCluster == rewrite->fat[start + i])
+        {
+            start = start + i + 1u;
+            i = (uint32_t)-1; /*Check again from the new start*/
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    if (true == status)
+    {
+        for (i = 0; (i + 1u) < sumCluster; i++)
+        {
+            rewrite->fat[start + i] = start + i + 1u;
+        }
+        rewrite->fat[start + sumCluster - 1u] = rewrite->endOfChain;
+        rewrite->nextCluster = start + sumCluster;
+        *firstCluster = start;
+    }
+
+    return status;
+}
+
+static bool DEFRAG_CopyFolder(DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t oldCluster, const uint32_t newParent, uint32_t *const newCluster, const uint32_t depth)
+{
+    bool status = true; /*return value */
+    DEFRAG_Folder_Struct_t folder;
+    uint8_t *entry = NULL;
+    uint32_t sumCluster = 0;
+    uint32_t sumClusterNeeded = 0;
+    uint32_t cluster = 0;
+    uint32_t childCluster = 0;
+    uint32_t fileSize = 0;
+    uint32_t i = 0; /*Offset of entry*/
+
+    memset(&folder, 0, sizeof(folder));
+    *newCluster = 0;
+    if (0 == oldCluster)
+    {
+        /*Root of fat 12/16 : fixed area before the data region*/
+        folder.size = (rewrite->info.locationOfData - rewrite->info.locationOfRoot) * rewrite->info.bytePerSector;
+        folder.data = (uint8_t *)STATS_Malloc(folder.size);
+        status = (NULL != folder.data) &&
+                 ((int32_t)folder.size == HAL_ReadMultiSector(rewrite->info.locationOfRoot, rewrite->info.locationOfData - rewrite->info.locationOfRoot, folder.data));
+    }
+    else if ((DEFRAG_MAX_DEPTH <= depth) || (oldCluster >= (rewrite->info.totalClusters + 2u)) || (0 != (rewrite->visited[oldCluster / 8u] & (1u << (oldCluster % 8u)))))
+    {
+        status = false; /*Looping tree*/
+    }
+    else
+    {
+        rewrite->visited[oldCluster / 8u] |= (uint8_t)(1u << (oldCluster % 8u));
+        sumCluster = DEFRAG_ChainLength(rewrite, oldCluster);
+        folder.data = (uint8_t *)STATS_Malloc((size_t)sumCluster * rewrite->sizeOfCluster);
+        status = (NULL != folder.data) && (true == FATFS_StreamData(oldCluster, sumCluster * rewrite->sizeOfCluster, DEFRAG_ReadFolder, &folder)) &&
+                 (true == DEFRAG_Allocate(rewrite, sumCluster, newCluster));
+    }
+
+    /*Entries in order : each one takes the next clusters*/
+    for (i = 0; (true == status) && ((i + DEFRAG_SIZE_ENTRY) <= folder.size); i += DEFRAG_SIZE_ENTRY)
+    {
+        entry = &folder.data[i];
+        if (0 == entry[0])
+        {
+            break; /*End of folder*/
+        }
+        if ((DEFRAG_ATTRIBUTE_LONG_FILE_NAME == entry[DEFRAG_ATTRIBUTE_OFFSET]) || (0 != (entry[DEFRAG_ATTRIBUTE_OFFSET] & DEFRAG_ATTRIBUTE_VOLUME_LABEL)))
+        {
+            continue;
+        }
+        if (DEFRAG_DELETED_ENTRY == entry[0])
+        {
+            DEFRAG_SetCluster(rewrite, entry, 0); /*Its old clusters are not copied*/
+            continue;
+        }
+        if ('.' == entry[0])
+        {
+            DEFRAG_SetCluster(rewrite, entry, ('.' == entry[1]) ? newParent : *newCluster);
+            continue;
+        }
+
+        cluster = DEFRAG_READ_2_BYTES(&entry[DEFRAG_LOW_CLUSTER_OFFSET]);
+        if (32u == rewrite->info.fatType)
+        {
+            cluster |= DEFRAG_READ_2_BYTES(&entry[DEFRAG_HIGH_CLUSTER_OFFSET]) << 16u;
+        }
+        fileSize = DEFRAG_READ_4_BYTES(&entry[DEFRAG_FILE_SIZE_OFFSET]);
+        childCluster = 0;
+        if (0 != (entry[DEFRAG_ATTRIBUTE_OFFSET] & FATFS_ATTRIBUTE_DIRECTORY))
+        {
+            if (0 != cluster)
+            {
+                status = DEFRAG_CopyFolder(rewrite, cluster, (0 == depth) ? 0 : *newCluster, &childCluster, depth + 1u); /*".." of a folder of the root is 0*/
+            }
+        }
+        else if ((0 != fileSize) && (2u <= cluster) && (cluster < (rewrite->info.totalClusters + 2u)))
+        {
+            /*Clusters after the size of file are not copied*/
+            sumClusterNeeded = (fileSize - 1u) / rewrite->sizeOfCluster + 1u;
+            sumCluster = DEFRAG_ChainLength(rewrite, cluster);
+            if (sumCluster > sumClusterNeeded)
+            {
+                sumCluster = sumClusterNeeded;
+            }
+            status = DEFRAG_Allocate(rewrite, sumCluster, &childCluster);
+            if (true == status)
+            {
+                rewrite->offset = ((uint64_t)rewrite->info.locationOfData + (uint64_t)(childCluster - 2u) * rewrite->info.sectorPerCluster) * rewrite->info.bytePerSector;
+                status = FATFS_StreamData(cluster, sumCluster * rewrite->sizeOfCluster, DEFRAG_CopyData, rewrite);
+            }
+        }
+        else
+        {
+            /*Empty file*/
+        }
+        DEFRAG_SetCluster(rewrite, entry, childCluster);
+    }
+
+    /*The folder is written once its entries point to the new clusters*/
+    if (true == status)
+    {
+        if (0 == oldCluster)
+        {
+            DEFRAG_Write(rewrite, (uint64_t)rewrite->info.locationOfRoot * rewrite->info.bytePerSector, folder.data, folder.size);
+        }
+        else
+        {
+            DEFRAG_Write(rewrite, ((uint64_t)rewrite->info.locationOfData + (uint64_t)(*newCluster - 2u) * rewrite->info.sectorPerCluster) * rewrite->info.bytePerSector, folder.data,
+                         folder.size);
+        }
+    }
+    free(folder.data);
+
+    return status;
+}
+
+static void DEFRAG_SetCluster(const DEFRAG_Rewrite_Struct_t *const rewrite, uint8_t *const entry, const uint32_t cluster)
+{
+    entry[DEFRAG_LOW_CLUSTER_OFFSET] = (uint8_t)cluster;
+    entry[DEFRAG_LOW_CLUSTER_OFFSET + 1u] = (uint8_t)(cluster >> 8u);
+    if (32u == rewrite->info.fatType)
+    {
+        entry[DEFRAG_HIGH_CLUSTER_OFFSET] = (uint8_t)(cluster >> 16u);
+        entry[DEFRAG_HIGH_CLUSTER_OFFSET + 1u] = (uint8_t)(cluster >> 24u);
+    }
+}
+
+static bool DEFRAG_WriteSystemArea(DEFRAG_Rewrite_Struct_t *const rewrite, const uint32_t rootCluster)
+{
+    bool status = true; /*return value */
+    const uint32_t sizeOfReserved = rewrite->info.locationOfFirstFat * rewrite->info.bytePerSector;
+    const uint32_t sizeOfFat = rewrite->info.sectorPerFat * rewrite->info.bytePerSector;
+    uint8_t *reserved = NULL;
+    uint8_t *fat = NULL;
+    uint32_t sectorOfFsInfo = 0;
+    uint32_t sumFree = 0;
+    uint32_t i = 0; /*Index value*/
+    uint32_t j = 0; /*Byte of FAT*/
+
+    reserved = (uint8_t *)STATS_Malloc(sizeOfReserved);
+    fat = (uint8_t *)STATS_Calloc(sizeOfFat + 4u, sizeof(uint8_t));
+    status = (NULL != reserved) && (NULL != fat) && ((int32_t)sizeOfReserved == HAL_ReadMultiSector(0, rewrite->info.locationOfFirstFat, reserved));
+
+    /*Root cluster and FSInfo of fat 32*/
+    if ((true == status) && (32u == rewrite->info.fatType))
+    {
+        reserved[DEFRAG_ROOT_CLUSTER_OFFSET] = (uint8_t)rootCluster;
+        reserved[DEFRAG_ROOT_CLUSTER_OFFSET + 1u] = (uint8_t)(rootCluster >> 8u);
+        reserved[DEFRAG_ROOT_CLUSTER_OFFSET + 2u] = (uint8_t)(rootCluster >> 16u);
+        reserved[DEFRAG_ROOT_CLUSTER_OFFSET + 3u] = (uint8_t)(rootCluster >> 24u);
+        sectorOfFsInfo = DEFRAG_READ_2_BYTES(&reserved[DEFRAG_FS_INFO_SECTOR_OFFSET]);
+        if ((0 != sectorOfFsInfo) && (sectorOfFsInfo < rewrite->info.locationOfFirstFat) &&
+            (DEFRAG_FS_INFO_LEAD_SIGNATURE == DEFRAG_READ_4_BYTES(&reserved[sectorOfFsInfo * rewrite->info.bytePerSector])))
+        {
+            for (i = 2; i < (rewrite->info.totalClusters + 2u); i++)
+            {
+                sumFree += (0 == rewrite->fat[i]) ? 1u : 0u;
+            }
+            for (i = 0; i < 4u; i++)
+            {
+                reserved[sectorOfFsInfo * rewrite->info.bytePerSector + DEFRAG_FS_INFO_FREE_COUNT_OFFSET + i] = (uint8_t)(sumFree >> (8u * i));
+                reserved[sectorOfFsInfo * rewrite->info.bytePerSector + DEFRAG_FS_INFO_NEXT_FREE_OFFSET + i] = (uint8_t)(rewrite->nextCluster >> (8u * i));
+            }
+        }
+    }
+
+    /*Encode the FAT*/
+    for (i = 0; (true == status) && (i < (rewrite->info.totalClusters + 2u)); i++)
+    {
+        if (32u == rewrite->info.fatType)
+        {
+            j = 4u * i;
+            fat[j] = (uint8_t)rewrite->fat[i];
+            fat[j + 1u] = (uint8_t)(rewrite->fat[i] >> 8u);
+            fat[j + 2u] = (uint8_t)(rewrite->fat[i] >> 16u);
+            fat[j + 3u] = (uint8_t)(rewrite->fat[i] >> 24u);
+        }
+        else if (16u == rewrite->info.fatType)
+        {
+            j = 2u * i;
+            fat[j] = (uint8_t)rewrite->fat[i];
+            fat[j + 1u] = (uint8_t)(rewrite->fat[i] >> 8u);
+        }
+        else
+        {
+            /*Two elements share 3 bytes*/
+            j = i + i / 2u;
+            if (0 == (i % 2u))
+            {
+                fat[j] = (uint8_t)rewrite->fat[i];
+                fat[j + 1u] = (uint8_t)((fat[j + 1u] & 0xf0u) | ((rewrite->fat[i] >> 8u) & 0x0fu));
+            }
+            else
+            {
+                fat[j] = (uint8_t)((fat[j] & 0x0fu) | ((rewrite->fat[i] << 4u) & 0xf0u));
+                fat[j + 1u] = (uint8_t)(rewrite->fat[i] >> 4u);
+            }
+        }
+    }
+
+    if (true == status)
+    {
+        DEFRAG_Write(rewrite, 0, reserved, sizeOfReserved);
+        for (i = 0; i < rewrite->info.numberOfFat; i++)
+        {
+            DEFRAG_Write(rewrite, (uint64_t)(rewrite->info.locationOfFirstFat + i * rewrite->info.sectorPerFat) * rewrite->info.bytePerSector, fat, sizeOfFat);
+        }
+        DEFRAG_Flush(rewrite);
+        status = rewrite->status;
+    }
+    free(fat);
+    free(reserved);
+
+    return status;
+}
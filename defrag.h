@@ -0,0 +1,18 @@
+#ifndef __DEFRAG_H__
+#define __DEFRAG_H__
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  DEFRAG_Rewrite
+ * @brief Write a copy of the mounted volume where every folder and file is contiguous, in the order a recursive
+ *        read visits them (folder, then its entries in order). Same FAT type and geometry, folders are copied as
+ *        they are (names, dates, attributes) with only their cluster numbers changed. The volume must be mounted with FATFS_Init
+ * @param[in] imagePath   Path of the mounted image (reserved sectors are copied from it)
+ * @param[in] outputPath   Path of the new image
+ * @return bool Returns false if the volume has a looping tree or the new image could not be written
+ */
+bool DEFRAG_Rewrite(const uint8_t *const imagePath, const uint8_t *const outputPath);
+
+#endif /*__DEFRAG_H__*/
@@ -6,7 +6,17 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "hal.h"
+#include "mystring.h"
+#include "alloc.h"
+#include "stats.h"
 #include "fatfs.h"
 
 /*******************************************************************************
@@ -44,7 +54,7 @@
  */
 
 #define FATFS_ATTRIBUTE_OF_FILE_OFFSET (11u)
-#define FATFS_CREATE_TIME_FILE_OFFSET (13u)
+#define FATFS_CREATE_TIME_FILE_OFFSET (14u) /*Byte 13 holds the tenths of second*/
 #define FATFS_CREATE_DATE_FILE_OFFSET (16u)
 #define FATFS_LAST_ACCESS_DATE_FILE_OFFSET (18u)
 #define FATFS_HIGH_WORD_OF_ADDRESS_CLUSTER_OFFSET (20u)
@@ -53,6 +63,7 @@
 #define FATFS_LOW_WORD_OF_ADDRESS_CLUSTER_OFFSET (26u)
 #define FATFS_FILE_SIZE_OFFSET (28u)
 #define FATFS_STATRT_CLUSTER_ROOT_FAT32_OFFSET (44u)
+#define FATFS_FS_INFO_SECTOR_OFFSET (48u)
 
 #define FATFS_FIELD_SECONDS_SHIFT_RIGHT (0u)
 #define FATFS_FIELD_MINUTES_SHIFT_RIGHT (5u)
@@ -73,6 +84,24 @@
 #define FATFS_SIZE_ENTRY_BYTE (32u)
 #define FATFS_SUB_ENTRY (15u)
 #define FATFS_END_OF_ENTRY (0u)
+#define FATFS_DELETED_ENTRY (0xe5u)
+
+/*
+ * Macros are used to read information in the sub entry (LFN)
+ */
+
+#define FATFS_SUB_ENTRY_ORDER_MASK (0x1fu)
+#define FATFS_SUB_ENTRY_LAST_MASK (0x40u)
+#define FATFS_SUB_ENTRY_CHECK_SUM_OFFSET (13u)
+#define FATFS_SIZE_SHORT_NAME (11u)
+#define FATFS_SIZE_NAME (8u)
+#define FATFS_SIZE_EXTENSION (3u)
+#define FATFS_KANJI_E5_ENTRY (0x05u) /*First byte 0x05 stands for a name starting with the character 0xe5*/
+
+/*
+ * Upper 4 bits of a fat 32 element are reserved
+ */
+#define FATFS_FAT32_ELEMENT_MASK (0x0fffffff)
 
 /*************************************************************/
 
@@ -86,6 +115,65 @@
 
 /*************************************************************/
 
+/*
+ * Maximum size of one read when streaming file data (rounded down to whole clusters)
+ */
+#define FATFS_STREAM_CHUNK_BYTE (1024u * 1024u)
+
+/*************************************************************/
+
+/*
+ * FSInfo sector of fat 32
+ */
+#define FATFS_FS_INFO_LEAD_SIGNATURE (0x41615252u)
+#define FATFS_FS_INFO_STRUCT_SIGNATURE (0x61417272u)
+#define FATFS_FS_INFO_STRUCT_SIGNATURE_OFFSET (484u)
+#define FATFS_FS_INFO_FREE_COUNT_OFFSET (488u)
+#define FATFS_FS_INFO_NEXT_FREE_OFFSET (492u)
+#define FATFS_FS_INFO_UNKNOWN (0xffffffffu)
+
+/*************************************************************/
+
+/*
+ * Limits of FATFS_Find
+ */
+#define FATFS_FIND_MAX_COMPONENT (63u) /*A state of the search is a 64 bits set of positions in the pattern*/
+#define FATFS_FIND_MAX_THREAD (64u)
+#define FATFS_FIND_MAX_PATH (4096u)
+
+#define FATFS_ATTRIBUTE_VOLUME_LABEL (0x08u)
+#define FATFS_ATTRIBUTE_ARCHIVE (0x20u)
+
+/*
+ * Write-back cache of folder sectors (open addressing, 2^FATFS_CACHE_BITS sectors). It is flushed and
+ * emptied when 3/4 of the slots are used
+ */
+#define FATFS_CACHE_BITS (12u)
+#define FATFS_CACHE_SIZE (1u << FATFS_CACHE_BITS)
+#define FATFS_CACHE_EMPTY (0u)
+#define FATFS_CACHE_CLEAN (1u)
+#define FATFS_CACHE_DIRTY (2u)
+#define FATFS_FLUSH_MAX_SECTOR (256u) /*Sectors merged into one write by FATFS_Flush*/
+
+#define FATFS_LOCATION_ROOT (0xffffffffu) /*Slot of the root directory, which has no entry*/
+#define FATFS_SHORT_NAME_MAX_TAIL (9999u) /*Largest N of a generated short name "NAME~N"*/
+#define FATFS_LONG_FILE_NAME_MAX_LENGTH (255u)
+
+#define FATFS_PUT_2_BYTES(x, value)                \
+    do                                             \
+    {                                              \
+        (x)[0] = (uint8_t)(value);                 \
+        (x)[1] = (uint8_t)((uint32_t)(value) >> 8u); \
+    } while (0)
+#define FATFS_PUT_4_BYTES(x, value)                        \
+    do                                                     \
+    {                                                      \
+        FATFS_PUT_2_BYTES((x), (value));                   \
+        FATFS_PUT_2_BYTES(&(x)[2], (uint32_t)(value) >> 16u); \
+    } while (0)
+
+/*************************************************************/
+
 /*
  * struct stores information of fat flie
  */
@@ -100,16 +188,71 @@ typedef struct
     uint32_t locationOfRoot;            /*Location of the first sector of root directory*/
     uint32_t locationOfData;            /*Location of the first sector of data region*/
     uint32_t stratClusterOfRootOfFat32; /*First cluster of root directory (using in FAT32)*/
+    uint32_t totalClusters;             /*Number of clusters of the data region*/
+    uint16_t sectorOfFsInfo;            /*Sector of FSInfo (using in FAT32, 0 otherwise)*/
 } FATFS_FatFileSystemInfo_Struct_t;
 
 /*
- *Struct for list of long file name
+ *Folder waiting to be read by FATFS_Find
+ */
+typedef struct __FATFS_FindItem_struct_t
+{
+    uint32_t cluster;                       /*First cluster of folder (0 : root)*/
+    uint64_t state;                         /*Positions of the pattern reached at this folder*/
+    struct __FATFS_FindItem_struct_t *next; /*Next folder waiting*/
+    uint8_t path[];                         /*Path of folder*/
+} FATFS_FindItem_struct_t;
+
+/*
+ *State shared by the threads of FATFS_Find
+ */
+typedef struct
+{
+    pthread_mutex_t lock;                                  /*Protects the fields below and the callback*/
+    pthread_cond_t wake;                                   /*Signaled when a folder is added or the search ends*/
+    FATFS_FindItem_struct_t *head;                         /*Folders waiting to be read*/
+    uint32_t sumPending;                                   /*Folders waiting or being read*/
+    bool stop;                                             /*Set when the callback returns false*/
+    uint8_t *visited;                                      /*Bitmap of folders already queued, to stop on a looping tree*/
+    const uint8_t *component[FATFS_FIND_MAX_COMPONENT];    /*Components of the pattern*/
+    uint32_t componentLength[FATFS_FIND_MAX_COMPONENT];    /*Length of each component*/
+    bool isAnyFolder[FATFS_FIND_MAX_COMPONENT];            /*true for "**"*/
+    uint32_t sumComponent;                                 /*Number of components*/
+    FATFS_FindCallback_t callback;
+    void *context;
+} FATFS_FindContext_struct_t;
+
+/*
+ *Slot of the write-back cache
+ */
+typedef struct
+{
+    uint32_t sector; /*Sector held by the slot*/
+    uint8_t state;   /*FATFS_CACHE_EMPTY, FATFS_CACHE_CLEAN or FATFS_CACHE_DIRTY*/
+} FATFS_CacheSlot_struct_t;
+
+/*
+ *Where the entry of a file or folder is stored
  */
-typedef struct __FATFS_LongFileName_struct_t
+typedef struct
+{
+    uint32_t folder;      /*First cluster of the folder holding the entry (0 : root)*/
+    uint32_t slot;        /*Slot of the main entry from the start of the folder (FATFS_LOCATION_ROOT : root)*/
+    uint32_t sumSubEntry; /*Number of sub entries stored before the main entry*/
+} FATFS_Location_struct_t;
+
+/*
+ *Cursor over the 32 bytes slots of a folder, used to change entries
+ */
+typedef struct
 {
-    uint8_t stringName[27]; /*In the sub-entry up to 26 characters of the file name are stored + 1 '\0'*/
-    struct __FATFS_LongFileName_struct_t *next;
-} FATFS_LongFileName_struct_t;
+    uint32_t cluster;        /*Cluster holding the slot (0 : root of fat 12/16)*/
+    uint32_t sector;         /*Sector holding the slot*/
+    uint32_t sectorInBlock;  /*Index of sector in the cluster (or in the root of fat 12/16)*/
+    uint32_t offset;         /*Offset of the slot in the sector*/
+    uint32_t slot;           /*Slot number from the start of the folder*/
+    uint32_t sumClusterRead; /*Used to stop on a looping chain*/
+} FATFS_Slot_struct_t;
 
 /*******************************************************************************
  * Variables
@@ -119,32 +262,323 @@ static FATFS_FatFileSystemInfo_Struct_t s_InformationOfFatFs; /*Stores informati
 static FATFS_ListEntry_struct_t *s_HeadOfListEntry = NULL;    /*Head pointer of entry list*/
 static uint32_t *s_BufferForFat = NULL;                       /*Store information of FAT table*/
 static uint32_t s_EndOfFile = 0;                              /*Check what kind of fat this is. It is also a condition used to check the end of the file*/
+static uint32_t s_SumElementOfFat = 0;                        /*Number of elements in s_BufferForFat*/
+static bool s_IsWritable = false;                             /*Volume opened by FATFS_InitWritable*/
+static uint8_t *s_RawFat = NULL;                              /*Bytes of the first FAT, used to encode changed elements*/
+static uint8_t *s_DirtyFat = NULL;                            /*Bitmap of FAT sectors changed since the last flush*/
+static FATFS_CacheSlot_struct_t *s_Cache = NULL;              /*Write-back cache of folder sectors*/
+static uint8_t *s_CacheData = NULL;                           /*Data of the cache slots*/
+static uint32_t s_SumCacheUsed = 0;                           /*Number of slots used*/
+static uint32_t s_SumFreeCluster = 0;                         /*Free clusters, written to FSInfo by FATFS_Flush*/
+static uint32_t s_NextFreeCluster = 2;                        /*Free cluster hint written to FSInfo*/
+static FATFS_Location_struct_t *s_Preallocated = NULL;        /*Files having clusters after their end (FATFS_PreallocateFile)*/
+static uint32_t s_SumPreallocated = 0;
+
+/*
+ * Position of the 13 UTF-16 characters inside a sub entry
+ */
+static const uint8_t s_OffsetOfLongFileName[FATFS_CHARACTERS_PER_SUB_ENTRY] = {1u, 3u, 5u, 7u, 9u, 14u, 16u, 18u, 20u, 22u, 24u, 28u, 30u};
 
 /*******************************************************************************
  * Prototypes
  ******************************************************************************/
 
 /** FATFS_ProcessSubEntry
- * @brief Processing sub entry
+ * @brief Processing sub entry. The characters are stored in the LFN state of the iterator
  * @param[in] buffer array of entry
- * @param[out] node for list entry
+ * @param[in,out] dir directory iterator
  * @return bool Returns true if this is a sub entry
  */
-static bool FATFS_ProcessSubEntry(const uint8_t *const buffer, FATFS_ListEntry_struct_t *const node);
+static bool FATFS_ProcessSubEntry(const uint8_t *const buffer, FATFS_Dir_Struct_t *const dir);
 
 /** FATFS_ProcessMainEntry
  * @brief Processing main entry
  * @param[in] buffer array of entry
- * @param[out] node for list entry
+ * @param[out] entry information of the entry
  * @return bool Returns true if this is a main entry
  */
-static bool FATFS_ProcessMainEntry(const uint8_t *const buffer, FATFS_ListEntry_struct_t *const node);
+static bool FATFS_ProcessMainEntry(const uint8_t *const buffer, FATFS_Entry_Struct_t *const entry);
+
+/** FATFS_CalculateCheckSum
+ * @brief Check sum of a short name, stored in every sub entry of its LFN
+ * @param[in] shortName 11 bytes of the short name (name + extension)
+ * @return uint8_t check sum
+ */
+static uint8_t FATFS_CalculateCheckSum(const uint8_t *const shortName);
+
+/** FATFS_DirReadBlock
+ * @brief Read the next cluster (or block of the root of fat 12/16) of a directory into the iterator
+ * @param[in,out] dir directory iterator
+ * @return bool Returns true if data was read
+ */
+static bool FATFS_DirReadBlock(FATFS_Dir_Struct_t *const dir);
+
+/** FATFS_IsValidCluster
+ * @brief Check that a value read from the FAT is a cluster of the data region (not free, bad or end of chain)
+ * @param[in] cluster value to check
+ * @return bool Returns true if the cluster can be read
+ */
+static bool FATFS_IsValidCluster(const uint32_t cluster);
+
+/** FATFS_FindClosure
+ * @brief Add the positions reachable by letting "**" match no folder
+ * @param[in] find search
+ * @param[in] state positions of the pattern
+ * @return uint64_t Returns the completed positions
+ */
+static uint64_t FATFS_FindClosure(const FATFS_FindContext_struct_t *const find, uint64_t state);
+
+/** FATFS_ReadFsInfo
+ * @brief Read free count and next free hint from the FSInfo sector of fat 32
+ * @param[out] stats receiver
+ * @return bool Returns true if the sector is valid and its free count is known
+ */
+static bool FATFS_ReadFsInfo(FATFS_Stats_Struct_t *const stats);
+
+/** FATFS_ScanFat
+ * @brief Count free and bad clusters and find the largest free run in the FAT loaded in memory
+ * @param[out] stats receiver
+ * @return none
+ */
+static void FATFS_ScanFat(FATFS_Stats_Struct_t *const stats);
+
+/** FATFS_FindStep
+ * @brief Move the positions of the pattern over one name
+ * @param[in] find search
+ * @param[in] state positions before the name
+ * @param[in] longName long name of the entry (may be empty)
+ * @param[in] shortName short name of the entry
+ * @return uint64_t Returns the positions after the name (bit sumComponent set : the entry matches)
+ */
+static uint64_t FATFS_FindStep(const FATFS_FindContext_struct_t *const find, const uint64_t state, const uint8_t *const longName, const uint8_t *const shortName);
+
+/** FATFS_FindWorker
+ * @brief Thread of FATFS_Find : read waiting folders until there is none left
+ * @param[in] argument search (FATFS_FindContext_struct_t)
+ * @return void* NULL
+ */
+static void *FATFS_FindWorker(void *argument);
+
+/** FATFS_Mount
+ * @brief Read the boot sector and the FAT
+ * @param[in] isOpen result of the HAL_Init function opening the image
+ * @param[in] isWritable true if the image is open for writing : keep what is needed to change it
+ * @return bool Returns true if success
+ */
+static bool FATFS_Mount(const bool isOpen, const bool isWritable);
+
+/** FATFS_Locate
+ * @brief Find an entry from its path and where it is stored
+ * @param[in] path path from the root directory
+ * @param[out] entry receiver of the entry
+ * @param[out] location receiver of the place of the entry (may be NULL)
+ * @return bool Returns true if the entry was found
+ */
+static bool FATFS_Locate(const uint8_t *const path, FATFS_Entry_Struct_t *const entry, FATFS_Location_struct_t *const location);
+
+/** FATFS_SetFat
+ * @brief Change an element of the FAT in memory and mark its sector to be flushed
+ * @param[in] cluster element
+ * @param[in] value new value
+ * @return none
+ */
+static void FATFS_SetFat(const uint32_t cluster, const uint32_t value);
+
+/** FATFS_CacheGet
+ * @brief Get a folder sector from the write-back cache, reading it if it is not there
+ * @param[in] sector sector
+ * @param[in] isWrite true if the caller changes the sector
+ * @param[in] isNew true to fill the sector with zeros instead of reading it
+ * @return uint8_t* Returns the data of the sector (valid until the next call) or NULL if it can not be read
+ */
+static uint8_t *FATFS_CacheGet(const uint32_t sector, const bool isWrite, const bool isNew);
+
+/** FATFS_CacheFind
+ * @brief Find the slot of a sector in the cache
+ * @param[in] sector sector
+ * @return uint32_t Returns the slot holding the sector or the empty slot where it would be stored
+ */
+static uint32_t FATFS_CacheFind(const uint32_t sector);
+
+/** FATFS_CacheOverlay
+ * @brief Copy changed sectors of the cache over sectors just read from the image
+ * @param[in] firstSector first sector read
+ * @param[in] sumSector number of sectors read
+ * @param[in,out] buffer data read
+ * @return none
+ */
+static void FATFS_CacheOverlay(const uint32_t firstSector, const uint32_t sumSector, uint8_t *const buffer);
+
+/** FATFS_CacheDiscard
+ * @brief Forget the changes of sectors that are no longer part of a folder
+ * @param[in] firstSector first sector
+ * @param[in] sumSector number of sectors
+ * @return none
+ */
+static void FATFS_CacheDiscard(const uint32_t firstSector, const uint32_t sumSector);
+
+/** FATFS_CompareSector
+ * @brief Compare two keys (sector << 32 | slot) for qsort
+ * @param[in] first first key
+ * @param[in] second second key
+ * @return int order
+ */
+static int FATFS_CompareSector(const void *first, const void *second);
+
+/** FATFS_SlotSeek
+ * @brief Place a cursor on a slot of a folder
+ * @param[out] cursor cursor
+ * @param[in] folder first cluster of folder (0 : root)
+ * @param[in] slot slot number
+ * @return bool Returns false if the folder is shorter
+ */
+static bool FATFS_SlotSeek(FATFS_Slot_struct_t *const cursor, const uint32_t folder, const uint32_t slot);
+
+/** FATFS_SlotNext
+ * @brief Move a cursor to the next slot
+ * @param[in,out] cursor cursor
+ * @return bool Returns false at the end of the folder (the cursor keeps its last cluster)
+ */
+static bool FATFS_SlotNext(FATFS_Slot_struct_t *const cursor);
+
+/** FATFS_SlotData
+ * @brief Get the 32 bytes of the slot under a cursor
+ * @param[in] cursor cursor
+ * @param[in] isWrite true if the caller changes the slot
+ * @return uint8_t* Returns the slot (valid until the next access to the cache) or NULL
+ */
+static uint8_t *FATFS_SlotData(const FATFS_Slot_struct_t *const cursor, const bool isWrite);
+
+/** FATFS_AllocateChain
+ * @brief Allocate a chain of free clusters, ending with an end of chain marker. The runs come from the index
+ *        of free extents : as few runs as possible, the first one at goal when it is free
+ * @param[in] sumCluster number of clusters
+ * @param[in] goal preferred first cluster (ALLOC_NO_GOAL : none)
+ * @param[out] firstCluster first cluster of the chain
+ * @return bool Returns false if there are not enough free clusters
+ */
+static bool FATFS_AllocateChain(const uint32_t sumCluster, const uint32_t goal, uint32_t *const firstCluster);
+
+/** FATFS_FreeChain
+ * @brief Free every cluster of a chain
+ * @param[in] cluster first cluster (nothing is done if it is not a valid cluster)
+ * @return none
+ */
+static void FATFS_FreeChain(uint32_t cluster);
+
+/** FATFS_TrimChain
+ * @brief Free the clusters of a chain after the ones needed by a size
+ * @param[in,out] entry first cluster (set to 0 if no cluster is needed) and size
+ * @return bool Returns false if the chain is shorter than the size
+ */
+static bool FATFS_TrimChain(FATFS_Entry_Struct_t *const entry);
+
+/** FATFS_ClearCluster
+ * @brief Fill a new folder cluster with zeros in the cache
+ * @param[in] cluster cluster
+ * @return bool Returns true if success
+ */
+static bool FATFS_ClearCluster(const uint32_t cluster);
+
+/** FATFS_GetTimeStamp
+ * @brief Get the current local date and time in FAT format
+ * @param[out] dateField date
+ * @param[out] timeField time
+ * @return none
+ */
+static void FATFS_GetTimeStamp(uint16_t *const dateField, uint16_t *const timeField);
+
+/** FATFS_SplitPath
+ * @brief Split a path into the path of its folder and its name
+ * @param[in] path path
+ * @param[out] folder receiver of the path of folder, FATFS_FIND_MAX_PATH bytes
+ * @param[out] name receiver of the name (UTF-8), FATFS_LONG_FILE_NAME_MAX_UTF8 + 1 bytes
+ * @return bool Returns false if the name is empty, "." or ".." or too long
+ */
+static bool FATFS_SplitPath(const uint8_t *const path, uint8_t *const folder, uint8_t *const name);
+
+/** FATFS_EncodeName
+ * @brief Convert a name from UTF-8 to the UTF-16 characters of a long file name and check it
+ * @param[in] name name
+ * @param[out] longName receiver, FATFS_LONG_FILE_NAME_MAX_LENGTH characters
+ * @param[out] length number of characters
+ * @return bool Returns false if the name can not be stored
+ */
+static bool FATFS_EncodeName(const uint8_t *const name, uint16_t *const longName, uint32_t *const length);
+
+/** FATFS_MakeShortName
+ * @brief Make the short name of a new entry. "NAME~N.EXT" with the smallest free N is used when the name is not a valid short name
+ * @param[in] folder first cluster of folder (0 : root)
+ * @param[in] name name (UTF-8)
+ * @param[out] shortName 11 bytes (name + extension padded with spaces)
+ * @param[out] needLongName true if the name must be stored as a long file name
+ * @return bool Returns false if no free N was found
+ */
+static bool FATFS_MakeShortName(const uint32_t folder, const uint8_t *const name, uint8_t *const shortName, bool *const needLongName);
+
+/** FATFS_AddEntry
+ * @brief Store a new entry (and its sub entries) in a folder. The folder gets a new cluster if it is full
+ * @param[in] folder first cluster of folder (0 : root)
+ * @param[in] name name (UTF-8)
+ * @param[in] attributes attributes
+ * @param[in] firstCluster first cluster of the new entry
+ * @return bool Returns true if success
+ */
+static bool FATFS_AddEntry(const uint32_t folder, const uint8_t *const name, const uint8_t attributes, const uint32_t firstCluster);
+
+/** FATFS_UpdateEntry
+ * @brief Write first cluster, size and last modified time of an entry
+ * @param[in] location place of the entry
+ * @param[in] firstCluster first cluster
+ * @param[in] fileSize size
+ * @return bool Returns true if success
+ */
+static bool FATFS_UpdateEntry(const FATFS_Location_struct_t *const location, const uint32_t firstCluster, const uint32_t fileSize);
+
+/** FATFS_DeleteEntry
+ * @brief Mark an entry and its sub entries deleted
+ * @param[in] location place of the entry
+ * @return bool Returns true if success
+ */
+static bool FATFS_DeleteEntry(const FATFS_Location_struct_t *const location);
+
+/** FATFS_AppendData
+ * @brief Write data after the end of a file, allocating the clusters needed at once
+ * @param[in,out] entry entry of the file (first cluster and size are updated)
+ * @param[in] data data (NULL : zeros)
+ * @param[in] size size of data
+ * @return bool Returns true if success
+ */
+static bool FATFS_AppendData(FATFS_Entry_Struct_t *const entry, const uint8_t *const data, const uint32_t size);
+
+/** FATFS_Create
+ * @brief Create an empty file or folder
+ * @param[in] path path of the new entry
+ * @param[in] attributes FATFS_ATTRIBUTE_ARCHIVE or FATFS_ATTRIBUTE_DIRECTORY
+ * @return bool Returns true if success
+ */
+static bool FATFS_Create(const uint8_t *const path, const uint8_t attributes);
 
 /*******************************************************************************
  * Code
  ******************************************************************************/
 
 bool FATFS_Init(const uint8_t const *filePath)
+{
+    return FATFS_Mount(HAL_Init(filePath), false);
+}
+
+bool FATFS_InitWritable(const uint8_t *const filePath)
+{
+    return FATFS_Mount(HAL_InitReadWrite(filePath), true);
+}
+
+bool FATFS_InitMemory(const uint8_t *const image, const uint64_t size)
+{
+    return FATFS_Mount(HAL_InitMemory(image, size), false);
+}
+
+static bool FATFS_Mount(const bool isOpen, const bool isWritable)
 {
     uint8_t bufferForBoot[512]; /*Read the first 512 bytes information of boot sector */
     uint8_t *bufferOfFat = NULL;
@@ -156,9 +590,11 @@ bool FATFS_Init(const uint8_t const *filePath)
     uint16_t totalClusters = 0;    /*Total number of clusters of the file*/
     uint16_t sumEntryOfRoot = 0;   /*Total number of entries of the root directory*/
     bool returnValue = true;       /*Return value*/
+    FATFS_Stats_Struct_t stats;    /*Free clusters of a writable volume*/
+    const uint64_t begin = STATS_Begin();
 
     /*Read boot sector ( in sector 0) */
-    if ((true == HAL_Init(filePath)) && (512 == HAL_ReadSector(0, bufferForBoot)))
+    if ((true == isOpen) && (512 == HAL_ReadSector(0, bufferForBoot)))
     {
         /*Open the file successfully and read the Boot Sectorsuccessfully*/
 
@@ -175,6 +611,8 @@ bool FATFS_Init(const uint8_t const *filePath)
 
         s_InformationOfFatFs.sectorPerFat = FATFS_CONVERT_2_BYTES(&bufferForBoot[FATFS_SECTOR_PER_FAT_12_16_OFFSET]);
 
+        s_InformationOfFatFs.sectorOfFsInfo = 0;
+
         /*Determine what type of FAT this is*/
         totalSectors = FATFS_CONVERT_2_BYTES(&bufferForBoot[FATFS_TOTAL_SECTORS_OFFSET]);
         if ((0 == totalSectors) && (0 == s_InformationOfFatFs.sectorPerFat)) /*total Sectors and sectorPerFat read from the boot sector are 0*/
@@ -185,6 +623,7 @@ bool FATFS_Init(const uint8_t const *filePath)
             s_InformationOfFatFs.sectorPerFat = FATFS_CONVERT_4_BYTES(&bufferForBoot[FATFS_SECTOR_PER_FAT_32_OFFSET]);
             s_InformationOfFatFs.locationOfData = s_InformationOfFatFs.locationOfFirstFat + s_InformationOfFatFs.numberOfFat * s_InformationOfFatFs.sectorPerFat;
             s_InformationOfFatFs.stratClusterOfRootOfFat32 = FATFS_CONVERT_4_BYTES(&bufferForBoot[FATFS_STATRT_CLUSTER_ROOT_FAT32_OFFSET]);
+            s_InformationOfFatFs.sectorOfFsInfo = FATFS_CONVERT_2_BYTES(&bufferForBoot[FATFS_FS_INFO_SECTOR_OFFSET]);
             s_InformationOfFatFs.locationOfRoot = s_InformationOfFatFs.locationOfData + (s_InformationOfFatFs.stratClusterOfRootOfFat32 - 2) * s_InformationOfFatFs.sectorPerCluster;
 
             sumByteOfFat = s_InformationOfFatFs.sectorPerFat * s_InformationOfFatFs.bytePerSector;
@@ -221,19 +660,31 @@ bool FATFS_Init(const uint8_t const *filePath)
                 }
             }
         }
+        /*Number of clusters of the data region (the 16 bits field is 0 when the volume has more than 65535 sectors)*/
+        if (0 == totalSectors)
+        {
+            totalSectors = FATFS_CONVERT_4_BYTES(&bufferForBoot[FATFS_TOTAL_SECTORS_FAT16_32_OFFSET]);
+        }
+        s_InformationOfFatFs.totalClusters = (totalSectors - s_InformationOfFatFs.locationOfData) / s_InformationOfFatFs.sectorPerCluster;
+        if ((s_InformationOfFatFs.totalClusters + 2u) > totalElemmentOfFat)
+        {
+            s_InformationOfFatFs.totalClusters = totalElemmentOfFat - 2u;
+        }
+
         /*Update sector size*/
         HAL_UpdateSectorSize(s_InformationOfFatFs.bytePerSector);
 
         /*Read FAT table */
-        bufferOfFat = (uint8_t *)malloc(sumByteOfFat);
+        bufferOfFat = (uint8_t *)HAL_AllocBuffer(sumByteOfFat); /*Aligned : a direct read is not copied*/
         HAL_ReadMultiSector(s_InformationOfFatFs.locationOfFirstFat, s_InformationOfFatFs.sectorPerFat, bufferOfFat);
 
-        s_BufferForFat = (uint32_t *)malloc(totalElemmentOfFat * sizeof(uint32_t));
+        s_BufferForFat = (uint32_t *)STATS_Malloc((totalElemmentOfFat + 1u) * sizeof(uint32_t)); /*+1 : fat 12 decodes elements in pairs*/
+        s_SumElementOfFat = totalElemmentOfFat;
         if (FATFS_END_OF_FILE_FAT32 == s_EndOfFile)
         {
             for (i = 0; i < sumByteOfFat; i += 4) /*size element : 4 byte*/
             {
-                s_BufferForFat[j] = FATFS_CONVERT_4_BYTES(&bufferOfFat[i]);
+                s_BufferForFat[j] = FATFS_CONVERT_4_BYTES(&bufferOfFat[i]) & FATFS_FAT32_ELEMENT_MASK;
                 j++;
             }
         }
@@ -256,208 +707,200 @@ bool FATFS_Init(const uint8_t const *filePath)
             }
         }
 
+        if (true == isWritable)
+        {
+            /*Keep the bytes of the FAT : a changed element is encoded in place and only its sector is written*/
+            s_RawFat = bufferOfFat;
+            s_DirtyFat = (uint8_t *)STATS_Calloc((s_InformationOfFatFs.sectorPerFat + 7u) / 8u, 1u);
+            s_Cache = (FATFS_CacheSlot_struct_t *)STATS_Calloc(FATFS_CACHE_SIZE, sizeof(FATFS_CacheSlot_struct_t));
+            s_CacheData = (uint8_t *)STATS_Malloc(FATFS_CACHE_SIZE * s_InformationOfFatFs.bytePerSector);
+            s_SumCacheUsed = 0;
+            returnValue = (NULL != s_RawFat) && (NULL != s_DirtyFat) && (NULL != s_Cache) && (NULL != s_CacheData);
+            if (true == returnValue)
+            {
+                FATFS_ScanFat(&stats);
+                s_SumFreeCluster = stats.freeClusters;
+                s_NextFreeCluster = (FATFS_STATS_UNKNOWN == stats.nextFreeCluster) ? 2u : stats.nextFreeCluster;
+                returnValue = ALLOC_Build(s_BufferForFat, 2u, s_InformationOfFatFs.totalClusters + 2u);
+            }
+            s_IsWritable = returnValue;
+        }
+        else
+        {
+            free(bufferOfFat);
+        }
     }
     else
     {
         /*Error*/
         returnValue = false;
     }
+    STATS_End(STATS_OPERATION_MOUNT, begin);
 
     return returnValue;
 }
 
 FATFS_ListEntry_struct_t *FATFS_ReadDirectory(const uint32_t locationToRead)
 {
-    FATFS_ListEntry_struct_t *returnListEntry = NULL; /*return value */
-    bool status = false;                              /*Check if any entry is used*/
-    bool checkWhileLoop = true;                       /*Using for while loop*/
-    uint16_t i = 0;                                   /*Index value*/
-    uint8_t *buffer = NULL;                           /*buffer for receive data*/
-    uint32_t sizeOfBuffer = 0;                        /*Size of buffer*/
-    uint16_t sumSectorToRead = 0;                     /*Total sectors for 1 read*/
-    uint32_t positionOfcluster = 0;                   /*Location of cluster to read (for reading root 32 or reading sub)*/
-    bool checkSubEntry = true;
-    bool checkMainEntry = true;
-    FATFS_ListEntry_struct_t *entry = NULL;
-    FATFS_ListEntry_struct_t *previousEntry = NULL;
-    FATFS_ListEntry_struct_t *tailEntry = NULL;
-    uint32_t location = 0;
+    FATFS_Dir_Struct_t dir;                         /*Directory iterator*/
+    const FATFS_Entry_Struct_t *entry = NULL;       /*Entry read by the iterator*/
+    FATFS_ListEntry_struct_t *node = NULL;          /*New node of list*/
+    FATFS_ListEntry_struct_t *tailEntry = NULL;     /*Last node of list*/
+    FATFS_ListEntry_struct_t *previousEntry = NULL; /*Used to delete the old list*/
+    const uint64_t begin = STATS_Begin();
 
-    location = locationToRead;
     /*Delete the old list*/
-    previousEntry = s_HeadOfListEntry;
-    while (NULL != tailEntry)
+    while (NULL != s_HeadOfListEntry)
     {
-        previousEntry->next = tailEntry;
+        previousEntry = s_HeadOfListEntry;
+        s_HeadOfListEntry = s_HeadOfListEntry->next;
         free(previousEntry);
-        previousEntry = tailEntry;
     }
-    if ((0 == location) && (FATFS_END_OF_FILE_FAT32 != s_EndOfFile)) /*If reading root of fat 12 or 16*/
-    {
-        /*Root 12 or 16*/
-        location = s_InformationOfFatFs.locationOfRoot;
-        sumSectorToRead = s_InformationOfFatFs.sumSectorOfRoot;
-        sizeOfBuffer = sumSectorToRead * s_InformationOfFatFs.bytePerSector;
-        /*Initialize buffer and first node*/
-        buffer = (uint8_t *)malloc(sizeOfBuffer);
-        entry = (FATFS_ListEntry_struct_t *)malloc(sizeof(FATFS_ListEntry_struct_t));
-        entry->next = NULL;
-        entry->entry.longFileName[0] = 0; /*Assume there is no Long file name*/
-        s_HeadOfListEntry = entry;
-        previousEntry = entry;
-
-        if (sizeOfBuffer == HAL_ReadMultiSector(location, sumSectorToRead, buffer))
-        {
-            for (i = 0; i < sizeOfBuffer; i += FATFS_SIZE_ENTRY_BYTE) /*Because an entry has 32 bytes, we read in hops of 32 .*/
-            {
-                checkSubEntry = FATFS_ProcessSubEntry(&buffer[i], entry);   /*Read by sub entry. If true, return true*/
-                checkMainEntry = FATFS_ProcessMainEntry(&buffer[i], entry); /*Read by main entry. If true, return true*/
-                if (true == checkMainEntry)
-                {
-                    /*This is the main entry*/
-                    status = true; /*Had node entry*/
 
-                    /*Save node*/
-                    if (previousEntry == s_HeadOfListEntry)
-                    {
-                        /*Do nothing*/
-                    }
-                    else if (NULL == s_HeadOfListEntry->next)
-                    {
-                        s_HeadOfListEntry->next = previousEntry;
-                        tailEntry = previousEntry;
-                    }
-                    else
-                    {
-                        tailEntry->next = previousEntry;
-                        tailEntry = previousEntry;
-                    }
+    if (true == FATFS_DirOpen(&dir, locationToRead))
+    {
+        entry = FATFS_DirNext(&dir);
+        while (NULL != entry)
+        {
+            node = (FATFS_ListEntry_struct_t *)STATS_Malloc(sizeof(FATFS_ListEntry_struct_t));
+            if (NULL == node)
+            {
+                break;
+            }
+            node->entry = *entry;
+            node->next = NULL;
 
-                    /*Creat next node*/
-                    entry = (FATFS_ListEntry_struct_t *)malloc(sizeof(FATFS_ListEntry_struct_t));
-                    entry->next = NULL;
-                    entry->entry.longFileName[0] = 0; /*Assume there is no Long file name*/
-                    previousEntry = entry;
-                }
-                else if ((false == checkSubEntry) && ((false == checkMainEntry)))
-                {
-                    /*This is the end of the file*/
-                    free(entry);
-                    break;
-                }
-                else
-                {
-                    /*Do nothing*/
-                }
+            /*Save node*/
+            if (NULL == s_HeadOfListEntry)
+            {
+                s_HeadOfListEntry = node;
             }
+            else
+            {
+                tailEntry->next = node;
+            }
+            tailEntry = node;
+
+            entry = FATFS_DirNext(&dir);
         }
+        FATFS_DirClose(&dir);
     }
     else
     {
-        if (0 == location)
-        {
-            /*Root 32*/
-            positionOfcluster = s_InformationOfFatFs.stratClusterOfRootOfFat32;
-        }
-        else
+        /*Do nothing*/
+    }
+    STATS_End(STATS_OPERATION_READ_DIRECTORY, begin);
+
+    return s_HeadOfListEntry;
+}
+
+bool FATFS_DirOpen(FATFS_Dir_Struct_t *const dir, const uint32_t locationToRead)
+{
+    bool status = true; /*return value */
+
+    dir->sizeOfBuffer = s_InformationOfFatFs.sectorPerCluster * s_InformationOfFatFs.bytePerSector;
+    dir->sizeOfData = 0;
+    dir->index = 0;
+    dir->sumClusterRead = 0;
+    dir->endOfDirectory = false;
+    dir->nextSubEntry = 0;
+    dir->longFileNameReady = false;
+    dir->sumSlotRead = 0;
+
+    if ((0 == locationToRead) && (FATFS_END_OF_FILE_FAT32 != s_EndOfFile)) /*If reading root of fat 12 or 16*/
+    {
+        /*Root 12 or 16 : fixed region, read block by block*/
+        dir->currentCluster = 0;
+        dir->nextSector = s_InformationOfFatFs.locationOfRoot;
+        dir->remainSector = s_InformationOfFatFs.sumSectorOfRoot;
+    }
+    else
+    {
+        dir->currentCluster = (0 == locationToRead) ? s_InformationOfFatFs.stratClusterOfRootOfFat32 : locationToRead;
+        dir->nextSector = 0;
+        dir->remainSector = 0;
+        if (false == FATFS_IsValidCluster(dir->currentCluster))
         {
-            /*Sub directory*/
-            positionOfcluster = location;
+            status = false;
         }
-        location = s_InformationOfFatFs.locationOfData + (positionOfcluster - 2) * s_InformationOfFatFs.sectorPerCluster; /*Because the data area starts to be used from cluster 2. So must be subtracted*/
-        sumSectorToRead = s_InformationOfFatFs.sectorPerCluster;
-        sizeOfBuffer = sumSectorToRead * s_InformationOfFatFs.bytePerSector;
-        /*Initialize buffer and first node*/
-        buffer = (uint8_t *)malloc(sizeOfBuffer * sizeof(uint8_t));
-        entry = (FATFS_ListEntry_struct_t *)malloc(sizeof(FATFS_ListEntry_struct_t));
-        entry->next = NULL;
-        entry->entry.longFileName[0] = 0; /*Assume there is no Long file name*/
-        s_HeadOfListEntry = entry;
-        previousEntry = entry;
+    }
 
-        /*Read and save entry*/
-        while (sizeOfBuffer == HAL_ReadMultiSector(location, sumSectorToRead, buffer))
-        {
-            for (i = 0; i < sizeOfBuffer; i += FATFS_SIZE_ENTRY_BYTE) /*Because an entry has 32 bytes, we read in hops of 32 .*/
-            {
-                checkSubEntry = FATFS_ProcessSubEntry(&buffer[i], entry);   /*Read by sub entry. If true, return true*/
-                checkMainEntry = FATFS_ProcessMainEntry(&buffer[i], entry); /*Read by main entry. If true, return true*/
-                if (true == checkMainEntry)
-                {
-                    /*This is the main entry*/
-                    status = true; /*Had node entry*/
+    if (true == status)
+    {
+        dir->buffer = (uint8_t *)HAL_AllocBuffer(dir->sizeOfBuffer);
+        status = (NULL != dir->buffer);
+    }
+    else
+    {
+        dir->buffer = NULL;
+    }
 
-                    /*Save node*/
-                    if (previousEntry == s_HeadOfListEntry)
-                    {
-                        /*Do nothing*/
-                    }
-                    else if (NULL == s_HeadOfListEntry->next)
-                    {
-                        s_HeadOfListEntry->next = previousEntry;
-                        tailEntry = previousEntry;
-                    }
-                    else
-                    {
-                        tailEntry->next = previousEntry;
-                        tailEntry = previousEntry;
-                    }
+    return status;
+}
 
-                    /*Creat next node*/
-                    entry = (FATFS_ListEntry_struct_t *)malloc(sizeof(FATFS_ListEntry_struct_t));
-                    entry->next = NULL;
-                    entry->entry.longFileName[0] = 0; /*Assume there is no Long file name*/
-                    previousEntry = entry;
-                }
-                else if ((false == checkSubEntry) && ((false == checkMainEntry)))
-                {
-                    /*This is the end of the file*/
-                    free(entry);
-                    break;
-                    checkWhileLoop = false;
-                }
-                else
-                {
-                    /*Do nothing*/
-                }
+const FATFS_Entry_Struct_t *FATFS_DirNext(FATFS_Dir_Struct_t *const dir)
+{
+    const FATFS_Entry_Struct_t *returnEntry = NULL; /*return value */
+    const uint8_t *buffer = NULL;                   /*Current entry*/
+
+    while ((NULL == returnEntry) && (false == dir->endOfDirectory))
+    {
+        if (dir->index >= dir->sizeOfData)
+        {
+            /*All entries of the block were processed : read the next one*/
+            if (false == FATFS_DirReadBlock(dir))
+            {
+                dir->endOfDirectory = true;
+                break;
             }
+        }
+
+        buffer = &dir->buffer[dir->index];
+        dir->index += FATFS_SIZE_ENTRY_BYTE; /*Because an entry has 32 bytes, we read in hops of 32 .*/
+        dir->sumSlotRead++;
 
-            if (false == checkWhileLoop)
+        if (FATFS_END_OF_ENTRY == buffer[0])
+        {
+            /*This is the end of the directory*/
+            dir->endOfDirectory = true;
+        }
+        else if (true == FATFS_ProcessSubEntry(buffer, dir))
+        {
+            /*Sub entry stored in the iterator*/
+        }
+        else if (true == FATFS_ProcessMainEntry(buffer, &dir->entry))
+        {
+            /*This is the main entry*/
+            dir->slotOfEntry = dir->sumSlotRead - 1u;
+            if ((true == dir->longFileNameReady) && (dir->longFileNameCheckSum == FATFS_CalculateCheckSum(buffer)))
             {
-                break; /*Break for while*/
+                FATFS_DecodeLongFileName(dir->longFileName, dir->entry.longFileName);
+                dir->sumSubEntryOfEntry = dir->slotOfEntry - dir->firstSlotOfLongFileName;
             }
             else
             {
-                /*read next cluster*/
-                positionOfcluster = s_BufferForFat[positionOfcluster];
-                location = s_InformationOfFatFs.locationOfData + (positionOfcluster - 2) * s_InformationOfFatFs.sectorPerCluster; /*Because the data area starts to be used from cluster 2. So must be subtracted*/
-                if ((s_EndOfFile != positionOfcluster))
-                {
-                    /*Do nothing*/
-                }
-                else
-                {
-                    break; /*Break for while*/
-                }
+                dir->entry.longFileName[0] = 0; /*There is no Long file name*/
+                dir->sumSubEntryOfEntry = 0;
             }
+            dir->nextSubEntry = 0;
+            dir->longFileNameReady = false;
+            returnEntry = &dir->entry;
+            STATS_Add(STATS_ENTRY_PARSED, 1u);
+        }
+        else
+        {
+            /*Do nothing*/
         }
     }
 
-    if (true == status)
-    {
-        /*Had node*/
-        returnListEntry = s_HeadOfListEntry;
-    }
-    else
-    {
-        free(entry);
-        returnListEntry = NULL;
-        s_HeadOfListEntry = NULL;
-    }
-
-    free(buffer);
+    return returnEntry;
+}
 
-    return returnListEntry;
+void FATFS_DirClose(FATFS_Dir_Struct_t *const dir)
+{
+    free(dir->buffer);
+    dir->buffer = NULL;
+    dir->endOfDirectory = true;
 }
 
 void FATFS_ReadData(uint32_t firstCluster,uint32_t const sizeDataToRead, uint8_t **buffer)
@@ -466,9 +909,10 @@ void FATFS_ReadData(uint32_t firstCluster,uint32_t const sizeDataToRead, uint8_t
     uint32_t sumBytePerCluster = s_InformationOfFatFs.bytePerSector * s_InformationOfFatFs.sectorPerCluster;
     uint32_t index = 0;
     uint32_t totalCluster = 0;
+    const uint64_t begin = STATS_Begin();
 
      totalCluster = sizeDataToRead/sumBytePerCluster + ((sizeDataToRead % sumBytePerCluster) !=0);
-    *buffer = (uint8_t *)malloc(sumBytePerCluster*totalCluster);
+    *buffer = (uint8_t *)HAL_AllocBuffer(sumBytePerCluster*totalCluster);
 
     do
     {
@@ -477,178 +921,623 @@ void FATFS_ReadData(uint32_t firstCluster,uint32_t const sizeDataToRead, uint8_t
         HAL_ReadMultiSector(locationOfSelected, s_InformationOfFatFs.sectorPerCluster,(*buffer + index) );
         firstCluster = s_BufferForFat[firstCluster];
         index+= sumBytePerCluster;
+        STATS_Add(STATS_FAT_LOOKUP, 1u);
+        STATS_Add(STATS_CLUSTER_FOLLOWED, (s_EndOfFile != firstCluster) ? 1u : 0u);
     } while (s_EndOfFile != firstCluster);
-
-}
-
-void FATFS_DeInit(void)
-{
-    HAL_DeInit(); /*Close FAT file system*/
+    STATS_End(STATS_OPERATION_FILE_READ, begin);
 }
 
-/************************************************************************************
- * Static function
- *************************************************************************************/
-
-static bool FATFS_ProcessSubEntry(const uint8_t *const buffer, FATFS_ListEntry_struct_t *const node)
+bool FATFS_StreamData(uint32_t firstCluster, const uint32_t sizeDataToRead, const FATFS_DataCallback_t callback, void *const context)
 {
-    bool status = true;                                              /*return value */
-    uint8_t i = 0;                                                   /*Index value*/
-    uint8_t j = 0;                                                   /*Index value*/
-    static bool s_checkNewSubEntry = true;                           /*check new sub directory*/
-    static FATFS_LongFileName_struct_t *s_headOfLongFileName = NULL; /*Head pointer of list long file name(LFN)*/
-    FATFS_LongFileName_struct_t *nodeOfLongFileName = NULL;          /*node of list LFN*/
-    FATFS_LongFileName_struct_t *previousNodeOfLongFileName = NULL;  /*node of list LFN*/
+    bool status = true;             /*return value */
+    uint8_t *buffer = NULL;         /*Chunk buffer, reused for every read*/
+    uint32_t sumBytePerCluster = s_InformationOfFatFs.bytePerSector * s_InformationOfFatFs.sectorPerCluster;
+    uint32_t maxClusterPerRead = 0; /*Number of clusters fitting in the chunk buffer*/
+    uint32_t sumClusterToRead = 0;  /*Number of clusters of the current contiguous run*/
+    uint32_t startCluster = 0;      /*First cluster of the current contiguous run*/
+    uint32_t nextCluster = 0;       /*Last cluster of the next contiguous run*/
+    uint32_t remainByte = sizeDataToRead;
+    uint32_t sizeOfChunk = 0;
+    uint32_t sizeOfRun = 0;
+    const uint64_t begin = STATS_Begin();
+
+    maxClusterPerRead = FATFS_STREAM_CHUNK_BYTE / sumBytePerCluster;
+    if (0 == maxClusterPerRead)
+    {
+        maxClusterPerRead = 1;
+    }
+    /*Do not allocate more than the file needs*/
+    if ((remainByte / sumBytePerCluster + 1u) < maxClusterPerRead)
+    {
+        maxClusterPerRead = remainByte / sumBytePerCluster + 1u;
+    }
+    buffer = (uint8_t *)HAL_AllocBuffer(maxClusterPerRead * sumBytePerCluster);
+    if (NULL == buffer)
+    {
+        status = false;
+    }
 
-    /*If this is a subdirectory and the 0th element of the buffer is non-zero (end of file message)*/
-    if (FATFS_SUB_ENTRY == buffer[FATFS_ATTRIBUTE_OF_FILE_OFFSET] && (FATFS_END_OF_ENTRY != buffer[0]))
+    while ((true == status) && (0 != remainByte))
     {
-        /*Creat node of list LFN*/
-        if (true == s_checkNewSubEntry)
+        if (false == FATFS_IsValidCluster(firstCluster))
         {
-            nodeOfLongFileName = (FATFS_LongFileName_struct_t *)malloc(sizeof(FATFS_LongFileName_struct_t));
-            nodeOfLongFileName->next = NULL;
-            s_headOfLongFileName = nodeOfLongFileName;
-            s_checkNewSubEntry = false;
+            /*The chain ends before the size given by the entry*/
+            status = false;
+            break;
         }
-        else
+
+        /*Merge following clusters as long as they are contiguous on the disk*/
+        startCluster = firstCluster;
+        sumClusterToRead = 1;
+        while ((sumClusterToRead < maxClusterPerRead) && ((sumClusterToRead * sumBytePerCluster) < remainByte) && ((firstCluster + 1u) == s_BufferForFat[firstCluster]))
         {
-            nodeOfLongFileName = (FATFS_LongFileName_struct_t *)malloc(sizeof(FATFS_LongFileName_struct_t));
-            nodeOfLongFileName->next = s_headOfLongFileName;
-            s_headOfLongFileName = nodeOfLongFileName;
+            firstCluster++;
+            sumClusterToRead++;
         }
+        firstCluster = s_BufferForFat[firstCluster];
+        STATS_Add(STATS_FAT_LOOKUP, sumClusterToRead);
+        STATS_Add(STATS_CLUSTER_FOLLOWED, sumClusterToRead - ((true == FATFS_IsValidCluster(firstCluster)) ? 0u : 1u));
 
-        /*Save name fields of this sub entry*/
-        for (i = 0; i < FATFS_SIZE_ENTRY_BYTE; i++)
+        sizeOfRun = sumClusterToRead * sumBytePerCluster;
+        if (sizeOfRun != (uint32_t)HAL_ReadMultiSector(s_InformationOfFatFs.locationOfData + (startCluster - 2) * s_InformationOfFatFs.sectorPerCluster, sumClusterToRead * s_InformationOfFatFs.sectorPerCluster, buffer))
         {
-            if ((1 <= i) && (10 >= i) && (0 != buffer[i]) && (0xff != buffer[i])) /*Field 1 : From bit 1 to bit 10 . Do not store characters 0 and 0xff*/
-            {
-                nodeOfLongFileName->stringName[j] = buffer[i];
-                j++;
-            }
-            else if ((14 <= i) && (25 >= i) && (0 != buffer[i]) && (0xff != buffer[i])) /*Field 2 : From bit 14 to bit 25 . Do not store characters 0 and 0xff*/
-            {
-                nodeOfLongFileName->stringName[j] = buffer[i];
-                j++;
-            }
-            else if ((28 <= i) && (31 >= i) && (0 != buffer[i]) && (0xff != buffer[i])) /*Field 3 : From bit 28 to bit 32 . Do not store characters 0 and 0xff*/
-            {
-                nodeOfLongFileName->stringName[j] = buffer[i];
-                j++;
-            }
-            else
-            {
-                /*Do nothing*/
-            }
+            status = false;
+            break;
         }
-        nodeOfLongFileName->stringName[j] = 0; /* add end of string*/
 
-        /*Check if this is the last LFN by comparing the first 5 bits ( 0x1f - mask) of the 0th byte with 0x01*/
-        if (0x01u == (buffer[0] & 0x1f))
-        {
+        sizeOfChunk = (remainByte < sizeOfRun) ? remainByte : sizeOfRun;
 
-            previousNodeOfLongFileName = s_headOfLongFileName;
-            s_headOfLongFileName = NULL;
-            j = 0;
-            /*Save all characters of list LFn to (node->entry.fileName) */
-            while (NULL != previousNodeOfLongFileName)
+        /*Start reading the next run while the callback works on this one*/
+        if ((remainByte > sizeOfChunk) && (true == FATFS_IsValidCluster(firstCluster)))
+        {
+            nextCluster = firstCluster;
+            sumClusterToRead = 1;
+            while ((sumClusterToRead < maxClusterPerRead) && ((sumClusterToRead * sumBytePerCluster) < (remainByte - sizeOfChunk)) && ((nextCluster + 1u) == s_BufferForFat[nextCluster]))
             {
-                i = 0;
-                while (0 != previousNodeOfLongFileName->stringName[i])
-                {
-                    node->entry.longFileName[j] = previousNodeOfLongFileName->stringName[i];
-                    i++;
-                    j++;
-                }
-                nodeOfLongFileName = previousNodeOfLongFileName;
-                previousNodeOfLongFileName = previousNodeOfLongFileName->next;
-                free(nodeOfLongFileName);
+                nextCluster++;
+                sumClusterToRead++;
             }
-            node->entry.longFileName[j] = 0; /* add end of string*/
+            HAL_Prefetch(s_InformationOfFatFs.locationOfData + (firstCluster - 2) * s_InformationOfFatFs.sectorPerCluster, sumClusterToRead * s_InformationOfFatFs.sectorPerCluster);
+        }
+
+        status = callback(buffer, sizeOfChunk, context);
+        remainByte -= sizeOfChunk;
+    }
+
+    free(buffer);
+    STATS_End(STATS_OPERATION_FILE_READ, begin);
+
+    return status;
+}
+
+bool FATFS_GetStats(FATFS_Stats_Struct_t *const stats, const bool scanFat)
+{
+    bool status = (NULL != s_BufferForFat); /*return value */
+
+    if (true == status)
+    {
+        stats->totalClusters = s_InformationOfFatFs.totalClusters;
+        stats->bytePerCluster = (uint32_t)s_InformationOfFatFs.bytePerSector * s_InformationOfFatFs.sectorPerCluster;
+        stats->badClusters = FATFS_STATS_UNKNOWN;
+        stats->largestFreeRun = FATFS_STATS_UNKNOWN;
+        stats->nextFreeCluster = FATFS_STATS_UNKNOWN;
+        stats->isFromFsInfo = (false == scanFat) && (0 != s_InformationOfFatFs.sectorOfFsInfo) && (true == FATFS_ReadFsInfo(stats));
+        if (true == stats->isFromFsInfo)
+        {
+            stats->usedClusters = stats->totalClusters - stats->freeClusters;
         }
         else
         {
-            /*do nothing*/
+            FATFS_ScanFat(stats);
+            stats->usedClusters = stats->totalClusters - stats->freeClusters - stats->badClusters;
         }
-        status = true;
+    }
+
+    return status;
+}
+
+void FATFS_GetVolumeInfo(FATFS_VolumeInfo_Struct_t *const info)
+{
+    if (FATFS_END_OF_FILE_FAT32 == s_EndOfFile)
+    {
+        info->fatType = 32u;
+        info->rootCluster = s_InformationOfFatFs.stratClusterOfRootOfFat32;
     }
     else
     {
-        s_headOfLongFileName = NULL;
-        s_checkNewSubEntry = true;
-        status = false;
+        info->fatType = (FATFS_END_OF_FILE_FAT16 == s_EndOfFile) ? 16u : 12u;
+        info->rootCluster = 0;
+    }
+    info->bytePerSector = s_InformationOfFatFs.bytePerSector;
+    info->sectorPerCluster = s_InformationOfFatFs.sectorPerCluster;
+    info->numberOfFat = s_InformationOfFatFs.numberOfFat;
+    info->sectorPerFat = s_InformationOfFatFs.sectorPerFat;
+    info->locationOfFirstFat = s_InformationOfFatFs.locationOfFirstFat;
+    info->locationOfRoot = s_InformationOfFatFs.locationOfRoot;
+    info->locationOfData = s_InformationOfFatFs.locationOfData;
+    info->totalClusters = s_InformationOfFatFs.totalClusters;
+}
+
+bool FATFS_GetNextCluster(const uint32_t cluster, uint32_t *const nextCluster)
+{
+    bool status = false; /*return value */
+
+    if (cluster < s_SumElementOfFat)
+    {
+        *nextCluster = s_BufferForFat[cluster];
+        status = FATFS_IsValidCluster(*nextCluster);
+        STATS_Add(STATS_FAT_LOOKUP, 1u);
+        STATS_Add(STATS_CLUSTER_FOLLOWED, (true == status) ? 1u : 0u);
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return status;
+}
+
+void FATFS_GetShortName(const FATFS_Entry_Struct_t *const entry, uint8_t *const name)
+{
+    uint8_t i = 0; /*Index value*/
+    uint8_t j = 0; /*Index of name*/
+
+    for (i = 0; (i < FATFS_SIZE_NAME) && (' ' != entry->shortFileName[i]) && (0 != entry->shortFileName[i]); i++)
+    {
+        name[j] = entry->shortFileName[i];
+        j++;
+    }
+    if ((0 != j) && (FATFS_KANJI_E5_ENTRY == name[0]))
+    {
+        name[0] = FATFS_DELETED_ENTRY;
+    }
+    if ((' ' != entry->shortFileExtension[0]) && (0 != entry->shortFileExtension[0]))
+    {
+        name[j] = '.';
+        j++;
+        for (i = 0; (i < FATFS_SIZE_EXTENSION) && (' ' != entry->shortFileExtension[i]) && (0 != entry->shortFileExtension[i]); i++)
+        {
+            name[j] = entry->shortFileExtension[i];
+            j++;
+        }
+    }
+    name[j] = 0; /* add end of string*/
+}
+
+void FATFS_DecodeLongFileName(const uint16_t *const longFileName, uint8_t *const name)
+{
+    const uint16_t *const source = longFileName;
+    uint8_t *const target = name;
+    uint32_t i = 0; /*Index of UTF-16 character*/
+    uint32_t j = 0; /*Index of UTF-8 byte*/
+    uint32_t character = 0;
+#if defined(__SSE2__)
+    const __m128i nonAscii = _mm_set1_epi16((short)0xff80);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i units;
+    __m128i isAscii;
+#endif
+
+    while ((i < FATFS_LONG_FILE_NAME_MAX_LENGTH) && (0 != source[i]))
+    {
+#if defined(__SSE2__)
+        /*8 characters at a time while they are all ASCII (and not the end of name) : narrow them to bytes*/
+        while ((i + 8u) <= FATFS_LONG_FILE_NAME_MAX_LENGTH)
+        {
+            units = _mm_loadu_si128((const __m128i *)&source[i]);
+            isAscii = _mm_andnot_si128(_mm_cmpeq_epi16(units, zero), _mm_cmpeq_epi16(_mm_and_si128(units, nonAscii), zero));
+            if (0xffff != _mm_movemask_epi8(isAscii))
+            {
+                break;
+            }
+            _mm_storel_epi64((__m128i *)&target[j], _mm_packus_epi16(units, units));
+            i += 8u;
+            j += 8u;
+        }
+        if ((i >= FATFS_LONG_FILE_NAME_MAX_LENGTH) || (0 == source[i]))
+        {
+            break;
+        }
+#endif
+        character = source[i];
+        i++;
+        if ((0xd800u <= character) && (character < 0xdc00u) && (i < FATFS_LONG_FILE_NAME_MAX_LENGTH) && (0xdc00u <= source[i]) && (source[i] < 0xe000u))
+        {
+            /*Surrogate pair*/
+            character = 0x10000u + ((character - 0xd800u) << 10u) + (source[i] - 0xdc00u);
+            i++;
+        }
+        else if ((0xd800u <= character) && (character < 0xe000u))
+        {
+            character = 0xfffdu; /*Lone surrogate : replacement character*/
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if (0x80u > character)
+        {
+            target[j] = (uint8_t)character;
+            j += 1u;
+        }
+        else if (0x800u > character)
+        {
+            target[j] = (uint8_t)(0xc0u | (character >> 6u));
+            target[j + 1u] = (uint8_t)(0x80u | (character & 0x3fu));
+            j += 2u;
+        }
+        else if (0x10000u > character)
+        {
+            target[j] = (uint8_t)(0xe0u | (character >> 12u));
+            target[j + 1u] = (uint8_t)(0x80u | ((character >> 6u) & 0x3fu));
+            target[j + 2u] = (uint8_t)(0x80u | (character & 0x3fu));
+            j += 3u;
+        }
+        else
+        {
+            target[j] = (uint8_t)(0xf0u | (character >> 18u));
+            target[j + 1u] = (uint8_t)(0x80u | ((character >> 12u) & 0x3fu));
+            target[j + 2u] = (uint8_t)(0x80u | ((character >> 6u) & 0x3fu));
+            target[j + 3u] = (uint8_t)(0x80u | (character & 0x3fu));
+            j += 4u;
+        }
+    }
+    target[j] = 0; /* add end of string*/
+}
+
+bool FATFS_DecodeEntry(const uint8_t *const slot, FATFS_Entry_Struct_t *const entry)
+{
+    bool status = FATFS_ProcessMainEntry(slot, entry); /*return value */
+
+    entry->longFileName[0] = 0;
+
+    return status;
+}
+
+bool FATFS_Lookup(const uint8_t *const path, FATFS_Entry_Struct_t *const entry)
+{
+    const uint64_t begin = STATS_Begin();
+    const bool status = FATFS_Locate(path, entry, NULL); /*return value */
+
+    STATS_End(STATS_OPERATION_LOOKUP, begin);
+
+    return status;
+}
+
+static bool FATFS_Locate(const uint8_t *const path, FATFS_Entry_Struct_t *const entry, FATFS_Location_struct_t *const location)
+{
+    bool status = true;                         /*return value */
+    bool found = false;                         /*Component found in the directory*/
+    FATFS_Dir_Struct_t dir;                     /*Directory iterator*/
+    const FATFS_Entry_Struct_t *current = NULL; /*Entry read by the iterator*/
+    uint8_t component[sizeof(entry->longFileName)];
+    uint8_t shortName[FATFS_SHORT_NAME_SIZE];
+    uint32_t folder = 0;   /*First cluster of the directory to search (0 : root)*/
+    uint16_t i = 0;        /*Index of path*/
+    uint16_t j = 0;        /*Index of component*/
+
+    /*Root directory*/
+    memset(entry, 0, sizeof(FATFS_Entry_Struct_t));
+    entry->attributes = FATFS_ATTRIBUTE_DIRECTORY;
+    if (NULL != location)
+    {
+        location->folder = 0;
+        location->slot = FATFS_LOCATION_ROOT;
+        location->sumSubEntry = 0;
+    }
+
+    while ((true == status) && (0 != path[i]))
+    {
+        /*Take the next component of the path*/
+        while (('/' == path[i]) || ('\\' == path[i]))
+        {
+            i++;
+        }
+        j = 0;
+        while ((0 != path[i]) && ('/' != path[i]) && ('\\' != path[i]) && (j < (sizeof(component) - 1u)))
+        {
+            component[j] = path[i];
+            i++;
+            j++;
+        }
+        component[j] = 0;
+        if (0 == j)
+        {
+            break; /*Trailing '/'*/
+        }
+
+        if (0 == (entry->attributes & FATFS_ATTRIBUTE_DIRECTORY))
+        {
+            status = false; /*A file can not have children*/
+        }
+        else if (true == FATFS_DirOpen(&dir, folder))
+        {
+            found = false;
+            current = FATFS_DirNext(&dir);
+            while ((false == found) && (NULL != current))
+            {
+                FATFS_GetShortName(current, shortName);
+                if ((FATFS_DELETED_ENTRY != current->shortFileName[0]) &&
+                    ((0 == MYSTRING_CompareNoCase(component, current->longFileName)) || (0 == MYSTRING_CompareNoCase(component, shortName))))
+                {
+                    *entry = *current;
+                    if (NULL != location)
+                    {
+                        location->folder = folder;
+                        location->slot = dir.slotOfEntry;
+                        location->sumSubEntry = dir.sumSubEntryOfEntry;
+                    }
+                    folder = current->firstCluster;
+                    found = true;
+                }
+                else
+                {
+                    current = FATFS_DirNext(&dir);
+                }
+            }
+            FATFS_DirClose(&dir);
+            status = found;
+        }
+        else
+        {
+            status = false;
+        }
     }
 
     return status;
 }
 
-static bool FATFS_ProcessMainEntry(const uint8_t *const buffer, FATFS_ListEntry_struct_t *const node)
+bool FATFS_Find(const uint32_t locationToRead, const uint8_t *const pattern, const uint32_t sumThread, const FATFS_FindCallback_t callback, void *const context)
 {
     bool status = true; /*return value */
-    uint16_t temp = 0;
-    uint8_t i = 0;
+    FATFS_FindContext_struct_t find;
+    FATFS_FindItem_struct_t *item = NULL;
+    pthread_t thread[FATFS_FIND_MAX_THREAD];
+    uint32_t sumThreadToStart = sumThread;
+    uint32_t sumThreadStarted = 0;
+    uint32_t i = 0;
+    const uint8_t *start = pattern;
 
-    /*If this is not a subdirectory and the 0th element of the buffer is non-zero (end of file message)*/
-    if (FATFS_SUB_ENTRY != buffer[FATFS_ATTRIBUTE_OF_FILE_OFFSET] && (FATFS_END_OF_ENTRY != buffer[0]))
+    memset(&find, 0, sizeof(find));
+    find.callback = callback;
+    find.context = context;
+
+    /*Split the pattern into components. A pattern without '/' matches at any depth : "**" + pattern*/
+    if (NULL == strchr((const char *)pattern, '/'))
+    {
+        find.component[0] = (const uint8_t *)"**";
+        find.componentLength[0] = 2u;
+        find.isAnyFolder[0] = true;
+        find.sumComponent = 1u;
+    }
+    while ('/' == *start)
+    {
+        start++;
+    }
+    while ((true == status) && (0 != *start))
+    {
+        if (FATFS_FIND_MAX_COMPONENT == find.sumComponent)
+        {
+            status = false;
+            break;
+        }
+        find.component[find.sumComponent] = start;
+        while ((0 != *start) && ('/' != *start))
+        {
+            start++;
+        }
+        find.componentLength[find.sumComponent] = start - find.component[find.sumComponent];
+        find.isAnyFolder[find.sumComponent] = (2u == find.componentLength[find.sumComponent]) && (0 == memcmp(find.component[find.sumComponent], "**", 2u));
+        find.sumComponent++;
+        while ('/' == *start)
+        {
+            start++;
+        }
+    }
+    if ((0 == find.sumComponent) || ((1u == find.sumComponent) && (true == find.isAnyFolder[0])))
     {
+        status = false; /*Nothing to match*/
+    }
 
-        for (i = 0; i < 8; i++)
+    /*First folder*/
+    if (true == status)
+    {
+        find.visited = (uint8_t *)STATS_Calloc(s_SumElementOfFat / 8u + 1u, sizeof(uint8_t));
+        item = (FATFS_FindItem_struct_t *)STATS_Malloc(sizeof(FATFS_FindItem_struct_t) + 1u);
+        status = (NULL != find.visited) && (NULL != item);
+    }
+    if (true == status)
+    {
+        item->cluster = locationToRead;
+        item->state = FATFS_FindClosure(&find, 1u);
+        item->next = NULL;
+        item->path[0] = 0;
+        find.head = item;
+        find.sumPending = 1;
+        pthread_mutex_init(&find.lock, NULL);
+        pthread_cond_init(&find.wake, NULL);
+
+        /*Folders are read in parallel, the calling thread works too*/
+        if (0 == sumThreadToStart)
         {
-            node->entry.shortFileName[i] = buffer[i];
+            sumThreadToStart = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        if (FATFS_FIND_MAX_THREAD < sumThreadToStart)
+        {
+            sumThreadToStart = FATFS_FIND_MAX_THREAD;
+        }
+        for (i = 1; i < sumThreadToStart; i++)
+        {
+            if (0 == pthread_create(&thread[sumThreadStarted], NULL, FATFS_FindWorker, &find))
+            {
+                sumThreadStarted++;
+            }
+        }
+        FATFS_FindWorker(&find);
+        for (i = 0; i < sumThreadStarted; i++)
+        {
+            pthread_join(thread[i], NULL);
         }
-        node->entry.shortFileName[8] = 0; /* add end of string*/
-        /*Save information of file (folder)*/
 
-        /*attributes*/
-        node->entry.attributes = buffer[FATFS_ATTRIBUTE_OF_FILE_OFFSET];
-        /*creat time*/
-        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_CREATE_TIME_FILE_OFFSET]);
-        node->entry.creatTime.seconds = 0;
-        node->entry.creatTime.seconds |= (temp >> FATFS_FIELD_SECONDS_SHIFT_RIGHT) & FATFS_FIELD_SECONDS_MASK;
-        node->entry.creatTime.minutes = 0;
-        node->entry.creatTime.minutes |= (temp >> FATFS_FIELD_MINUTES_SHIFT_RIGHT) & FATFS_FIELD_MINUTES_MASK;
-        node->entry.creatTime.hours = 0;
-        node->entry.creatTime.hours |= (temp >> FATFS_FIELD_HOURS_SHIFT_RIGHT) & FATFS_FIELD_HOURS_MASK;
-        /*Creat date*/
-        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_CREATE_DATE_FILE_OFFSET]);
-        node->entry.creatDate.day = 0;
-        node->entry.creatDate.day |= (temp >> FATFS_FIELD_DAY_SHIFT_RIGHT) & FATFS_FIELD_DAY_MASK;
-        node->entry.creatDate.month = 0;
-        node->entry.creatDate.month |= (temp >> FATFS_FIELD_MONTH_SHIFT_RIGHT) & FATFS_FIELD_MONTH_MASK;
-        node->entry.creatDate.year = 0;
-        node->entry.creatDate.year |= (temp >> FATFS_FIELD_YEAR_SHIFT_RIGHT) & FATFS_FIELD_YEAR_MASK;
-        /*last modified time*/
-        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LAST_MOD_TIME_FILE_OFFSET]);
-        node->entry.lastModTime.seconds = 0;
-        node->entry.lastModTime.seconds |= (temp >> FATFS_FIELD_SECONDS_SHIFT_RIGHT) & FATFS_FIELD_SECONDS_MASK;
-        node->entry.lastModTime.minutes = 0;
-        node->entry.lastModTime.minutes |= (temp >> FATFS_FIELD_MINUTES_SHIFT_RIGHT) & FATFS_FIELD_MINUTES_MASK;
-        node->entry.lastModTime.hours = 0;
-        node->entry.lastModTime.hours |= (temp >> FATFS_FIELD_HOURS_SHIFT_RIGHT) & FATFS_FIELD_HOURS_MASK;
-        /*last modified date*/
-        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LAST_MOD_DATE_FILE_OFFSET]);
-        node->entry.lastModDate.day = 0;
-        node->entry.lastModDate.day |= (temp >> FATFS_FIELD_DAY_SHIFT_RIGHT) & FATFS_FIELD_DAY_MASK;
-        node->entry.lastModDate.month = 0;
-        node->entry.lastModDate.month |= (temp >> FATFS_FIELD_MONTH_SHIFT_RIGHT) & FATFS_FIELD_MONTH_MASK;
-        node->entry.lastModDate.year = 0;
-        node->entry.lastModDate.year |= (temp >> FATFS_FIELD_YEAR_SHIFT_RIGHT) & FATFS_FIELD_YEAR_MASK;
-        /*last access date*/
-        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LAST_ACCESS_DATE_FILE_OFFSET]);
-        node->entry.lastAccessDate.day = 0;
-        node->entry.lastAccessDate.day |= (temp >> FATFS_FIELD_DAY_SHIFT_RIGHT) & FATFS_FIELD_DAY_MASK;
-        node->entry.lastAccessDate.month = 0;
-        node->entry.lastAccessDate.month |= (temp >> FATFS_FIELD_MONTH_SHIFT_RIGHT) & FATFS_FIELD_MONTH_MASK;
-        node->entry.lastAccessDate.year = 0;
-        node->entry.lastAccessDate.year |= (temp >> FATFS_FIELD_YEAR_SHIFT_RIGHT) & FATFS_FIELD_YEAR_MASK;
-        /*First cluster of file ( folder)*/
-        node->entry.firstCluster = 0;
-        node->entry.firstCluster = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LOW_WORD_OF_ADDRESS_CLUSTER_OFFSET]);
-        node->entry.firstCluster |= (FATFS_CONVERT_2_BYTES(&buffer[FATFS_HIGH_WORD_OF_ADDRESS_CLUSTER_OFFSET])) << 16;
-        /*size of file ( folder)*/
-        node->entry.fileSize = FATFS_CONVERT_4_BYTES(&buffer[FATFS_FILE_SIZE_OFFSET]);
+        /*Folders left when the search was stopped*/
+        while (NULL != find.head)
+        {
+            item = find.head;
+            find.head = item->next;
+            free(item);
+        }
+        pthread_cond_destroy(&find.wake);
+        pthread_mutex_destroy(&find.lock);
+    }
+    else
+    {
+        free(item);
+    }
+    free(find.visited);
 
-        status = true;
+    return status;
+}
+
+bool FATFS_CreateFile(const uint8_t *const path)
+{
+    return FATFS_Create(path, FATFS_ATTRIBUTE_ARCHIVE);
+}
+
+bool FATFS_CreateDirectory(const uint8_t *const path)
+{
+    return FATFS_Create(path, FATFS_ATTRIBUTE_DIRECTORY);
+}
+
+bool FATFS_AppendFile(const uint8_t *const path, const uint8_t *const data, const uint32_t size)
+{
+    bool status = s_IsWritable; /*return value */
+    FATFS_Entry_Struct_t entry;
+    FATFS_Location_struct_t location;
+
+    if ((true == status) && (true == FATFS_Locate(path, &entry, &location)) && (FATFS_LOCATION_ROOT != location.slot) &&
+        (0 == (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)) && (size <= (0xffffffffu - entry.fileSize)))
+    {
+        if (0 != size)
+        {
+            status = FATFS_AppendData(&entry, data, size);
+        }
+        if (true == status)
+        {
+            status = FATFS_UpdateEntry(&location, entry.firstCluster, entry.fileSize);
+        }
+    }
+    else
+    {
+        status = false;
+    }
+
+    return status;
+}
+
+bool FATFS_TruncateFile(const uint8_t *const path, const uint32_t size)
+{
+    bool status = s_IsWritable; /*return value */
+    FATFS_Entry_Struct_t entry;
+    FATFS_Location_struct_t location;
+
+    if ((true == status) && (true == FATFS_Locate(path, &entry, &location)) && (FATFS_LOCATION_ROOT != location.slot) &&
+        (0 == (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)))
+    {
+        if (size > entry.fileSize)
+        {
+            status = FATFS_AppendData(&entry, NULL, size - entry.fileSize);
+        }
+        else if (size < entry.fileSize)
+        {
+            entry.fileSize = size;
+            status = FATFS_TrimChain(&entry);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+        if (true == status)
+        {
+            status = FATFS_UpdateEntry(&location, entry.firstCluster, entry.fileSize);
+        }
+    }
+    else
+    {
+        status = false;
+    }
+
+    return status;
+}
+
+bool FATFS_PreallocateFile(const uint8_t *const path, const uint32_t size)
+{
+    bool status = s_IsWritable; /*return value */
+    FATFS_Entry_Struct_t entry;
+    FATFS_Location_struct_t location;
+    FATFS_Location_struct_t *list = NULL;
+    const uint32_t bytePerCluster = s_InformationOfFatFs.bytePerSector * s_InformationOfFatFs.sectorPerCluster;
+    const uint32_t sumClusterNeeded = (size / bytePerCluster) + ((0 != (size % bytePerCluster)) ? 1u : 0u);
+    uint32_t sumCluster = 0;
+    uint32_t lastCluster = 0;
+    uint32_t cluster = 0;
+
+    if ((true == status) && (true == FATFS_Locate(path, &entry, &location)) && (FATFS_LOCATION_ROOT != location.slot) &&
+        (0 == (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)))
+    {
+        /*Clusters already in the chain, the preallocated ones included*/
+        cluster = entry.firstCluster;
+        while ((true == FATFS_IsValidCluster(cluster)) && (sumCluster < sumClusterNeeded))
+        {
+            lastCluster = cluster;
+            sumCluster++;
+            cluster = s_BufferForFat[cluster];
+        }
+        if (sumCluster < sumClusterNeeded)
+        {
+            status = FATFS_AllocateChain(sumClusterNeeded - sumCluster, (0 != lastCluster) ? (lastCluster + 1u) : ALLOC_NO_GOAL, &cluster);
+            if ((true == status) && (0 != lastCluster))
+            {
+                FATFS_SetFat(lastCluster, cluster);
+            }
+            else if (true == status)
+            {
+                status = FATFS_UpdateEntry(&location, cluster, entry.fileSize);
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+
+            /*Clusters after the end are freed by FATFS_DeInit*/
+            list = (true == status) ? (FATFS_Location_struct_t *)STATS_Realloc(s_Preallocated, (s_SumPreallocated + 1u) * sizeof(FATFS_Location_struct_t)) : NULL;
+            if (NULL != list)
+            {
+                s_Preallocated = list;
+                s_Preallocated[s_SumPreallocated] = location;
+                s_SumPreallocated++;
+            }
+        }
+    }
+    else
+    {
+        status = false;
+    }
+
+    return status;
+}
+
+bool FATFS_DeleteFile(const uint8_t *const path)
+{
+    bool status = s_IsWritable; /*return value */
+    FATFS_Entry_Struct_t entry;
+    FATFS_Location_struct_t location;
+
+    if ((true == status) && (true == FATFS_Locate(path, &entry, &location)) && (FATFS_LOCATION_ROOT != location.slot) &&
+        (0 == (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)))
+    {
+        FATFS_FreeChain(entry.firstCluster);
+        status = FATFS_DeleteEntry(&location);
     }
     else
     {
@@ -657,3 +1546,1713 @@ static bool FATFS_ProcessMainEntry(const uint8_t *const buffer, FATFS_ListEntry_
 
     return status;
 }
+
+bool FATFS_RemoveDirectory(const uint8_t *const path)
+{
+    bool status = s_IsWritable; /*return value */
+    FATFS_Entry_Struct_t entry;
+    FATFS_Location_struct_t location;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *current = NULL;
+    uint32_t cluster = 0;
+    uint32_t sumCluster = 0;
+
+    if ((true == status) && (true == FATFS_Locate(path, &entry, &location)) && (FATFS_LOCATION_ROOT != location.slot) &&
+        (0 != (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)) && (true == FATFS_DirOpen(&dir, entry.firstCluster)))
+    {
+        /*Only "." and ".." (and deleted entries) may be left*/
+        current = FATFS_DirNext(&dir);
+        while ((true == status) && (NULL != current))
+        {
+            if ((FATFS_DELETED_ENTRY != current->shortFileName[0]) && ('.' != current->shortFileName[0]) &&
+                (0 == (current->attributes & FATFS_ATTRIBUTE_VOLUME_LABEL)))
+            {
+                status = false;
+            }
+            current = FATFS_DirNext(&dir);
+        }
+        FATFS_DirClose(&dir);
+
+        if (true == status)
+        {
+            /*Changes of its sectors must not be written over the data of the next owner*/
+            cluster = entry.firstCluster;
+            while ((true == FATFS_IsValidCluster(cluster)) && (sumCluster < s_SumElementOfFat))
+            {
+                FATFS_CacheDiscard(s_InformationOfFatFs.locationOfData + (cluster - 2u) * s_InformationOfFatFs.sectorPerCluster, s_InformationOfFatFs.sectorPerCluster);
+                cluster = s_BufferForFat[cluster];
+                sumCluster++;
+            }
+            FATFS_FreeChain(entry.firstCluster);
+            status = FATFS_DeleteEntry(&location);
+        }
+    }
+    else
+    {
+        status = false;
+    }
+
+    return status;
+}
+
+bool FATFS_Flush(void)
+{
+    bool status = s_IsWritable; /*return value */
+    const uint32_t bytePerSector = s_InformationOfFatFs.bytePerSector;
+    uint64_t *order = NULL;  /*Changed cache slots sorted by sector*/
+    uint8_t *buffer = NULL;  /*Sectors merged into one write*/
+    uint32_t sumOrder = 0;
+    uint32_t copy = 0;       /*Index of FAT*/
+    uint32_t sector = 0;
+    uint32_t firstSector = 0;
+    uint32_t sumSector = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    if (true == status)
+    {
+        /*FAT : runs of changed sectors, each run written to every FAT, in the order of the disk*/
+        for (copy = 0; copy < s_InformationOfFatFs.numberOfFat; copy++)
+        {
+            sector = 0;
+            while (sector < s_InformationOfFatFs.sectorPerFat)
+            {
+                if (0 != (s_DirtyFat[sector >> 3u] & (1u << (sector & 7u))))
+                {
+                    firstSector = sector;
+                    while ((sector < s_InformationOfFatFs.sectorPerFat) && (0 != (s_DirtyFat[sector >> 3u] & (1u << (sector & 7u)))))
+                    {
+                        sector++;
+                    }
+                    sumSector = sector - firstSector;
+                    if ((sumSector * bytePerSector) != (uint32_t)HAL_WriteMultiSector(s_InformationOfFatFs.locationOfFirstFat + copy * s_InformationOfFatFs.sectorPerFat + firstSector,
+                                                                                     sumSector, &s_RawFat[firstSector * bytePerSector]))
+                    {
+                        status = false;
+                    }
+                }
+                else
+                {
+                    sector++;
+                }
+            }
+        }
+        if (true == status)
+        {
+            memset(s_DirtyFat, 0, (s_InformationOfFatFs.sectorPerFat + 7u) / 8u);
+        }
+
+        /*Folders : changed sectors sorted, consecutive sectors merged*/
+        order = (uint64_t *)STATS_Malloc((s_SumCacheUsed + 1u) * sizeof(uint64_t));
+        buffer = (uint8_t *)STATS_Malloc(FATFS_FLUSH_MAX_SECTOR * bytePerSector);
+        if ((NULL != order) && (NULL != buffer))
+        {
+            for (i = 0; i < FATFS_CACHE_SIZE; i++)
+            {
+                if (FATFS_CACHE_DIRTY == s_Cache[i].state)
+                {
+                    order[sumOrder] = ((uint64_t)s_Cache[i].sector << 32u) | i;
+                    sumOrder++;
+                }
+            }
+            qsort(order, sumOrder, sizeof(uint64_t), FATFS_CompareSector);
+            i = 0;
+            while (i < sumOrder)
+            {
+                firstSector = (uint32_t)(order[i] >> 32u);
+                sumSector = 0;
+                j = i;
+                while ((j < sumOrder) && (sumSector < FATFS_FLUSH_MAX_SECTOR) && ((firstSector + sumSector) == (uint32_t)(order[j] >> 32u)))
+                {
+                    memcpy(&buffer[sumSector * bytePerSector], &s_CacheData[(uint32_t)order[j] * bytePerSector], bytePerSector);
+                    s_Cache[(uint32_t)order[j]].state = FATFS_CACHE_CLEAN;
+                    sumSector++;
+                    j++;
+                }
+                if ((sumSector * bytePerSector) != (uint32_t)HAL_WriteMultiSector(firstSector, sumSector, buffer))
+                {
+                    status = false;
+                }
+                i = j;
+            }
+        }
+        else
+        {
+            status = false;
+        }
+
+        /*FSInfo : free count and next free hint*/
+        if ((true == status) && (0 != s_InformationOfFatFs.sectorOfFsInfo) && (bytePerSector == (uint32_t)HAL_ReadSector(s_InformationOfFatFs.sectorOfFsInfo, buffer)) &&
+            (FATFS_FS_INFO_LEAD_SIGNATURE == FATFS_CONVERT_4_BYTES(&buffer[0])) &&
+            (FATFS_FS_INFO_STRUCT_SIGNATURE == FATFS_CONVERT_4_BYTES(&buffer[FATFS_FS_INFO_STRUCT_SIGNATURE_OFFSET])))
+        {
+            FATFS_PUT_4_BYTES(&buffer[FATFS_FS_INFO_FREE_COUNT_OFFSET], s_SumFreeCluster);
+            FATFS_PUT_4_BYTES(&buffer[FATFS_FS_INFO_NEXT_FREE_OFFSET], s_NextFreeCluster);
+            status = (bytePerSector == (uint32_t)HAL_WriteMultiSector(s_InformationOfFatFs.sectorOfFsInfo, 1u, buffer));
+        }
+        free(order);
+        free(buffer);
+    }
+
+    return status;
+}
+
+void FATFS_DeInit(void)
+{
+    FATFS_ListEntry_struct_t *previousEntry = NULL;
+    FATFS_Entry_Struct_t entry;
+    FATFS_Slot_struct_t cursor;
+    uint8_t *data = NULL;
+    uint32_t i = 0;
+
+    if (true == s_IsWritable)
+    {
+        /*Free preallocated clusters that were not used (the entry may have been deleted or moved since)*/
+        for (i = 0; i < s_SumPreallocated; i++)
+        {
+            if (true == FATFS_SlotSeek(&cursor, s_Preallocated[i].folder, s_Preallocated[i].slot))
+            {
+                data = FATFS_SlotData(&cursor, false);
+                if ((NULL != data) && (FATFS_DELETED_ENTRY != data[0]) && (FATFS_END_OF_ENTRY != data[0]) && (true == FATFS_ProcessMainEntry(data, &entry)) &&
+                    (0 == (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY)) && (true == FATFS_TrimChain(&entry)) && (0 == entry.firstCluster))
+                {
+                    FATFS_UpdateEntry(&s_Preallocated[i], 0, 0);
+                }
+            }
+        }
+        free(s_Preallocated);
+        s_Preallocated = NULL;
+        s_SumPreallocated = 0;
+
+        FATFS_Flush();
+        HAL_Sync();
+        free(s_RawFat);
+        free(s_DirtyFat);
+        free(s_Cache);
+        free(s_CacheData);
+        s_RawFat = NULL;
+        s_DirtyFat = NULL;
+        s_Cache = NULL;
+        s_CacheData = NULL;
+        s_IsWritable = false;
+        ALLOC_DeInit();
+    }
+
+    /*Delete the list of entries and the FAT table*/
+    while (NULL != s_HeadOfListEntry)
+    {
+        previousEntry = s_HeadOfListEntry;
+        s_HeadOfListEntry = s_HeadOfListEntry->next;
+        free(previousEntry);
+    }
+    free(s_BufferForFat);
+    s_BufferForFat = NULL;
+    s_SumElementOfFat = 0;
+
+    HAL_DeInit(); /*Close FAT file system*/
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static bool FATFS_ProcessSubEntry(const uint8_t *const buffer, FATFS_Dir_Struct_t *const dir)
+{
+    bool status = true;    /*return value */
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+    uint8_t i = 0;         /*Index value*/
+#endif
+    uint8_t order = 0;     /*Sequence number of this sub entry (1 for the first 13 characters)*/
+    uint16_t position = 0; /*Position of the first character of this sub entry in the LFN*/
+
+    /*If this is a sub entry*/
+    if (FATFS_SUB_ENTRY == buffer[FATFS_ATTRIBUTE_OF_FILE_OFFSET])
+    {
+        order = buffer[0] & FATFS_SUB_ENTRY_ORDER_MASK;
+
+        if ((FATFS_DELETED_ENTRY == buffer[0]) || (0 == order) || (FATFS_LONG_FILE_NAME_MAX_SUB_ENTRY < order))
+        {
+            /*Deleted or damaged sub entry : forget the LFN in progress*/
+            dir->nextSubEntry = 0;
+            dir->longFileNameReady = false;
+        }
+        else
+        {
+            /*Sub entries are stored from the last one (flag 0x40) to the first one*/
+            if (0 != (buffer[0] & FATFS_SUB_ENTRY_LAST_MASK))
+            {
+                dir->longFileNameCheckSum = buffer[FATFS_SUB_ENTRY_CHECK_SUM_OFFSET];
+                dir->longFileName[order * FATFS_CHARACTERS_PER_SUB_ENTRY] = 0; /*end of string if the last sub entry is full*/
+                dir->nextSubEntry = order;
+                dir->firstSlotOfLongFileName = dir->sumSlotRead - 1u;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+
+            if ((order == dir->nextSubEntry) && (dir->longFileNameCheckSum == buffer[FATFS_SUB_ENTRY_CHECK_SUM_OFFSET]))
+            {
+                /*Save name fields of this sub entry*/
+                position = (order - 1u) * FATFS_CHARACTERS_PER_SUB_ENTRY;
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+                /*The characters are 3 runs of the slot (5, 6 and 2 characters) already in the order of memory*/
+                memcpy(&dir->longFileName[position], &buffer[s_OffsetOfLongFileName[0]], 5u * 2u);
+                memcpy(&dir->longFileName[position + 5u], &buffer[s_OffsetOfLongFileName[5]], 6u * 2u);
+                memcpy(&dir->longFileName[position + 11u], &buffer[s_OffsetOfLongFileName[11]], 2u * 2u);
+#else
+                for (i = 0; i < FATFS_CHARACTERS_PER_SUB_ENTRY; i++)
+                {
+                    dir->longFileName[position + i] = FATFS_CONVERT_2_BYTES(&buffer[s_OffsetOfLongFileName[i]]);
+                }
+#endif
+                dir->nextSubEntry = order - 1u;
+                dir->longFileNameReady = (1u == order);
+                STATS_Add(STATS_LFN_FRAGMENT, 1u);
+            }
+            else
+            {
+                /*Out of sequence : forget the LFN in progress*/
+                dir->nextSubEntry = 0;
+                dir->longFileNameReady = false;
+            }
+        }
+        status = true;
+    }
+    else
+    {
+        status = false;
+    }
+
+    return status;
+}
+
+static bool FATFS_ProcessMainEntry(const uint8_t *const buffer, FATFS_Entry_Struct_t *const entry)
+{
+    bool status = true; /*return value */
+    uint16_t temp = 0;
+    uint8_t i = 0;
+
+    /*If this is not a subdirectory and the 0th element of the buffer is non-zero (end of file message)*/
+    if (FATFS_SUB_ENTRY != buffer[FATFS_ATTRIBUTE_OF_FILE_OFFSET] && (FATFS_END_OF_ENTRY != buffer[0]))
+    {
+
+        for (i = 0; i < 8; i++)
+        {
+            entry->shortFileName[i] = buffer[i];
+        }
+        entry->shortFileName[8] = 0; /* add end of string*/
+        for (i = 0; i < FATFS_SIZE_EXTENSION; i++)
+        {
+            entry->shortFileExtension[i] = buffer[FATFS_SIZE_NAME + i];
+        }
+        entry->shortFileExtension[FATFS_SIZE_EXTENSION] = 0; /* add end of string*/
+        /*Save information of file (folder)*/
+
+        /*attributes*/
+        entry->attributes = buffer[FATFS_ATTRIBUTE_OF_FILE_OFFSET];
+        /*creat time*/
+        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_CREATE_TIME_FILE_OFFSET]);
+        entry->creatTime.seconds = 0;
+        entry->creatTime.seconds |= (temp >> FATFS_FIELD_SECONDS_SHIFT_RIGHT) & FATFS_FIELD_SECONDS_MASK;
+        entry->creatTime.minutes = 0;
+        entry->creatTime.minutes |= (temp >> FATFS_FIELD_MINUTES_SHIFT_RIGHT) & FATFS_FIELD_MINUTES_MASK;
+        entry->creatTime.hours = 0;
+        entry->creatTime.hours |= (temp >> FATFS_FIELD_HOURS_SHIFT_RIGHT) & FATFS_FIELD_HOURS_MASK;
+        /*Creat date*/
+        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_CREATE_DATE_FILE_OFFSET]);
+        entry->creatDate.day = 0;
+        entry->creatDate.day |= (temp >> FATFS_FIELD_DAY_SHIFT_RIGHT) & FATFS_FIELD_DAY_MASK;
+        entry->creatDate.month = 0;
+        entry->creatDate.month |= (temp >> FATFS_FIELD_MONTH_SHIFT_RIGHT) & FATFS_FIELD_MONTH_MASK;
+        entry->creatDate.year = 0;
+        entry->creatDate.year |= (temp >> FATFS_FIELD_YEAR_SHIFT_RIGHT) & FATFS_FIELD_YEAR_MASK;
+        /*last modified time*/
+        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LAST_MOD_TIME_FILE_OFFSET]);
+        entry->lastModTime.seconds = 0;
+        entry->lastModTime.seconds |= (temp >> FATFS_FIELD_SECONDS_SHIFT_RIGHT) & FATFS_FIELD_SECONDS_MASK;
+        entry->lastModTime.minutes = 0;
+        entry->lastModTime.minutes |= (temp >> FATFS_FIELD_MINUTES_SHIFT_RIGHT) & FATFS_FIELD_MINUTES_MASK;
+        entry->lastModTime.hours = 0;
+        entry->lastModTime.hours |= (temp >> FATFS_FIELD_HOURS_SHIFT_RIGHT) & FATFS_FIELD_HOURS_MASK;
+        /*last modified date*/
+        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LAST_MOD_DATE_FILE_OFFSET]);
+        entry->lastModDate.day = 0;
+        entry->lastModDate.day |= (temp >> FATFS_FIELD_DAY_SHIFT_RIGHT) & FATFS_FIELD_DAY_MASK;
+        entry->lastModDate.month = 0;
+        entry->lastModDate.month |= (temp >> FATFS_FIELD_MONTH_SHIFT_RIGHT) & FATFS_FIELD_MONTH_MASK;
+        entry->lastModDate.year = 0;
+        entry->lastModDate.year |= (temp >> FATFS_FIELD_YEAR_SHIFT_RIGHT) & FATFS_FIELD_YEAR_MASK;
+        /*last access date*/
+        temp = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LAST_ACCESS_DATE_FILE_OFFSET]);
+        entry->lastAccessDate.day = 0;
+        entry->lastAccessDate.day |= (temp >> FATFS_FIELD_DAY_SHIFT_RIGHT) & FATFS_FIELD_DAY_MASK;
+        entry->lastAccessDate.month = 0;
+        entry->lastAccessDate.month |= (temp >> FATFS_FIELD_MONTH_SHIFT_RIGHT) & FATFS_FIELD_MONTH_MASK;
+        entry->lastAccessDate.year = 0;
+        entry->lastAccessDate.year |= (temp >> FATFS_FIELD_YEAR_SHIFT_RIGHT) & FATFS_FIELD_YEAR_MASK;
+        /*First cluster of file ( folder)*/
+        entry->firstCluster = 0;
+        entry->firstCluster = FATFS_CONVERT_2_BYTES(&buffer[FATFS_LOW_WORD_OF_ADDRESS_CLUSTER_OFFSET]);
+        entry->firstCluster |= (FATFS_CONVERT_2_BYTES(&buffer[FATFS_HIGH_WORD_OF_ADDRESS_CLUSTER_OFFSET])) << 16;
+        /*size of file ( folder)*/
+        entry->fileSize = FATFS_CONVERT_4_BYTES(&buffer[FATFS_FILE_SIZE_OFFSET]);
+
+        status = true;
+    }
+    else
+    {
+        status = false;
+    }
+
+    return status;
+}
+
+static uint8_t FATFS_CalculateCheckSum(const uint8_t *const shortName)
+{
+    uint8_t checkSum = 0;
+    uint8_t i = 0;
+
+    for (i = 0; i < FATFS_SIZE_SHORT_NAME; i++)
+    {
+        checkSum = (uint8_t)(((checkSum & 1u) << 7u) + (checkSum >> 1u) + shortName[i]);
+    }
+
+    return checkSum;
+}
+
+static bool FATFS_DirReadBlock(FATFS_Dir_Struct_t *const dir)
+{
+    bool status = false;          /*return value */
+    uint32_t sumSectorToRead = 0; /*Total sectors for 1 read*/
+    const uint64_t begin = STATS_Begin();
+
+    if (0 == dir->currentCluster)
+    {
+        /*Root 12 or 16*/
+        if (0 != dir->remainSector)
+        {
+            sumSectorToRead = (dir->remainSector < s_InformationOfFatFs.sectorPerCluster) ? dir->remainSector : s_InformationOfFatFs.sectorPerCluster;
+            dir->sizeOfData = sumSectorToRead * s_InformationOfFatFs.bytePerSector;
+            status = (dir->sizeOfData == (uint32_t)HAL_ReadMultiSector(dir->nextSector, sumSectorToRead, dir->buffer));
+            FATFS_CacheOverlay(dir->nextSector, sumSectorToRead, dir->buffer);
+            dir->nextSector += sumSectorToRead;
+            dir->remainSector -= sumSectorToRead;
+        }
+    }
+    else
+    {
+        if (0 != dir->sumClusterRead)
+        {
+            /*read next cluster*/
+            dir->currentCluster = s_BufferForFat[dir->currentCluster];
+            STATS_Add(STATS_FAT_LOOKUP, 1u);
+            STATS_Add(STATS_CLUSTER_FOLLOWED, (true == FATFS_IsValidCluster(dir->currentCluster)) ? 1u : 0u);
+        }
+        /*A chain can not be longer than the FAT : stop if it loops*/
+        if ((true == FATFS_IsValidCluster(dir->currentCluster)) && (dir->sumClusterRead < s_SumElementOfFat))
+        {
+            dir->sizeOfData = dir->sizeOfBuffer;
+            /*Because the data area starts to be used from cluster 2. So must be subtracted*/
+            status = (dir->sizeOfData == (uint32_t)HAL_ReadMultiSector(s_InformationOfFatFs.locationOfData + (dir->currentCluster - 2) * s_InformationOfFatFs.sectorPerCluster, s_InformationOfFatFs.sectorPerCluster, dir->buffer));
+            FATFS_CacheOverlay(s_InformationOfFatFs.locationOfData + (dir->currentCluster - 2) * s_InformationOfFatFs.sectorPerCluster, s_InformationOfFatFs.sectorPerCluster, dir->buffer);
+            dir->sumClusterRead++;
+        }
+    }
+    dir->index = 0;
+    STATS_End(STATS_OPERATION_DIRECTORY_BLOCK, begin);
+
+    return status;
+}
+
+static bool FATFS_IsValidCluster(const uint32_t cluster)
+{
+    /*Values from (end of file - 8) are bad cluster (0x..7) and end of chain markers (0x..8 -> 0x..f)*/
+    return ((2u <= cluster) && (cluster < s_SumElementOfFat) && (cluster < (s_EndOfFile - 8u)));
+}
+
+static uint64_t FATFS_FindClosure(const FATFS_FindContext_struct_t *const find, uint64_t state)
+{
+    uint32_t i = 0; /*Position in pattern*/
+
+    for (i = 0; i < find->sumComponent; i++)
+    {
+        if ((0 != (state & ((uint64_t)1u << i))) && (true == find->isAnyFolder[i]))
+        {
+            state |= (uint64_t)1u << (i + 1u);
+        }
+    }
+
+    return state;
+}
+
+static uint64_t FATFS_FindStep(const FATFS_FindContext_struct_t *const find, const uint64_t state, const uint8_t *const longName, const uint8_t *const shortName)
+{
+    uint64_t nextState = 0; /*return value */
+    uint32_t i = 0;         /*Position in pattern*/
+
+    for (i = 0; i < find->sumComponent; i++)
+    {
+        if (0 == (state & ((uint64_t)1u << i)))
+        {
+            continue;
+        }
+        if (true == find->isAnyFolder[i])
+        {
+            nextState |= (uint64_t)1u << i; /*"**" also matches this name*/
+        }
+        else if (((0 != longName[0]) && (true == MYSTRING_WildcardMatch(find->component[i], find->componentLength[i], longName))) ||
+                 (true == MYSTRING_WildcardMatch(find->component[i], find->componentLength[i], shortName)))
+        {
+            nextState |= (uint64_t)1u << (i + 1u);
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+    }
+
+    return FATFS_FindClosure(find, nextState);
+}
+
+static void *FATFS_FindWorker(void *argument)
+{
+    FATFS_FindContext_struct_t *const find = (FATFS_FindContext_struct_t *)argument;
+    FATFS_FindItem_struct_t *item = NULL;
+    FATFS_FindItem_struct_t *child = NULL;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *entry = NULL;
+    uint8_t shortName[FATFS_SHORT_NAME_SIZE];
+    uint8_t path[FATFS_FIND_MAX_PATH];
+    uint64_t state = 0;
+    uint64_t matchBit = (uint64_t)1u << find->sumComponent;
+    uint32_t sizeOfPath = 0;
+    bool queued = false;
+
+    pthread_mutex_lock(&find->lock);
+    while (true)
+    {
+        /*Wait for a folder, leave when nothing is waiting nor being read*/
+        while ((NULL == find->head) && (0 != find->sumPending) && (false == find->stop))
+        {
+            pthread_cond_wait(&find->wake, &find->lock);
+        }
+        if ((NULL == find->head) || (true == find->stop))
+        {
+            break;
+        }
+        item = find->head;
+        find->head = item->next;
+        pthread_mutex_unlock(&find->lock);
+
+        if (true == FATFS_DirOpen(&dir, item->cluster))
+        {
+            entry = FATFS_DirNext(&dir);
+            /*stop is written under the lock by the worker whose callback ended the search : read without it here*/
+            while ((NULL != entry) && (false == __atomic_load_n(&find->stop, __ATOMIC_RELAXED)))
+            {
+                /*Skip ".", "..", deleted entries and the volume label*/
+                if (('.' != entry->shortFileName[0]) && (FATFS_DELETED_ENTRY != entry->shortFileName[0]) && (0 == (entry->attributes & FATFS_ATTRIBUTE_VOLUME_LABEL)))
+                {
+                    FATFS_GetShortName(entry, shortName);
+                    state = FATFS_FindStep(find, item->state, entry->longFileName, shortName);
+                    if (0 != state)
+                    {
+                        sizeOfPath = snprintf((char *)path, sizeof(path), "%s/%s", item->path, (0 != entry->longFileName[0]) ? entry->longFileName : shortName);
+                        if (sizeof(path) <= sizeOfPath)
+                        {
+                            sizeOfPath = sizeof(path) - 1u;
+                        }
+                    }
+                    if (0 != (state & matchBit))
+                    {
+                        /*Stream the result*/
+                        pthread_mutex_lock(&find->lock);
+                        if ((false == find->stop) && (false == find->callback(path, entry, find->context)))
+                        {
+                            __atomic_store_n(&find->stop, true, __ATOMIC_RELAXED);
+                            pthread_cond_broadcast(&find->wake);
+                        }
+                        pthread_mutex_unlock(&find->lock);
+                    }
+                    /*Read the folder only if the pattern can still match below it*/
+                    if ((0 != (state & (matchBit - 1u))) && (0 != (entry->attributes & FATFS_ATTRIBUTE_DIRECTORY)) && (true == FATFS_IsValidCluster(entry->firstCluster)))
+                    {
+                        child = (FATFS_FindItem_struct_t *)STATS_Malloc(sizeof(FATFS_FindItem_struct_t) + sizeOfPath + 1u);
+                        if (NULL != child)
+                        {
+                            child->cluster = entry->firstCluster;
+                            child->state = state & (matchBit - 1u);
+                            memcpy(child->path, path, sizeOfPath + 1u);
+                            child->path[sizeOfPath] = 0;
+
+                            pthread_mutex_lock(&find->lock);
+                            queued = (0 == (find->visited[child->cluster / 8u] & (1u << (child->cluster % 8u))));
+                            if (true == queued)
+                            {
+                                find->visited[child->cluster / 8u] |= (uint8_t)(1u << (child->cluster % 8u));
+                                child->next = find->head;
+                                find->head = child;
+                                find->sumPending++;
+                                pthread_cond_signal(&find->wake);
+                            }
+                            pthread_mutex_unlock(&find->lock);
+                            if (false == queued)
+                            {
+                                free(child);
+                            }
+                        }
+                    }
+                }
+                entry = FATFS_DirNext(&dir);
+            }
+            FATFS_DirClose(&dir);
+        }
+        free(item);
+
+        pthread_mutex_lock(&find->lock);
+        find->sumPending--;
+        if (0 == find->sumPending)
+        {
+            pthread_cond_broadcast(&find->wake);
+        }
+    }
+    pthread_mutex_unlock(&find->lock);
+
+    return NULL;
+}
+
+static bool FATFS_ReadFsInfo(FATFS_Stats_Struct_t *const stats)
+{
+    bool status = false; /*return value */
+    uint8_t *buffer = NULL;
+    uint32_t freeCount = 0;
+    uint32_t nextFree = 0;
+
+    buffer = (uint8_t *)STATS_Malloc(s_InformationOfFatFs.bytePerSector);
+    if ((NULL != buffer) && (s_InformationOfFatFs.bytePerSector == HAL_ReadSector(s_InformationOfFatFs.sectorOfFsInfo, buffer)))
+    {
+        freeCount = FATFS_CONVERT_4_BYTES(&buffer[FATFS_FS_INFO_FREE_COUNT_OFFSET]);
+        nextFree = FATFS_CONVERT_4_BYTES(&buffer[FATFS_FS_INFO_NEXT_FREE_OFFSET]);
+        /*The free count is only a hint : it is used if the signatures are right and the value is possible*/
+        if ((FATFS_FS_INFO_LEAD_SIGNATURE == FATFS_CONVERT_4_BYTES(&buffer[0])) &&
+            (FATFS_FS_INFO_STRUCT_SIGNATURE == FATFS_CONVERT_4_BYTES(&buffer[FATFS_FS_INFO_STRUCT_SIGNATURE_OFFSET])) &&
+            (FATFS_FS_INFO_UNKNOWN != freeCount) && (freeCount <= s_InformationOfFatFs.totalClusters))
+        {
+            stats->freeClusters = freeCount;
+            if ((2u <= nextFree) && (nextFree < (s_InformationOfFatFs.totalClusters + 2u)))
+            {
+                stats->nextFreeCluster = nextFree;
+            }
+            status = true;
+        }
+    }
+    free(buffer);
+
+    return status;
+}
+
+static void FATFS_ScanFat(FATFS_Stats_Struct_t *const stats)
+{
+    const uint32_t badCluster = s_EndOfFile - 8u;
+    const uint32_t endOfScan = s_InformationOfFatFs.totalClusters + 2u;
+    uint32_t cluster = 2;
+    uint32_t endOfBlock = 0;
+    uint32_t sumFree = 0;
+    uint32_t sumBad = 0;
+    uint32_t run = 0; /*Length of the current free run*/
+    uint32_t largestRun = 0;
+    uint32_t firstFree = FATFS_STATS_UNKNOWN;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bad = _mm_set1_epi32((int32_t)badCluster);
+    __m128i value;
+    int maskFree = 0;
+    int maskBad = 0;
+#endif
+
+    while (cluster < endOfScan)
+    {
+        endOfBlock = endOfScan;
+#if defined(__SSE2__)
+        /*4 elements per step : a block that is all free or all used only needs the masks*/
+        if ((cluster + 4u) <= endOfScan)
+        {
+            value = _mm_loadu_si128((const __m128i *)&s_BufferForFat[cluster]);
+            maskFree = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, zero)));
+            maskBad = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, bad)));
+            if (0x0f == maskFree)
+            {
+                if (FATFS_STATS_UNKNOWN == firstFree)
+                {
+                    firstFree = cluster;
+                }
+                sumFree += 4u;
+                run += 4u;
+                cluster += 4u;
+                continue;
+            }
+            if ((0 == maskFree) && (0 == maskBad))
+            {
+                if (run > largestRun)
+                {
+                    largestRun = run;
+                }
+                run = 0;
+                cluster += 4u;
+                continue;
+            }
+            endOfBlock = cluster + 4u; /*Mixed block : one element at a time*/
+        }
+#endif
+        for (; cluster < endOfBlock; cluster++)
+        {
+            if (0 == s_BufferForFat[cluster])
+            {
+                if (FATFS_STATS_UNKNOWN == firstFree)
+                {
+                    firstFree = cluster;
+                }
+                sumFree++;
+                run++;
+            }
+            else
+            {
+                if (badCluster == s_BufferForFat[cluster])
+                {
+                    sumBad++;
+                }
+                if (run > largestRun)
+                {
+                    largestRun = run;
+                }
+                run = 0;
+            }
+        }
+    }
+    if (run > largestRun)
+    {
+        largestRun = run;
+    }
+
+    stats->freeClusters = sumFree;
+    stats->badClusters = sumBad;
+    stats->largestFreeRun = largestRun;
+    stats->nextFreeCluster = firstFree;
+}
+
+static void FATFS_SetFat(const uint32_t cluster, const uint32_t value)
+{
+    uint32_t offset = 0;     /*Offset of the element in the FAT*/
+    uint32_t lastOffset = 0; /*Offset of the last byte of the element*/
+    uint8_t *element = NULL;
+
+    /*Keep the number of free clusters for FSInfo*/
+    if ((0 == s_BufferForFat[cluster]) && (0 != value))
+    {
+        s_SumFreeCluster--;
+    }
+    else if ((0 != s_BufferForFat[cluster]) && (0 == value))
+    {
+        s_SumFreeCluster++;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+    s_BufferForFat[cluster] = value;
+
+    if (FATFS_END_OF_FILE_FAT32 == s_EndOfFile)
+    {
+        offset = cluster * 4u;
+        lastOffset = offset + 3u;
+        element = &s_RawFat[offset];
+        /*The 4 high bits are reserved : keep them*/
+        element[0] = value & 0xffu;
+        element[1] = (value >> 8u) & 0xffu;
+        element[2] = (value >> 16u) & 0xffu;
+        element[3] = (element[3] & 0xf0u) | ((value >> 24u) & 0x0fu);
+    }
+    else if (FATFS_END_OF_FILE_FAT16 == s_EndOfFile)
+    {
+        offset = cluster * 2u;
+        lastOffset = offset + 1u;
+        element = &s_RawFat[offset];
+        element[0] = value & 0xffu;
+        element[1] = (value >> 8u) & 0xffu;
+    }
+    else
+    {
+        /*2 elements share 3 bytes, an element may be on 2 sectors*/
+        offset = cluster + (cluster >> 1u);
+        lastOffset = offset + 1u;
+        element = &s_RawFat[offset];
+        if (0 == (cluster & 1u))
+        {
+            element[0] = value & 0xffu;
+            element[1] = (element[1] & 0xf0u) | ((value >> 8u) & 0x0fu);
+        }
+        else
+        {
+            element[0] = (element[0] & 0x0fu) | ((value << 4u) & 0xf0u);
+            element[1] = (value >> 4u) & 0xffu;
+        }
+    }
+    offset /= s_InformationOfFatFs.bytePerSector;
+    lastOffset /= s_InformationOfFatFs.bytePerSector;
+    s_DirtyFat[offset >> 3u] |= (uint8_t)(1u << (offset & 7u));
+    s_DirtyFat[lastOffset >> 3u] |= (uint8_t)(1u << (lastOffset & 7u));
+}
+
+static uint32_t FATFS_CacheFind(const uint32_t sector)
+{
+    uint32_t i = (uint32_t)(sector * 2654435761u) >> (32u - FATFS_CACHE_BITS); /*Fibonacci hashing*/
+
+    while ((FATFS_CACHE_EMPTY != s_Cache[i].state) && (sector != s_Cache[i].sector))
+    {
+        i = (i + 1u) & (FATFS_CACHE_SIZE - 1u);
+    }
+
+    return i;
+}
+
+static uint8_t *FATFS_CacheGet(const uint32_t sector, const bool isWrite, const bool isNew)
+{
+    uint8_t *data = NULL; /*return value */
+    uint32_t i = FATFS_CacheFind(sector);
+
+    if (FATFS_CACHE_EMPTY == s_Cache[i].state)
+    {
+        if (s_SumCacheUsed >= ((FATFS_CACHE_SIZE / 4u) * 3u))
+        {
+            /*Keep probing short : write everything and start again with an empty cache*/
+            FATFS_Flush();
+            memset(s_Cache, 0, FATFS_CACHE_SIZE * sizeof(FATFS_CacheSlot_struct_t));
+            s_SumCacheUsed = 0;
+            i = FATFS_CacheFind(sector);
+        }
+        data = &s_CacheData[i * s_InformationOfFatFs.bytePerSector];
+        STATS_Add(STATS_CACHE_MISS, 1u);
+        if ((true == isNew) || (s_InformationOfFatFs.bytePerSector == HAL_ReadSector(sector, data)))
+        {
+            s_Cache[i].sector = sector;
+            s_Cache[i].state = FATFS_CACHE_CLEAN;
+            s_SumCacheUsed++;
+        }
+        else
+        {
+            data = NULL;
+        }
+    }
+    else
+    {
+        data = &s_CacheData[i * s_InformationOfFatFs.bytePerSector];
+        STATS_Add(STATS_CACHE_HIT, 1u);
+    }
+
+    if (NULL != data)
+    {
+        if (true == isNew)
+        {
+            memset(data, 0, s_InformationOfFatFs.bytePerSector);
+        }
+        if (true == isWrite)
+        {
+            s_Cache[i].state = FATFS_CACHE_DIRTY;
+        }
+    }
+
+    return data;
+}
+
+static void FATFS_CacheOverlay(const uint32_t firstSector, const uint32_t sumSector, uint8_t *const buffer)
+{
+    uint32_t i = 0;
+    uint32_t slot = 0;
+
+    for (i = 0; (NULL != s_Cache) && (0 != s_SumCacheUsed) && (i < sumSector); i++)
+    {
+        slot = FATFS_CacheFind(firstSector + i);
+        if (FATFS_CACHE_DIRTY == s_Cache[slot].state)
+        {
+            memcpy(&buffer[i * s_InformationOfFatFs.bytePerSector], &s_CacheData[slot * s_InformationOfFatFs.bytePerSector], s_InformationOfFatFs.bytePerSector);
+        }
+    }
+}
+
+static void FATFS_CacheDiscard(const uint32_t firstSector, const uint32_t sumSector)
+{
+    uint32_t i = 0;
+    uint32_t slot = 0;
+
+    /*The slot stays used (removing it would break probing), a new folder cluster is always filled again*/
+    for (i = 0; i < sumSector; i++)
+    {
+        slot = FATFS_CacheFind(firstSector + i);
+        if (FATFS_CACHE_DIRTY == s_Cache[slot].state)
+        {
+            s_Cache[slot].state = FATFS_CACHE_CLEAN;
+        }
+    }
+}
+
+static int FATFS_CompareSector(const void *first, const void *second)
+{
+    const uint64_t a = *(const uint64_t *)first;
+    const uint64_t b = *(const uint64_t *)second;
+
+    return (a > b) - (a < b);
+}
+
+static bool FATFS_SlotSeek(FATFS_Slot_struct_t *const cursor, const uint32_t folder, const uint32_t slot)
+{
+    bool status = true; /*return value */
+    const uint32_t slotPerSector = s_InformationOfFatFs.bytePerSector / FATFS_SIZE_ENTRY_BYTE;
+    const uint32_t sectorIndex = slot / slotPerSector;
+    uint32_t i = 0;
+
+    cursor->slot = slot;
+    cursor->offset = (slot % slotPerSector) * FATFS_SIZE_ENTRY_BYTE;
+    cursor->sumClusterRead = 0;
+    if ((0 == folder) && (FATFS_END_OF_FILE_FAT32 != s_EndOfFile))
+    {
+        /*Root 12 or 16*/
+        cursor->cluster = 0;
+        cursor->sectorInBlock = sectorIndex;
+        cursor->sector = s_InformationOfFatFs.locationOfRoot + sectorIndex;
+        status = (sectorIndex < s_InformationOfFatFs.sumSectorOfRoot);
+    }
+    else
+    {
+        cursor->cluster = (0 == folder) ? s_InformationOfFatFs.stratClusterOfRootOfFat32 : folder;
+        status = FATFS_IsValidCluster(cursor->cluster);
+        for (i = 0; (true == status) && (i < (sectorIndex / s_InformationOfFatFs.sectorPerCluster)); i++)
+        {
+            status = FATFS_GetNextCluster(cursor->cluster, &cursor->cluster) && (i < s_SumElementOfFat);
+        }
+        cursor->sumClusterRead = i;
+        cursor->sectorInBlock = sectorIndex % s_InformationOfFatFs.sectorPerCluster;
+        cursor->sector = s_InformationOfFatFs.locationOfData + (cursor->cluster - 2u) * s_InformationOfFatFs.sectorPerCluster + cursor->sectorInBlock;
+    }
+
+    return status;
+}
+
+static bool FATFS_SlotNext(FATFS_Slot_struct_t *const cursor)
+{
+    bool status = true; /*return value */
+    uint32_t nextCluster = 0;
+
+    cursor->slot++;
+    cursor->offset += FATFS_SIZE_ENTRY_BYTE;
+    if (cursor->offset >= s_InformationOfFatFs.bytePerSector)
+    {
+        cursor->offset = 0;
+        cursor->sectorInBlock++;
+        if (0 == cursor->cluster)
+        {
+            status = (cursor->sectorInBlock < s_InformationOfFatFs.sumSectorOfRoot);
+            cursor->sector++;
+        }
+        else if (cursor->sectorInBlock < s_InformationOfFatFs.sectorPerCluster)
+        {
+            cursor->sector++;
+        }
+        else
+        {
+            /*Next cluster of the folder. A chain can not be longer than the FAT*/
+            status = (true == FATFS_GetNextCluster(cursor->cluster, &nextCluster)) && (cursor->sumClusterRead < s_SumElementOfFat);
+            if (true == status)
+            {
+                cursor->cluster = nextCluster;
+                cursor->sumClusterRead++;
+                cursor->sectorInBlock = 0;
+                cursor->sector = s_InformationOfFatFs.locationOfData + (nextCluster - 2u) * s_InformationOfFatFs.sectorPerCluster;
+            }
+        }
+    }
+
+    return status;
+}
+
+static uint8_t *FATFS_SlotData(const FATFS_Slot_struct_t *const cursor, const bool isWrite)
+{
+    uint8_t *data = FATFS_CacheGet(cursor->sector, isWrite, false);
+
+    return (NULL != data) ? &data[cursor->offset] : NULL;
+}
+
+static bool FATFS_AllocateChain(const uint32_t sumCluster, const uint32_t goal, uint32_t *const firstCluster)
+{
+    bool status = (sumCluster <= s_SumFreeCluster); /*return value */
+    uint32_t previous = 0;     /*Last cluster of the chain*/
+    uint32_t sumFound = 0;
+    uint32_t start = 0;        /*Run given by the index*/
+    uint32_t length = 0;
+    uint32_t nextGoal = goal;
+    uint32_t i = 0;
+
+    *firstCluster = 0;
+    /*The FAT is only changed in memory, its sectors are written by FATFS_Flush*/
+    while ((true == status) && (sumFound < sumCluster))
+    {
+        status = ALLOC_Allocate(sumCluster - sumFound, nextGoal, &start, &length);
+        if (true == status)
+        {
+            for (i = 0; i < length; i++)
+            {
+                FATFS_SetFat(start + i, ((i + 1u) < length) ? (start + i + 1u) : s_EndOfFile);
+            }
+            if (0 == previous)
+            {
+                *firstCluster = start;
+            }
+            else
+            {
+                FATFS_SetFat(previous, start);
+            }
+            previous = start + length - 1u;
+            sumFound += length;
+            STATS_Add(STATS_CLUSTER_ALLOCATED, length);
+            nextGoal = start + length;
+            s_NextFreeCluster = nextGoal;
+        }
+    }
+
+    if ((false == status) && (0 != *firstCluster))
+    {
+        FATFS_FreeChain(*firstCluster);
+        *firstCluster = 0;
+    }
+
+    return status;
+}
+
+static void FATFS_FreeChain(uint32_t cluster)
+{
+    uint32_t nextCluster = 0;
+    uint32_t sumCluster = 0;
+    uint32_t start = 0;  /*Run of contiguous clusters being freed*/
+    uint32_t length = 0;
+
+    /*A freed element reads 0 : a looping chain stops when it comes back*/
+    while ((true == FATFS_IsValidCluster(cluster)) && (0 != s_BufferForFat[cluster]) && (sumCluster < s_SumElementOfFat))
+    {
+        nextCluster = s_BufferForFat[cluster];
+        FATFS_SetFat(cluster, 0);
+        if ((0 != length) && ((start + length) == cluster))
+        {
+            length++;
+        }
+        else
+        {
+            if (0 != length)
+            {
+                ALLOC_Release(start, length);
+            }
+            start = cluster;
+            length = 1;
+        }
+        if (cluster < s_NextFreeCluster)
+        {
+            s_NextFreeCluster = cluster;
+        }
+        cluster = nextCluster;
+        sumCluster++;
+    }
+    if (0 != length)
+    {
+        ALLOC_Release(start, length);
+    }
+}
+
+static bool FATFS_TrimChain(FATFS_Entry_Struct_t *const entry)
+{
+    bool status = true; /*return value */
+    const uint32_t bytePerCluster = s_InformationOfFatFs.bytePerSector * s_InformationOfFatFs.sectorPerCluster;
+    const uint32_t sumClusterToKeep = (entry->fileSize / bytePerCluster) + ((0 != (entry->fileSize % bytePerCluster)) ? 1u : 0u);
+    uint32_t cluster = entry->firstCluster;
+    uint32_t i = 0;
+
+    if (0 == sumClusterToKeep)
+    {
+        FATFS_FreeChain(entry->firstCluster);
+        entry->firstCluster = 0;
+    }
+    else
+    {
+        /*The last kept cluster becomes the end of the chain*/
+        status = FATFS_IsValidCluster(cluster);
+        for (i = 1; (true == status) && (i < sumClusterToKeep); i++)
+        {
+            status = FATFS_GetNextCluster(cluster, &cluster);
+        }
+        if ((true == status) && (true == FATFS_IsValidCluster(s_BufferForFat[cluster])))
+        {
+            FATFS_FreeChain(s_BufferForFat[cluster]);
+            FATFS_SetFat(cluster, s_EndOfFile);
+        }
+    }
+
+    return status;
+}
+
+static bool FATFS_ClearCluster(const uint32_t cluster)
+{
+    bool status = true; /*return value */
+    const uint32_t firstSector = s_InformationOfFatFs.locationOfData + (cluster - 2u) * s_InformationOfFatFs.sectorPerCluster;
+    uint32_t i = 0;
+
+    for (i = 0; (true == status) && (i < s_InformationOfFatFs.sectorPerCluster); i++)
+    {
+        status = (NULL != FATFS_CacheGet(firstSector + i, true, true));
+    }
+
+    return status;
+}
+
+static void FATFS_GetTimeStamp(uint16_t *const dateField, uint16_t *const timeField)
+{
+    const time_t now = time(NULL);
+    struct tm local;
+
+    if ((NULL != localtime_r(&now, &local)) && (80 <= local.tm_year))
+    {
+        *dateField = (uint16_t)(((local.tm_year - 80) << FATFS_FIELD_YEAR_SHIFT_RIGHT) | ((local.tm_mon + 1) << FATFS_FIELD_MONTH_SHIFT_RIGHT) | (local.tm_mday << FATFS_FIELD_DAY_SHIFT_RIGHT));
+        *timeField = (uint16_t)((local.tm_hour << FATFS_FIELD_HOURS_SHIFT_RIGHT) | (local.tm_min << FATFS_FIELD_MINUTES_SHIFT_RIGHT) | ((local.tm_sec / 2) << FATFS_FIELD_SECONDS_SHIFT_RIGHT));
+    }
+    else
+    {
+        /*1980-01-01 00:00:00*/
+        *dateField = (1u << FATFS_FIELD_MONTH_SHIFT_RIGHT) | (1u << FATFS_FIELD_DAY_SHIFT_RIGHT);
+        *timeField = 0;
+    }
+}
+
+static bool FATFS_SplitPath(const uint8_t *const path, uint8_t *const folder, uint8_t *const name)
+{
+    bool status = true; /*return value */
+    uint32_t end = strlen((const char *)path);
+    uint32_t start = 0; /*First character of name*/
+
+    /*Ignore trailing '/'*/
+    while ((0 != end) && (('/' == path[end - 1u]) || ('\\' == path[end - 1u])))
+    {
+        end--;
+    }
+    start = end;
+    while ((0 != start) && ('/' != path[start - 1u]) && ('\\' != path[start - 1u]))
+    {
+        start--;
+    }
+
+    if ((start == end) || ((end - start) > FATFS_LONG_FILE_NAME_MAX_UTF8) || (start >= FATFS_FIND_MAX_PATH))
+    {
+        status = false;
+    }
+    else
+    {
+        memcpy(folder, path, start);
+        folder[start] = 0;
+        memcpy(name, &path[start], end - start);
+        name[end - start] = 0;
+        status = (0 != strcmp((const char *)name, ".")) && (0 != strcmp((const char *)name, ".."));
+    }
+
+    return status;
+}
+
+static bool FATFS_EncodeName(const uint8_t *const name, uint16_t *const longName, uint32_t *const length)
+{
+    bool status = true; /*return value */
+    uint32_t i = 0;     /*Index of name*/
+    uint32_t j = 0;     /*Index of longName*/
+    uint32_t character = 0;
+    uint32_t sumContinuation = 0; /*Bytes following the first byte of a UTF-8 character*/
+
+    while ((true == status) && (0 != name[i]))
+    {
+        character = name[i];
+        i++;
+        if (0x80u > character)
+        {
+            sumContinuation = 0;
+            /*Characters never allowed in a long file name*/
+            status = (0x20u <= character) && (NULL == strchr("\"*/:<>?\\|", (int)character));
+        }
+        else if (0xe0u > character)
+        {
+            sumContinuation = 1;
+            character &= 0x1fu;
+        }
+        else if (0xf0u > character)
+        {
+            sumContinuation = 2;
+            character &= 0x0fu;
+        }
+        else
+        {
+            sumContinuation = 3;
+            character &= 0x07u;
+        }
+        while ((true == status) && (0 != sumContinuation))
+        {
+            status = (0x80u == (name[i] & 0xc0u));
+            character = (character << 6u) | (name[i] & 0x3fu);
+            i++;
+            sumContinuation--;
+        }
+
+        if (true == status)
+        {
+            if (0xffffu < character)
+            {
+                /*Surrogate pair*/
+                status = ((j + 2u) <= FATFS_LONG_FILE_NAME_MAX_LENGTH);
+                if (true == status)
+                {
+                    character -= 0x10000u;
+                    longName[j] = (uint16_t)(0xd800u | (character >> 10u));
+                    longName[j + 1u] = (uint16_t)(0xdc00u | (character & 0x3ffu));
+                    j += 2u;
+                }
+            }
+            else
+            {
+                status = (j < FATFS_LONG_FILE_NAME_MAX_LENGTH);
+                if (true == status)
+                {
+                    longName[j] = (uint16_t)character;
+                    j++;
+                }
+            }
+        }
+    }
+    /*A name can not end with a space or a dot*/
+    *length = j;
+    if ((0 == j) || (' ' == longName[j - 1u]) || ('.' == longName[j - 1u]))
+    {
+        status = false;
+    }
+
+    return status;
+}
+
+static bool FATFS_MakeShortName(const uint32_t folder, const uint8_t *const name, uint8_t *const shortName, bool *const needLongName)
+{
+    bool status = true;                       /*return value */
+    uint8_t base[FATFS_SIZE_NAME];            /*Name part, up to 8 characters*/
+    uint8_t extension[FATFS_SIZE_EXTENSION];  /*Extension part, up to 3 characters*/
+    uint32_t lengthOfBase = 0;
+    uint32_t lengthOfExtension = 0;
+    uint32_t lastDot = 0;                     /*Index of the dot starting the extension (0 : none)*/
+    uint32_t i = 0;
+    uint32_t tail = 0;                        /*N of "NAME~N"*/
+    uint32_t lengthOfTail = 0;                /*Length of "~N"*/
+    uint32_t keep = 0;                        /*Characters of base kept before "~N"*/
+    uint8_t *used = NULL;                     /*Bitmap of N already used in the folder*/
+    uint8_t character = 0;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *current = NULL;
+
+    /*The extension starts at the last dot, a leading dot does not start an extension*/
+    for (i = 1; 0 != name[i]; i++)
+    {
+        if ('.' == name[i])
+        {
+            lastDot = i;
+        }
+    }
+
+    /*Upper case, spaces and dots removed, characters not allowed in a short name replaced by '_'*/
+    *needLongName = false;
+    for (i = 0; 0 != name[i]; i++)
+    {
+        character = name[i];
+        if ((0 != lastDot) && (i == lastDot))
+        {
+            continue;
+        }
+        if ((' ' == character) || (('.' == character) && ((0 == lastDot) || (i < lastDot))))
+        {
+            *needLongName = true;
+            continue;
+        }
+        if (0x80u <= character)
+        {
+            *needLongName = true;
+            if (0xc0u > character)
+            {
+                continue; /*Only one '_' per UTF-8 character*/
+            }
+            character = '_';
+        }
+        else if (NULL != strchr("+,;=[]", (int)character))
+        {
+            *needLongName = true;
+            character = '_';
+        }
+        else if (('a' <= character) && ('z' >= character))
+        {
+            *needLongName = true; /*Keep the case in the long file name*/
+            character -= 'a' - 'A';
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+
+        if ((0 == lastDot) || (i < lastDot))
+        {
+            if (lengthOfBase < FATFS_SIZE_NAME)
+            {
+                base[lengthOfBase] = character;
+                lengthOfBase++;
+            }
+            else
+            {
+                *needLongName = true;
+            }
+        }
+        else
+        {
+            if (lengthOfExtension < FATFS_SIZE_EXTENSION)
+            {
+                extension[lengthOfExtension] = character;
+                lengthOfExtension++;
+            }
+            else
+            {
+                *needLongName = true;
+            }
+        }
+    }
+    if (0 == lengthOfBase)
+    {
+        base[0] = '_';
+        lengthOfBase = 1;
+        *needLongName = true;
+    }
+
+    memset(shortName, ' ', FATFS_SIZE_SHORT_NAME);
+    memcpy(&shortName[FATFS_SIZE_NAME], extension, lengthOfExtension);
+    if (false == *needLongName)
+    {
+        memcpy(shortName, base, lengthOfBase);
+    }
+    else
+    {
+        /*Numbers already used by "BASE~N.EXT" in the folder, found in one pass*/
+        used = (uint8_t *)STATS_Calloc((FATFS_SHORT_NAME_MAX_TAIL / 8u) + 1u, 1u);
+        status = (NULL != used) && (true == FATFS_DirOpen(&dir, folder));
+        if (true == status)
+        {
+            current = FATFS_DirNext(&dir);
+            while (NULL != current)
+            {
+                for (i = 1; (i < FATFS_SIZE_NAME) && ('~' != current->shortFileName[i]); i++)
+                {
+                }
+                if ((FATFS_DELETED_ENTRY != current->shortFileName[0]) && (i < (FATFS_SIZE_NAME - 1u)) &&
+                    (0 == memcmp(current->shortFileExtension, &shortName[FATFS_SIZE_NAME], FATFS_SIZE_EXTENSION)) &&
+                    (0 == memcmp(current->shortFileName, base, (i < lengthOfBase) ? i : lengthOfBase)))
+                {
+                    keep = i;
+                    tail = 0;
+                    for (i = keep + 1u; (i < FATFS_SIZE_NAME) && ('0' <= current->shortFileName[i]) && ('9' >= current->shortFileName[i]); i++)
+                    {
+                        tail = tail * 10u + (current->shortFileName[i] - '0');
+                    }
+                    if ((0 != tail) && (tail <= FATFS_SHORT_NAME_MAX_TAIL))
+                    {
+                        used[tail >> 3u] |= (uint8_t)(1u << (tail & 7u));
+                    }
+                }
+                current = FATFS_DirNext(&dir);
+            }
+            FATFS_DirClose(&dir);
+
+            for (tail = 1; (tail <= FATFS_SHORT_NAME_MAX_TAIL) && (0 != (used[tail >> 3u] & (1u << (tail & 7u)))); tail++)
+            {
+            }
+            status = (tail <= FATFS_SHORT_NAME_MAX_TAIL);
+        }
+        if (true == status)
+        {
+            lengthOfTail = (10u > tail) ? 2u : ((100u > tail) ? 3u : ((1000u > tail) ? 4u : 5u));
+            keep = (lengthOfBase < (FATFS_SIZE_NAME - lengthOfTail)) ? lengthOfBase : (FATFS_SIZE_NAME - lengthOfTail);
+            memcpy(shortName, base, keep);
+            shortName[keep] = '~';
+            for (i = keep + lengthOfTail - 1u; i > keep; i--)
+            {
+                shortName[i] = (uint8_t)('0' + (tail % 10u));
+                tail /= 10u;
+            }
+        }
+        free(used);
+    }
+
+    return status;
+}
+
+static bool FATFS_AddEntry(const uint32_t folder, const uint8_t *const name, const uint8_t attributes, const uint32_t firstCluster)
+{
+    bool status = true; /*return value */
+    uint16_t longName[FATFS_LONG_FILE_NAME_MAX_LENGTH];
+    uint32_t lengthOfLongName = 0;
+    uint8_t shortName[FATFS_SIZE_SHORT_NAME];
+    bool needLongName = false;
+    uint32_t sumSubEntry = 0;
+    uint32_t sumFreeSlot = 0;    /*Free slots found in a row*/
+    uint32_t firstFreeSlot = 0;
+    bool isAfterEnd = false;     /*The end of directory entry was passed : every next slot is free*/
+    bool found = false;
+    FATFS_Slot_struct_t cursor;
+    uint8_t *data = NULL;
+    uint32_t newCluster = 0;
+    uint32_t order = 0;          /*Sequence number of a sub entry*/
+    uint32_t position = 0;       /*Index in longName*/
+    uint16_t character = 0;
+    uint16_t dateField = 0;
+    uint16_t timeField = 0;
+    uint8_t checkSum = 0;
+    uint32_t i = 0;
+
+    status = (true == FATFS_EncodeName(name, longName, &lengthOfLongName)) && (true == FATFS_MakeShortName(folder, name, shortName, &needLongName));
+    if (true == status)
+    {
+        sumSubEntry = (true == needLongName) ? ((lengthOfLongName + FATFS_CHARACTERS_PER_SUB_ENTRY - 1u) / FATFS_CHARACTERS_PER_SUB_ENTRY) : 0u;
+
+        /*Find sumSubEntry + 1 free slots in a row, the folder gets a new cluster if there are not enough*/
+        status = FATFS_SlotSeek(&cursor, folder, 0);
+        while ((true == status) && (false == found))
+        {
+            data = FATFS_SlotData(&cursor, false);
+            status = (NULL != data);
+            if (true == status)
+            {
+                if ((true == isAfterEnd) || (FATFS_END_OF_ENTRY == data[0]) || (FATFS_DELETED_ENTRY == data[0]))
+                {
+                    isAfterEnd = isAfterEnd || (FATFS_END_OF_ENTRY == data[0]);
+                    if (0 == sumFreeSlot)
+                    {
+                        firstFreeSlot = cursor.slot;
+                    }
+                    sumFreeSlot++;
+                    found = (sumFreeSlot == (sumSubEntry + 1u));
+                }
+                else
+                {
+                    sumFreeSlot = 0;
+                }
+            }
+            if ((true == status) && (false == found) && (false == FATFS_SlotNext(&cursor)))
+            {
+                /*The root of fat 12/16 can not grow*/
+                status = (0 != cursor.cluster) && (true == FATFS_AllocateChain(1u, cursor.cluster + 1u, &newCluster));
+                if (true == status)
+                {
+                    FATFS_SetFat(cursor.cluster, newCluster);
+                    status = FATFS_ClearCluster(newCluster);
+                    cursor.cluster = newCluster;
+                    cursor.sumClusterRead++;
+                    cursor.sectorInBlock = 0;
+                    cursor.sector = s_InformationOfFatFs.locationOfData + (newCluster - 2u) * s_InformationOfFatFs.sectorPerCluster;
+                    isAfterEnd = true;
+                }
+            }
+        }
+    }
+
+    if (true == status)
+    {
+        checkSum = FATFS_CalculateCheckSum(shortName);
+        status = FATFS_SlotSeek(&cursor, folder, firstFreeSlot);
+        /*Sub entries from the last one (flag 0x40) to the first one*/
+        for (order = sumSubEntry; (true == status) && (0 != order); order--)
+        {
+            data = FATFS_SlotData(&cursor, true);
+            status = (NULL != data);
+            if (true == status)
+            {
+                memset(data, 0, FATFS_SIZE_ENTRY_BYTE);
+                data[0] = (uint8_t)(order | ((order == sumSubEntry) ? FATFS_SUB_ENTRY_LAST_MASK : 0u));
+                data[FATFS_ATTRIBUTE_OF_FILE_OFFSET] = FATFS_SUB_ENTRY;
+                data[FATFS_SUB_ENTRY_CHECK_SUM_OFFSET] = checkSum;
+                for (i = 0; i < FATFS_CHARACTERS_PER_SUB_ENTRY; i++)
+                {
+                    /*The name ends with 0 then the rest is filled with 0xffff*/
+                    position = (order - 1u) * FATFS_CHARACTERS_PER_SUB_ENTRY + i;
+                    character = (position < lengthOfLongName) ? longName[position] : ((position == lengthOfLongName) ? 0u : 0xffffu);
+                    FATFS_PUT_2_BYTES(&data[s_OffsetOfLongFileName[i]], character);
+                }
+                status = FATFS_SlotNext(&cursor);
+            }
+        }
+        /*Main entry*/
+        data = (true == status) ? FATFS_SlotData(&cursor, true) : NULL;
+        status = (NULL != data);
+        if (true == status)
+        {
+            FATFS_GetTimeStamp(&dateField, &timeField);
+            memset(data, 0, FATFS_SIZE_ENTRY_BYTE);
+            memcpy(data, shortName, FATFS_SIZE_SHORT_NAME);
+            data[FATFS_ATTRIBUTE_OF_FILE_OFFSET] = attributes;
+            FATFS_PUT_2_BYTES(&data[FATFS_CREATE_TIME_FILE_OFFSET], timeField);
+            FATFS_PUT_2_BYTES(&data[FATFS_CREATE_DATE_FILE_OFFSET], dateField);
+            FATFS_PUT_2_BYTES(&data[FATFS_LAST_ACCESS_DATE_FILE_OFFSET], dateField);
+            FATFS_PUT_2_BYTES(&data[FATFS_HIGH_WORD_OF_ADDRESS_CLUSTER_OFFSET], firstCluster >> 16u);
+            FATFS_PUT_2_BYTES(&data[FATFS_LAST_MOD_TIME_FILE_OFFSET], timeField);
+            FATFS_PUT_2_BYTES(&data[FATFS_LAST_MOD_DATE_FILE_OFFSET], dateField);
+            FATFS_PUT_2_BYTES(&data[FATFS_LOW_WORD_OF_ADDRESS_CLUSTER_OFFSET], firstCluster);
+        }
+        /*Slots after the end of directory entry may hold old data : the next one becomes the end*/
+        if ((true == status) && (true == isAfterEnd) && (true == FATFS_SlotNext(&cursor)))
+        {
+            data = FATFS_SlotData(&cursor, false);
+            if ((NULL != data) && (FATFS_END_OF_ENTRY != data[0]))
+            {
+                data = FATFS_SlotData(&cursor, true);
+                data[0] = FATFS_END_OF_ENTRY;
+            }
+        }
+    }
+
+    return status;
+}
+
+static bool FATFS_UpdateEntry(const FATFS_Location_struct_t *const location, const uint32_t firstCluster, const uint32_t fileSize)
+{
+    bool status = false; /*return value */
+    FATFS_Slot_struct_t cursor;
+    uint8_t *data = NULL;
+    uint16_t dateField = 0;
+    uint16_t timeField = 0;
+
+    if (true == FATFS_SlotSeek(&cursor, location->folder, location->slot))
+    {
+        data = FATFS_SlotData(&cursor, true);
+        if (NULL != data)
+        {
+            FATFS_GetTimeStamp(&dateField, &timeField);
+            FATFS_PUT_2_BYTES(&data[FATFS_HIGH_WORD_OF_ADDRESS_CLUSTER_OFFSET], firstCluster >> 16u);
+            FATFS_PUT_2_BYTES(&data[FATFS_LOW_WORD_OF_ADDRESS_CLUSTER_OFFSET], firstCluster);
+            FATFS_PUT_4_BYTES(&data[FATFS_FILE_SIZE_OFFSET], fileSize);
+            FATFS_PUT_2_BYTES(&data[FATFS_LAST_ACCESS_DATE_FILE_OFFSET], dateField);
+            FATFS_PUT_2_BYTES(&data[FATFS_LAST_MOD_TIME_FILE_OFFSET], timeField);
+            FATFS_PUT_2_BYTES(&data[FATFS_LAST_MOD_DATE_FILE_OFFSET], dateField);
+            status = true;
+        }
+    }
+
+    return status;
+}
+
+static bool FATFS_DeleteEntry(const FATFS_Location_struct_t *const location)
+{
+    bool status = true; /*return value */
+    FATFS_Slot_struct_t cursor;
+    uint8_t *data = NULL;
+    uint32_t i = 0;
+
+    status = FATFS_SlotSeek(&cursor, location->folder, location->slot - location->sumSubEntry);
+    for (i = 0; (true == status) && (i <= location->sumSubEntry); i++)
+    {
+        data = FATFS_SlotData(&cursor, true);
+        status = (NULL != data);
+        if (true == status)
+        {
+            data[0] = FATFS_DELETED_ENTRY;
+            if (i < location->sumSubEntry)
+            {
+                status = FATFS_SlotNext(&cursor);
+            }
+        }
+    }
+
+    return status;
+}
+
+static bool FATFS_AppendData(FATFS_Entry_Struct_t *const entry, const uint8_t *const data, const uint32_t size)
+{
+    bool status = true; /*return value */
+    const uint32_t bytePerCluster = s_InformationOfFatFs.bytePerSector * s_InformationOfFatFs.sectorPerCluster;
+    const uint32_t maxClusterPerWrite = (FATFS_STREAM_CHUNK_BYTE > bytePerCluster) ? (FATFS_STREAM_CHUNK_BYTE / bytePerCluster) : 1u;
+    uint8_t *bufferOfCluster = NULL; /*Last cluster, partly used*/
+    uint8_t *zero = NULL;            /*Zeros written when data is NULL*/
+    uint32_t sumCluster = (entry->fileSize / bytePerCluster) + ((0 != (entry->fileSize % bytePerCluster)) ? 1u : 0u);
+    const uint32_t usedOfLastCluster = entry->fileSize % bytePerCluster;
+    uint32_t lastCluster = 0;  /*Last cluster holding data*/
+    uint32_t tailCluster = 0;  /*Last cluster of the chain*/
+    uint32_t firstCluster = 0; /*First cluster after lastCluster*/
+    uint32_t cluster = 0;
+    uint32_t sectorOfLastCluster = 0; /*First sector of lastCluster*/
+    uint32_t sumWritten = 0;
+    uint32_t sizeToWrite = 0;
+    uint32_t sumClusterOfRun = 0;
+    uint32_t i = 0;
+
+    bufferOfCluster = (uint8_t *)STATS_Malloc(bytePerCluster);
+    status = (NULL != bufferOfCluster);
+
+    /*Last cluster of the file*/
+    if ((true == status) && (0 != sumCluster))
+    {
+        lastCluster = entry->firstCluster;
+        status = FATFS_IsValidCluster(lastCluster);
+        for (i = 1; (true == status) && (i < sumCluster); i++)
+        {
+            status = FATFS_GetNextCluster(lastCluster, &lastCluster);
+        }
+    }
+
+    /*Fill the end of the last cluster*/
+    if ((true == status) && (0 != usedOfLastCluster))
+    {
+        sizeToWrite = ((bytePerCluster - usedOfLastCluster) < size) ? (bytePerCluster - usedOfLastCluster) : size;
+        sectorOfLastCluster = s_InformationOfFatFs.locationOfData + (lastCluster - 2u) * s_InformationOfFatFs.sectorPerCluster;
+        status = (bytePerCluster == (uint32_t)HAL_ReadMultiSector(sectorOfLastCluster, s_InformationOfFatFs.sectorPerCluster, bufferOfCluster));
+        if (true == status)
+        {
+            if (NULL != data)
+            {
+                memcpy(&bufferOfCluster[usedOfLastCluster], data, sizeToWrite);
+            }
+            else
+            {
+                memset(&bufferOfCluster[usedOfLastCluster], 0, sizeToWrite);
+            }
+            status = (bytePerCluster == (uint32_t)HAL_WriteMultiSector(sectorOfLastCluster, s_InformationOfFatFs.sectorPerCluster, bufferOfCluster));
+            sumWritten = sizeToWrite;
+        }
+    }
+
+    /*Preallocated clusters are used first, the missing ones are allocated at once after them,
+      then everything is written by runs of contiguous clusters*/
+    if ((true == status) && (sumWritten < size))
+    {
+        sumCluster = ((size - sumWritten) / bytePerCluster) + ((0 != ((size - sumWritten) % bytePerCluster)) ? 1u : 0u);
+        firstCluster = (0 == lastCluster) ? entry->firstCluster : s_BufferForFat[lastCluster];
+        tailCluster = lastCluster;
+        cluster = firstCluster;
+        while ((0 != sumCluster) && (true == FATFS_IsValidCluster(cluster)))
+        {
+            tailCluster = cluster;
+            cluster = s_BufferForFat[cluster];
+            sumCluster--;
+        }
+        if (0 != sumCluster)
+        {
+            status = FATFS_AllocateChain(sumCluster, (0 != tailCluster) ? (tailCluster + 1u) : ALLOC_NO_GOAL, &cluster);
+            if ((true == status) && (0 == tailCluster))
+            {
+                entry->firstCluster = cluster;
+                firstCluster = cluster;
+            }
+            else if (true == status)
+            {
+                FATFS_SetFat(tailCluster, cluster);
+                firstCluster = (tailCluster == lastCluster) ? cluster : firstCluster;
+            }
+            else
+            {
+                /*Do nothing*/
+            }
+        }
+        cluster = firstCluster;
+        if ((true == status) && (NULL == data))
+        {
+            zero = (uint8_t *)STATS_Calloc(maxClusterPerWrite, bytePerCluster);
+            status = (NULL != zero);
+        }
+        while ((true == status) && (sumWritten < size))
+        {
+            if ((size - sumWritten) >= bytePerCluster)
+            {
+                sumClusterOfRun = 1;
+                while ((sumClusterOfRun < maxClusterPerWrite) && ((size - sumWritten) >= ((sumClusterOfRun + 1u) * bytePerCluster)) &&
+                       (s_BufferForFat[cluster + sumClusterOfRun - 1u] == (cluster + sumClusterOfRun)))
+                {
+                    sumClusterOfRun++;
+                }
+                sizeToWrite = sumClusterOfRun * bytePerCluster;
+                status = (sizeToWrite == (uint32_t)HAL_WriteMultiSector(s_InformationOfFatFs.locationOfData + (cluster - 2u) * s_InformationOfFatFs.sectorPerCluster,
+                                                                        sumClusterOfRun * s_InformationOfFatFs.sectorPerCluster, (NULL != data) ? &data[sumWritten] : zero));
+                cluster += sumClusterOfRun - 1u;
+            }
+            else
+            {
+                /*Last cluster : the rest is filled with zeros*/
+                sizeToWrite = size - sumWritten;
+                memset(bufferOfCluster, 0, bytePerCluster);
+                if (NULL != data)
+                {
+                    memcpy(bufferOfCluster, &data[sumWritten], sizeToWrite);
+                }
+                status = (bytePerCluster == (uint32_t)HAL_WriteMultiSector(s_InformationOfFatFs.locationOfData + (cluster - 2u) * s_InformationOfFatFs.sectorPerCluster,
+                                                                           s_InformationOfFatFs.sectorPerCluster, bufferOfCluster));
+            }
+            sumWritten += sizeToWrite;
+            cluster = s_BufferForFat[cluster];
+        }
+    }
+
+    if (true == status)
+    {
+        entry->fileSize += size;
+    }
+    free(bufferOfCluster);
+    free(zero);
+
+    return status;
+}
+
+static bool FATFS_Create(const uint8_t *const path, const uint8_t attributes)
+{
+    bool status = s_IsWritable; /*return value */
+    uint8_t folderPath[FATFS_FIND_MAX_PATH];
+    uint8_t name[FATFS_LONG_FILE_NAME_MAX_UTF8 + 1u];
+    FATFS_Entry_Struct_t entry;
+    uint32_t folder = 0;
+    uint32_t firstCluster = 0;
+    uint8_t *data = NULL;
+
+    status = (true == status) && (true == FATFS_SplitPath(path, folderPath, name)) && (true == FATFS_Locate(folderPath, &entry, NULL)) &&
+             (0 != (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY));
+    folder = entry.firstCluster;
+    status = (true == status) && (false == FATFS_Locate(path, &entry, NULL)); /*The name is already used*/
+
+    if ((true == status) && (FATFS_ATTRIBUTE_DIRECTORY == attributes))
+    {
+        /*A folder starts with "." (itself) and ".." (its parent, 0 for the root)*/
+        status = (true == FATFS_AllocateChain(1u, (0 != folder) ? (folder + 1u) : ALLOC_NO_GOAL, &firstCluster)) && (true == FATFS_ClearCluster(firstCluster));
+        data = (true == status) ? FATFS_CacheGet(s_InformationOfFatFs.locationOfData + (firstCluster - 2u) * s_InformationOfFatFs.sectorPerCluster, true, false) : NULL;
+        status = (NULL != data);
+        if (true == status)
+        {
+            memset(data, ' ', FATFS_SIZE_SHORT_NAME);
+            data[0] = '.';
+            data[FATFS_ATTRIBUTE_OF_FILE_OFFSET] = FATFS_ATTRIBUTE_DIRECTORY;
+            FATFS_PUT_2_BYTES(&data[FATFS_HIGH_WORD_OF_ADDRESS_CLUSTER_OFFSET], firstCluster >> 16u);
+            FATFS_PUT_2_BYTES(&data[FATFS_LOW_WORD_OF_ADDRESS_CLUSTER_OFFSET], firstCluster);
+            memset(&data[FATFS_SIZE_ENTRY_BYTE], ' ', FATFS_SIZE_SHORT_NAME);
+            data[FATFS_SIZE_ENTRY_BYTE] = '.';
+            data[FATFS_SIZE_ENTRY_BYTE + 1u] = '.';
+            data[FATFS_SIZE_ENTRY_BYTE + FATFS_ATTRIBUTE_OF_FILE_OFFSET] = FATFS_ATTRIBUTE_DIRECTORY;
+            FATFS_PUT_2_BYTES(&data[FATFS_SIZE_ENTRY_BYTE + FATFS_HIGH_WORD_OF_ADDRESS_CLUSTER_OFFSET], folder >> 16u);
+            FATFS_PUT_2_BYTES(&data[FATFS_SIZE_ENTRY_BYTE + FATFS_LOW_WORD_OF_ADDRESS_CLUSTER_OFFSET], folder);
+        }
+    }
+
+    if (true == status)
+    {
+        status = FATFS_AddEntry(folder, name, attributes, firstCluster);
+    }
+    if ((false == status) && (0 != firstCluster))
+    {
+        FATFS_CacheDiscard(s_InformationOfFatFs.locationOfData + (firstCluster - 2u) * s_InformationOfFatFs.sectorPerCluster, s_InformationOfFatFs.sectorPerCluster);
+        FATFS_FreeChain(firstCluster);
+    }
+
+    return status;
+}
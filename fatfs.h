@@ -27,13 +27,20 @@ typedef struct
 
 } FATFS_Date_Struct_t; // date
 
+/*
+ *Maximum size in bytes of a long file name in UTF-8 : 255 UTF-16 characters take 3 bytes at most
+ *(a surrogate pair takes 4 bytes for 2 characters)
+ */
+#define FATFS_LONG_FILE_NAME_MAX_UTF8 (255u * 3u)
+
 /*
  * Store the information in the entry
  */
 typedef struct
 {
-    uint8_t longFileName[256]; /*Use to save long file name (the maximum size of long file name according to wiki is 255 characters) +1 '\0'*/
+    uint8_t longFileName[FATFS_LONG_FILE_NAME_MAX_UTF8 + 1u]; /*Long file name in UTF-8 (255 UTF-16 characters at most) +1 '\0'*/
     uint8_t shortFileName[9];  /*Use to save long file name (the maximum size of short file name according to wiki is 8 characters) +1 '\0'*/
+    uint8_t shortFileExtension[4]; /*Extension of the short name (3 characters) +1 '\0'*/
     uint8_t attributes;
     FATFS_Time_Struct_t creatTime;
     FATFS_Date_Struct_t creatDate;
@@ -53,6 +60,98 @@ typedef struct __FATFS_ListEntry_struct_t
     struct __FATFS_ListEntry_struct_t *next;
 } FATFS_ListEntry_struct_t;
 
+/*
+ *Attribute bit of a folder
+ */
+#define FATFS_ATTRIBUTE_DIRECTORY (0x10u)
+
+/*
+ *Size of the buffer receiving a short name "NAME.EXT" +1 '\0'
+ */
+#define FATFS_SHORT_NAME_SIZE (13u)
+
+/*
+ *Geometry of the mounted volume
+ */
+typedef struct
+{
+    uint8_t fatType;             /*12, 16 or 32*/
+    uint16_t bytePerSector;      /*Number of bytes per sector*/
+    uint8_t sectorPerCluster;    /*Number of sectors per cluster*/
+    uint8_t numberOfFat;         /*Number of FAT*/
+    uint32_t sectorPerFat;       /*Number of sectors per FAT*/
+    uint32_t locationOfFirstFat; /*Location of the first sector of fat*/
+    uint32_t locationOfRoot;     /*Location of the first sector of root directory*/
+    uint32_t locationOfData;     /*Location of the first sector of data region*/
+    uint32_t rootCluster;        /*First cluster of root directory (FAT32 only, 0 otherwise)*/
+    uint32_t totalClusters;      /*Number of clusters of the data region (clusters 2 -> totalClusters + 1)*/
+} FATFS_VolumeInfo_Struct_t;
+
+/*
+ *Value of a statistic that was not computed
+ */
+#define FATFS_STATS_UNKNOWN (0xffffffffu)
+
+/*
+ *Allocation statistics of the mounted volume (in clusters)
+ */
+typedef struct
+{
+    uint32_t totalClusters;   /*Number of clusters of the data region*/
+    uint32_t freeClusters;    /*Free clusters*/
+    uint32_t usedClusters;    /*Allocated clusters (bad clusters not included when they are known)*/
+    uint32_t badClusters;     /*Clusters marked bad (FATFS_STATS_UNKNOWN when taken from FSInfo)*/
+    uint32_t largestFreeRun;  /*Longest run of contiguous free clusters (FATFS_STATS_UNKNOWN when taken from FSInfo)*/
+    uint32_t nextFreeCluster; /*Where to look for a free cluster (FATFS_STATS_UNKNOWN if there is none or no hint)*/
+    uint32_t bytePerCluster;  /*Number of bytes per cluster*/
+    bool isFromFsInfo;        /*true if the counts come from the FSInfo sector of fat 32*/
+} FATFS_Stats_Struct_t;
+
+/*
+ *Maximum number of sub entries (LFN slots) of one long file name: 20 * 13 characters >= 255
+ */
+#define FATFS_LONG_FILE_NAME_MAX_SUB_ENTRY (20u)
+
+/*
+ *Number of UTF-16 characters stored in one sub entry
+ */
+#define FATFS_CHARACTERS_PER_SUB_ENTRY (13u)
+
+/*
+ *Directory iterator. Holds one cluster of the directory and the long file name being assembled
+ */
+typedef struct
+{
+    uint8_t *buffer;                 /*Buffer for one cluster (or one block of the root of fat 12/16)*/
+    uint32_t sizeOfBuffer;           /*Size in bytes of buffer*/
+    uint32_t sizeOfData;             /*Number of valid bytes in buffer*/
+    uint32_t index;                  /*Offset in buffer of the next entry to process*/
+    uint32_t currentCluster;         /*Cluster held in buffer (0 when reading the root of fat 12/16)*/
+    uint32_t nextSector;             /*Next sector to read when reading the root of fat 12/16*/
+    uint32_t remainSector;           /*Sectors left to read when reading the root of fat 12/16*/
+    uint32_t sumClusterRead;         /*Number of clusters read, used to stop on a looping chain*/
+    bool endOfDirectory;             /*true when the end of directory entry or the end of chain is reached*/
+    uint16_t longFileName[FATFS_LONG_FILE_NAME_MAX_SUB_ENTRY * FATFS_CHARACTERS_PER_SUB_ENTRY + 1u]; /*UTF-16 characters of the LFN being assembled +1 end of string*/
+    uint8_t longFileNameCheckSum;    /*Check sum of the short name stored in the sub entries*/
+    uint8_t nextSubEntry;            /*Sequence number expected for the next sub entry (0 : no LFN in progress)*/
+    bool longFileNameReady;          /*true when all sub entries of the LFN have been read*/
+    uint32_t sumSlotRead;            /*Number of 32 bytes slots processed*/
+    uint32_t firstSlotOfLongFileName;/*Slot of the first sub entry of the LFN being assembled*/
+    uint32_t slotOfEntry;            /*Slot of the main entry returned by FATFS_DirNext*/
+    uint32_t sumSubEntryOfEntry;     /*Number of sub entries stored before it (0 : no LFN)*/
+    FATFS_Entry_Struct_t entry;      /*Entry returned by FATFS_DirNext*/
+} FATFS_Dir_Struct_t;
+
+/*
+ *Callback receives consecutive chunks of file data. Return false to stop streaming
+ */
+typedef bool (*FATFS_DataCallback_t)(const uint8_t *const data, const uint32_t size, void *const context);
+
+/*
+ *Callback receives each entry found by FATFS_Find. Calls are never concurrent. Return false to stop the search
+ */
+typedef bool (*FATFS_FindCallback_t)(const uint8_t *const path, const FATFS_Entry_Struct_t *const entry, void *const context);
+
 /*******************************************************************************
  * Prototypes
  ******************************************************************************/
@@ -64,6 +163,22 @@ typedef struct __FATFS_ListEntry_struct_t
  */
 bool FATFS_Init(const uint8_t *const filePath);
 
+/**  FATFS_InitWritable
+ * @brief Open the file FAT for reading and writing. Changed FAT sectors and folder sectors are kept in memory
+ *        and written by FATFS_Flush (or FATFS_DeInit). Data of files is written at once
+ * @param[in] filePath   The path to the file
+ * @return if success then returns true
+ */
+bool FATFS_InitWritable(const uint8_t *const filePath);
+
+/**  FATFS_InitMemory
+ * @brief Mount an image held in memory, read only (no file I/O : used to time the decoding code)
+ * @param[in] image   Bytes of the image (kept by the caller until FATFS_DeInit)
+ * @param[in] size   Size in bytes of the image
+ * @return if success then returns true
+ */
+bool FATFS_InitMemory(const uint8_t *const image, const uint64_t size);
+
 /**  FATFS_ReadDirectory
  * @brief Read root directory or sub directory
  * @param[in] locationToRead   Location of root or first cluster of sub. If it's fat 32, it could be the first cluster location of root
@@ -71,6 +186,28 @@ bool FATFS_Init(const uint8_t *const filePath);
  */
 FATFS_ListEntry_struct_t *FATFS_ReadDirectory(const uint32_t locationToRead);
 
+/**  FATFS_DirOpen
+ * @brief Open a directory for reading entry by entry. Nothing is read until FATFS_DirNext is called
+ * @param[out] dir   Directory iterator
+ * @param[in] locationToRead   Location of root (0) or first cluster of sub
+ * @return bool Returns true if success
+ */
+bool FATFS_DirOpen(FATFS_Dir_Struct_t *const dir, const uint32_t locationToRead);
+
+/**  FATFS_DirNext
+ * @brief Read the next entry of a directory. Only one cluster is held in memory at a time
+ * @param[in,out] dir   Directory iterator
+ * @return const FATFS_Entry_Struct_t* Returns the entry (valid until the next call) or NULL at the end of the directory
+ */
+const FATFS_Entry_Struct_t *FATFS_DirNext(FATFS_Dir_Struct_t *const dir);
+
+/**  FATFS_DirClose
+ * @brief Release the iterator's buffer
+ * @param[in,out] dir   Directory iterator
+ * @return none
+ */
+void FATFS_DirClose(FATFS_Dir_Struct_t *const dir);
+
 /**  FATFS_ReadData
  * @brief Read data at specified cluster
  * @param[in] firstCluster   position of first cluster
@@ -78,8 +215,154 @@ FATFS_ListEntry_struct_t *FATFS_ReadDirectory(const uint32_t locationToRead);
  * @param[out] buffer   Receiver array
  */
 void FATFS_ReadData(uint32_t firstCluster,uint32_t const sizeDataToRead, uint8_t **buffer);
+
+/**  FATFS_StreamData
+ * @brief Read data of a file chunk by chunk. Contiguous clusters are merged into one read and the next read
+ *        is started while the callback works. Several threads may stream files at the same time
+ * @param[in] firstCluster   position of first cluster
+ * @param[in] sizeDataToRead   size data
+ * @param[in] callback   Function receives each chunk (the chunk is only valid during the call)
+ * @param[in] context   User pointer passed to callback
+ * @return bool Returns true if all data was read and delivered
+ */
+bool FATFS_StreamData(uint32_t firstCluster, const uint32_t sizeDataToRead, const FATFS_DataCallback_t callback, void *const context);
+
+/**  FATFS_GetStats
+ * @brief Get free, used and bad cluster counts. On fat 32 the FSInfo sector is used when it is valid (no scan).
+ *        Otherwise the FAT loaded by FATFS_Init is scanned, several elements per instruction
+ * @param[out] stats   Receiver of the statistics
+ * @param[in] scanFat   true to always scan the FAT (gives bad clusters and largest free run, ignores FSInfo)
+ * @return bool Returns false if no volume is mounted
+ */
+bool FATFS_GetStats(FATFS_Stats_Struct_t *const stats, const bool scanFat);
+
+/**  FATFS_GetVolumeInfo
+ * @brief Get geometry of the mounted volume
+ * @param[out] info   Receiver of the geometry
+ * @return none
+ */
+void FATFS_GetVolumeInfo(FATFS_VolumeInfo_Struct_t *const info);
+
+/**  FATFS_GetNextCluster
+ * @brief Follow the cluster chain by one step
+ * @param[in] cluster   Current cluster
+ * @param[out] nextCluster   Next cluster of the chain
+ * @return bool Returns false at the end of the chain (or if the FAT element is free, bad or out of range)
+ */
+bool FATFS_GetNextCluster(const uint32_t cluster, uint32_t *const nextCluster);
+
+/**  FATFS_GetShortName
+ * @brief Build the short name "NAME.EXT" of an entry without padding spaces
+ * @param[in] entry   Entry
+ * @param[out] name   Receiver, at least FATFS_SHORT_NAME_SIZE bytes
+ * @return none
+ */
+void FATFS_GetShortName(const FATFS_Entry_Struct_t *const entry, uint8_t *const name);
+
+/**  FATFS_DecodeLongFileName
+ * @brief Convert the UTF-16 characters of a long file name to UTF-8. Surrogate pairs give 4 bytes,
+ *        a lone surrogate gives U+FFFD
+ * @param[in] longFileName   UTF-16 characters ended by 0, read by 8 up to the 255th character
+ * @param[out] name   Receiver, FATFS_LONG_FILE_NAME_MAX_UTF8 + 1 bytes
+ * @return none
+ */
+void FATFS_DecodeLongFileName(const uint16_t *const longFileName, uint8_t *const name);
+
+/**  FATFS_DecodeEntry
+ * @brief Decode one 32 bytes main entry read anywhere (used by recovery scans). A deleted entry keeps 0xe5 as
+ *        the first byte of shortFileName, the long file name is not read (longFileName is empty)
+ * @param[in] slot   32 bytes of the entry
+ * @param[out] entry   Receiver of the entry
+ * @return bool Returns false for a sub entry (LFN) or the end of directory mark
+ */
+bool FATFS_DecodeEntry(const uint8_t *const slot, FATFS_Entry_Struct_t *const entry);
+
+/**  FATFS_Lookup
+ * @brief Find an entry from its path ("/folder/file.txt"). Long and short names are compared ignoring case
+ * @param[in] path   Path from the root directory
+ * @param[out] entry   Receiver of the entry. For the root, firstCluster is 0 and attributes is FATFS_ATTRIBUTE_DIRECTORY
+ * @return bool Returns true if the entry was found
+ */
+bool FATFS_Lookup(const uint8_t *const path, FATFS_Entry_Struct_t *const entry);
+
+/**  FATFS_Find
+ * @brief Search entries matching a pattern, reading folders on several threads.
+ *        Without '/' the pattern is matched against names at any depth ("*.txt").
+ *        With '/' it is anchored at the start folder ("docs/report_??.txt", "**" matches any number of folders)
+ *        and folders that can not lead to a match are not read.
+ *        Long and short names are tried, ignoring case
+ * @param[in] locationToRead   First cluster of the start folder (0 : root)
+ * @param[in] pattern   Pattern ('*', '?', "[a-z]", "**")
+ * @param[in] sumThread   Number of threads (0 : one per CPU)
+ * @param[in] callback   Function receives every match as soon as it is found
+ * @param[in] context   User pointer passed to callback
+ * @return bool Returns false if the pattern is invalid or a thread could not be started
+ */
+bool FATFS_Find(const uint32_t locationToRead, const uint8_t *const pattern, const uint32_t sumThread, const FATFS_FindCallback_t callback, void *const context);
+
+/**  FATFS_CreateFile
+ * @brief Create an empty file. A long file name and a unique short name ("NAME~1.EXT") are made when needed
+ * @param[in] path   Path of the new file, its folder must exist
+ * @return bool Returns false if the volume is not writable, the name is invalid or already used, or the folder is full
+ */
+bool FATFS_CreateFile(const uint8_t *const path);
+
+/**  FATFS_CreateDirectory
+ * @brief Create an empty folder (with its "." and ".." entries)
+ * @param[in] path   Path of the new folder, its parent must exist
+ * @return bool Returns true if success
+ */
+bool FATFS_CreateDirectory(const uint8_t *const path);
+
+/**  FATFS_AppendFile
+ * @brief Add data at the end of a file. Preallocated clusters are used first, the other ones are allocated at once
+ * @param[in] path   Path of the file
+ * @param[in] data   Data to add
+ * @param[in] size   Size of data
+ * @return bool Returns false if the file does not exist or the volume is full
+ */
+bool FATFS_AppendFile(const uint8_t *const path, const uint8_t *const data, const uint32_t size);
+
+/**  FATFS_PreallocateFile
+ * @brief Allocate the clusters of a file before its data is written, as one run when the volume has one.
+ *        The size of the file does not change, clusters still unused are freed by FATFS_DeInit
+ * @param[in] path   Path of the file
+ * @param[in] size   Expected size of the file
+ * @return bool Returns false if the file does not exist or the volume is full
+ */
+bool FATFS_PreallocateFile(const uint8_t *const path, const uint32_t size);
+
+/**  FATFS_TruncateFile
+ * @brief Change the size of a file. Clusters after the new end are freed, a larger size is filled with zeros
+ * @param[in] path   Path of the file
+ * @param[in] size   New size
+ * @return bool Returns true if success
+ */
+bool FATFS_TruncateFile(const uint8_t *const path, const uint32_t size);
+
+/**  FATFS_DeleteFile
+ * @brief Delete a file and free its clusters
+ * @param[in] path   Path of the file
+ * @return bool Returns false if the entry does not exist or is a folder
+ */
+bool FATFS_DeleteFile(const uint8_t *const path);
+
+/**  FATFS_RemoveDirectory
+ * @brief Delete an empty folder
+ * @param[in] path   Path of the folder
+ * @return bool Returns false if the folder does not exist or is not empty
+ */
+bool FATFS_RemoveDirectory(const uint8_t *const path);
+
+/**  FATFS_Flush
+ * @brief Write the changed FAT sectors to every FAT, then the changed folder sectors, sorted and merged into
+ *        large writes, then the free count of FSInfo
+ * @return bool Returns false if the volume is not writable or a write failed
+ */
+bool FATFS_Flush(void);
+
 /**  FATFS_DeInit
- * @brief Close the file FAT
+ * @brief Close the file FAT (changes of a writable volume are flushed first)
  * @return none
  */
 void FATFS_DeInit(void);
@@ -0,0 +1,288 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "fatfs.h"
+#include "index.h"
+#include "table.h"
+#include "stats.h"
+#include "frag.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Maximum number of threads of FRAG_Analyze
+ */
+#define FRAG_MAX_THREAD (64u)
+
+/*
+ *Rows given to a thread of FRAG_Analyze
+ */
+typedef struct
+{
+    const TABLE_Table_Struct_t *table;
+    FRAG_File_Struct_t *files;
+    uint32_t firstRow;                        /*First row of the slice*/
+    uint32_t endRow;                          /*Row after the slice*/
+    uint32_t bytePerCluster;                  /*A file needs ceil(size / bytePerCluster) clusters*/
+    uint32_t sumEntry;                        /*Counters of the slice*/
+    uint32_t sumFragmented;
+    uint32_t sumLooping;
+    uint32_t sumTooLong;
+    uint64_t sumExtent;
+    uint64_t sumCluster;
+    uint32_t histogram[FRAG_HISTOGRAM_SIZE];
+} FRAG_Slice_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  FRAG_Worker
+ * @brief Thread of FRAG_Analyze : count the extents of the rows of a slice
+ * @param[in] argument slice (FRAG_Slice_Struct_t)
+ * @return void* NULL
+ */
+static void *FRAG_Worker(void *argument);
+
+/**  FRAG_CompareExtent
+ * @brief Order entries by number of extents, most first (used by qsort)
+ * @param[in] first entry
+ * @param[in] second entry
+ * @return int Returns the order
+ */
+static int FRAG_CompareExtent(const void *first, const void *second);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool FRAG_Analyze(const TABLE_Table_Struct_t *const table, const uint32_t sumThread, FRAG_Report_Struct_t *const report)
+{
+    bool status = true; /*return value */
+    FATFS_VolumeInfo_Struct_t info;
+    FRAG_Slice_Struct_t slice[FRAG_MAX_THREAD];
+    pthread_t thread[FRAG_MAX_THREAD];
+    bool isStarted[FRAG_MAX_THREAD];
+    uint32_t sumSlice = sumThread;
+    uint32_t sizeOfSlice = 0;
+    uint32_t i = 0; /*Index value*/
+    uint32_t j = 0; /*Index value*/
+
+    memset(report, 0, sizeof(FRAG_Report_Struct_t));
+    report->files = (FRAG_File_Struct_t *)STATS_Malloc(((size_t)table->sumRow + 1u) * sizeof(FRAG_File_Struct_t));
+    if (NULL == report->files)
+    {
+        status = false;
+    }
+
+    if (true == status)
+    {
+        report->sumFile = table->sumRow;
+        FATFS_GetVolumeInfo(&info);
+        if (0 == sumSlice)
+        {
+            sumSlice = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        if (FRAG_MAX_THREAD < sumSlice)
+        {
+            sumSlice = FRAG_MAX_THREAD;
+        }
+        sizeOfSlice = table->sumRow / sumSlice + 1u;
+
+        /*One slice of rows per thread, the first slice is done by this thread*/
+        for (i = 0; i < sumSlice; i++)
+        {
+            memset(&slice[i], 0, sizeof(FRAG_Slice_Struct_t));
+            slice[i].table = table;
+            slice[i].files = report->files;
+            slice[i].firstRow = (i * sizeOfSlice < table->sumRow) ? (i * sizeOfSlice) : table->sumRow;
+            slice[i].endRow = (slice[i].firstRow + sizeOfSlice < table->sumRow) ? (slice[i].firstRow + sizeOfSlice) : table->sumRow;
+            slice[i].bytePerCluster = (uint32_t)info.bytePerSector * info.sectorPerCluster;
+            isStarted[i] = (0 != i) && (0 == pthread_create(&thread[i], NULL, FRAG_Worker, &slice[i]));
+        }
+        for (i = 0; i < sumSlice; i++)
+        {
+            if (true == isStarted[i])
+            {
+                pthread_join(thread[i], NULL);
+            }
+            else
+            {
+                FRAG_Worker(&slice[i]);
+            }
+
+            report->sumEntry += slice[i].sumEntry;
+            report->sumFragmented += slice[i].sumFragmented;
+            report->sumLooping += slice[i].sumLooping;
+            report->sumTooLong += slice[i].sumTooLong;
+            report->sumExtent += slice[i].sumExtent;
+            report->sumCluster += slice[i].sumCluster;
+            for (j = 0; j < FRAG_HISTOGRAM_SIZE; j++)
+            {
+                report->histogram[j] += slice[i].histogram[j];
+            }
+        }
+    }
+
+    return status;
+}
+
+uint32_t FRAG_GetWorst(const FRAG_Report_Struct_t *const report, FRAG_File_Struct_t *const worst, const uint32_t maxWorst)
+{
+    uint32_t sumWorst = 0;          /*return value */
+    FRAG_File_Struct_t *fragmented = NULL;
+    uint32_t sumFragmented = 0;
+    uint32_t i = 0; /*Index value*/
+
+    fragmented = (FRAG_File_Struct_t *)STATS_Malloc(((size_t)report->sumFragmented + 1u) * sizeof(FRAG_File_Struct_t));
+    if (NULL != fragmented)
+    {
+        for (i = 0; (i < report->sumFile) && (sumFragmented < report->sumFragmented); i++)
+        {
+            if ((1u < report->files[i].sumExtent) && (false == report->files[i].isLooping))
+            {
+                fragmented[sumFragmented] = report->files[i];
+                sumFragmented++;
+            }
+        }
+        qsort(fragmented, sumFragmented, sizeof(FRAG_File_Struct_t), FRAG_CompareExtent);
+        sumWorst = (sumFragmented < maxWorst) ? sumFragmented : maxWorst;
+        memcpy(worst, fragmented, (size_t)sumWorst * sizeof(FRAG_File_Struct_t));
+        free(fragmented);
+    }
+
+    return sumWorst;
+}
+
+void FRAG_Free(FRAG_Report_Struct_t *const report)
+{
+    free(report->files);
+    memset(report, 0, sizeof(FRAG_Report_Struct_t));
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void *FRAG_Worker(void *argument)
+{
+    FRAG_Slice_Struct_t *const slice = (FRAG_Slice_Struct_t *)argument;
+    FRAG_File_Struct_t *file = NULL;
+    uint32_t row = 0;
+    uint32_t cluster = 0;
+    uint32_t nextCluster = 0;
+    uint32_t maxCluster = 0;
+    uint32_t tortoise = 0; /*Cluster saved by the loop detection*/
+    uint32_t power = 0;
+    uint32_t step = 0;
+    uint32_t bucket = 0;
+
+    for (row = slice->firstRow; row < slice->endRow; row++)
+    {
+        file = &slice->files[row];
+        file->row = row;
+        file->sumExtent = 0;
+        file->sumCluster = 0;
+        file->isLooping = false;
+        file->isTooLong = false;
+        cluster = slice->table->firstCluster[row];
+        if (0 == cluster)
+        {
+            continue;
+        }
+
+        /*The size of a file bounds the clusters counted, a folder has no size*/
+        if (0 != (slice->table->attributes[row] & FATFS_ATTRIBUTE_DIRECTORY))
+        {
+            maxCluster = 0xffffffffu;
+        }
+        else
+        {
+            maxCluster = (uint32_t)(((uint64_t)slice->table->size[row] + slice->bytePerCluster - 1u) / slice->bytePerCluster);
+            maxCluster = (0 != maxCluster) ? maxCluster : 1u;
+        }
+
+        /*A new extent starts each time the next cluster is not the following one*/
+        file->sumExtent = 1;
+        file->sumCluster = 1;
+        tortoise = cluster;
+        power = 1;
+        step = 0;
+        while ((false == file->isLooping) && (true == FATFS_GetNextCluster(cluster, &nextCluster)))
+        {
+            if (tortoise == nextCluster)
+            {
+                file->isLooping = true;
+            }
+            else if (maxCluster <= file->sumCluster)
+            {
+                file->isTooLong = true;
+            }
+            else
+            {
+                if ((cluster + 1u) != nextCluster)
+                {
+                    file->sumExtent++;
+                }
+                file->sumCluster++;
+            }
+            /*Brent's loop detection : the chain loops if it comes back to the cluster saved after the last power of 2 steps*/
+            step++;
+            if (power == step)
+            {
+                tortoise = nextCluster;
+                power <<= 1u;
+                step = 0;
+            }
+            cluster = nextCluster;
+        }
+        if (true == file->isLooping)
+        {
+            slice->sumLooping++;
+            continue;
+        }
+        slice->sumTooLong += (true == file->isTooLong) ? 1u : 0u;
+
+        bucket = (1u == file->sumExtent) ? 0u : (32u - (uint32_t)__builtin_clz(file->sumExtent - 1u));
+        if (FRAG_HISTOGRAM_SIZE <= bucket)
+        {
+            bucket = FRAG_HISTOGRAM_SIZE - 1u;
+        }
+        slice->histogram[bucket]++;
+        slice->sumEntry++;
+        slice->sumExtent += file->sumExtent;
+        slice->sumCluster += file->sumCluster;
+        if (1u < file->sumExtent)
+        {
+            slice->sumFragmented++;
+        }
+    }
+
+    return NULL;
+}
+
+static int FRAG_CompareExtent(const void *first, const void *second)
+{
+    const FRAG_File_Struct_t *const firstFile = (const FRAG_File_Struct_t *)first;
+    const FRAG_File_Struct_t *const secondFile = (const FRAG_File_Struct_t *)second;
+    int order = 0; /*return value */
+
+    if (firstFile->sumExtent != secondFile->sumExtent)
+    {
+        order = (firstFile->sumExtent > secondFile->sumExtent) ? -1 : 1;
+    }
+    else
+    {
+        order = (firstFile->row < secondFile->row) ? -1 : ((firstFile->row > secondFile->row) ? 1 : 0);
+    }
+
+    return order;
+}
@@ -0,0 +1,71 @@
+#ifndef __FRAG_H__
+#define __FRAG_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Buckets of the histogram of extents : 1, 2, 3-4, 5-8, 9-16, 17-32, 33-64, more than 64
+ */
+#define FRAG_HISTOGRAM_SIZE (8u)
+
+/*
+ *Fragmentation of one entry
+ */
+typedef struct
+{
+    uint32_t row;        /*Row of the entry in the table*/
+    uint32_t sumExtent;  /*Number of runs of contiguous clusters*/
+    uint32_t sumCluster; /*Number of clusters of the chain*/
+    bool isLooping;      /*The chain comes back to one of its clusters : not counted in the report*/
+    bool isTooLong;      /*The chain has more clusters than the size of the file needs : only those are counted*/
+} FRAG_File_Struct_t;
+
+/*
+ *Fragmentation of the volume
+ */
+typedef struct
+{
+    uint32_t sumEntry;                        /*Entries having at least one cluster*/
+    uint32_t sumFragmented;                   /*Entries having more than one extent*/
+    uint32_t sumLooping;                      /*Entries whose chain loops (not counted in the other fields)*/
+    uint32_t sumTooLong;                      /*Files whose chain is longer than their size needs (counted up to their size)*/
+    uint64_t sumExtent;                       /*Extents of all entries*/
+    uint64_t sumCluster;                      /*Clusters of all entries*/
+    uint32_t histogram[FRAG_HISTOGRAM_SIZE];  /*Number of entries per number of extents*/
+    FRAG_File_Struct_t *files;                /*One element per row of the table*/
+    uint32_t sumFile;                         /*Number of elements of files*/
+} FRAG_Report_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  FRAG_Analyze
+ * @brief Count the extents of every file and folder of the mounted volume. The chains are followed in the FAT
+ *        loaded in memory, the rows being shared by several threads
+ * @param[in] table   Table of the volume (TABLE_Build)
+ * @param[in] sumThread   Number of threads (0 : one per CPU)
+ * @param[out] report   Fragmentation (release with FRAG_Free)
+ * @return bool Returns true if success
+ */
+bool FRAG_Analyze(const TABLE_Table_Struct_t *const table, const uint32_t sumThread, FRAG_Report_Struct_t *const report);
+
+/**  FRAG_GetWorst
+ * @brief Get the most fragmented entries, most extents first (looping chains are left out)
+ * @param[in] report   Fragmentation
+ * @param[out] worst   Receiver
+ * @param[in] maxWorst   Size of receiver
+ * @return uint32_t Returns the number of entries written (only fragmented entries are listed)
+ */
+uint32_t FRAG_GetWorst(const FRAG_Report_Struct_t *const report, FRAG_File_Struct_t *const worst, const uint32_t maxWorst);
+
+/**  FRAG_Free
+ * @brief Release a report
+ * @param[in,out] report   Fragmentation
+ * @return none
+ */
+void FRAG_Free(FRAG_Report_Struct_t *const report);
+
+#endif /*__FRAG_H__*/
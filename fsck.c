@@ -0,0 +1,498 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "hal.h"
+#include "fatfs.h"
+#include "stats.h"
+#include "fsck.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Limits of the folder walk
+ */
+#define FSCK_MAX_THREAD (64u)
+#define FSCK_MAX_PATH (4096u)
+
+/*
+ *Number of sectors of each FAT compared per read
+ */
+#define FSCK_FAT_CHUNK_SECTOR (2048u)
+
+/*
+ *Volume label attribute
+ */
+#define FSCK_ATTRIBUTE_VOLUME_LABEL (0x08u)
+
+/*
+ *Folder waiting to be read
+ */
+typedef struct __FSCK_Folder_struct_t
+{
+    uint32_t cluster;                      /*First cluster of folder (0 : root)*/
+    struct __FSCK_Folder_struct_t *next;   /*Next folder waiting*/
+    uint8_t path[];                        /*Path of folder*/
+} FSCK_Folder_struct_t;
+
+/*
+ *State shared by the threads of FSCK_Check
+ */
+typedef struct
+{
+    pthread_mutex_t lock;         /*Protects the folders waiting and the callback*/
+    pthread_cond_t wake;          /*Signaled when a folder is added or the walk ends*/
+    FSCK_Folder_struct_t *head;   /*Folders waiting to be read*/
+    uint32_t sumPending;          /*Folders waiting or being read*/
+    uint32_t *owner;              /*Chain owning each cluster (0 : none), set with compare and swap*/
+    uint32_t nextOwner;           /*Last chain number given (atomic)*/
+    uint32_t sumCluster;          /*Number of clusters + 2*/
+    uint32_t endOfChain;          /*Smallest value marking the end of a chain*/
+    uint32_t badCluster;          /*Value marking a bad cluster*/
+    uint32_t sizeOfCluster;       /*Size in bytes of a cluster*/
+    FSCK_Report_Struct_t *report;
+    FSCK_Callback_t callback;
+    void *context;
+} FSCK_Check_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  FSCK_Report
+ * @brief Give a problem to the callback
+ * @param[in] check state of the check
+ * @param[in] problem problem
+ * @param[in] path entry concerned
+ * @param[in] cluster cluster concerned
+ * @param[in] value value read in the FAT
+ * @return none
+ */
+static void FSCK_Report(FSCK_Check_Struct_t *const check, const FSCK_Problem_t problem, const uint8_t *const path, const uint32_t cluster, const uint32_t value);
+
+/**  FSCK_WalkChain
+ * @brief Take the clusters of a chain for a new owner, reporting loops, cross links and broken chains
+ * @param[in] check state of the check
+ * @param[in] path entry owning the chain
+ * @param[in] firstCluster first cluster of the chain
+ * @param[out] sumClusterOfChain number of clusters taken
+ * @return bool Returns true if the whole chain was taken up to its end of chain mark
+ */
+static bool FSCK_WalkChain(FSCK_Check_Struct_t *const check, const uint8_t *const path, const uint32_t firstCluster, uint32_t *const sumClusterOfChain);
+
+/**  FSCK_PushFolder
+ * @brief Add a folder to the folders waiting to be read
+ * @param[in] check state of the check
+ * @param[in] cluster first cluster of folder
+ * @param[in] path path of folder
+ * @return none
+ */
+static void FSCK_PushFolder(FSCK_Check_Struct_t *const check, const uint32_t cluster, const uint8_t *const path);
+
+/**  FSCK_Worker
+ * @brief Thread of FSCK_Check : read waiting folders and walk the chain of every entry
+ * @param[in] argument state of the check (FSCK_Check_Struct_t)
+ * @return void* NULL
+ */
+static void *FSCK_Worker(void *argument);
+
+/**  FSCK_CompareFat
+ * @brief Compare every copy of the FAT with the first one, a large block at a time
+ * @param[in] check state of the check
+ * @param[in] info volume
+ * @return bool Returns false if the FAT could not be read
+ */
+static bool FSCK_CompareFat(FSCK_Check_Struct_t *const check, const FATFS_VolumeInfo_Struct_t *const info);
+
+/**  FSCK_FindLost
+ * @brief Count allocated clusters that no chain owns and report the start of each lost chain
+ * @param[in] check state of the check
+ * @return bool Returns false if there is not enough memory
+ */
+static bool FSCK_FindLost(FSCK_Check_Struct_t *const check);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool FSCK_Check(const uint32_t sumThread, FSCK_Report_Struct_t *const report, const FSCK_Callback_t callback, void *const context)
+{
+    bool status = true; /*return value */
+    FSCK_Check_Struct_t check;
+    FATFS_VolumeInfo_Struct_t info;
+    pthread_t thread[FSCK_MAX_THREAD];
+    uint32_t sumThreadToStart = sumThread;
+    uint32_t sumThreadStarted = 0;
+    uint32_t sumClusterOfChain = 0;
+    uint32_t i = 0; /*Index value*/
+
+    memset(report, 0, sizeof(FSCK_Report_Struct_t));
+    memset(&check, 0, sizeof(check));
+    FATFS_GetVolumeInfo(&info);
+    check.report = report;
+    check.callback = callback;
+    check.context = context;
+    check.sumCluster = info.totalClusters + 2u;
+    check.endOfChain = (32u == info.fatType) ? 0x0ffffff8u : ((16u == info.fatType) ? 0xfff8u : 0xff8u);
+    check.badCluster = check.endOfChain - 1u;
+    check.sizeOfCluster = (uint32_t)info.bytePerSector * info.sectorPerCluster;
+    check.owner = (uint32_t *)STATS_Calloc(check.sumCluster, sizeof(uint32_t));
+    if (NULL == check.owner)
+    {
+        status = false;
+    }
+
+    if (true == status)
+    {
+        pthread_mutex_init(&check.lock, NULL);
+        pthread_cond_init(&check.wake, NULL);
+
+        /*The root of fat 32 has a chain too*/
+        if (32u == info.fatType)
+        {
+            __atomic_fetch_add(&report->sumFolder, 1u, __ATOMIC_RELAXED);
+            (void)FSCK_WalkChain(&check, (const uint8_t *)"/", info.rootCluster, &sumClusterOfChain);
+        }
+        FSCK_PushFolder(&check, 0, (const uint8_t *)"");
+
+        /*Folders are walked by the threads while this thread compares the FAT copies*/
+        if (0 == sumThreadToStart)
+        {
+            sumThreadToStart = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        if (FSCK_MAX_THREAD < sumThreadToStart)
+        {
+            sumThreadToStart = FSCK_MAX_THREAD;
+        }
+        for (i = 0; i < sumThreadToStart; i++)
+        {
+            if (0 == pthread_create(&thread[sumThreadStarted], NULL, FSCK_Worker, &check))
+            {
+                sumThreadStarted++;
+            }
+        }
+        status = FSCK_CompareFat(&check, &info);
+        if (0 == sumThreadStarted)
+        {
+            FSCK_Worker(&check);
+        }
+        for (i = 0; i < sumThreadStarted; i++)
+        {
+            pthread_join(thread[i], NULL);
+        }
+
+        /*Every chain is owned now*/
+        if (true == status)
+        {
+            status = FSCK_FindLost(&check);
+        }
+
+        pthread_cond_destroy(&check.wake);
+        pthread_mutex_destroy(&check.lock);
+    }
+    free(check.owner);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void FSCK_Report(FSCK_Check_Struct_t *const check, const FSCK_Problem_t problem, const uint8_t *const path, const uint32_t cluster, const uint32_t value)
+{
+    if (NULL != check->callback)
+    {
+        pthread_mutex_lock(&check->lock);
+        check->callback(problem, path, cluster, value, check->context);
+        pthread_mutex_unlock(&check->lock);
+    }
+}
+
+static bool FSCK_WalkChain(FSCK_Check_Struct_t *const check, const uint8_t *const path, const uint32_t firstCluster, uint32_t *const sumClusterOfChain)
+{
+    bool status = true; /*return value */
+    uint32_t id = __atomic_add_fetch(&check->nextOwner, 1u, __ATOMIC_RELAXED);
+    uint32_t cluster = firstCluster;
+    uint32_t nextCluster = 0;
+    uint32_t previousOwner = 0;
+
+    *sumClusterOfChain = 0;
+    if ((2u > firstCluster) || (check->sumCluster <= firstCluster))
+    {
+        __atomic_fetch_add(&check->report->sumBadChain, 1u, __ATOMIC_RELAXED);
+        FSCK_Report(check, FSCK_PROBLEM_BAD_CHAIN, path, firstCluster, firstCluster);
+        status = false;
+    }
+
+    while (true == status)
+    {
+        /*Take the cluster. It is already owned by this chain (loop) or by another one (cross link)*/
+        previousOwner = 0;
+        if (false == __atomic_compare_exchange_n(&check->owner[cluster], &previousOwner, id, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            if (id == previousOwner)
+            {
+                __atomic_fetch_add(&check->report->sumLoop, 1u, __ATOMIC_RELAXED);
+                FSCK_Report(check, FSCK_PROBLEM_LOOP, path, cluster, 0);
+            }
+            else
+            {
+                __atomic_fetch_add(&check->report->sumCrossLink, 1u, __ATOMIC_RELAXED);
+                FSCK_Report(check, FSCK_PROBLEM_CROSS_LINK, path, cluster, 0);
+            }
+            status = false;
+            break;
+        }
+        (*sumClusterOfChain)++;
+
+        if (false == FATFS_GetNextCluster(cluster, &nextCluster))
+        {
+            if (check->endOfChain > nextCluster)
+            {
+                /*Free, bad or reserved value before the end of chain mark*/
+                __atomic_fetch_add(&check->report->sumBadChain, 1u, __ATOMIC_RELAXED);
+                FSCK_Report(check, FSCK_PROBLEM_BAD_CHAIN, path, cluster, nextCluster);
+                status = false;
+            }
+            break;
+        }
+        if (check->sumCluster <= nextCluster)
+        {
+            __atomic_fetch_add(&check->report->sumBadChain, 1u, __ATOMIC_RELAXED);
+            FSCK_Report(check, FSCK_PROBLEM_BAD_CHAIN, path, cluster, nextCluster);
+            status = false;
+            break;
+        }
+        cluster = nextCluster;
+    }
+    __atomic_fetch_add(&check->report->sumClusterUsed, *sumClusterOfChain, __ATOMIC_RELAXED);
+
+    return status;
+}
+
+static void FSCK_PushFolder(FSCK_Check_Struct_t *const check, const uint32_t cluster, const uint8_t *const path)
+{
+    FSCK_Folder_struct_t *folder = NULL;
+    size_t sizeOfPath = strlen((const char *)path);
+
+    folder = (FSCK_Folder_struct_t *)STATS_Malloc(sizeof(FSCK_Folder_struct_t) + sizeOfPath + 1u);
+    if (NULL != folder)
+    {
+        folder->cluster = cluster;
+        memcpy(folder->path, path, sizeOfPath + 1u);
+
+        pthread_mutex_lock(&check->lock);
+        folder->next = check->head;
+        check->head = folder;
+        check->sumPending++;
+        pthread_cond_signal(&check->wake);
+        pthread_mutex_unlock(&check->lock);
+    }
+}
+
+static void *FSCK_Worker(void *argument)
+{
+    FSCK_Check_Struct_t *const check = (FSCK_Check_Struct_t *)argument;
+    FSCK_Folder_struct_t *folder = NULL;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *entry = NULL;
+    uint8_t shortName[FATFS_SHORT_NAME_SIZE];
+    uint8_t path[FSCK_MAX_PATH];
+    uint32_t sumClusterOfChain = 0;
+    uint32_t sumClusterExpected = 0;
+    bool isComplete = false;
+
+    pthread_mutex_lock(&check->lock);
+    while (true)
+    {
+        /*Wait for a folder, leave when nothing is waiting nor being read*/
+        while ((NULL == check->head) && (0 != check->sumPending))
+        {
+            pthread_cond_wait(&check->wake, &check->lock);
+        }
+        if (NULL == check->head)
+        {
+            break;
+        }
+        folder = check->head;
+        check->head = folder->next;
+        pthread_mutex_unlock(&check->lock);
+
+        if (true == FATFS_DirOpen(&dir, folder->cluster))
+        {
+            entry = FATFS_DirNext(&dir);
+            while (NULL != entry)
+            {
+                /*Skip ".", "..", deleted entries and the volume label*/
+                if (('.' != entry->shortFileName[0]) && (0xe5u != entry->shortFileName[0]) && (0 == (entry->attributes & FSCK_ATTRIBUTE_VOLUME_LABEL)))
+                {
+                    FATFS_GetShortName(entry, shortName);
+                    snprintf((char *)path, sizeof(path), "%s/%s", folder->path, (0 != entry->longFileName[0]) ? entry->longFileName : shortName);
+
+                    if (0 != (entry->attributes & FATFS_ATTRIBUTE_DIRECTORY))
+                    {
+                        __atomic_fetch_add(&check->report->sumFolder, 1u, __ATOMIC_RELAXED);
+                        /*Read the folder only if this entry took its first cluster, so a looping tree is read once*/
+                        (void)FSCK_WalkChain(check, path, entry->firstCluster, &sumClusterOfChain);
+                        if (0 != sumClusterOfChain)
+                        {
+                            FSCK_PushFolder(check, entry->firstCluster, path);
+                        }
+                    }
+                    else
+                    {
+                        __atomic_fetch_add(&check->report->sumFile, 1u, __ATOMIC_RELAXED);
+                        sumClusterExpected = (entry->fileSize / check->sizeOfCluster) + ((0 != (entry->fileSize % check->sizeOfCluster)) ? 1u : 0u);
+                        if (0 == entry->firstCluster)
+                        {
+                            isComplete = true;
+                            sumClusterOfChain = 0;
+                        }
+                        else
+                        {
+                            isComplete = FSCK_WalkChain(check, path, entry->firstCluster, &sumClusterOfChain);
+                        }
+                        if ((true == isComplete) && (sumClusterExpected != sumClusterOfChain))
+                        {
+                            __atomic_fetch_add(&check->report->sumSizeMismatch, 1u, __ATOMIC_RELAXED);
+                            FSCK_Report(check, FSCK_PROBLEM_SIZE, path, entry->firstCluster, sumClusterOfChain);
+                        }
+                    }
+                }
+                entry = FATFS_DirNext(&dir);
+            }
+            FATFS_DirClose(&dir);
+        }
+        free(folder);
+
+        pthread_mutex_lock(&check->lock);
+        check->sumPending--;
+        if (0 == check->sumPending)
+        {
+            pthread_cond_broadcast(&check->wake);
+        }
+    }
+    pthread_mutex_unlock(&check->lock);
+
+    return NULL;
+}
+
+static bool FSCK_CompareFat(FSCK_Check_Struct_t *const check, const FATFS_VolumeInfo_Struct_t *const info)
+{
+    bool status = true; /*return value */
+    uint8_t *first = NULL;
+    uint8_t *copy = NULL;
+    uint32_t sector = 0;   /*First sector of the chunk, from the start of a FAT*/
+    uint32_t sumSector = 0;
+    uint32_t i = 0;        /*Sector of the chunk*/
+    uint32_t k = 0;        /*Copy of the FAT*/
+    bool isDifferent = false;
+    bool wasDifferent = false;
+
+    if (1u < info->numberOfFat)
+    {
+        first = (uint8_t *)STATS_Malloc((size_t)FSCK_FAT_CHUNK_SECTOR * info->bytePerSector);
+        copy = (uint8_t *)STATS_Malloc((size_t)FSCK_FAT_CHUNK_SECTOR * info->bytePerSector);
+        status = (NULL != first) && (NULL != copy);
+    }
+
+    for (k = 1; (true == status) && (k < info->numberOfFat); k++)
+    {
+        wasDifferent = false;
+        for (sector = 0; (true == status) && (sector < info->sectorPerFat); sector += sumSector)
+        {
+            sumSector = info->sectorPerFat - sector;
+            if (FSCK_FAT_CHUNK_SECTOR < sumSector)
+            {
+                sumSector = FSCK_FAT_CHUNK_SECTOR;
+            }
+            if (((int32_t)(sumSector * info->bytePerSector) != HAL_ReadMultiSector(info->locationOfFirstFat + sector, sumSector, first)) ||
+                ((int32_t)(sumSector * info->bytePerSector) != HAL_ReadMultiSector(info->locationOfFirstFat + k * info->sectorPerFat + sector, sumSector, copy)))
+            {
+                status = false;
+                break;
+            }
+
+            /*Whole chunk first, sector by sector only when it differs*/
+            if (0 == memcmp(first, copy, (size_t)sumSector * info->bytePerSector))
+            {
+                wasDifferent = false;
+                continue;
+            }
+            for (i = 0; i < sumSector; i++)
+            {
+                isDifferent = (0 != memcmp(&first[i * info->bytePerSector], &copy[i * info->bytePerSector], info->bytePerSector));
+                if (true == isDifferent)
+                {
+                    check->report->sumFatMismatchSector++;
+                    if (false == wasDifferent)
+                    {
+                        /*Report the first sector of each run of different sectors*/
+                        FSCK_Report(check, FSCK_PROBLEM_FAT_MISMATCH, (const uint8_t *)"", sector + i, k);
+                    }
+                }
+                wasDifferent = isDifferent;
+            }
+        }
+    }
+
+    free(first);
+    free(copy);
+
+    return status;
+}
+
+static bool FSCK_FindLost(FSCK_Check_Struct_t *const check)
+{
+    bool status = true; /*return value */
+    uint8_t *isPointed = NULL; /*Bitmap of lost clusters that another lost cluster points to*/
+    uint32_t cluster = 0;
+    uint32_t nextCluster = 0;
+    bool isValid = false;
+
+    isPointed = (uint8_t *)STATS_Calloc(check->sumCluster / 8u + 1u, sizeof(uint8_t));
+    if (NULL == isPointed)
+    {
+        status = false;
+    }
+
+    if (true == status)
+    {
+        /*Allocated and not owned*/
+        for (cluster = 2; cluster < check->sumCluster; cluster++)
+        {
+            isValid = FATFS_GetNextCluster(cluster, &nextCluster);
+            if ((0 == check->owner[cluster]) && (0 != nextCluster) && (check->badCluster != nextCluster))
+            {
+                check->report->sumLostCluster++;
+                if ((true == isValid) && (nextCluster < check->sumCluster))
+                {
+                    isPointed[nextCluster / 8u] |= (uint8_t)(1u << (nextCluster % 8u));
+                }
+            }
+        }
+
+        /*A lost chain starts at a lost cluster no other lost cluster points to*/
+        for (cluster = 2; (0 != check->report->sumLostCluster) && (cluster < check->sumCluster); cluster++)
+        {
+            (void)FATFS_GetNextCluster(cluster, &nextCluster);
+            if ((0 == check->owner[cluster]) && (0 != nextCluster) && (check->badCluster != nextCluster) && (0 == (isPointed[cluster / 8u] & (1u << (cluster % 8u)))))
+            {
+                check->report->sumLostChain++;
+                FSCK_Report(check, FSCK_PROBLEM_LOST, (const uint8_t *)"", cluster, nextCluster);
+            }
+        }
+    }
+    free(isPointed);
+
+    return status;
+}
@@ -0,0 +1,62 @@
+#ifndef __FSCK_H__
+#define __FSCK_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Problems reported by FSCK_Check
+ */
+typedef enum
+{
+    FSCK_PROBLEM_CROSS_LINK = 0,   /*A cluster of the chain already belongs to another entry*/
+    FSCK_PROBLEM_LOOP = 1,         /*The chain comes back to one of its own clusters*/
+    FSCK_PROBLEM_BAD_CHAIN = 2,    /*The chain points to a free, bad or out of range cluster*/
+    FSCK_PROBLEM_SIZE = 3,         /*The length of the chain does not match the size of file*/
+    FSCK_PROBLEM_LOST = 4,         /*Allocated clusters not used by any entry (first cluster of a lost chain)*/
+    FSCK_PROBLEM_FAT_MISMATCH = 5  /*A copy of the FAT differs from the first one*/
+} FSCK_Problem_t;
+
+/*
+ *Counters of FSCK_Check
+ */
+typedef struct
+{
+    uint32_t sumFile;              /*Number of files checked*/
+    uint32_t sumFolder;            /*Number of folders checked*/
+    uint32_t sumClusterUsed;       /*Number of clusters owned by an entry*/
+    uint32_t sumCrossLink;         /*Number of cross-linked chains*/
+    uint32_t sumLoop;              /*Number of looping chains*/
+    uint32_t sumBadChain;          /*Number of broken chains*/
+    uint32_t sumSizeMismatch;      /*Number of files whose size does not match the chain*/
+    uint32_t sumLostCluster;       /*Number of allocated clusters not owned by any entry*/
+    uint32_t sumLostChain;         /*Number of lost chains*/
+    uint32_t sumFatMismatchSector; /*Number of sectors of the FAT copies that differ from the first FAT*/
+} FSCK_Report_Struct_t;
+
+/*
+ *Callback receives each problem. Calls are never concurrent.
+ *path : entry concerned (empty for lost clusters and FAT copies)
+ *cluster : cluster concerned (sector of the FAT for FSCK_PROBLEM_FAT_MISMATCH)
+ *value : next cluster read in the FAT, or the copy of the FAT for FSCK_PROBLEM_FAT_MISMATCH
+ */
+typedef void (*FSCK_Callback_t)(const FSCK_Problem_t problem, const uint8_t *const path, const uint32_t cluster, const uint32_t value, void *const context);
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  FSCK_Check
+ * @brief Check the mounted volume in one pass : every chain is walked once and marked in a table of cluster owners
+ *        (folders are read on several threads), then allocated clusters without owner are reported as lost.
+ *        The FAT copies are compared with the first FAT while the folders are walked
+ * @param[in] sumThread   Number of threads walking folders (0 : one per CPU)
+ * @param[out] report   Counters
+ * @param[in] callback   Function receives every problem (may be NULL)
+ * @param[in] context   User pointer passed to callback
+ * @return bool Returns false if the check could not run (memory, read error)
+ */
+bool FSCK_Check(const uint32_t sumThread, FSCK_Report_Struct_t *const report, const FSCK_Callback_t callback, void *const context);
+
+#endif /*__FSCK_H__*/
@@ -1,9 +1,22 @@
 /*******************************************************************************
  * Includes
  ******************************************************************************/
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "stats.h"
+#include "zimage.h"
+#include "hal.h"
 
 /*******************************************************************************
  * Definitions
@@ -14,13 +27,66 @@
  */
 #define HAL_SIZE_SECTOR_DEFAULT (512u)
 
+/*
+ *Direct mode (O_DIRECT) : alignment of offsets, sizes and buffers when the file system does not tell it, and the
+ *pool of buffers that reads not aligned go through
+ */
+#define HAL_DIRECT_ALIGN_DEFAULT (4096u)
+#define HAL_DIRECT_BUFFER_SIZE (1024u * 1024u)
+#define HAL_DIRECT_SUM_BUFFER (16u) /*16 MiB : a whole number of 2 MiB huge pages*/
+
 /*******************************************************************************
  * Variables
  ******************************************************************************/
 
 static uint16_t s_SizeOfSector = HAL_SIZE_SECTOR_DEFAULT; /*Size in bytes of each sector*/
 
-static FILE *s_Stream = NULL; /*Stream points to FAT file location*/
+static int s_FileDescriptor = -1; /*File descriptor of FAT file. Reads use pread so several threads can read at the same time*/
+
+static const uint8_t *s_Memory = NULL; /*Image held in memory (HAL_InitMemory), NULL when a file is used*/
+static uint64_t s_SizeOfMemory = 0;
+
+static bool s_IsCompressed = false; /*The file is a compressed image (ZIMAGE_Convert) : reads go through zimage*/
+
+static bool s_IsDirectWanted = false; /*HAL_SetDirect : next files opened by HAL_Init use O_DIRECT*/
+static bool s_IsDirect = false;       /*The file is read with O_DIRECT*/
+static uint32_t s_DirectAlign = HAL_DIRECT_ALIGN_DEFAULT;
+
+static uint8_t *s_Pool = NULL; /*HAL_DIRECT_SUM_BUFFER buffers of HAL_DIRECT_BUFFER_SIZE bytes*/
+static uint8_t *s_FreeBuffers[HAL_DIRECT_SUM_BUFFER];
+static uint32_t s_SumFreeBuffer = 0;
+static pthread_mutex_t s_PoolLock = PTHREAD_MUTEX_INITIALIZER; /*Protects the free buffers*/
+static pthread_cond_t s_PoolFree = PTHREAD_COND_INITIALIZER;   /*A buffer was given back*/
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  HAL_ReadAt
+ * @brief Read bytes at an offset of the FAT file, retrying short reads
+ * @param[in] offset   Offset in bytes
+ * @param[in] size   Number of bytes to read
+ * @param[out] buff   Receiver array
+ * @return int32_t Returns the number of bytes read
+ */
+static int32_t HAL_ReadAt(const off_t offset, const uint32_t size, uint8_t *buff);
+
+/**  HAL_StartDirect
+ * @brief Read the opened file with O_DIRECT : get the alignment, map the pool (huge pages if there are some) and
+ *        set O_DIRECT
+ * @return bool Returns false if the file system does not support O_DIRECT or there is not enough memory
+ */
+static bool HAL_StartDirect(void);
+
+/**  HAL_ReadDirect
+ * @brief Read bytes with O_DIRECT : straight into buff when it is aligned, otherwise through a buffer of the pool
+ *        with the range rounded to the alignment and split in pieces of HAL_DIRECT_BUFFER_SIZE
+ * @param[in] offset   Offset in bytes
+ * @param[in] size   Number of bytes to read
+ * @param[out] buff   Receiver array
+ * @return int32_t Returns the number of bytes read
+ */
+static int32_t HAL_ReadDirect(const off_t offset, const uint32_t size, uint8_t *buff);
 
 /*******************************************************************************
  * Code
@@ -31,14 +97,29 @@ bool HAL_Init(const uint8_t *const filePath)
     bool status = true; /*return value */
 
     /*Open FAT file*/
-    s_Stream = fopen(filePath, "rb");
-    fflush(s_Stream);
+    s_FileDescriptor = open((const char *)filePath, O_RDONLY);
 
     /*Check error*/
-    if (NULL != s_Stream)
+    if (0 <= s_FileDescriptor)
     {
-        /*File opened successfully*/
-        status = true;
+        /*File opened successfully : a compressed image is read through zimage*/
+        s_IsCompressed = ZIMAGE_IsImage(s_FileDescriptor);
+        status = (false == s_IsCompressed) || (true == ZIMAGE_Open(s_FileDescriptor));
+        if (false == status)
+        {
+            /*Damaged compressed image : not mounted*/
+            close(s_FileDescriptor);
+            s_FileDescriptor = -1;
+            s_IsCompressed = false;
+        }
+        else if ((false == s_IsCompressed) && (true == s_IsDirectWanted))
+        {
+            s_IsDirect = HAL_StartDirect(); /*Reads stay buffered when the file system has no O_DIRECT*/
+        }
+        else
+        {
+            /*Do nothing*/
+        }
     }
     else
     {
@@ -49,44 +130,298 @@ bool HAL_Init(const uint8_t *const filePath)
     return status;
 }
 
+bool HAL_InitReadWrite(const uint8_t *const filePath)
+{
+    s_FileDescriptor = open((const char *)filePath, O_RDWR);
+
+    /*A compressed image can not be written*/
+    if ((0 <= s_FileDescriptor) && (true == ZIMAGE_IsImage(s_FileDescriptor)))
+    {
+        close(s_FileDescriptor);
+        s_FileDescriptor = -1;
+    }
+
+    return (0 <= s_FileDescriptor);
+}
+
+bool HAL_InitMemory(const uint8_t *const image, const uint64_t size)
+{
+    s_Memory = image;
+    s_SizeOfMemory = size;
+
+    return true;
+}
+
 int32_t HAL_ReadSector(uint32_t index, uint8_t *buff)
 {
-    int32_t sumByteOfSector = 0; /*return value */
+    STATS_Add(STATS_READ_SECTOR, 1u);
+
+    return HAL_ReadAt((off_t)index * s_SizeOfSector, s_SizeOfSector, buff);
+}
+
+int32_t HAL_ReadMultiSector(uint32_t index, uint32_t num, uint8_t *buff)
+{
+    STATS_Add(STATS_READ_MULTI_SECTOR, 1u);
+
+    return HAL_ReadAt((off_t)index * s_SizeOfSector, num * s_SizeOfSector, buff);
+}
+
+int32_t HAL_WriteMultiSector(uint32_t index, uint32_t num, const uint8_t *buff)
+{
+    int32_t sumByte = 0; /*return value */
+    ssize_t sizeOfWrite = 0;
+    const uint64_t begin = STATS_Begin();
+    const off_t offset = (off_t)index * s_SizeOfSector;
+    const uint32_t size = num * s_SizeOfSector;
+
+    while ((uint32_t)sumByte < size)
+    {
+        sizeOfWrite = pwrite(s_FileDescriptor, &buff[sumByte], size - sumByte, offset + sumByte);
+        if (0 >= sizeOfWrite)
+        {
+            break; /*Error (read only file, disk full)*/
+        }
+        sumByte += sizeOfWrite;
+    }
+    STATS_Add(STATS_WRITE, 1u);
+    STATS_Add(STATS_BYTE_WRITTEN, (uint64_t)sumByte);
+    STATS_End(STATS_OPERATION_HAL_WRITE, begin);
+
+    return sumByte;
+}
+
+bool HAL_Sync(void)
+{
+    return (0 == fdatasync(s_FileDescriptor));
+}
+
+void HAL_Prefetch(uint32_t index, uint32_t num)
+{
+    /*Only a hint : errors are ignored (offsets of a compressed image are not those of the file, direct reads
+      do not use the page cache)*/
+    if ((false == s_IsCompressed) && (false == s_IsDirect))
+    {
+        (void)posix_fadvise(s_FileDescriptor, (off_t)index * s_SizeOfSector, (off_t)num * s_SizeOfSector, POSIX_FADV_WILLNEED);
+    }
+}
+
+void HAL_UpdateSectorSize(const uint16_t sizeOfSector)
+{
+    s_SizeOfSector = sizeOfSector; /*Update size of sector (byte)*/
+}
+
+bool HAL_IsCompressed(void)
+{
+    return s_IsCompressed;
+}
+
+void HAL_SetDirect(const bool isDirect)
+{
+    s_IsDirectWanted = isDirect;
+}
 
-    if (0 == fseek(s_Stream, (index * s_SizeOfSector), SEEK_SET)) /*Move file pointer to index*/
+bool HAL_IsDirect(void)
+{
+    return s_IsDirect;
+}
+
+void *HAL_AllocBuffer(const uint32_t size)
+{
+    void *buffer = NULL; /*return value */
+
+    if (0 != posix_memalign(&buffer, (s_DirectAlign < HAL_DIRECT_ALIGN_DEFAULT) ? HAL_DIRECT_ALIGN_DEFAULT : s_DirectAlign, (0 != size) ? size : 1u))
     {
-        sumByteOfSector = fread(buff, sizeof(uint8_t), s_SizeOfSector, s_Stream); /*Read*/
+        buffer = NULL;
     }
     else
     {
-        /*Move file pointer to index location failed*/
+        STATS_Add(STATS_ALLOCATION, 1u);
     }
 
-    return sumByteOfSector;
+    return buffer;
 }
 
-int32_t HAL_ReadMultiSector(uint32_t index, uint32_t num, uint8_t *buff)
+void HAL_DeInit(void)
+{
+    if (true == s_IsCompressed)
+    {
+        ZIMAGE_Close();
+        s_IsCompressed = false;
+    }
+    if (true == s_IsDirect)
+    {
+        munmap(s_Pool, (size_t)HAL_DIRECT_SUM_BUFFER * HAL_DIRECT_BUFFER_SIZE);
+        s_Pool = NULL;
+        s_SumFreeBuffer = 0;
+        s_IsDirect = false;
+    }
+    if (0 <= s_FileDescriptor)
+    {
+        close(s_FileDescriptor); /*Close FAT file*/
+        s_FileDescriptor = -1;
+    }
+    s_Memory = NULL;
+    s_SizeOfMemory = 0;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static int32_t HAL_ReadAt(const off_t offset, const uint32_t size, uint8_t *buff)
 {
     int32_t sumByte = 0; /*return value */
+    ssize_t sizeOfRead = 0;
+    const uint64_t begin = STATS_Begin();
 
-    if (0 == fseek(s_Stream, (index * s_SizeOfSector), SEEK_SET)) /*Move file pointer to index*/
+    if (NULL != s_Memory)
+    {
+        /*Image in memory : copy what exists*/
+        if ((uint64_t)offset < s_SizeOfMemory)
+        {
+            sumByte = (int32_t)(((s_SizeOfMemory - (uint64_t)offset) < size) ? (s_SizeOfMemory - (uint64_t)offset) : size);
+            memcpy(buff, &s_Memory[offset], (size_t)sumByte);
+        }
+    }
+    else if (true == s_IsCompressed)
+    {
+        sumByte = ZIMAGE_Read((uint64_t)offset, size, buff);
+    }
+    else if (true == s_IsDirect)
     {
-        sumByte = fread(buff, sizeof(uint8_t), (num * s_SizeOfSector), s_Stream); /*Read*/
+        sumByte = HAL_ReadDirect(offset, size, buff);
     }
     else
     {
-        /*Move file pointer to index location failed*/
+        while ((uint32_t)sumByte < size)
+        {
+            sizeOfRead = pread(s_FileDescriptor, &buff[sumByte], size - sumByte, offset + sumByte);
+            if (0 >= sizeOfRead)
+            {
+                break; /*End of file or error*/
+            }
+            sumByte += sizeOfRead;
+        }
     }
+    STATS_AddRead((uint64_t)offset, (uint64_t)sumByte);
+    STATS_End(STATS_OPERATION_HAL_READ, begin);
 
     return sumByte;
 }
 
-void HAL_UpdateSectorSize(const uint16_t sizeOfSector)
+static bool HAL_StartDirect(void)
 {
-    s_SizeOfSector = sizeOfSector; /*Update size of sector (byte)*/
+    bool status = true; /*return value */
+    const size_t sizeOfPool = (size_t)HAL_DIRECT_SUM_BUFFER * HAL_DIRECT_BUFFER_SIZE;
+    int flags = 0;
+    uint32_t i = 0;
+#if defined(STATX_DIOALIGN)
+    struct statx information;
+#endif
+
+    s_DirectAlign = HAL_DIRECT_ALIGN_DEFAULT;
+#if defined(STATX_DIOALIGN)
+    if ((0 == statx(s_FileDescriptor, "", AT_EMPTY_PATH, STATX_DIOALIGN, &information)) && (0 != (information.stx_mask & STATX_DIOALIGN)))
+    {
+        /*Alignments of 0 : the file system has no O_DIRECT*/
+        status = (0 != information.stx_dio_offset_align) && (information.stx_dio_offset_align <= HAL_DIRECT_BUFFER_SIZE) &&
+                 (information.stx_dio_mem_align <= HAL_DIRECT_BUFFER_SIZE);
+        s_DirectAlign = (information.stx_dio_offset_align < information.stx_dio_mem_align) ? information.stx_dio_mem_align : information.stx_dio_offset_align;
+    }
+#endif
+
+    if (true == status)
+    {
+        s_Pool = (uint8_t *)mmap(NULL, sizeOfPool, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (MAP_FAILED == (void *)s_Pool)
+        {
+            /*No huge page reserved*/
+            s_Pool = (uint8_t *)mmap(NULL, sizeOfPool, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+        status = (MAP_FAILED != (void *)s_Pool);
+        s_Pool = (true == status) ? s_Pool : NULL;
+    }
+    if (true == status)
+    {
+        flags = fcntl(s_FileDescriptor, F_GETFL);
+        status = (0 <= flags) && (0 == fcntl(s_FileDescriptor, F_SETFL, flags | O_DIRECT));
+    }
+
+    if (true == status)
+    {
+        for (i = 0; i < HAL_DIRECT_SUM_BUFFER; i++)
+        {
+            s_FreeBuffers[i] = &s_Pool[(size_t)i * HAL_DIRECT_BUFFER_SIZE];
+        }
+        s_SumFreeBuffer = HAL_DIRECT_SUM_BUFFER;
+    }
+    else if (NULL != s_Pool)
+    {
+        munmap(s_Pool, sizeOfPool);
+        s_Pool = NULL;
+    }
+    else
+    {
+        /*Do nothing*/
+    }
+
+    return status;
 }
 
-void HAL_DeInit(void)
+static int32_t HAL_ReadDirect(const off_t offset, const uint32_t size, uint8_t *buff)
 {
-    fclose(s_Stream); /*Close FAT file*/
+    int32_t sumByte = 0; /*return value */
+    const uint64_t mask = (uint64_t)s_DirectAlign - 1u;
+    uint8_t *buffer = NULL;
+    uint64_t start = 0;
+    uint64_t sizeOfChunk = 0;
+    uint32_t skip = 0; /*Bytes before the range in the first aligned block*/
+    uint32_t sizeOfPart = 0;
+    ssize_t sizeOfRead = 0;
+    bool isEnd = false;
+
+    if ((0 == ((uintptr_t)buff & mask)) && (0 == ((uint64_t)offset & mask)) && (0 == (size & mask)))
+    {
+        /*Aligned : no copy*/
+        while ((false == isEnd) && ((uint32_t)sumByte < size))
+        {
+            sizeOfRead = pread(s_FileDescriptor, &buff[sumByte], size - sumByte, offset + sumByte);
+            isEnd = (0 >= sizeOfRead); /*End of file or error*/
+            sumByte += (false == isEnd) ? (int32_t)sizeOfRead : 0;
+        }
+    }
+    else
+    {
+        pthread_mutex_lock(&s_PoolLock);
+        while (0 == s_SumFreeBuffer)
+        {
+            pthread_cond_wait(&s_PoolFree, &s_PoolLock);
+        }
+        buffer = s_FreeBuffers[--s_SumFreeBuffer];
+        pthread_mutex_unlock(&s_PoolLock);
+
+        while ((false == isEnd) && ((uint32_t)sumByte < size))
+        {
+            start = ((uint64_t)offset + (uint64_t)sumByte) & ~mask;
+            skip = (uint32_t)((uint64_t)offset + (uint64_t)sumByte - start);
+            sizeOfChunk = ((uint64_t)skip + (size - (uint32_t)sumByte) + mask) & ~mask;
+            sizeOfChunk = (sizeOfChunk < HAL_DIRECT_BUFFER_SIZE) ? sizeOfChunk : HAL_DIRECT_BUFFER_SIZE;
+            sizeOfRead = pread(s_FileDescriptor, buffer, (size_t)sizeOfChunk, (off_t)start);
+            isEnd = (sizeOfRead <= (ssize_t)skip); /*End of file or error*/
+            if (false == isEnd)
+            {
+                sizeOfPart = (((uint32_t)sizeOfRead - skip) < (size - (uint32_t)sumByte)) ? ((uint32_t)sizeOfRead - skip) : (size - (uint32_t)sumByte);
+                memcpy(&buff[sumByte], &buffer[skip], sizeOfPart);
+                sumByte += (int32_t)sizeOfPart;
+                isEnd = (sizeOfRead < (ssize_t)sizeOfChunk); /*The file ends in this piece*/
+            }
+        }
+
+        pthread_mutex_lock(&s_PoolLock);
+        s_FreeBuffers[s_SumFreeBuffer++] = buffer;
+        pthread_cond_signal(&s_PoolFree);
+        pthread_mutex_unlock(&s_PoolLock);
+    }
+
+    return sumByte;
 }
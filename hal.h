@@ -6,12 +6,28 @@
  ******************************************************************************/
 
 /**  HAL_Init
- * @brief Open the file FAT
+ * @brief Open the file FAT. A compressed image (ZIMAGE_Convert) is recognized and read through its block cache
  * @param[in] filePath   The path to the file
  * @return bool Returns True if the file is opened successfully
  */
 bool HAL_Init(const uint8_t *const filePath);
 
+/**  HAL_InitReadWrite
+ * @brief Open the file FAT for reading and writing (fails on a compressed image)
+ * @param[in] filePath   The path to the file
+ * @return bool Returns True if the file is opened successfully
+ */
+bool HAL_InitReadWrite(const uint8_t *const filePath);
+
+/**  HAL_InitMemory
+ * @brief Use an image held in memory instead of a file (reads are copies, writes fail). Used to time the
+ *        decoding code without file I/O
+ * @param[in] image   Bytes of the image (kept by the caller until HAL_DeInit)
+ * @param[in] size   Size in bytes of the image
+ * @return bool Returns true
+ */
+bool HAL_InitMemory(const uint8_t *const image, const uint64_t size);
+
 /**  HAL_ReadSector
  * @brief Read only one sector
  * @param[in] index   Location of sectors
@@ -29,6 +45,29 @@ int32_t HAL_ReadSector(uint32_t index, uint8_t *buff);
  */
 int32_t HAL_ReadMultiSector(uint32_t index, uint32_t num, uint8_t *buff);
 
+/**  HAL_WriteMultiSector
+ * @brief Write multiple sectors (the file must be opened with HAL_InitReadWrite)
+ * @param[in] index   Location of first sector to write
+ * @param[in] num   Total number of sectors to write
+ * @param[in] buff   Data to write
+ * @return int32_t Returns the number of bytes written
+ */
+int32_t HAL_WriteMultiSector(uint32_t index, uint32_t num, const uint8_t *buff);
+
+/**  HAL_Sync
+ * @brief Wait until written sectors are stored on the disk
+ * @return bool Returns true if success
+ */
+bool HAL_Sync(void);
+
+/**  HAL_Prefetch
+ * @brief Ask the system to start reading sectors in the background, so a later read of them does not wait
+ * @param[in] index   Location of first sector
+ * @param[in] num   Total number of sectors
+ * @return none
+ */
+void HAL_Prefetch(uint32_t index, uint32_t num);
+
 /**  HAL_UpdateSectorSize
  * @brief Update size of sector
  * @param[in] sizeOfSector   Location of first sector to read
@@ -36,6 +75,35 @@ int32_t HAL_ReadMultiSector(uint32_t index, uint32_t num, uint8_t *buff);
  */
 void HAL_UpdateSectorSize(const uint16_t sizeOfSector);
 
+/**  HAL_IsCompressed
+ * @brief Tell if the opened file is a compressed image (sectors are not at their offset in the file)
+ * @return bool Returns true for a compressed image
+ */
+bool HAL_IsCompressed(void);
+
+/**  HAL_SetDirect
+ * @brief Read the next files opened by HAL_Init with O_DIRECT : the page cache is not filled by one pass scans.
+ *        Reads not aligned go through a pool of aligned buffers. Compressed images, files opened with
+ *        HAL_InitReadWrite and file systems without O_DIRECT stay buffered
+ * @param[in] isDirect   true to use O_DIRECT
+ * @return none
+ */
+void HAL_SetDirect(const bool isDirect);
+
+/**  HAL_IsDirect
+ * @brief Tell if the opened file is read with O_DIRECT
+ * @return bool Returns true if reads bypass the page cache
+ */
+bool HAL_IsDirect(void);
+
+/**  HAL_AllocBuffer
+ * @brief Allocate a buffer aligned for direct reads (released with free). Reads of whole aligned ranges into it
+ *        are not copied
+ * @param[in] size   Size in bytes
+ * @return void* Returns the buffer or NULL
+ */
+void *HAL_AllocBuffer(const uint32_t size);
+
 /**  HAL_DeInit
  * @brief Close the file FAT
  * @return none
@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "fatfs.h"
+#include "index.h"
+#include "table.h"
+#include "checksum.h"
+#include "stats.h"
+#include "hash.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Maximum number of threads of HASH_Files
+ */
+#define HASH_MAX_THREAD (64u)
+
+/*
+ *Work shared by the threads of HASH_Files
+ */
+typedef struct
+{
+    const TABLE_Table_Struct_t *table;
+    const uint32_t *rows;          /*Rows sorted by size, largest first*/
+    uint32_t sumRow;
+    uint32_t nextRow;              /*Next element of rows to hash (atomic)*/
+    uint32_t algorithms;
+    HASH_Digest_Struct_t *digests;
+    bool status;                   /*Cleared when a file can not be read*/
+} HASH_Work_Struct_t;
+
+/*
+ *Digests of the file being streamed
+ */
+typedef struct
+{
+    uint32_t algorithms;
+    uint32_t crc32c;
+    CHECKSUM_Sha256_Struct_t sha256;
+} HASH_File_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  HASH_Worker
+ * @brief Thread of HASH_Files : hash files until there is none left
+ * @param[in] argument work (HASH_Work_Struct_t)
+ * @return void* NULL
+ */
+static void *HASH_Worker(void *argument);
+
+/**  HASH_Update
+ * @brief Hash one chunk of a file (used as FATFS_DataCallback_t)
+ * @param[in] data  chunk of file data
+ * @param[in] size  size of chunk
+ * @param[in] context  digests of the file (HASH_File_Struct_t)
+ * @return bool true
+ */
+static bool HASH_Update(const uint8_t *const data, const uint32_t size, void *const context);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool HASH_Files(const TABLE_Table_Struct_t *const table, const uint32_t *const rows, const uint32_t sumRow, const uint32_t algorithms, const uint32_t sumThread,
+                HASH_Digest_Struct_t *const digests)
+{
+    bool status = true; /*return value */
+    HASH_Work_Struct_t work;
+    pthread_t thread[HASH_MAX_THREAD];
+    uint32_t *order = NULL;
+    uint32_t sumThreadToStart = sumThread;
+    uint32_t sumThreadStarted = 0;
+    uint32_t i = 0; /*Index value*/
+
+    /*Largest files first, so the last thread running does not hold a big file alone*/
+    order = (uint32_t *)STATS_Malloc(((size_t)sumRow + 1u) * sizeof(uint32_t));
+    if (NULL == order)
+    {
+        status = false;
+    }
+    else
+    {
+        memcpy(order, rows, (size_t)sumRow * sizeof(uint32_t));
+        status = TABLE_Sort(table, order, sumRow, TABLE_SORT_SIZE, true);
+    }
+
+    if (true == status)
+    {
+        work.table = table;
+        work.rows = order;
+        work.sumRow = sumRow;
+        work.nextRow = 0;
+        work.algorithms = algorithms;
+        work.digests = digests;
+        work.status = true;
+
+        if (0 == sumThreadToStart)
+        {
+            sumThreadToStart = (uint32_t)sysconf(_SC_NPROCESSORS_ONLN);
+        }
+        if (HASH_MAX_THREAD < sumThreadToStart)
+        {
+            sumThreadToStart = HASH_MAX_THREAD;
+        }
+        for (i = 1; i < sumThreadToStart; i++)
+        {
+            if (0 == pthread_create(&thread[sumThreadStarted], NULL, HASH_Worker, &work))
+            {
+                sumThreadStarted++;
+            }
+        }
+        HASH_Worker(&work);
+        for (i = 0; i < sumThreadStarted; i++)
+        {
+            pthread_join(thread[i], NULL);
+        }
+        status = work.status;
+    }
+    free(order);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void *HASH_Worker(void *argument)
+{
+    HASH_Work_Struct_t *const work = (HASH_Work_Struct_t *)argument;
+    HASH_Digest_Struct_t *digest = NULL;
+    HASH_File_Struct_t file;
+    uint32_t next = 0;
+    uint32_t row = 0;
+
+    file.algorithms = work->algorithms;
+    next = __atomic_fetch_add(&work->nextRow, 1u, __ATOMIC_RELAXED);
+    while (next < work->sumRow)
+    {
+        row = work->rows[next];
+        digest = &work->digests[row];
+        memset(digest, 0, sizeof(HASH_Digest_Struct_t));
+        if (0 == (work->table->attributes[row] & FATFS_ATTRIBUTE_DIRECTORY))
+        {
+            file.crc32c = 0;
+            CHECKSUM_Sha256Init(&file.sha256);
+            digest->isValid = (0 == work->table->size[row]) || (true == FATFS_StreamData(work->table->firstCluster[row], work->table->size[row], HASH_Update, &file));
+            if (true == digest->isValid)
+            {
+                digest->crc32c = file.crc32c;
+                CHECKSUM_Sha256Final(&file.sha256, digest->sha256);
+            }
+            else
+            {
+                __atomic_store_n(&work->status, false, __ATOMIC_RELAXED);
+            }
+        }
+        next = __atomic_fetch_add(&work->nextRow, 1u, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+static bool HASH_Update(const uint8_t *const data, const uint32_t size, void *const context)
+{
+    HASH_File_Struct_t *const file = (HASH_File_Struct_t *)context;
+
+    if (0 != (file->algorithms & HASH_ALGORITHM_CRC32C))
+    {
+        file->crc32c = CHECKSUM_Crc32c(file->crc32c, data, size);
+    }
+    if (0 != (file->algorithms & HASH_ALGORITHM_SHA256))
+    {
+        CHECKSUM_Sha256Update(&file->sha256, data, size);
+    }
+
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef __HASH_H__
+#define __HASH_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Digests computed by HASH_Files (may be combined)
+ */
+#define HASH_ALGORITHM_CRC32C (0x01u)
+#define HASH_ALGORITHM_SHA256 (0x02u)
+
+/*
+ *Digests of one file
+ */
+typedef struct
+{
+    uint32_t crc32c;                        /*CRC32C of the content*/
+    uint8_t sha256[CHECKSUM_SHA256_SIZE];   /*SHA-256 of the content*/
+    bool isValid;                           /*false if the file could not be read*/
+} HASH_Digest_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  HASH_Files
+ * @brief Hash the content of files of the mounted volume. Files are shared by several threads, largest first,
+ *        and the next read of a file is running while the current chunk is hashed
+ * @param[in] table   Table of the volume (TABLE_Build)
+ * @param[in] rows   Rows of the files to hash (folders are skipped)
+ * @param[in] sumRow   Number of rows
+ * @param[in] algorithms   HASH_ALGORITHM_CRC32C and/or HASH_ALGORITHM_SHA256
+ * @param[in] sumThread   Number of threads (0 : one per CPU)
+ * @param[out] digests   Receiver, table->sumRow elements indexed by row
+ * @return bool Returns true if every file was hashed
+ */
+bool HASH_Files(const TABLE_Table_Struct_t *const table, const uint32_t *const rows, const uint32_t sumRow, const uint32_t algorithms, const uint32_t sumThread,
+                HASH_Digest_Struct_t *const digests);
+
+#endif /*__HASH_H__*/
@@ -0,0 +1,526 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "checksum.h"
+#include "mystring.h"
+#include "fatfs.h"
+#include "stats.h"
+#include "index.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Identification of the index file
+ */
+#define INDEX_MAGIC "FATIDX01"
+#define INDEX_SIZE_MAGIC (8u)
+#define INDEX_VERSION (2u)
+
+/*
+ *Records are aligned on 8 bytes in the index file
+ */
+#define INDEX_ALIGN(x) (((x) + 7u) & ~(uint64_t)7u)
+
+/*
+ *Size of the boot sector used for the check sum
+ */
+#define INDEX_SIZE_BOOT_SECTOR (512u)
+
+/*
+ *Pack date and time of an entry as stored in a directory entry
+ */
+#define INDEX_PACK_DATE(d) (((uint32_t)(d).year << 9u) | ((uint32_t)(d).month << 5u) | (uint32_t)(d).day)
+#define INDEX_PACK_TIME(t) (((uint32_t)(t).hours << 11u) | ((uint32_t)(t).minutes << 5u) | (uint32_t)(t).seconds)
+
+/*
+ *Arrays of the index while it is built
+ */
+typedef struct
+{
+    INDEX_Node_Struct_t *node;
+    uint32_t sumNode;
+    uint32_t maxNode;
+    INDEX_Extent_Struct_t *extent;
+    uint32_t sumExtent;
+    uint32_t maxExtent;
+    uint8_t *names;
+    uint32_t sizeOfNames;
+    uint32_t maxSizeOfNames;
+} INDEX_Builder_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static const uint8_t *s_NamesToSort = NULL; /*Names used by INDEX_CompareNode while sorting*/
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  INDEX_CheckSumImage
+ * @brief Compute size, modification time and check sum of the boot sector of an image
+ * @param[in] imagePath   Path of the image
+ * @param[out] header   sizeOfImage, timeOfImage and checkSumOfBoot are written
+ * @return bool Returns true if success
+ */
+static bool INDEX_CheckSumImage(const uint8_t *const imagePath, INDEX_Header_Struct_t *const header);
+
+/**  INDEX_AddNode
+ * @brief Add a node and its name and extents to the builder
+ * @param[in,out] builder   Index being built
+ * @param[in] entry   Entry of the node
+ * @param[in] parent   Parent node
+ * @param[in] sumClusterLimit   Maximum length of a chain (stop on a looping chain)
+ * @return bool Returns true if success
+ */
+static bool INDEX_AddNode(INDEX_Builder_Struct_t *const builder, const FATFS_Entry_Struct_t *const entry, const uint32_t parent, const uint32_t sumClusterLimit);
+
+/**  INDEX_CompareNode
+ * @brief Compare names of 2 nodes for qsort
+ * @param[in] first   first node
+ * @param[in] second   second node
+ * @return int Returns the order of the names ignoring case
+ */
+static int INDEX_CompareNode(const void *first, const void *second);
+
+/**  INDEX_Grow
+ * @brief Make room for one more element in an array of the builder
+ * @param[in,out] array   Array
+ * @param[in,out] maxElement   Capacity of array
+ * @param[in] sumElement   Number of elements used (+ needed)
+ * @param[in] sizeOfElement   Size of one element
+ * @return bool Returns true if success
+ */
+static bool INDEX_Grow(void **const array, uint32_t *const maxElement, const uint32_t sumElement, const size_t sizeOfElement);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool INDEX_Build(const uint8_t *const imagePath, const uint8_t *const indexPath)
+{
+    bool status = true; /*return value */
+    INDEX_Builder_Struct_t builder;
+    INDEX_Header_Struct_t header;
+    FATFS_VolumeInfo_Struct_t info;
+    FATFS_Entry_Struct_t root;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *entry = NULL;
+    uint8_t *visited = NULL; /*Bitmap of folders already read, to stop on a looping tree*/
+    uint32_t i = 0;          /*Index of node*/
+    uint32_t cluster = 0;
+    uint8_t temporaryPath[4096];
+    uint8_t padding[8] = {0};
+    FILE *stream = NULL;
+
+    memset(&builder, 0, sizeof(builder));
+    memset(&header, 0, sizeof(header));
+    FATFS_GetVolumeInfo(&info);
+
+    /*Root node*/
+    memset(&root, 0, sizeof(root));
+    root.attributes = FATFS_ATTRIBUTE_DIRECTORY;
+    root.firstCluster = info.rootCluster;
+    visited = (uint8_t *)STATS_Calloc((info.totalClusters + 2u) / 8u + 1u, sizeof(uint8_t));
+    status = (NULL != visited) && INDEX_AddNode(&builder, &root, 0, info.totalClusters);
+
+    /*Breadth first : children of a folder are consecutive nodes*/
+    for (i = 0; (true == status) && (i < builder.sumNode); i++)
+    {
+        if (0 == (builder.node[i].attributes & FATFS_ATTRIBUTE_DIRECTORY))
+        {
+            continue;
+        }
+        cluster = builder.node[i].firstCluster;
+        if ((0 != i) && ((0 == cluster) || (cluster >= (info.totalClusters + 2u)) || (0 != (visited[cluster / 8u] & (1u << (cluster % 8u))))))
+        {
+            continue; /*Empty, damaged or already read folder*/
+        }
+        visited[cluster / 8u] |= (uint8_t)(1u << (cluster % 8u));
+
+        builder.node[i].firstChild = builder.sumNode;
+        if (true == FATFS_DirOpen(&dir, (0 == i) ? 0 : cluster))
+        {
+            entry = FATFS_DirNext(&dir);
+            while ((true == status) && (NULL != entry))
+            {
+                /*Skip ".", "..", deleted entries and the volume label*/
+                if (('.' != entry->shortFileName[0]) && (0xe5u != entry->shortFileName[0]) && (0 == (entry->attributes & 0x08u)))
+                {
+                    status = INDEX_AddNode(&builder, entry, i, info.totalClusters);
+                }
+                entry = FATFS_DirNext(&dir);
+            }
+            FATFS_DirClose(&dir);
+        }
+        builder.node[i].sumChild = builder.sumNode - builder.node[i].firstChild;
+
+        /*Sort children to find them by binary search*/
+        s_NamesToSort = builder.names;
+        qsort(&builder.node[builder.node[i].firstChild], builder.node[i].sumChild, sizeof(INDEX_Node_Struct_t), INDEX_CompareNode);
+    }
+
+    /*Header*/
+    if (true == status)
+    {
+        memcpy(header.magic, INDEX_MAGIC, INDEX_SIZE_MAGIC);
+        header.version = INDEX_VERSION;
+        header.sizeOfHeader = sizeof(INDEX_Header_Struct_t);
+        header.fatType = info.fatType;
+        header.sectorPerCluster = info.sectorPerCluster;
+        header.bytePerSector = info.bytePerSector;
+        header.locationOfData = info.locationOfData;
+        header.sumNode = builder.sumNode;
+        header.sumExtent = builder.sumExtent;
+        header.sizeOfNames = builder.sizeOfNames;
+        header.offsetOfNode = INDEX_ALIGN(sizeof(INDEX_Header_Struct_t));
+        header.offsetOfExtent = INDEX_ALIGN(header.offsetOfNode + (uint64_t)builder.sumNode * sizeof(INDEX_Node_Struct_t));
+        header.offsetOfNames = INDEX_ALIGN(header.offsetOfExtent + (uint64_t)builder.sumExtent * sizeof(INDEX_Extent_Struct_t));
+        status = INDEX_CheckSumImage(imagePath, &header);
+    }
+
+    /*Write to a temporary file then rename, so a reader never sees a partial index*/
+    if (true == status)
+    {
+        snprintf((char *)temporaryPath, sizeof(temporaryPath), "%s.tmp", indexPath);
+        stream = fopen((const char *)temporaryPath, "wb");
+        status = (NULL != stream);
+    }
+    if (true == status)
+    {
+        status = (1u == fwrite(&header, sizeof(header), 1u, stream));
+        status = status && ((header.offsetOfNode - sizeof(header)) == fwrite(padding, 1u, header.offsetOfNode - sizeof(header), stream));
+        status = status && (builder.sumNode == fwrite(builder.node, sizeof(INDEX_Node_Struct_t), builder.sumNode, stream));
+        status = status && ((header.offsetOfExtent - header.offsetOfNode - (uint64_t)builder.sumNode * sizeof(INDEX_Node_Struct_t)) ==
+                            fwrite(padding, 1u, header.offsetOfExtent - header.offsetOfNode - (uint64_t)builder.sumNode * sizeof(INDEX_Node_Struct_t), stream));
+        status = status && (builder.sumExtent == fwrite(builder.extent, sizeof(INDEX_Extent_Struct_t), builder.sumExtent, stream));
+        status = status && ((header.offsetOfNames - header.offsetOfExtent - (uint64_t)builder.sumExtent * sizeof(INDEX_Extent_Struct_t)) ==
+                            fwrite(padding, 1u, header.offsetOfNames - header.offsetOfExtent - (uint64_t)builder.sumExtent * sizeof(INDEX_Extent_Struct_t), stream));
+        status = status && (builder.sizeOfNames == fwrite(builder.names, sizeof(uint8_t), builder.sizeOfNames, stream));
+        status = (0 == fclose(stream)) && status;
+        if (true == status)
+        {
+            status = (0 == rename((const char *)temporaryPath, (const char *)indexPath));
+        }
+        else
+        {
+            remove((const char *)temporaryPath);
+        }
+    }
+
+    free(visited);
+    free(builder.node);
+    free(builder.extent);
+    free(builder.names);
+
+    return status;
+}
+
+bool INDEX_Open(INDEX_Handle_Struct_t *const handle, const uint8_t *const imagePath, const uint8_t *const indexPath)
+{
+    bool status = true; /*return value */
+    int32_t fd = -1;
+    struct stat information;
+    INDEX_Header_Struct_t checkOfImage;
+    const INDEX_Header_Struct_t *header = NULL;
+    const INDEX_Node_Struct_t *node = NULL;
+    uint32_t i = 0;
+
+    memset(handle, 0, sizeof(INDEX_Handle_Struct_t));
+
+    /*Map the index file*/
+    fd = open((const char *)indexPath, O_RDONLY);
+    if ((0 > fd) || (0 != fstat(fd, &information)) || (sizeof(INDEX_Header_Struct_t) > (uint64_t)information.st_size))
+    {
+        status = false;
+    }
+    else
+    {
+        handle->size = information.st_size;
+        handle->base = (uint8_t *)mmap(NULL, handle->size, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED == handle->base)
+        {
+            handle->base = NULL;
+            status = false;
+        }
+    }
+    if (0 <= fd)
+    {
+        close(fd);
+    }
+
+    /*Check the format*/
+    if (true == status)
+    {
+        header = (const INDEX_Header_Struct_t *)handle->base;
+        status = (0 == memcmp(header->magic, INDEX_MAGIC, INDEX_SIZE_MAGIC)) && (INDEX_VERSION == header->version) && (sizeof(INDEX_Header_Struct_t) == header->sizeOfHeader) &&
+                 (0 != header->sumNode) && (0 != header->sizeOfNames) &&
+                 ((header->offsetOfNode + (uint64_t)header->sumNode * sizeof(INDEX_Node_Struct_t)) <= handle->size) &&
+                 ((header->offsetOfExtent + (uint64_t)header->sumExtent * sizeof(INDEX_Extent_Struct_t)) <= handle->size) &&
+                 ((header->offsetOfNames + header->sizeOfNames) <= handle->size) &&
+                 (0 == handle->base[header->offsetOfNames + header->sizeOfNames - 1u]);
+    }
+
+    /*Check the links of the nodes : lookups follow them without checking*/
+    if (true == status)
+    {
+        node = (const INDEX_Node_Struct_t *)(handle->base + header->offsetOfNode);
+        for (i = 0; (true == status) && (i < header->sumNode); i++)
+        {
+            status = (node[i].parent < header->sumNode) && (((uint64_t)node[i].firstChild + node[i].sumChild) <= header->sumNode) &&
+                     (node[i].nameOffset < header->sizeOfNames) && (((uint64_t)node[i].firstExtent + node[i].sumExtent) <= header->sumExtent);
+        }
+    }
+
+    /*Check that the image did not change since the index was built*/
+    if (true == status)
+    {
+        checkOfImage = *header;
+        status = (true == INDEX_CheckSumImage(imagePath, &checkOfImage)) && (checkOfImage.sizeOfImage == header->sizeOfImage) &&
+                 (checkOfImage.timeOfImage == header->timeOfImage) && (checkOfImage.checkSumOfBoot == header->checkSumOfBoot);
+    }
+
+    if (true == status)
+    {
+        handle->header = header;
+        handle->node = (const INDEX_Node_Struct_t *)(handle->base + header->offsetOfNode);
+        handle->extent = (const INDEX_Extent_Struct_t *)(handle->base + header->offsetOfExtent);
+        handle->names = handle->base + header->offsetOfNames;
+    }
+    else
+    {
+        INDEX_Close(handle);
+    }
+
+    return status;
+}
+
+uint32_t INDEX_Lookup(const INDEX_Handle_Struct_t *const handle, const uint8_t *const path)
+{
+    uint32_t node = 0; /*return value : start from the root*/
+    uint8_t component[1024];
+    uint32_t i = 0; /*Index of path*/
+    uint32_t j = 0; /*Index of component*/
+    uint32_t low = 0;
+    uint32_t high = 0;
+    uint32_t middle = 0;
+    int32_t compare = 0;
+
+    while ((INDEX_NOT_FOUND != node) && (0 != path[i]))
+    {
+        /*Take the next component of the path*/
+        while (('/' == path[i]) || ('\\' == path[i]))
+        {
+            i++;
+        }
+        j = 0;
+        while ((0 != path[i]) && ('/' != path[i]) && ('\\' != path[i]) && (j < (sizeof(component) - 1u)))
+        {
+            component[j] = path[i];
+            i++;
+            j++;
+        }
+        component[j] = 0;
+        if (0 == j)
+        {
+            break; /*Trailing '/'*/
+        }
+
+        /*Binary search in the children*/
+        low = handle->node[node].firstChild;
+        high = low + handle->node[node].sumChild;
+        node = INDEX_NOT_FOUND;
+        while (low < high)
+        {
+            middle = low + (high - low) / 2u;
+            compare = MYSTRING_CompareNoCase(component, INDEX_GetName(handle, middle));
+            if (0 == compare)
+            {
+                node = middle;
+                break;
+            }
+            else if (0 > compare)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1u;
+            }
+        }
+    }
+
+    return node;
+}
+
+const uint8_t *INDEX_GetName(const INDEX_Handle_Struct_t *const handle, const uint32_t node)
+{
+    return &handle->names[handle->node[node].nameOffset];
+}
+
+void INDEX_Close(INDEX_Handle_Struct_t *const handle)
+{
+    if (NULL != handle->base)
+    {
+        munmap(handle->base, handle->size);
+    }
+    memset(handle, 0, sizeof(INDEX_Handle_Struct_t));
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static bool INDEX_CheckSumImage(const uint8_t *const imagePath, INDEX_Header_Struct_t *const header)
+{
+    bool status = true; /*return value */
+    FILE *stream = NULL;
+    uint8_t buffer[INDEX_SIZE_BOOT_SECTOR];
+    struct stat information;
+
+    stream = fopen((const char *)imagePath, "rb");
+    if ((NULL == stream) || (0 != fstat(fileno(stream), &information)))
+    {
+        status = false;
+    }
+    else
+    {
+        /*Every write to the image changes the time (a write inside the folders changes neither the FAT nor the size)*/
+        header->sizeOfImage = information.st_size;
+        header->timeOfImage = (uint64_t)information.st_mtim.tv_sec * 1000000000u + (uint64_t)information.st_mtim.tv_nsec;
+    }
+
+    /*Boot sector*/
+    if ((true == status) && (INDEX_SIZE_BOOT_SECTOR == fread(buffer, sizeof(uint8_t), INDEX_SIZE_BOOT_SECTOR, stream)))
+    {
+        header->checkSumOfBoot = CHECKSUM_Crc32c(0, buffer, INDEX_SIZE_BOOT_SECTOR);
+    }
+    else
+    {
+        status = false;
+    }
+
+    if (NULL != stream)
+    {
+        fclose(stream);
+    }
+
+    return status;
+}
+
+static bool INDEX_AddNode(INDEX_Builder_Struct_t *const builder, const FATFS_Entry_Struct_t *const entry, const uint32_t parent, const uint32_t sumClusterLimit)
+{
+    bool status = true; /*return value */
+    INDEX_Node_Struct_t *node = NULL;
+    uint8_t shortName[FATFS_SHORT_NAME_SIZE];
+    const uint8_t *name = NULL;
+    uint32_t sizeOfName = 0;
+    uint32_t cluster = 0;
+    uint32_t nextCluster = 0;
+    uint32_t sumCluster = 0;
+
+    /*Long name if there is one*/
+    if (0 != entry->longFileName[0])
+    {
+        name = entry->longFileName;
+    }
+    else
+    {
+        FATFS_GetShortName(entry, shortName);
+        name = shortName;
+    }
+    sizeOfName = strlen((const char *)name) + 1u;
+
+    status = INDEX_Grow((void **)&builder->node, &builder->maxNode, builder->sumNode + 1u, sizeof(INDEX_Node_Struct_t)) &&
+             INDEX_Grow((void **)&builder->names, &builder->maxSizeOfNames, builder->sizeOfNames + sizeOfName, sizeof(uint8_t));
+    if (true == status)
+    {
+        node = &builder->node[builder->sumNode];
+        memset(node, 0, sizeof(INDEX_Node_Struct_t));
+        node->parent = parent;
+        node->nameOffset = builder->sizeOfNames;
+        node->fileSize = entry->fileSize;
+        node->firstCluster = entry->firstCluster;
+        node->attributes = entry->attributes;
+        node->lastModified = (INDEX_PACK_DATE(entry->lastModDate) << 16u) | INDEX_PACK_TIME(entry->lastModTime);
+        node->firstExtent = builder->sumExtent;
+        memcpy(&builder->names[builder->sizeOfNames], name, sizeOfName);
+        builder->sizeOfNames += sizeOfName;
+        builder->sumNode++;
+
+        /*Extents of the cluster chain*/
+        cluster = entry->firstCluster;
+        while ((true == status) && (2u <= cluster) && (sumCluster < sumClusterLimit))
+        {
+            if ((0 == node->sumExtent) || ((builder->extent[builder->sumExtent - 1u].startCluster + builder->extent[builder->sumExtent - 1u].sumCluster) != cluster))
+            {
+                status = INDEX_Grow((void **)&builder->extent, &builder->maxExtent, builder->sumExtent + 1u, sizeof(INDEX_Extent_Struct_t));
+                if (true == status)
+                {
+                    builder->extent[builder->sumExtent].startCluster = cluster;
+                    builder->extent[builder->sumExtent].sumCluster = 0;
+                    builder->sumExtent++;
+                    node->sumExtent++;
+                }
+            }
+            if (true == status)
+            {
+                builder->extent[builder->sumExtent - 1u].sumCluster++;
+                sumCluster++;
+            }
+            if (false == FATFS_GetNextCluster(cluster, &nextCluster))
+            {
+                break; /*End of chain*/
+            }
+            cluster = nextCluster;
+        }
+    }
+
+    return status;
+}
+
+static int INDEX_CompareNode(const void *first, const void *second)
+{
+    return MYSTRING_CompareNoCase(&s_NamesToSort[((const INDEX_Node_Struct_t *)first)->nameOffset], &s_NamesToSort[((const INDEX_Node_Struct_t *)second)->nameOffset]);
+}
+
+static bool INDEX_Grow(void **const array, uint32_t *const maxElement, const uint32_t sumElement, const size_t sizeOfElement)
+{
+    bool status = true; /*return value */
+    void *newArray = NULL;
+    uint32_t newMax = 0;
+
+    if (sumElement > *maxElement)
+    {
+        newMax = (0 == *maxElement) ? 64u : *maxElement;
+        while (newMax < sumElement)
+        {
+            newMax *= 2u;
+        }
+        newArray = STATS_Realloc(*array, (size_t)newMax * sizeOfElement);
+        if (NULL != newArray)
+        {
+            *array = newArray;
+            *maxElement = newMax;
+        }
+        else
+        {
+            status = false;
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,122 @@
+#ifndef __INDEX_H__
+#define __INDEX_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Value returned by INDEX_Lookup when the path does not exist
+ */
+#define INDEX_NOT_FOUND (0xffffffffu)
+
+/*
+ *Header of the index file. All records of the file are little endian with fixed size,
+ *so the file can be mapped in memory and used without parsing
+ */
+typedef struct
+{
+    uint8_t magic[8];           /*"FATIDX01"*/
+    uint32_t version;           /*Version of the format*/
+    uint32_t sizeOfHeader;      /*sizeof(INDEX_Header_Struct_t)*/
+    uint64_t sizeOfImage;       /*Size in bytes of the image*/
+    uint64_t timeOfImage;       /*Last modification of the image (nanoseconds since 1970)*/
+    uint32_t checkSumOfBoot;    /*CRC32C of the boot sector*/
+    uint8_t fatType;            /*12, 16 or 32*/
+    uint8_t sectorPerCluster;   /*Number of sectors per cluster*/
+    uint16_t bytePerSector;     /*Number of bytes per sector*/
+    uint32_t locationOfData;    /*Location of the first sector of data region*/
+    uint32_t sumNode;           /*Number of nodes (node 0 is the root directory)*/
+    uint32_t sumExtent;         /*Number of extents*/
+    uint32_t sizeOfNames;       /*Size in bytes of the names (each name ends with '\0')*/
+    uint64_t offsetOfNode;      /*Byte offset of the nodes in the index file*/
+    uint64_t offsetOfExtent;    /*Byte offset of the extents in the index file*/
+    uint64_t offsetOfNames;     /*Byte offset of the names in the index file*/
+} INDEX_Header_Struct_t;
+
+/*
+ *One file or folder. Children of a folder are consecutive nodes sorted by name (ignoring case)
+ */
+typedef struct
+{
+    uint32_t parent;       /*Node of the parent folder (0 for the root)*/
+    uint32_t firstChild;   /*First child node (folders only)*/
+    uint32_t sumChild;     /*Number of children (folders only, "." and ".." are not stored)*/
+    uint32_t nameOffset;   /*Offset of the name in the names*/
+    uint32_t fileSize;     /*Size of file*/
+    uint32_t firstCluster; /*First cluster (0 for an empty file or the root of fat 12/16)*/
+    uint32_t firstExtent;  /*First extent of the cluster chain*/
+    uint32_t sumExtent;    /*Number of extents of the cluster chain*/
+    uint32_t lastModified; /*Last modified date (high 16 bits) and time (low 16 bits) in FAT format*/
+    uint8_t attributes;    /*Attributes of the entry*/
+    uint8_t reserved[3];
+} INDEX_Node_Struct_t;
+
+/*
+ *Run of contiguous clusters
+ */
+typedef struct
+{
+    uint32_t startCluster; /*First cluster of the run*/
+    uint32_t sumCluster;   /*Number of clusters of the run*/
+} INDEX_Extent_Struct_t;
+
+/*
+ *Index file mapped in memory
+ */
+typedef struct
+{
+    uint8_t *base;                        /*Start of the mapping*/
+    size_t size;                          /*Size of the mapping*/
+    const INDEX_Header_Struct_t *header;  /*Header*/
+    const INDEX_Node_Struct_t *node;      /*Array of nodes*/
+    const INDEX_Extent_Struct_t *extent;  /*Array of extents*/
+    const uint8_t *names;                 /*Names*/
+} INDEX_Handle_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  INDEX_Build
+ * @brief Walk the whole volume and write the index file. The volume must be mounted with FATFS_Init
+ * @param[in] imagePath   Path of the image (used to compute the check sums)
+ * @param[in] indexPath   Path of the index file to write
+ * @return bool Returns true if success
+ */
+bool INDEX_Build(const uint8_t *const imagePath, const uint8_t *const indexPath);
+
+/**  INDEX_Open
+ * @brief Map an index file, check its records and that it still matches the image (size, modification time and boot sector).
+ *        Every write to the image changes its modification time, so the FAT is not read
+ * @param[out] handle   Index mapped in memory
+ * @param[in] imagePath   Path of the image
+ * @param[in] indexPath   Path of the index file
+ * @return bool Returns false if the index is missing, damaged or out of date
+ */
+bool INDEX_Open(INDEX_Handle_Struct_t *const handle, const uint8_t *const imagePath, const uint8_t *const indexPath);
+
+/**  INDEX_Lookup
+ * @brief Find a node from its path ("/folder/file.txt"), ignoring case
+ * @param[in] handle   Index
+ * @param[in] path   Path from the root directory
+ * @return uint32_t Returns the node or INDEX_NOT_FOUND
+ */
+uint32_t INDEX_Lookup(const INDEX_Handle_Struct_t *const handle, const uint8_t *const path);
+
+/**  INDEX_GetName
+ * @brief Get the name of a node
+ * @param[in] handle   Index
+ * @param[in] node   Node
+ * @return const uint8_t* Returns the name (long name if there is one)
+ */
+const uint8_t *INDEX_GetName(const INDEX_Handle_Struct_t *const handle, const uint32_t node);
+
+/**  INDEX_Close
+ * @brief Unmap the index file
+ * @param[in,out] handle   Index
+ * @return none
+ */
+void INDEX_Close(INDEX_Handle_Struct_t *const handle);
+
+#endif /*__INDEX_H__*/
@@ -8,13 +8,21 @@
  ******************************************************************************/
 
 /**
- * @brief  The entry point.
+ * @brief  The entry point. Without argument the interactive menu is started
  *  @return int
  */
-int main(void)
+int main(int argc, char *argv[])
 {
+    int exitCode = 0;
 
-    APP_MainMenu();
+    if (1 < argc)
+    {
+        exitCode = APP_CommandLine(argc, argv);
+    }
+    else
+    {
+        APP_MainMenu();
+    }
 
-    return 0;
+    return exitCode;
 }
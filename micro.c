@@ -0,0 +1,415 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "fatfs.h"
+#include "mkfs.h"
+#include "bench.h"
+#include "stats.h"
+#include "micro.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Main entries decoded by one iteration of main_entry_decode
+ */
+#define MICRO_SUM_ENTRY (4096u)
+#define MICRO_SIZE_ENTRY (32u)
+
+/*
+ *Size of the generated files : chains of several clusters, written in 4 pieces
+ */
+#define MICRO_FILE_SIZE (16u * 1024u)
+#define MICRO_SUM_FRAGMENT (4u)
+
+/*
+ *Size of the generated image
+ */
+#define MICRO_SIZE_FAT12 (4u * 1024u * 1024u)
+#define MICRO_SIZE_FAT16_32 (64u * 1024u * 1024u)
+
+/*
+ *Folders under the root : enough for the fixed root of fat 12/16 (512 slots) to hold its share of files with long names
+ */
+#define MICRO_SUM_FOLDER (32u)
+
+/*
+ *Routines, in the order they run
+ */
+typedef enum
+{
+    MICRO_FAT_UNPACK = 0,
+    MICRO_MAIN_ENTRY,
+    MICRO_FOLDER_PARSE,
+    MICRO_CHAIN_FOLLOW,
+    MICRO_SUM_ROUTINE
+} MICRO_Routine_Enum_t;
+
+/*
+ *Inputs of the routines, all in memory
+ */
+typedef struct
+{
+    uint8_t *image;          /*Whole image*/
+    uint64_t sizeOfImage;
+    uint8_t *entries;        /*MICRO_SUM_ENTRY main entries*/
+    uint32_t *folders;       /*First cluster of every folder (0 : root)*/
+    uint32_t sumFolder;
+    uint32_t *files;         /*First cluster of every file*/
+    uint32_t sumFile;
+    uint32_t sumElementOfFat;
+    uint64_t sink;           /*Keeps the results used so the compiler does not remove the routines*/
+} MICRO_Data_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static const char *const s_NameOfRoutine[MICRO_SUM_ROUTINE] = {"fat_unpack", "main_entry_decode", "folder_parse_lfn", "chain_follow"};
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  MICRO_GetTime
+ * @brief Read the monotonic clock
+ * @return double Time in seconds
+ */
+static double MICRO_GetTime(void);
+
+/**  MICRO_GetCycle
+ * @brief Read the time stamp counter of the CPU
+ * @return uint64_t Cycles (0 if the CPU has no counter that can be read)
+ */
+static uint64_t MICRO_GetCycle(void);
+
+/**  MICRO_Prepare
+ * @brief Generate the image, read it into memory and list its folders and files
+ * @param[in] fatType   FAT type
+ * @param[in] sumFile   Files of the image
+ * @param[out] data   Inputs of the routines (released with MICRO_Release)
+ * @return bool Returns true if success
+ */
+static bool MICRO_Prepare(const uint8_t fatType, const uint32_t sumFile, MICRO_Data_Struct_t *const data);
+
+/**  MICRO_Release
+ * @brief Release the inputs of the routines
+ * @param[in,out] data   Inputs
+ * @return none
+ */
+static void MICRO_Release(MICRO_Data_Struct_t *const data);
+
+/**  MICRO_RunOnce
+ * @brief Run one iteration of a routine (the image is mounted except for MICRO_FAT_UNPACK)
+ * @param[in] routine   Routine
+ * @param[in,out] data   Inputs
+ * @return uint32_t Returns the number of items processed (FAT elements, entries or clusters)
+ */
+static uint32_t MICRO_RunOnce(const MICRO_Routine_Enum_t routine, MICRO_Data_Struct_t *const data);
+
+/**  MICRO_CompareTime
+ * @brief Order times, shortest first (used by qsort)
+ * @param[in] first time
+ * @param[in] second time
+ * @return int Returns the order
+ */
+static int MICRO_CompareTime(const void *first, const void *second);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool MICRO_Run(const uint8_t fatType, const uint32_t sumFile, const uint32_t sumIteration)
+{
+    bool status = true; /*return value */
+    MICRO_Data_Struct_t data;
+    FATFS_VolumeInfo_Struct_t info;
+    double *times = NULL;
+    double start = 0;
+    double median = 0;
+    uint64_t startCycle = 0;
+    uint64_t sumCycle = 0;
+    uint64_t sumAllocation = 0;
+    uint64_t counters[STATS_SUM_COUNTER];
+    uint32_t sumItem = 0;
+    uint32_t routine = 0;
+    uint32_t i = 0;
+
+    times = (double *)malloc(((0 != sumIteration) ? sumIteration : 1u) * sizeof(double));
+    status = (NULL != times) && (0 != sumIteration) && (true == MICRO_Prepare(fatType, sumFile, &data));
+    if (true == status)
+    {
+        status = FATFS_InitMemory(data.image, data.sizeOfImage);
+        FATFS_GetVolumeInfo(&info);
+        FATFS_DeInit();
+    }
+
+    if (true == status)
+    {
+        printf("{\n  \"fat\": %u,\n  \"cluster\": %u,\n  \"files\": %u,\n  \"folders\": %u,\n  \"iterations\": %u,\n  \"results\": [",
+               info.fatType, (uint32_t)info.bytePerSector * info.sectorPerCluster, data.sumFile, data.sumFolder, sumIteration);
+    }
+    for (routine = 0; (true == status) && (routine < MICRO_SUM_ROUTINE); routine++)
+    {
+        /*The unpack routine is the mount itself*/
+        if (MICRO_MAIN_ENTRY == routine)
+        {
+            status = FATFS_InitMemory(data.image, data.sizeOfImage);
+        }
+        (void)MICRO_RunOnce((MICRO_Routine_Enum_t)routine, &data); /*Warm up caches and branch predictors*/
+        sumCycle = 0;
+        for (i = 0; (true == status) && (i < sumIteration); i++)
+        {
+            /*Allocations are counted by STATS_Malloc, STATS_Calloc, STATS_Realloc and HAL_AllocBuffer*/
+            STATS_Get(counters);
+            sumAllocation = counters[STATS_ALLOCATION];
+            startCycle = MICRO_GetCycle();
+            start = MICRO_GetTime();
+            sumItem = MICRO_RunOnce((MICRO_Routine_Enum_t)routine, &data);
+            times[i] = MICRO_GetTime() - start;
+            sumCycle += MICRO_GetCycle() - startCycle;
+            STATS_Get(counters);
+            sumAllocation = counters[STATS_ALLOCATION] - sumAllocation;
+        }
+        if (true == status)
+        {
+            qsort(times, sumIteration, sizeof(double), MICRO_CompareTime);
+            median = times[sumIteration / 2u];
+            printf("%s\n    {\"name\": \"%s\", \"items\": %u, \"median_seconds\": %.9f, \"ns_per_item\": %.3f, \"cycles_per_item\": %.2f, \"allocations_per_iteration\": %llu}",
+                   (0 == routine) ? "" : ",", s_NameOfRoutine[routine], sumItem, median, (0 != sumItem) ? (median * 1e9 / sumItem) : 0.0,
+                   (0 != sumItem) ? ((double)sumCycle / sumIteration / sumItem) : 0.0, (unsigned long long)sumAllocation);
+        }
+    }
+    if (true == status)
+    {
+        FATFS_DeInit();
+        printf("\n  ],\n  \"sink\": %llu\n}\n", (unsigned long long)(data.sink & 0xffu));
+        MICRO_Release(&data);
+    }
+    free(times);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static double MICRO_GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static uint64_t MICRO_GetCycle(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static bool MICRO_Prepare(const uint8_t fatType, const uint32_t sumFile, MICRO_Data_Struct_t *const data)
+{
+    bool status = true; /*return value */
+    BENCH_Shape_Struct_t shape;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *entry = NULL;
+    char temporaryPath[] = "/tmp/fatmicro.XXXXXX";
+    struct stat imageStat;
+    uint8_t *slot = NULL;
+    ssize_t sizeOfRead = 0;
+    uint64_t sumByte = 0;
+    uint32_t i = 0;
+    int fileDescriptor = -1;
+
+    memset(data, 0, sizeof(MICRO_Data_Struct_t));
+    BENCH_InitShape(&shape);
+    MKFS_InitOptions(&shape.volume, (12u == fatType) ? MICRO_SIZE_FAT12 : MICRO_SIZE_FAT16_32);
+    shape.volume.fatType = fatType;
+    shape.sumFile = sumFile;
+    shape.depth = 1u;
+    shape.width = MICRO_SUM_FOLDER;
+    shape.sizeOfFile = MICRO_FILE_SIZE;
+    shape.sumFragment = MICRO_SUM_FRAGMENT;
+    shape.isLongName = true;
+
+    /*Generated in a file, then only memory is used*/
+    fileDescriptor = mkstemp(temporaryPath);
+    status = (0 <= fileDescriptor);
+    if (true == status)
+    {
+        close(fileDescriptor);
+        status = (true == BENCH_Generate((const uint8_t *)temporaryPath, &shape)) && (0 == stat(temporaryPath, &imageStat));
+        fileDescriptor = (true == status) ? open(temporaryPath, O_RDONLY) : -1;
+        unlink(temporaryPath);
+        data->sizeOfImage = (uint64_t)imageStat.st_size;
+        data->image = (true == status) ? (uint8_t *)malloc((size_t)data->sizeOfImage) : NULL;
+        status = (0 <= fileDescriptor) && (NULL != data->image);
+    }
+    while ((true == status) && (sumByte < data->sizeOfImage))
+    {
+        sizeOfRead = read(fileDescriptor, &data->image[sumByte], (size_t)(data->sizeOfImage - sumByte));
+        status = (0 < sizeOfRead);
+        sumByte += (true == status) ? (uint64_t)sizeOfRead : 0u;
+    }
+    if (0 <= fileDescriptor)
+    {
+        close(fileDescriptor);
+    }
+
+    /*Folders and files : the root, then the folders in the order they are found*/
+    if (true == status)
+    {
+        data->folders = (uint32_t *)malloc((shape.width + 1u) * sizeof(uint32_t));
+        data->files = (uint32_t *)malloc((sumFile + 1u) * sizeof(uint32_t));
+        data->entries = (uint8_t *)calloc(MICRO_SUM_ENTRY, MICRO_SIZE_ENTRY);
+        status = (NULL != data->folders) && (NULL != data->files) && (NULL != data->entries) && (true == FATFS_InitMemory(data->image, data->sizeOfImage));
+        data->sumFolder = 1;
+        data->folders[0] = 0;
+    }
+    for (i = 0; (true == status) && (i < data->sumFolder); i++)
+    {
+        if (true == FATFS_DirOpen(&dir, data->folders[i]))
+        {
+            for (entry = FATFS_DirNext(&dir); NULL != entry; entry = FATFS_DirNext(&dir))
+            {
+                if (('.' == entry->shortFileName[0]) || (0xe5u == entry->shortFileName[0]))
+                {
+                    /*Do nothing*/
+                }
+                else if ((0 != (entry->attributes & FATFS_ATTRIBUTE_DIRECTORY)) && (data->sumFolder <= shape.width))
+                {
+                    data->folders[data->sumFolder++] = entry->firstCluster;
+                }
+                else if ((0 == (entry->attributes & FATFS_ATTRIBUTE_DIRECTORY)) && (data->sumFile < sumFile))
+                {
+                    data->files[data->sumFile++] = entry->firstCluster;
+                }
+                else
+                {
+                    /*Do nothing*/
+                }
+            }
+            FATFS_DirClose(&dir);
+        }
+    }
+    if (true == status)
+    {
+        data->sumElementOfFat = 0;
+        FATFS_DeInit();
+        /*Short names "FILE0001BIN", archive attribute, dates, clusters and sizes*/
+        for (i = 0; i < MICRO_SUM_ENTRY; i++)
+        {
+            slot = &data->entries[i * MICRO_SIZE_ENTRY];
+            snprintf((char *)slot, 12u, "FILE%04uBIN", i % 10000u);
+            slot[11] = 0x20u;
+            slot[16] = 0x21u;
+            slot[17] = 0x5au;
+            slot[24] = 0x21u;
+            slot[25] = 0x5au;
+            slot[26] = (uint8_t)(i + 3u);
+            slot[27] = (uint8_t)((i + 3u) >> 8u);
+            slot[28] = (uint8_t)i;
+            slot[29] = 0x10u;
+        }
+    }
+    else
+    {
+        MICRO_Release(data);
+    }
+
+    return status;
+}
+
+static void MICRO_Release(MICRO_Data_Struct_t *const data)
+{
+    free(data->image);
+    free(data->entries);
+    free(data->folders);
+    free(data->files);
+    memset(data, 0, sizeof(MICRO_Data_Struct_t));
+}
+
+static uint32_t MICRO_RunOnce(const MICRO_Routine_Enum_t routine, MICRO_Data_Struct_t *const data)
+{
+    uint32_t sumItem = 0; /*return value */
+    FATFS_VolumeInfo_Struct_t info;
+    FATFS_Entry_Struct_t entry;
+    FATFS_Dir_Struct_t dir;
+    uint32_t cluster = 0;
+    uint32_t i = 0;
+
+    switch (routine)
+    {
+    case MICRO_FAT_UNPACK:
+        if (true == FATFS_InitMemory(data->image, data->sizeOfImage))
+        {
+            FATFS_GetVolumeInfo(&info);
+            sumItem = info.totalClusters + 2u;
+            FATFS_DeInit();
+        }
+        break;
+    case MICRO_MAIN_ENTRY:
+        for (i = 0; i < MICRO_SUM_ENTRY; i++)
+        {
+            (void)FATFS_DecodeEntry(&data->entries[i * MICRO_SIZE_ENTRY], &entry);
+            data->sink += entry.fileSize + entry.lastModDate.day;
+        }
+        sumItem = MICRO_SUM_ENTRY;
+        break;
+    case MICRO_FOLDER_PARSE:
+        for (i = 0; i < data->sumFolder; i++)
+        {
+            if (true == FATFS_DirOpen(&dir, data->folders[i]))
+            {
+                while (NULL != FATFS_DirNext(&dir))
+                {
+                    sumItem++;
+                }
+                data->sink += dir.entry.longFileName[0];
+                FATFS_DirClose(&dir);
+            }
+        }
+        break;
+    default:
+        for (i = 0; i < data->sumFile; i++)
+        {
+            cluster = data->files[i];
+            sumItem++;
+            while ((true == FATFS_GetNextCluster(cluster, &cluster)) && (sumItem < 0xffffffffu))
+            {
+                sumItem++;
+            }
+        }
+        break;
+    }
+
+    return sumItem;
+}
+
+static int MICRO_CompareTime(const void *first, const void *second)
+{
+    const double firstTime = *(const double *)first;
+    const double secondTime = *(const double *)second;
+
+    return (firstTime > secondTime) - (firstTime < secondTime);
+}
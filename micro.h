@@ -0,0 +1,20 @@
+#ifndef __MICRO_H__
+#define __MICRO_H__
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  MICRO_Run
+ * @brief Time the inner routines of fatfs on an image held in memory (FATFS_InitMemory, no file I/O) :
+ *        FAT unpack of the mount, decode of main entries, folder parse with long file names, chain following.
+ *        The image is generated (BENCH_Generate into a temporary file read back and removed).
+ *        Results (ns and cycles per item, allocations of the volume modules per iteration) are printed on stdout as JSON
+ * @param[in] fatType   FAT type of the generated image (12, 16 or 32)
+ * @param[in] sumFile   Files of the generated image
+ * @param[in] sumIteration   Timed iterations of each routine (the median is printed)
+ * @return bool Returns false if the image could not be generated or mounted
+ */
+bool MICRO_Run(const uint8_t fatType, const uint32_t sumFile, const uint32_t sumIteration);
+
+#endif /*__MICRO_H__*/
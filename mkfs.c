@@ -0,0 +1,404 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _FILE_OFFSET_BITS 64
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "stats.h"
+#include "mkfs.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Number of clusters allowed for each FAT type
+ */
+#define MKFS_FAT12_MAX_CLUSTER (4084u)
+#define MKFS_FAT16_MAX_CLUSTER (65524u)
+#define MKFS_FAT32_MAX_CLUSTER (0x0ffffff5u)
+
+/*
+ *Sizes choosing the FAT type and the cluster size when they are not given
+ */
+#define MKFS_FAT12_MAX_SIZE (16u * 1024u * 1024u)
+#define MKFS_FAT16_MAX_SIZE (512u * 1024u * 1024u)
+#define MKFS_FLOPPY_SIZE (1474560u)
+#define MKFS_MAX_BYTE_PER_CLUSTER (65536u)
+
+/*
+ *Reserved sectors
+ */
+#define MKFS_RESERVED_FAT12_16 (1u)
+#define MKFS_RESERVED_FAT32 (32u)
+#define MKFS_FS_INFO_SECTOR (1u)
+#define MKFS_BACKUP_BOOT_SECTOR (6u)
+#define MKFS_SUM_BOOT_SECTOR (8u) /*Sectors written at the start of fat 32 : boot, FSInfo and their backups*/
+
+/*
+ *Boot sector
+ */
+#define MKFS_BYTE_PER_SECTOR_OFFSET (11u)
+#define MKFS_SECTOR_PER_CLUSTER_OFFSET (13u)
+#define MKFS_NUMBER_RESERVED_SECTORS_OFFSET (14u)
+#define MKFS_NUMBER_FAT_OFFSET (16u)
+#define MKFS_NUMBER_ENTRY_OFFSET (17u)
+#define MKFS_TOTAL_SECTORS_OFFSET (19u)
+#define MKFS_MEDIA_OFFSET (21u)
+#define MKFS_SECTOR_PER_FAT_12_16_OFFSET (22u)
+#define MKFS_SECTOR_PER_TRACK_OFFSET (24u)
+#define MKFS_NUMBER_HEAD_OFFSET (26u)
+#define MKFS_TOTAL_SECTORS_32_OFFSET (32u)
+#define MKFS_SECTOR_PER_FAT_32_OFFSET (36u)
+#define MKFS_ROOT_CLUSTER_OFFSET (44u)
+#define MKFS_FS_INFO_SECTOR_OFFSET (48u)
+#define MKFS_BACKUP_BOOT_SECTOR_OFFSET (50u)
+#define MKFS_EXTENDED_12_16_OFFSET (36u) /*Drive number, boot signature, volume id, label, type*/
+#define MKFS_EXTENDED_32_OFFSET (64u)
+#define MKFS_BOOT_SIGNATURE (0x29u)
+#define MKFS_MEDIA_FIXED (0xf8u)
+#define MKFS_MEDIA_FLOPPY (0xf0u)
+
+/*
+ *FSInfo sector
+ */
+#define MKFS_FS_INFO_LEAD_SIGNATURE (0x41615252u)
+#define MKFS_FS_INFO_STRUCT_SIGNATURE (0x61417272u)
+#define MKFS_FS_INFO_STRUCT_SIGNATURE_OFFSET (484u)
+#define MKFS_FS_INFO_FREE_COUNT_OFFSET (488u)
+#define MKFS_FS_INFO_NEXT_FREE_OFFSET (492u)
+#define MKFS_FS_INFO_TRAIL_SIGNATURE (0xaa550000u)
+#define MKFS_FS_INFO_TRAIL_SIGNATURE_OFFSET (508u)
+
+#define MKFS_SIZE_LABEL (11u)
+#define MKFS_ATTRIBUTE_VOLUME_LABEL (0x08u)
+#define MKFS_ATTRIBUTE_OFFSET (11u)
+
+#define MKFS_PUT_2_BYTES(x, value)                   \
+    do                                               \
+    {                                                \
+        (x)[0] = (uint8_t)(value);                   \
+        (x)[1] = (uint8_t)((uint32_t)(value) >> 8u); \
+    } while (0)
+#define MKFS_PUT_4_BYTES(x, value)                            \
+    do                                                        \
+    {                                                         \
+        MKFS_PUT_2_BYTES((x), (value));                       \
+        MKFS_PUT_2_BYTES(&(x)[2], (uint32_t)(value) >> 16u);  \
+    } while (0)
+
+/*
+ *Layout of the new volume (in sectors)
+ */
+typedef struct
+{
+    uint8_t fatType;
+    uint32_t bytePerSector;
+    uint32_t sectorPerCluster;
+    uint32_t numberOfFat;
+    uint32_t sumEntryOfRoot;   /*0 for fat 32*/
+    uint32_t sumReserved;      /*Sectors before the first FAT*/
+    uint32_t sectorPerFat;
+    uint32_t sumSectorOfRoot;  /*Root region of fat 12/16*/
+    uint32_t totalSectors;
+    uint32_t totalClusters;
+} MKFS_Geometry_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  MKFS_ComputeGeometry
+ * @brief Find the size of the FAT (and the reserved sectors keeping the data region aligned on clusters)
+ * @param[in] options geometry asked
+ * @param[out] geometry layout
+ * @return bool Returns false if the number of clusters does not fit the FAT type
+ */
+static bool MKFS_ComputeGeometry(const MKFS_Options_Struct_t *const options, MKFS_Geometry_Struct_t *const geometry);
+
+/**  MKFS_WriteAt
+ * @brief Write a buffer at an offset of the image
+ * @param[in] fileDescriptor image
+ * @param[in] offset offset in bytes
+ * @param[in] buffer data
+ * @param[in] size size of data
+ * @return bool Returns true if everything was written
+ */
+static bool MKFS_WriteAt(const int fileDescriptor, const uint64_t offset, const uint8_t *const buffer, const uint32_t size);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+void MKFS_InitOptions(MKFS_Options_Struct_t *const options, const uint64_t sizeOfVolume)
+{
+    memset(options, 0, sizeof(MKFS_Options_Struct_t));
+    options->sizeOfVolume = sizeOfVolume;
+    options->bytePerSector = 512;
+    options->numberOfFat = 2;
+}
+
+bool MKFS_Format(const uint8_t *const imagePath, const MKFS_Options_Struct_t *const options)
+{
+    bool status = true; /*return value */
+    MKFS_Geometry_Struct_t geometry;
+    uint8_t *buffer = NULL;
+    uint8_t *boot = NULL;
+    uint8_t *extended = NULL; /*Extended boot record (after the fields of fat 32)*/
+    uint8_t label[MKFS_SIZE_LABEL];
+    const uint32_t volumeId = (uint32_t)time(NULL);
+    const bool isFloppy = (MKFS_FLOPPY_SIZE == options->sizeOfVolume);
+    int fileDescriptor = -1;
+    uint32_t i = 0;
+
+    status = MKFS_ComputeGeometry(options, &geometry);
+    if (true == status)
+    {
+        buffer = (uint8_t *)STATS_Calloc(MKFS_SUM_BOOT_SECTOR, geometry.bytePerSector);
+        fileDescriptor = open((const char *)imagePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        /*The whole image is a hole : only the sectors below are written*/
+        status = (NULL != buffer) && (0 <= fileDescriptor) &&
+                 (0 == ftruncate(fileDescriptor, (off_t)geometry.totalSectors * geometry.bytePerSector));
+    }
+
+    if (true == status)
+    {
+        memset(label, ' ', MKFS_SIZE_LABEL);
+        if (0 == options->label[0])
+        {
+            memcpy(label, "NO NAME", 7u);
+        }
+        for (i = 0; (i < MKFS_SIZE_LABEL) && (0 != options->label[i]); i++)
+        {
+            label[i] = (('a' <= options->label[i]) && ('z' >= options->label[i])) ? (uint8_t)(options->label[i] - ('a' - 'A')) : options->label[i];
+        }
+
+        /*Boot sector*/
+        boot = buffer;
+        boot[0] = 0xeb;
+        boot[1] = (32u == geometry.fatType) ? 0x58u : 0x3cu;
+        boot[2] = 0x90;
+        memcpy(&boot[3], "MSWIN4.1", 8u);
+        MKFS_PUT_2_BYTES(&boot[MKFS_BYTE_PER_SECTOR_OFFSET], geometry.bytePerSector);
+        boot[MKFS_SECTOR_PER_CLUSTER_OFFSET] = (uint8_t)geometry.sectorPerCluster;
+        MKFS_PUT_2_BYTES(&boot[MKFS_NUMBER_RESERVED_SECTORS_OFFSET], geometry.sumReserved);
+        boot[MKFS_NUMBER_FAT_OFFSET] = (uint8_t)geometry.numberOfFat;
+        MKFS_PUT_2_BYTES(&boot[MKFS_NUMBER_ENTRY_OFFSET], geometry.sumEntryOfRoot);
+        boot[MKFS_MEDIA_OFFSET] = (true == isFloppy) ? MKFS_MEDIA_FLOPPY : MKFS_MEDIA_FIXED;
+        MKFS_PUT_2_BYTES(&boot[MKFS_SECTOR_PER_TRACK_OFFSET], (true == isFloppy) ? 18u : 63u);
+        MKFS_PUT_2_BYTES(&boot[MKFS_NUMBER_HEAD_OFFSET], (true == isFloppy) ? 2u : 255u);
+        if ((32u != geometry.fatType) && (0x10000u > geometry.totalSectors))
+        {
+            MKFS_PUT_2_BYTES(&boot[MKFS_TOTAL_SECTORS_OFFSET], geometry.totalSectors);
+        }
+        else
+        {
+            MKFS_PUT_4_BYTES(&boot[MKFS_TOTAL_SECTORS_32_OFFSET], geometry.totalSectors);
+        }
+        if (32u == geometry.fatType)
+        {
+            MKFS_PUT_4_BYTES(&boot[MKFS_SECTOR_PER_FAT_32_OFFSET], geometry.sectorPerFat);
+            MKFS_PUT_4_BYTES(&boot[MKFS_ROOT_CLUSTER_OFFSET], 2u);
+            MKFS_PUT_2_BYTES(&boot[MKFS_FS_INFO_SECTOR_OFFSET], MKFS_FS_INFO_SECTOR);
+            MKFS_PUT_2_BYTES(&boot[MKFS_BACKUP_BOOT_SECTOR_OFFSET], MKFS_BACKUP_BOOT_SECTOR);
+            extended = &boot[MKFS_EXTENDED_32_OFFSET];
+        }
+        else
+        {
+            MKFS_PUT_2_BYTES(&boot[MKFS_SECTOR_PER_FAT_12_16_OFFSET], geometry.sectorPerFat);
+            extended = &boot[MKFS_EXTENDED_12_16_OFFSET];
+        }
+        extended[0] = (true == isFloppy) ? 0x00u : 0x80u; /*Drive number*/
+        extended[2] = MKFS_BOOT_SIGNATURE;
+        MKFS_PUT_4_BYTES(&extended[3], volumeId);
+        memcpy(&extended[7], label, MKFS_SIZE_LABEL);
+        memcpy(&extended[18], (12u == geometry.fatType) ? "FAT12   " : ((16u == geometry.fatType) ? "FAT16   " : "FAT32   "), 8u);
+        boot[510] = 0x55;
+        boot[511] = 0xaa;
+
+        if (32u == geometry.fatType)
+        {
+            /*FSInfo : every cluster is free except the root*/
+            MKFS_PUT_4_BYTES(&buffer[geometry.bytePerSector], MKFS_FS_INFO_LEAD_SIGNATURE);
+            MKFS_PUT_4_BYTES(&buffer[geometry.bytePerSector + MKFS_FS_INFO_STRUCT_SIGNATURE_OFFSET], MKFS_FS_INFO_STRUCT_SIGNATURE);
+            MKFS_PUT_4_BYTES(&buffer[geometry.bytePerSector + MKFS_FS_INFO_FREE_COUNT_OFFSET], geometry.totalClusters - 1u);
+            MKFS_PUT_4_BYTES(&buffer[geometry.bytePerSector + MKFS_FS_INFO_NEXT_FREE_OFFSET], 3u);
+            MKFS_PUT_4_BYTES(&buffer[geometry.bytePerSector + MKFS_FS_INFO_TRAIL_SIGNATURE_OFFSET], MKFS_FS_INFO_TRAIL_SIGNATURE);
+            /*Backup of both sectors*/
+            memcpy(&buffer[MKFS_BACKUP_BOOT_SECTOR * geometry.bytePerSector], buffer, 2u * geometry.bytePerSector);
+            status = MKFS_WriteAt(fileDescriptor, 0, buffer, MKFS_SUM_BOOT_SECTOR * geometry.bytePerSector);
+        }
+        else
+        {
+            status = MKFS_WriteAt(fileDescriptor, 0, buffer, geometry.bytePerSector);
+        }
+    }
+
+    if (true == status)
+    {
+        /*First sector of every FAT : media byte, end of chain marker of element 1 (and the root cluster of fat 32)*/
+        memset(buffer, 0, geometry.bytePerSector);
+        buffer[0] = (true == isFloppy) ? MKFS_MEDIA_FLOPPY : MKFS_MEDIA_FIXED;
+        buffer[1] = 0xff;
+        buffer[2] = 0xff;
+        if (16u <= geometry.fatType)
+        {
+            buffer[3] = 0xff;
+        }
+        if (32u == geometry.fatType)
+        {
+            MKFS_PUT_4_BYTES(&buffer[0], 0x0fffff00u | buffer[0]);
+            MKFS_PUT_4_BYTES(&buffer[4], 0x0fffffffu);
+            MKFS_PUT_4_BYTES(&buffer[8], 0x0fffffffu);
+        }
+        for (i = 0; (true == status) && (i < geometry.numberOfFat); i++)
+        {
+            status = MKFS_WriteAt(fileDescriptor, (uint64_t)(geometry.sumReserved + i * geometry.sectorPerFat) * geometry.bytePerSector, buffer, geometry.bytePerSector);
+        }
+    }
+
+    if ((true == status) && (0 != options->label[0]))
+    {
+        /*Label entry, first entry of the root*/
+        memset(buffer, 0, geometry.bytePerSector);
+        memcpy(buffer, label, MKFS_SIZE_LABEL);
+        buffer[MKFS_ATTRIBUTE_OFFSET] = MKFS_ATTRIBUTE_VOLUME_LABEL;
+        status = MKFS_WriteAt(fileDescriptor, (uint64_t)(geometry.sumReserved + geometry.numberOfFat * geometry.sectorPerFat) * geometry.bytePerSector, buffer, geometry.bytePerSector);
+    }
+
+    if (0 <= fileDescriptor)
+    {
+        status = (0 == close(fileDescriptor)) && (true == status);
+    }
+    free(buffer);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static bool MKFS_ComputeGeometry(const MKFS_Options_Struct_t *const options, MKFS_Geometry_Struct_t *const geometry)
+{
+    bool status = true; /*return value */
+    const uint64_t size = options->sizeOfVolume;
+    uint64_t sumByteOfFat = 0;
+    uint32_t sectorOfData = 0;
+    uint32_t maxCluster = 0;
+    uint32_t i = 0;
+
+    memset(geometry, 0, sizeof(MKFS_Geometry_Struct_t));
+    geometry->bytePerSector = options->bytePerSector;
+    geometry->numberOfFat = options->numberOfFat;
+    geometry->fatType = options->fatType;
+    if (0 == geometry->fatType)
+    {
+        geometry->fatType = (MKFS_FAT12_MAX_SIZE >= size) ? 12u : ((MKFS_FAT16_MAX_SIZE >= size) ? 16u : 32u);
+    }
+    status = ((512u == geometry->bytePerSector) || (1024u == geometry->bytePerSector) || (2048u == geometry->bytePerSector) || (4096u == geometry->bytePerSector)) &&
+             ((1u == geometry->numberOfFat) || (2u == geometry->numberOfFat)) &&
+             ((12u == geometry->fatType) || (16u == geometry->fatType) || (32u == geometry->fatType)) &&
+             ((size / geometry->bytePerSector) <= 0xffffffffu);
+
+    if (true == status)
+    {
+        geometry->totalSectors = (uint32_t)(size / geometry->bytePerSector);
+        maxCluster = (12u == geometry->fatType) ? MKFS_FAT12_MAX_CLUSTER : ((16u == geometry->fatType) ? MKFS_FAT16_MAX_CLUSTER : MKFS_FAT32_MAX_CLUSTER);
+        if (32u == geometry->fatType)
+        {
+            geometry->sumEntryOfRoot = 0;
+        }
+        else if (0 != options->sumEntryOfRoot)
+        {
+            geometry->sumEntryOfRoot = options->sumEntryOfRoot;
+        }
+        else
+        {
+            geometry->sumEntryOfRoot = (MKFS_FLOPPY_SIZE == size) ? 224u : 512u;
+        }
+        geometry->sumSectorOfRoot = (geometry->sumEntryOfRoot * 32u + geometry->bytePerSector - 1u) / geometry->bytePerSector;
+
+        geometry->sectorPerCluster = options->sectorPerCluster;
+        if ((0 == geometry->sectorPerCluster) && (32u == geometry->fatType))
+        {
+            /*Cluster sizes used by most formatters*/
+            geometry->sectorPerCluster = (((uint64_t)260u << 20u) >= size) ? 512u : ((((uint64_t)8u << 30u) >= size) ? 4096u : ((((uint64_t)16u << 30u) >= size) ? 8192u : ((((uint64_t)32u << 30u) >= size) ? 16384u : 32768u)));
+            geometry->sectorPerCluster = (geometry->sectorPerCluster > geometry->bytePerSector) ? (geometry->sectorPerCluster / geometry->bytePerSector) : 1u;
+        }
+        else if (0 == geometry->sectorPerCluster)
+        {
+            /*Smallest cluster keeping the number of clusters in range*/
+            geometry->sectorPerCluster = 1;
+            while (((geometry->totalSectors / geometry->sectorPerCluster) > maxCluster) && ((geometry->sectorPerCluster * geometry->bytePerSector) < MKFS_MAX_BYTE_PER_CLUSTER))
+            {
+                geometry->sectorPerCluster *= 2u;
+            }
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+        status = (0 == (geometry->sectorPerCluster & (geometry->sectorPerCluster - 1u))) && (128u >= geometry->sectorPerCluster) &&
+                 (MKFS_MAX_BYTE_PER_CLUSTER >= (geometry->sectorPerCluster * geometry->bytePerSector));
+    }
+
+    /*The size of the FAT depends on the number of clusters and the reverse : repeat until it is large enough*/
+    geometry->sectorPerFat = 1;
+    for (i = 0; (true == status) && (i < 16u); i++)
+    {
+        geometry->sumReserved = (32u == geometry->fatType) ? MKFS_RESERVED_FAT32 : MKFS_RESERVED_FAT12_16;
+        sectorOfData = geometry->sumReserved + geometry->numberOfFat * geometry->sectorPerFat + geometry->sumSectorOfRoot;
+        if (0 != (sectorOfData % geometry->sectorPerCluster))
+        {
+            /*Clusters aligned on their size in the image*/
+            geometry->sumReserved += geometry->sectorPerCluster - (sectorOfData % geometry->sectorPerCluster);
+            sectorOfData += geometry->sectorPerCluster - (sectorOfData % geometry->sectorPerCluster);
+        }
+        status = (sectorOfData < geometry->totalSectors) && (0xffffu >= geometry->sumReserved);
+        if (true == status)
+        {
+            geometry->totalClusters = (geometry->totalSectors - sectorOfData) / geometry->sectorPerCluster;
+            sumByteOfFat = (12u == geometry->fatType) ? ((((uint64_t)geometry->totalClusters + 2u) * 3u + 1u) / 2u) : (((uint64_t)geometry->totalClusters + 2u) * (geometry->fatType / 8u));
+            if (((sumByteOfFat + geometry->bytePerSector - 1u) / geometry->bytePerSector) <= geometry->sectorPerFat)
+            {
+                break;
+            }
+            geometry->sectorPerFat = (uint32_t)((sumByteOfFat + geometry->bytePerSector - 1u) / geometry->bytePerSector);
+        }
+    }
+
+    if (true == status)
+    {
+        /*The FAT type is found from the number of clusters, fat 12 also needs the 16 bits total of sectors*/
+        status = (geometry->totalClusters <= maxCluster) &&
+                 (((12u == geometry->fatType) && (0 != geometry->totalClusters) && (0x10000u > geometry->totalSectors)) ||
+                  ((16u == geometry->fatType) && (MKFS_FAT12_MAX_CLUSTER < geometry->totalClusters)) ||
+                  ((32u == geometry->fatType) && (MKFS_FAT16_MAX_CLUSTER < geometry->totalClusters)));
+    }
+
+    return status;
+}
+
+static bool MKFS_WriteAt(const int fileDescriptor, const uint64_t offset, const uint8_t *const buffer, const uint32_t size)
+{
+    uint32_t sumByte = 0;
+    ssize_t sizeOfWrite = 0;
+
+    while (sumByte < size)
+    {
+        sizeOfWrite = pwrite(fileDescriptor, &buffer[sumByte], size - sumByte, (off_t)(offset + sumByte));
+        if (0 >= sizeOfWrite)
+        {
+            break;
+        }
+        sumByte += (uint32_t)sizeOfWrite;
+    }
+
+    return (sumByte == size);
+}
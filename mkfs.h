@@ -0,0 +1,43 @@
+#ifndef __MKFS_H__
+#define __MKFS_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Geometry of a new volume
+ */
+typedef struct
+{
+    uint64_t sizeOfVolume;    /*Size of the image in bytes*/
+    uint8_t fatType;          /*12, 16, 32 or 0 : chosen from the size*/
+    uint16_t bytePerSector;   /*512, 1024, 2048 or 4096*/
+    uint8_t sectorPerCluster; /*1, 2, 4 ... 128 or 0 : chosen from the size*/
+    uint8_t numberOfFat;      /*1 or 2*/
+    uint16_t sumEntryOfRoot;  /*Entries of the root of fat 12/16 (0 : 224 for a floppy, 512 otherwise)*/
+    uint8_t label[12];        /*Volume label, up to 11 characters ("" : "NO NAME")*/
+} MKFS_Options_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  MKFS_InitOptions
+ * @brief Set the default geometry for a size (FAT type and cluster size chosen from the size, 2 FAT, 512 bytes sectors)
+ * @param[out] options   Geometry
+ * @param[in] sizeOfVolume   Size of the image in bytes
+ * @return none
+ */
+void MKFS_InitOptions(MKFS_Options_Struct_t *const options, const uint64_t sizeOfVolume);
+
+/**  MKFS_Format
+ * @brief Create an empty FAT12/16/32 image. Only the boot sector, FSInfo, the first sectors of every FAT and the
+ *        label are written, the rest of the image is a hole (ftruncate) : the size does not change the time or the disk used
+ * @param[in] imagePath   Path of the image (replaced if it exists)
+ * @param[in] options   Geometry
+ * @return bool Returns false if the geometry is not possible (number of clusters out of the range of the FAT type) or the image could not be written
+ */
+bool MKFS_Format(const uint8_t *const imagePath, const MKFS_Options_Struct_t *const options);
+
+#endif /*__MKFS_H__*/
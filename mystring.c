@@ -22,6 +22,11 @@
 #define MYSTRING_ZERO_ASCII ((uint8_t)48) /*Position character 0 in the ascii*/
 #define MYSTRING_NINE_ASCII ((uint8_t)57) /*/*Position character 9 in the ascii*/
 
+/*
+ * Convert an ASCII letter to upper case
+ */
+#define MYSTRING_TO_UPPER(x) ((((x) >= 'a') && ((x) <= 'z')) ? ((x) - ('a' - 'A')) : (x))
+
 /*
  * Macro that checks if the user entered a string as a positive integer
  */
@@ -52,6 +57,17 @@ static uint8_t MYSTRING_CaculateStringLengthOfUser(const uint8_t *const inputArr
  */
 static bool MYSTRING_IntegerCheck(const uint8_t *const string, const uint8_t sizeOfString);
 
+/**  MYSTRING_MatchCharacter
+ * @brief      Match one character against one element of a pattern ('?', "[set]" or a character)
+ *  @param[in] pattern  pattern
+ *  @param[in] patternLength  number of characters of pattern
+ *  @param[in] position  position of the element in pattern
+ *  @param[in] character  character to match
+ *  @param[out] next  position after the element
+ *  @return bool    Returns true if the character matches
+ */
+static bool MYSTRING_MatchCharacter(const uint8_t *const pattern, const uint32_t patternLength, const uint32_t position, const uint8_t character, uint32_t *const next);
+
 /*******************************************************************************
  * Code
  ******************************************************************************/
@@ -120,10 +136,133 @@ void MYSTRING_MyMemCpy(const uint8_t *const srouce, uint32_t num, uint8_t *const
    }
 }
 
+int32_t MYSTRING_CompareNoCase(const uint8_t *const first, const uint8_t *const second)
+{
+   uint32_t i = 0; /*Index value*/
+
+   while ((MYSTRING_END_STRING != first[i]) && (MYSTRING_TO_UPPER(first[i]) == MYSTRING_TO_UPPER(second[i])))
+   {
+      i++;
+   }
+
+   return (int32_t)MYSTRING_TO_UPPER(first[i]) - (int32_t)MYSTRING_TO_UPPER(second[i]);
+}
+
+bool MYSTRING_WildcardMatch(const uint8_t *const pattern, const uint32_t patternLength, const uint8_t *const string)
+{
+   uint32_t i = 0;                   /*Index of pattern*/
+   uint32_t j = 0;                   /*Index of string*/
+   uint32_t starPattern = 0xffffffffu; /*Position after the last '*' in pattern (none yet)*/
+   uint32_t starString = 0;          /*Position of string when the last '*' was met*/
+   uint32_t endOfSet = 0;            /*Position after the current character of pattern*/
+   bool matched = false;
+
+   while (MYSTRING_END_STRING != string[j])
+   {
+      if ((i < patternLength) && ('*' == pattern[i]))
+      {
+         /*Remember the star, try to match nothing first*/
+         i++;
+         starPattern = i;
+         starString = j;
+         continue;
+      }
+
+      matched = false;
+      endOfSet = i + 1u;
+      if (i < patternLength)
+      {
+         matched = MYSTRING_MatchCharacter(pattern, patternLength, i, string[j], &endOfSet);
+      }
+
+      if (true == matched)
+      {
+         i = endOfSet;
+         j++;
+      }
+      else if (0xffffffffu != starPattern)
+      {
+         /*Let the last star match one more character*/
+         starString++;
+         i = starPattern;
+         j = starString;
+      }
+      else
+      {
+         return false;
+      }
+   }
+
+   /*Only stars may remain in the pattern*/
+   while ((i < patternLength) && ('*' == pattern[i]))
+   {
+      i++;
+   }
+
+   return (i == patternLength);
+}
+
 /************************************************************************************
  * Static function
  *************************************************************************************/
 
+static bool MYSTRING_MatchCharacter(const uint8_t *const pattern, const uint32_t patternLength, const uint32_t position, const uint8_t character, uint32_t *const next)
+{
+   bool matched = false; /*return value */
+   bool negate = false;  /*"[!...]" or "[^...]"*/
+   uint32_t i = position + 1u;
+   uint8_t low = 0;
+   uint8_t high = 0;
+
+   *next = position + 1u;
+   if ('?' == pattern[position])
+   {
+      matched = true;
+   }
+   else if ('[' == pattern[position])
+   {
+      if ((i < patternLength) && (('!' == pattern[i]) || ('^' == pattern[i])))
+      {
+         negate = true;
+         i++;
+      }
+      /*A ']' just after '[' is a normal character*/
+      do
+      {
+         if (i >= patternLength)
+         {
+            /*No closing ']' : '[' is a normal character*/
+            return (MYSTRING_TO_UPPER(character) == MYSTRING_TO_UPPER('['));
+         }
+         low = MYSTRING_TO_UPPER(pattern[i]);
+         high = low;
+         if (((i + 2u) < patternLength) && ('-' == pattern[i + 1u]) && (']' != pattern[i + 2u]))
+         {
+            high = MYSTRING_TO_UPPER(pattern[i + 2u]);
+            i += 2u;
+         }
+         if ((MYSTRING_TO_UPPER(character) >= low) && (MYSTRING_TO_UPPER(character) <= high))
+         {
+            matched = true;
+         }
+         i++;
+      } while ((i < patternLength) && (']' != pattern[i]));
+
+      if (i >= patternLength)
+      {
+         return (MYSTRING_TO_UPPER(character) == MYSTRING_TO_UPPER('['));
+      }
+      *next = i + 1u;
+      matched = (matched != negate);
+   }
+   else
+   {
+      matched = (MYSTRING_TO_UPPER(pattern[position]) == MYSTRING_TO_UPPER(character));
+   }
+
+   return matched;
+}
+
 static uint8_t MYSTRING_CaculateStringLengthOfUser(const uint8_t *const inputArray)
 {
    uint8_t i = 0;               /* Use for loop*/
@@ -25,4 +25,22 @@ void MYSTRING_MyMemCpy(const uint8_t *const srouce, uint32_t num, uint8_t *const
 uint8_t MYSTRING_EnterSelection(uint8_t *const checkSelect);
 bool MYSTRING_ConvertCharToNum(const uint8_t *const string, const uint8_t sizeOfString, uint16_t *const value);
 
+/**  MYSTRING_CompareNoCase
+ * @brief      Compare two strings ignoring the case of ASCII letters (FAT names are not case sensitive)
+ * @param[in] first  first string
+ * @param[in] second  second string
+ * @return int32_t Returns 0 if equal, < 0 if first is before second, > 0 otherwise
+ */
+int32_t MYSTRING_CompareNoCase(const uint8_t *const first, const uint8_t *const second);
+
+/**  MYSTRING_WildcardMatch
+ * @brief      Match a string against a pattern ignoring the case of ASCII letters
+ *             '*' matches any characters, '?' one character, "[a-z]" / "[!abc]" a set of characters
+ * @param[in] pattern  pattern
+ * @param[in] patternLength  number of characters of pattern to use
+ * @param[in] string  string to match
+ * @return bool Returns true if the whole string matches
+ */
+bool MYSTRING_WildcardMatch(const uint8_t *const pattern, const uint32_t patternLength, const uint8_t *const string);
+
 #endif /*__MY_STRING_H__*/
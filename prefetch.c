@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "hal.h"
+#include "fatfs.h"
+#include "stats.h"
+#include "prefetch.h"
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static pthread_t s_Thread;
+static bool s_IsStarted = false;
+static bool s_IsStopping = false;
+
+static pthread_mutex_t s_Lock = PTHREAD_MUTEX_INITIALIZER; /*Protects the folders waiting and s_IsStopping*/
+static pthread_cond_t s_Wake = PTHREAD_COND_INITIALIZER;
+
+static uint32_t *s_Folders = NULL; /*Folders waiting for the thread (NULL : nothing to do)*/
+static uint32_t s_SumFolder = 0;
+static uint32_t s_Budget = 0;
+
+static uint32_t s_Generation = 0; /*Changed by each new list, cancel and stop : the thread stops reading the list it holds*/
+
+static uint64_t s_SumByteRead = 0;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  PREFETCH_Worker
+ * @brief Background thread : wait for folders and read their first clusters while the budget and generation allow
+ * @param[in] argument   unused
+ * @return void* Returns NULL
+ */
+static void *PREFETCH_Worker(void *argument);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool PREFETCH_Init(void)
+{
+    if (false == s_IsStarted)
+    {
+        s_IsStopping = false;
+        __atomic_store_n(&s_SumByteRead, 0u, __ATOMIC_RELAXED);
+        s_IsStarted = (0 == pthread_create(&s_Thread, NULL, PREFETCH_Worker, NULL));
+    }
+
+    return s_IsStarted;
+}
+
+void PREFETCH_Folders(const uint32_t *const folders, const uint32_t sumFolder, const uint32_t budget)
+{
+    uint32_t *copy = NULL;
+
+    if ((true == s_IsStarted) && (0 != sumFolder))
+    {
+        copy = (uint32_t *)STATS_Malloc(sumFolder * sizeof(uint32_t));
+    }
+
+    pthread_mutex_lock(&s_Lock);
+    __atomic_fetch_add(&s_Generation, 1u, __ATOMIC_RELEASE);
+    free(s_Folders);
+    s_Folders = copy;
+    if (NULL != copy)
+    {
+        memcpy(copy, folders, sumFolder * sizeof(uint32_t));
+        s_SumFolder = sumFolder;
+        s_Budget = (0 != budget) ? budget : PREFETCH_BUDGET_DEFAULT;
+        pthread_cond_signal(&s_Wake);
+    }
+    pthread_mutex_unlock(&s_Lock);
+}
+
+void PREFETCH_Cancel(void)
+{
+    PREFETCH_Folders(NULL, 0, 0);
+}
+
+uint64_t PREFETCH_GetByteRead(void)
+{
+    return __atomic_load_n(&s_SumByteRead, __ATOMIC_RELAXED);
+}
+
+void PREFETCH_DeInit(void)
+{
+    if (true == s_IsStarted)
+    {
+        pthread_mutex_lock(&s_Lock);
+        __atomic_fetch_add(&s_Generation, 1u, __ATOMIC_RELEASE);
+        s_IsStopping = true;
+        free(s_Folders);
+        s_Folders = NULL;
+        pthread_cond_signal(&s_Wake);
+        pthread_mutex_unlock(&s_Lock);
+        pthread_join(s_Thread, NULL);
+        s_IsStarted = false;
+    }
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void *PREFETCH_Worker(void *argument)
+{
+    FATFS_VolumeInfo_Struct_t info;
+    uint8_t *buffer = NULL;  /*Receives the clusters : only the page cache keeps them*/
+    uint32_t *folders = NULL;
+    uint32_t sumFolder = 0;
+    uint32_t budget = 0;
+    uint32_t generation = 0;
+    uint32_t sizeOfCluster = 0;
+    uint32_t cluster = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    (void)argument;
+    FATFS_GetVolumeInfo(&info);
+    sizeOfCluster = (uint32_t)info.bytePerSector * info.sectorPerCluster;
+    buffer = (uint8_t *)STATS_Malloc(sizeOfCluster);
+
+    pthread_mutex_lock(&s_Lock);
+    while (false == s_IsStopping)
+    {
+        if (NULL == s_Folders)
+        {
+            pthread_cond_wait(&s_Wake, &s_Lock);
+        }
+        else
+        {
+            /*Take the list : the lock is not held while reading*/
+            folders = s_Folders;
+            sumFolder = s_SumFolder;
+            budget = s_Budget;
+            generation = __atomic_load_n(&s_Generation, __ATOMIC_ACQUIRE);
+            s_Folders = NULL;
+            pthread_mutex_unlock(&s_Lock);
+
+            for (i = 0; (NULL != buffer) && (i < sumFolder) && (sizeOfCluster <= budget) && (generation == __atomic_load_n(&s_Generation, __ATOMIC_ACQUIRE)); i++)
+            {
+                cluster = folders[i];
+                /*The generation is checked before each read : a cancel stops the list at once*/
+                for (j = 0; (j < PREFETCH_CLUSTER_PER_FOLDER) && (sizeOfCluster <= budget) && (2u <= cluster) && (cluster < (info.totalClusters + 2u)) &&
+                            (generation == __atomic_load_n(&s_Generation, __ATOMIC_ACQUIRE));
+                     j++)
+                {
+                    (void)HAL_ReadMultiSector(info.locationOfData + (cluster - 2u) * info.sectorPerCluster, info.sectorPerCluster, buffer);
+                    __atomic_fetch_add(&s_SumByteRead, sizeOfCluster, __ATOMIC_RELAXED);
+                    budget -= sizeOfCluster;
+                    if (false == FATFS_GetNextCluster(cluster, &cluster))
+                    {
+                        cluster = 0; /*End of folder*/
+                    }
+                }
+            }
+            free(folders);
+            pthread_mutex_lock(&s_Lock);
+        }
+    }
+    pthread_mutex_unlock(&s_Lock);
+    free(buffer);
+
+    return NULL;
+}
@@ -0,0 +1,56 @@
+#ifndef __PREFETCH_H__
+#define __PREFETCH_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Clusters read at the start of each folder (enough for the first screen of a listing)
+ */
+#define PREFETCH_CLUSTER_PER_FOLDER (2u)
+
+/*
+ *Bytes read for one listing when no budget is given
+ */
+#define PREFETCH_BUDGET_DEFAULT (1024u * 1024u)
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  PREFETCH_Init
+ * @brief Start the background thread. The volume must be mounted (FATFS_Init) until PREFETCH_DeInit
+ * @return bool Returns false if the thread could not be started
+ */
+bool PREFETCH_Init(void);
+
+/**  PREFETCH_Folders
+ * @brief Read the first clusters of folders in the background, so the page cache holds them when they are opened.
+ *        Replaces (cancels) the folders given before
+ * @param[in] folders   First cluster of each folder, in the order they should be read (copied)
+ * @param[in] sumFolder   Number of folders
+ * @param[in] budget   Maximum number of bytes read (0 : PREFETCH_BUDGET_DEFAULT)
+ * @return none
+ */
+void PREFETCH_Folders(const uint32_t *const folders, const uint32_t sumFolder, const uint32_t budget);
+
+/**  PREFETCH_Cancel
+ * @brief Forget the folders not read yet. A read in progress finishes, no other starts
+ * @return none
+ */
+void PREFETCH_Cancel(void);
+
+/**  PREFETCH_GetByteRead
+ * @brief Get the number of bytes read by the background thread since PREFETCH_Init
+ * @return uint64_t Returns the number of bytes
+ */
+uint64_t PREFETCH_GetByteRead(void);
+
+/**  PREFETCH_DeInit
+ * @brief Cancel and stop the background thread, waiting for a read in progress. Call it before FATFS_DeInit
+ * @return none
+ */
+void PREFETCH_DeInit(void);
+
+#endif /*__PREFETCH_H__*/
@@ -0,0 +1,542 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "hal.h"
+#include "fatfs.h"
+#include "stats.h"
+#include "recover.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Size of the sequential reads of the data region
+ */
+#define RECOVER_BLOCK_SIZE (8u * 1024u * 1024u)
+
+/*
+ *Used clusters skipped after the first cluster of a candidate before its data is said lost
+ */
+#define RECOVER_MAX_SKIP (65536u)
+
+/*
+ *Directory entry
+ */
+#define RECOVER_SIZE_ENTRY (32u)
+#define RECOVER_SIZE_SHORT_NAME (11u)
+#define RECOVER_ATTRIBUTE_OFFSET (11u)
+#define RECOVER_RESERVED_OFFSET (12u)
+#define RECOVER_CREATE_TENTH_OFFSET (13u)
+#define RECOVER_CREATE_TIME_OFFSET (14u)
+#define RECOVER_CREATE_DATE_OFFSET (16u)
+#define RECOVER_HIGH_CLUSTER_OFFSET (20u)
+#define RECOVER_MOD_TIME_OFFSET (22u)
+#define RECOVER_MOD_DATE_OFFSET (24u)
+#define RECOVER_LOW_CLUSTER_OFFSET (26u)
+#define RECOVER_FILE_SIZE_OFFSET (28u)
+#define RECOVER_ATTRIBUTE_LONG_FILE_NAME (0x0fu)
+#define RECOVER_ATTRIBUTE_VOLUME_LABEL (0x08u)
+#define RECOVER_ATTRIBUTE_DIRECTORY (0x10u)
+#define RECOVER_ATTRIBUTE_UNUSED_MASK (0xc0u)
+#define RECOVER_RESERVED_CASE_MASK (0x18u) /*Lower case flags of Windows NT, the only bits used in byte 12*/
+#define RECOVER_DELETED_ENTRY (0xe5u)
+#define RECOVER_KANJI_E5_ENTRY (0x05u)
+#define RECOVER_END_OF_ENTRY (0x00u)
+#define RECOVER_JUMP_SHORT (0xebu) /*x86 jumps starting a boot sector (copies of it are not folders)*/
+#define RECOVER_JUMP_NEAR (0xe9u)
+#define RECOVER_SUB_ENTRY_ORDER_MASK (0x3fu)
+#define RECOVER_SUB_ENTRY_LAST_MASK (0x40u)
+#define RECOVER_SUB_ENTRY_CHECK_SUM_OFFSET (13u)
+#define RECOVER_LONG_FILE_NAME_MAX_SUB_ENTRY (20u)
+#define RECOVER_CHARACTERS_PER_SUB_ENTRY (13u)
+#define RECOVER_DOT_ENTRY ".          "
+
+#define RECOVER_READ_2_BYTES(address) ((uint32_t)(address)[0] | ((uint32_t)(address)[1] << 8u))
+#define RECOVER_READ_4_BYTES(address) (RECOVER_READ_2_BYTES(address) | (RECOVER_READ_2_BYTES(&(address)[2]) << 16u))
+
+/*
+ *Kind of a 32 bytes slot
+ */
+typedef enum
+{
+    RECOVER_SLOT_INVALID = 0,
+    RECOVER_SLOT_END,
+    RECOVER_SLOT_SUB_ENTRY,
+    RECOVER_SLOT_MAIN_ENTRY
+} RECOVER_Slot_Enum_t;
+
+/*
+ *State of a scan
+ */
+typedef struct
+{
+    FATFS_VolumeInfo_Struct_t info;
+    uint32_t sizeOfCluster;
+    uint32_t endCluster;           /*Cluster after the data region*/
+    RECOVER_Callback_t callback;
+    void *context;
+    RECOVER_Report_Struct_t *report;
+    bool isStopped;                /*Set when the callback returns false*/
+} RECOVER_Scan_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+/*
+ * Position of the 13 UTF-16 characters inside a sub entry
+ */
+static const uint8_t s_OffsetOfLongFileName[RECOVER_CHARACTERS_PER_SUB_ENTRY] = {1u, 3u, 5u, 7u, 9u, 14u, 16u, 18u, 20u, 22u, 24u, 28u, 30u};
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  RECOVER_CheckSlot
+ * @brief Tell if 32 bytes can be a slot of a folder. Most data clusters fail on the name bytes of the first slot,
+ *        which are checked 16 at a time
+ * @param[in] scan   State of the scan (range of clusters)
+ * @param[in] slot   32 bytes
+ * @return RECOVER_Slot_Enum_t Kind of slot
+ */
+static RECOVER_Slot_Enum_t RECOVER_CheckSlot(const RECOVER_Scan_Struct_t *const scan, const uint8_t *const slot);
+
+/**  RECOVER_IsFolderCluster
+ * @brief Tell if a cluster is a folder cluster : every slot before the end mark is valid and one is a main entry
+ * @param[in] scan   State of the scan
+ * @param[in] data   Cluster
+ * @return bool Returns true for a folder cluster
+ */
+static bool RECOVER_IsFolderCluster(const RECOVER_Scan_Struct_t *const scan, const uint8_t *const data);
+
+/**  RECOVER_IsFirstCluster
+ * @brief Tell if a folder cluster is the first cluster of its folder : it starts with a "." entry pointing to itself
+ * @param[in] scan   State of the scan
+ * @param[in] data   Cluster
+ * @param[in] cluster   Number of the cluster
+ * @return bool Returns true for the first cluster of a folder
+ */
+static bool RECOVER_IsFirstCluster(const RECOVER_Scan_Struct_t *const scan, const uint8_t *const data, const uint32_t cluster);
+
+/**  RECOVER_ProcessFolder
+ * @brief Give the candidates of a folder cluster (or of the root of fat 12/16) to the callback
+ * @param[in,out] scan   State of the scan
+ * @param[in] data   Slots
+ * @param[in] size   Size in bytes of data
+ * @param[in] folderCluster   Cluster of data (0 : root of fat 12/16)
+ * @param[in] isOrphan   true if the cluster is marked free : every entry is a candidate
+ * @return none
+ */
+static void RECOVER_ProcessFolder(RECOVER_Scan_Struct_t *const scan, const uint8_t *const data, const uint32_t size, const uint32_t folderCluster, const bool isOrphan);
+
+/**  RECOVER_GetLongFileName
+ * @brief Read the sub entries stored before a main entry (sequence numbers of deleted sub entries are erased,
+ *        the check sum is used instead) and convert them to UTF-8
+ * @param[in] data   Slots
+ * @param[in] slot   Index of the main entry
+ * @param[out] name   Receiver, RECOVER_NAME_SIZE bytes
+ * @return bool Returns false if there is no sub entry before the main entry
+ */
+static bool RECOVER_GetLongFileName(const uint8_t *const data, const uint32_t slot, uint8_t *const name);
+
+/**  RECOVER_GetRun
+ * @brief Find the next run of free clusters of a candidate
+ * @param[in] info   Geometry
+ * @param[in,out] cluster   Where to look, moved after the run
+ * @param[in] maxLength   Clusters still wanted
+ * @param[out] start   First cluster of the run
+ * @param[out] length   Clusters of the run (<= maxLength)
+ * @return bool Returns false if more than RECOVER_MAX_SKIP used clusters come first or the end of the volume is reached
+ */
+static bool RECOVER_GetRun(const FATFS_VolumeInfo_Struct_t *const info, uint32_t *const cluster, const uint32_t maxLength, uint32_t *const start, uint32_t *const length);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool RECOVER_Scan(const RECOVER_Callback_t callback, void *const context, RECOVER_Report_Struct_t *const report)
+{
+    bool status = true; /*return value */
+    RECOVER_Scan_Struct_t scan;
+    uint8_t *buffer = NULL;
+    uint32_t clusterPerBlock = 0;
+    uint32_t sumCluster = 0; /*Clusters of the block*/
+    uint32_t sumSector = 0;
+    uint32_t cluster = 0;
+    uint32_t nextCluster = 0;
+    uint32_t i = 0;
+    bool isOrphan = false;
+
+    memset(&scan, 0, sizeof(scan));
+    memset(report, 0, sizeof(RECOVER_Report_Struct_t));
+    FATFS_GetVolumeInfo(&scan.info);
+    scan.sizeOfCluster = (uint32_t)scan.info.bytePerSector * scan.info.sectorPerCluster;
+    scan.endCluster = scan.info.totalClusters + 2u;
+    scan.callback = callback;
+    scan.context = context;
+    scan.report = report;
+    clusterPerBlock = RECOVER_BLOCK_SIZE / scan.sizeOfCluster;
+    buffer = (uint8_t *)STATS_Malloc((size_t)clusterPerBlock * scan.sizeOfCluster);
+    status = (NULL != buffer) && (0 != clusterPerBlock);
+
+    /*The root of fat 12/16 is before the data region (at most 65535 entries : one block)*/
+    if ((true == status) && (0 == scan.info.rootCluster))
+    {
+        sumSector = scan.info.locationOfData - scan.info.locationOfRoot;
+        status = ((sumSector * scan.info.bytePerSector) <= RECOVER_BLOCK_SIZE) &&
+                 ((int32_t)(sumSector * scan.info.bytePerSector) == HAL_ReadMultiSector(scan.info.locationOfRoot, sumSector, buffer));
+        if (true == status)
+        {
+            report->sumByteRead += (uint64_t)sumSector * scan.info.bytePerSector;
+            RECOVER_ProcessFolder(&scan, buffer, sumSector * scan.info.bytePerSector, 0, false);
+        }
+    }
+
+    /*Sequential blocks, the kernel reads the next one while this one is checked*/
+    for (cluster = 2; (true == status) && (false == scan.isStopped) && (cluster < scan.endCluster); cluster += sumCluster)
+    {
+        sumCluster = ((scan.endCluster - cluster) < clusterPerBlock) ? (scan.endCluster - cluster) : clusterPerBlock;
+        if ((cluster + sumCluster) < scan.endCluster)
+        {
+            HAL_Prefetch(scan.info.locationOfData + (cluster + sumCluster - 2u) * scan.info.sectorPerCluster,
+                         (((scan.endCluster - cluster - sumCluster) < clusterPerBlock) ? (scan.endCluster - cluster - sumCluster) : clusterPerBlock) * scan.info.sectorPerCluster);
+        }
+        sumSector = sumCluster * scan.info.sectorPerCluster;
+        status = ((int32_t)(sumSector * scan.info.bytePerSector) == HAL_ReadMultiSector(scan.info.locationOfData + (cluster - 2u) * scan.info.sectorPerCluster, sumSector, buffer));
+        if (true == status)
+        {
+            report->sumByteRead += (uint64_t)sumSector * scan.info.bytePerSector;
+        }
+        for (i = 0; (true == status) && (false == scan.isStopped) && (i < sumCluster); i++)
+        {
+            if (false == RECOVER_IsFolderCluster(&scan, &buffer[(size_t)i * scan.sizeOfCluster]))
+            {
+                continue;
+            }
+            (void)FATFS_GetNextCluster(cluster + i, &nextCluster);
+            isOrphan = (0 == nextCluster);
+            /*A free cluster is only taken for the first cluster of a folder : a few valid slots are found by chance in old data*/
+            if ((false == isOrphan) || (true == RECOVER_IsFirstCluster(&scan, &buffer[(size_t)i * scan.sizeOfCluster], cluster + i)))
+            {
+                report->sumFolderCluster++;
+                report->sumOrphanCluster += (true == isOrphan) ? 1u : 0u;
+                RECOVER_ProcessFolder(&scan, &buffer[(size_t)i * scan.sizeOfCluster], scan.sizeOfCluster, cluster + i, isOrphan);
+            }
+        }
+    }
+    free(buffer);
+
+    return status;
+}
+
+bool RECOVER_Extract(const RECOVER_Candidate_Struct_t *const candidate, const uint8_t *const outputPath)
+{
+    bool status = true; /*return value */
+    FATFS_VolumeInfo_Struct_t info;
+    FILE *file = NULL;
+    uint8_t *buffer = NULL;
+    uint32_t sizeOfCluster = 0;
+    uint32_t clusterPerBlock = 0;
+    uint32_t remainByte = candidate->fileSize;
+    uint32_t remainCluster = candidate->sumCluster;
+    uint32_t cluster = candidate->firstCluster;
+    uint32_t start = 0;
+    uint32_t length = 0;
+    uint32_t sumCluster = 0;
+    uint32_t sizeOfWrite = 0;
+
+    FATFS_GetVolumeInfo(&info);
+    sizeOfCluster = (uint32_t)info.bytePerSector * info.sectorPerCluster;
+    clusterPerBlock = RECOVER_BLOCK_SIZE / sizeOfCluster;
+    status = ((0 != candidate->sumExtent) || (0 == candidate->fileSize)) && (0 == (candidate->attributes & RECOVER_ATTRIBUTE_DIRECTORY));
+    if (true == status)
+    {
+        buffer = (uint8_t *)STATS_Malloc((size_t)clusterPerBlock * sizeOfCluster);
+        file = fopen((const char *)outputPath, "wb");
+        status = (NULL != buffer) && (NULL != file);
+    }
+
+    /*Same runs as the scan found*/
+    while ((true == status) && (0 != remainCluster))
+    {
+        status = RECOVER_GetRun(&info, &cluster, remainCluster, &start, &length);
+        remainCluster -= (true == status) ? length : 0;
+        while ((true == status) && (0 != length))
+        {
+            sumCluster = (length < clusterPerBlock) ? length : clusterPerBlock;
+            status = ((int32_t)(sumCluster * sizeOfCluster) == HAL_ReadMultiSector(info.locationOfData + (start - 2u) * info.sectorPerCluster, sumCluster * info.sectorPerCluster, buffer));
+            sizeOfWrite = ((sumCluster * sizeOfCluster) < remainByte) ? (sumCluster * sizeOfCluster) : remainByte;
+            status = (true == status) && (sizeOfWrite == fwrite(buffer, 1, sizeOfWrite, file));
+            remainByte -= sizeOfWrite;
+            start += sumCluster;
+            length -= sumCluster;
+        }
+    }
+
+    if (NULL != file)
+    {
+        status = (0 == fclose(file)) && (true == status);
+    }
+    free(buffer);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static RECOVER_Slot_Enum_t RECOVER_CheckSlot(const RECOVER_Scan_Struct_t *const scan, const uint8_t *const slot)
+{
+    RECOVER_Slot_Enum_t kind = RECOVER_SLOT_MAIN_ENTRY; /*return value */
+    const uint8_t attributes = slot[RECOVER_ATTRIBUTE_OFFSET];
+    uint32_t nameMask = 0; /*Bit i set if byte i is a character allowed in a short name (>= 0x20, not lower case)*/
+    uint32_t date = 0;
+    uint32_t time = 0;
+    uint32_t cluster = 0;
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128i value = _mm_loadu_si128((const __m128i *)slot);
+    const __m128i lower = _mm_sub_epi8(value, _mm_set1_epi8('a'));
+    const __m128i isPrintable = _mm_cmpeq_epi8(_mm_max_epu8(value, _mm_set1_epi8(0x20)), value);
+    const __m128i isLower = _mm_cmpeq_epi8(_mm_min_epu8(lower, _mm_set1_epi8('z' - 'a')), lower);
+
+    nameMask = (uint32_t)_mm_movemask_epi8(_mm_andnot_si128(isLower, isPrintable));
+#else
+    for (i = 0; i < RECOVER_SIZE_SHORT_NAME; i++)
+    {
+        nameMask |= ((0x20u <= slot[i]) && (('a' > slot[i]) || ('z' < slot[i]))) ? (1u << i) : 0u;
+    }
+#endif
+
+    if (RECOVER_END_OF_ENTRY == slot[0])
+    {
+        kind = RECOVER_SLOT_END;
+    }
+    else if (RECOVER_ATTRIBUTE_LONG_FILE_NAME == attributes)
+    {
+        /*Sub entry : type 0, cluster 0, sequence number 1..20 unless deleted*/
+        kind = ((0 == slot[RECOVER_RESERVED_OFFSET]) && (0 == RECOVER_READ_2_BYTES(&slot[RECOVER_LOW_CLUSTER_OFFSET])) &&
+                ((RECOVER_DELETED_ENTRY == slot[0]) ||
+                 ((0 == (slot[0] & ~(RECOVER_SUB_ENTRY_ORDER_MASK | RECOVER_SUB_ENTRY_LAST_MASK))) && (0 != (slot[0] & RECOVER_SUB_ENTRY_ORDER_MASK)) &&
+                  (RECOVER_LONG_FILE_NAME_MAX_SUB_ENTRY >= (slot[0] & RECOVER_SUB_ENTRY_ORDER_MASK)))))
+                   ? RECOVER_SLOT_SUB_ENTRY
+                   : RECOVER_SLOT_INVALID;
+    }
+    else if ((0x7feu != (nameMask & 0x7feu)) || (0 != (attributes & RECOVER_ATTRIBUTE_UNUSED_MASK)) ||
+             (0 != (slot[RECOVER_RESERVED_OFFSET] & ~RECOVER_RESERVED_CASE_MASK)) || (199u < slot[RECOVER_CREATE_TENTH_OFFSET]) ||
+             ((0x20u > slot[0]) && (RECOVER_KANJI_E5_ENTRY != slot[0])) || (RECOVER_JUMP_SHORT == slot[0]) || (RECOVER_JUMP_NEAR == slot[0]))
+    {
+        kind = RECOVER_SLOT_INVALID;
+    }
+    else
+    {
+        /*Characters not allowed in a short name*/
+        for (i = 0; (RECOVER_SLOT_MAIN_ENTRY == kind) && (i < RECOVER_SIZE_SHORT_NAME); i++)
+        {
+            if ((NULL != strchr("\"*+,/:;<=>?[\\]|", slot[i])) && (0 != slot[i]))
+            {
+                kind = RECOVER_SLOT_INVALID;
+            }
+        }
+        /*Dates (month 1..12, day 1..31) and times when they are set*/
+        for (i = 0; (RECOVER_SLOT_MAIN_ENTRY == kind) && (i < 2u); i++)
+        {
+            date = RECOVER_READ_2_BYTES(&slot[(0 == i) ? RECOVER_CREATE_DATE_OFFSET : RECOVER_MOD_DATE_OFFSET]);
+            time = RECOVER_READ_2_BYTES(&slot[(0 == i) ? RECOVER_CREATE_TIME_OFFSET : RECOVER_MOD_TIME_OFFSET]);
+            if (((0 != date) && ((0 == ((date >> 5u) & 0x0fu)) || (12u < ((date >> 5u) & 0x0fu)) || (0 == (date & 0x1fu)))) ||
+                (23u < (time >> 11u)) || (59u < ((time >> 5u) & 0x3fu)) || (29u < (time & 0x1fu)))
+            {
+                kind = RECOVER_SLOT_INVALID;
+            }
+        }
+        cluster = RECOVER_READ_2_BYTES(&slot[RECOVER_LOW_CLUSTER_OFFSET]);
+        if (32u == scan->info.fatType)
+        {
+            cluster |= RECOVER_READ_2_BYTES(&slot[RECOVER_HIGH_CLUSTER_OFFSET]) << 16u;
+        }
+        else if (0 != RECOVER_READ_2_BYTES(&slot[RECOVER_HIGH_CLUSTER_OFFSET]))
+        {
+            kind = RECOVER_SLOT_INVALID;
+        }
+        else
+        {
+            /*Do nothing*/
+        }
+        if ((1u == cluster) || (cluster >= scan->endCluster) ||
+            ((0 != (attributes & RECOVER_ATTRIBUTE_DIRECTORY)) && (0 != RECOVER_READ_4_BYTES(&slot[RECOVER_FILE_SIZE_OFFSET]))))
+        {
+            kind = RECOVER_SLOT_INVALID;
+        }
+    }
+
+    return kind;
+}
+
+static bool RECOVER_IsFolderCluster(const RECOVER_Scan_Struct_t *const scan, const uint8_t *const data)
+{
+    RECOVER_Slot_Enum_t kind = RECOVER_SLOT_INVALID;
+    uint32_t sumMainEntry = 0;
+    uint32_t offset = 0;
+
+    for (offset = 0; offset < scan->sizeOfCluster; offset += RECOVER_SIZE_ENTRY)
+    {
+        kind = RECOVER_CheckSlot(scan, &data[offset]);
+        if ((RECOVER_SLOT_INVALID == kind) || (RECOVER_SLOT_END == kind))
+        {
+            break;
+        }
+        sumMainEntry += (RECOVER_SLOT_MAIN_ENTRY == kind) ? 1u : 0u;
+    }
+
+    return (RECOVER_SLOT_INVALID != kind) && (0 != sumMainEntry);
+}
+
+static bool RECOVER_IsFirstCluster(const RECOVER_Scan_Struct_t *const scan, const uint8_t *const data, const uint32_t cluster)
+{
+    uint32_t firstCluster = RECOVER_READ_2_BYTES(&data[RECOVER_LOW_CLUSTER_OFFSET]);
+
+    if (32u == scan->info.fatType)
+    {
+        firstCluster |= RECOVER_READ_2_BYTES(&data[RECOVER_HIGH_CLUSTER_OFFSET]) << 16u;
+    }
+
+    return (0 == memcmp(data, RECOVER_DOT_ENTRY, RECOVER_SIZE_SHORT_NAME)) && (0 != (data[RECOVER_ATTRIBUTE_OFFSET] & RECOVER_ATTRIBUTE_DIRECTORY)) &&
+           (cluster == firstCluster);
+}
+
+static void RECOVER_ProcessFolder(RECOVER_Scan_Struct_t *const scan, const uint8_t *const data, const uint32_t size, const uint32_t folderCluster, const bool isOrphan)
+{
+    RECOVER_Candidate_Struct_t candidate;
+    FATFS_Entry_Struct_t entry;
+    const uint8_t *slot = NULL;
+    uint32_t cluster = 0;
+    uint32_t start = 0;
+    uint32_t length = 0;
+    uint32_t remainCluster = 0;
+    uint32_t i = 0;
+
+    for (i = 0; (false == scan->isStopped) && ((i * RECOVER_SIZE_ENTRY) < size); i++)
+    {
+        slot = &data[i * RECOVER_SIZE_ENTRY];
+        if (RECOVER_END_OF_ENTRY == slot[0])
+        {
+            break;
+        }
+        /*Deleted entries, and every entry of an orphaned folder ("." and ".." excepted)*/
+        if ((RECOVER_ATTRIBUTE_LONG_FILE_NAME == slot[RECOVER_ATTRIBUTE_OFFSET]) || (0 != (slot[RECOVER_ATTRIBUTE_OFFSET] & RECOVER_ATTRIBUTE_VOLUME_LABEL)) ||
+            ('.' == slot[0]) || ((RECOVER_DELETED_ENTRY != slot[0]) && (false == isOrphan)) || (false == FATFS_DecodeEntry(slot, &entry)))
+        {
+            continue;
+        }
+
+        memset(&candidate, 0, sizeof(candidate));
+        candidate.folderCluster = folderCluster;
+        candidate.isDeleted = (RECOVER_DELETED_ENTRY == slot[0]);
+        candidate.attributes = entry.attributes;
+        candidate.firstCluster = (32u == scan->info.fatType) ? entry.firstCluster : (entry.firstCluster & 0xffffu);
+        if ((false == candidate.isDeleted) && (2u > candidate.firstCluster))
+        {
+            continue; /*Entry of an orphaned folder without data : nothing to recover*/
+        }
+        candidate.fileSize = entry.fileSize;
+        if (false == RECOVER_GetLongFileName(data, i, candidate.name))
+        {
+            if (true == candidate.isDeleted)
+            {
+                entry.shortFileName[0] = '_';
+            }
+            FATFS_GetShortName(&entry, candidate.name);
+        }
+
+        /*A folder has no size : its first cluster is checked*/
+        candidate.sumCluster = (0 != (entry.attributes & RECOVER_ATTRIBUTE_DIRECTORY)) ? 1u : (uint32_t)(((uint64_t)entry.fileSize + scan->sizeOfCluster - 1u) / scan->sizeOfCluster);
+        if ((2u <= candidate.firstCluster) && (0 != candidate.sumCluster))
+        {
+            /*The data is lost if the first cluster is used again*/
+            cluster = candidate.firstCluster;
+            remainCluster = candidate.sumCluster;
+            while ((0 != remainCluster) && (true == RECOVER_GetRun(&scan->info, &cluster, remainCluster, &start, &length)) &&
+                   ((0 != candidate.sumExtent) || (start == candidate.firstCluster)))
+            {
+                candidate.sumExtent++;
+                remainCluster -= length;
+            }
+            candidate.sumExtent = (0 == remainCluster) ? candidate.sumExtent : 0;
+        }
+
+        scan->report->sumCandidate++;
+        scan->isStopped = (false == scan->callback(&candidate, scan->context));
+    }
+}
+
+static bool RECOVER_GetLongFileName(const uint8_t *const data, const uint32_t slot, uint8_t *const name)
+{
+    uint16_t longFileName[RECOVER_LONG_FILE_NAME_MAX_SUB_ENTRY * RECOVER_CHARACTERS_PER_SUB_ENTRY + 1u] = {0};
+    const uint8_t *subEntry = NULL;
+    uint32_t character = 0;
+    uint32_t sumSubEntry = 0;
+    uint32_t j = 0; /*Index of character in longFileName*/
+    uint32_t i = 0;
+    uint8_t checkSum = 0;
+    bool isEnd = false;
+
+    /*The first 13 characters are in the slot just before the main entry, then going up*/
+    for (sumSubEntry = 0; (false == isEnd) && (sumSubEntry < slot) && (sumSubEntry < RECOVER_LONG_FILE_NAME_MAX_SUB_ENTRY); sumSubEntry++)
+    {
+        subEntry = &data[(slot - sumSubEntry - 1u) * RECOVER_SIZE_ENTRY];
+        if ((RECOVER_ATTRIBUTE_LONG_FILE_NAME != subEntry[RECOVER_ATTRIBUTE_OFFSET]) ||
+            ((0 != sumSubEntry) && (checkSum != subEntry[RECOVER_SUB_ENTRY_CHECK_SUM_OFFSET])))
+        {
+            break;
+        }
+        checkSum = subEntry[RECOVER_SUB_ENTRY_CHECK_SUM_OFFSET];
+        for (i = 0; (false == isEnd) && (i < RECOVER_CHARACTERS_PER_SUB_ENTRY); i++)
+        {
+            character = RECOVER_READ_2_BYTES(&subEntry[s_OffsetOfLongFileName[i]]);
+            isEnd = (0 == character) || (0xffffu == character);
+            if (false == isEnd)
+            {
+                longFileName[j++] = (('/' == character) || ('\\' == character)) ? (uint16_t)'_' : (uint16_t)character;
+            }
+        }
+        /*The sub entry flagged last (not deleted) ends the name*/
+        isEnd = (true == isEnd) || ((0 != (subEntry[0] & RECOVER_SUB_ENTRY_LAST_MASK)) && (RECOVER_DELETED_ENTRY != subEntry[0]));
+    }
+    /*Same conversion as the names of the volume (surrogate pairs, at most 255 characters)*/
+    FATFS_DecodeLongFileName(longFileName, name);
+
+    return (0 != j);
+}
+
+static bool RECOVER_GetRun(const FATFS_VolumeInfo_Struct_t *const info, uint32_t *const cluster, const uint32_t maxLength, uint32_t *const start, uint32_t *const length)
+{
+    const uint32_t endCluster = info->totalClusters + 2u;
+    uint32_t nextCluster = 1;
+    uint32_t sumSkip = 0;
+
+    /*Used clusters before the run*/
+    while ((*cluster < endCluster) && (sumSkip <= RECOVER_MAX_SKIP) && ((true == FATFS_GetNextCluster(*cluster, &nextCluster)) || (0 != nextCluster)))
+    {
+        (*cluster)++;
+        sumSkip++;
+    }
+    *start = *cluster;
+    *length = 0;
+    while ((*cluster < endCluster) && (*length < maxLength) && (false == FATFS_GetNextCluster(*cluster, &nextCluster)) && (0 == nextCluster))
+    {
+        (*cluster)++;
+        (*length)++;
+    }
+
+    return (0 != *length);
+}
@@ -0,0 +1,70 @@
+#ifndef __RECOVER_H__
+#define __RECOVER_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Size of the name of a candidate (UTF-8 long file name +1 '\0')
+ */
+#define RECOVER_NAME_SIZE (768u)
+
+/*
+ *Entry that can be recovered
+ */
+typedef struct
+{
+    uint8_t name[RECOVER_NAME_SIZE]; /*Long file name when its sub entries are intact, else the short name with '_' for the erased first character*/
+    uint32_t folderCluster;          /*Folder cluster holding the entry (0 : root of fat 12/16)*/
+    uint32_t firstCluster;           /*First cluster of the data*/
+    uint32_t fileSize;               /*Size in bytes*/
+    uint32_t sumCluster;             /*Clusters needed by fileSize*/
+    uint32_t sumExtent;              /*Runs of free clusters from firstCluster giving sumCluster clusters (0 : the data is lost)*/
+    uint8_t attributes;
+    bool isDeleted;                  /*true for a deleted entry, false for an entry of an orphaned folder cluster*/
+} RECOVER_Candidate_Struct_t;
+
+/*
+ *Result of a scan
+ */
+typedef struct
+{
+    uint64_t sumByteRead;         /*Bytes of the data region read*/
+    uint32_t sumFolderCluster;    /*Clusters recognized as folder clusters*/
+    uint32_t sumOrphanCluster;    /*Folder clusters marked free in the FAT*/
+    uint32_t sumCandidate;        /*Candidates given to the callback*/
+} RECOVER_Report_Struct_t;
+
+/*
+ *Callback receives each candidate, in the order of the image. Return false to stop the scan
+ */
+typedef bool (*RECOVER_Callback_t)(const RECOVER_Candidate_Struct_t *const candidate, void *const context);
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  RECOVER_Scan
+ * @brief Read the whole data region (and the root of fat 12/16) in large sequential blocks, the next block being prefetched.
+ *        Clusters where every slot is a valid entry are folder clusters : their deleted entries are candidates,
+ *        and every entry with data of a free folder cluster starting with a "." entry pointing to itself
+ *        (first cluster of an orphaned folder) too. The data of a candidate is
+ *        assumed to be the free clusters from its first cluster (clusters used again are skipped).
+ *        The volume must be mounted with FATFS_Init
+ * @param[in] callback   Receiver of the candidates
+ * @param[in] context   Passed to callback
+ * @param[out] report   Counts of the scan
+ * @return bool Returns false if memory is missing or the image could not be read
+ */
+bool RECOVER_Scan(const RECOVER_Callback_t callback, void *const context, RECOVER_Report_Struct_t *const report);
+
+/**  RECOVER_Extract
+ * @brief Write the data of a file candidate to a host file, from the clusters found by RECOVER_Scan
+ * @param[in] candidate   Candidate
+ * @param[in] outputPath   Path of the host file
+ * @return bool Returns false if the data is lost (sumExtent is 0) or the file could not be written
+ */
+bool RECOVER_Extract(const RECOVER_Candidate_Struct_t *const candidate, const uint8_t *const outputPath);
+
+#endif /*__RECOVER_H__*/
@@ -0,0 +1,95 @@
+#!/bin/sh
+#
+# Round trip of the write commands, for fat 12, 16 and 32 :
+#   mkfs -> put / mkdir / truncate / rm / rmdir -> fsck must exit 0 and hash must match sha256sum of the host files
+# The data is generated (no random) so a failure can be repeated.
+#
+# Usage : ./roundtrip.sh [fat]    (fat : path of the program, ./fat by default, see Build in README.md)
+#
+
+FAT=${1:-./fat}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+FAILED=0
+
+# make <path> <size> : deterministic content that is not periodic (clusters swapped or shifted change the hash)
+make() {
+    mkdir -p "$(dirname "$1")"
+    seq 1 100000000 | head -c "$2" > "$1"
+}
+
+# run <command...> : stop this volume when a command fails
+run() {
+    if ! "$FAT" "$@" > "$WORK/output.txt" 2>&1 < /dev/null; then
+        echo "  failed : fat $*"
+        cat "$WORK/output.txt"
+        return 1
+    fi
+}
+
+check() {
+    fatType=$1
+    sizeOfImage=$2
+    image="$WORK/fat$fatType.img"
+    src="$WORK/src$fatType"
+    spare="$WORK/spare$fatType"
+
+    rm -rf "$src" "$spare"
+    make "$src/empty0.txt" 0
+    make "$src/small.txt" 1
+    make "$src/A long file name with spaces.dat" 70000
+    make "$src/docs/r1.bin" 300000
+    make "$src/docs/deep/n.bin" 12345
+    make "$spare/old.bin" 40000
+    make "$spare/gone.bin" 3000
+    for i in 1 2 3 4 5 6 7 8; do
+        make "$src/frag/a$i.bin" $((i * 1500))
+    done
+    make "$src/frag/big.bin" 60000
+
+    run mkfs "$image" "$sizeOfImage" --fat "$fatType" &&
+    run mkdir "$image" /docs /docs/deep /frag /gone &&
+    run put "$image" /empty0.txt "$src/empty0.txt" /small.txt "$src/small.txt" "/A long file name with spaces.dat" "$src/A long file name with spaces.dat" &&
+    run put "$image" /docs/r1.bin "$src/docs/r1.bin" /docs/deep/n.bin "$spare/old.bin" /gone/gone.bin "$spare/gone.bin" &&
+    run put "$image" /frag/a1.bin "$src/frag/a1.bin" /frag/a2.bin "$src/frag/a2.bin" /frag/a3.bin "$src/frag/a3.bin" /frag/a4.bin "$src/frag/a4.bin" \
+                     /frag/a5.bin "$src/frag/a5.bin" /frag/a6.bin "$src/frag/a6.bin" /frag/a7.bin "$src/frag/a7.bin" /frag/a8.bin "$src/frag/a8.bin" &&
+    # Holes between the files : big.bin is written in several runs
+    run rm "$image" /frag/a1.bin /frag/a3.bin /frag/a5.bin /frag/a7.bin &&
+    run put "$image" /frag/big.bin "$src/frag/big.bin" &&
+    # Replace a file, shrink one, grow one (the end reads as zeros)
+    run put "$image" /docs/deep/n.bin "$src/docs/deep/n.bin" &&
+    run truncate "$image" /docs/r1.bin 100002 &&
+    run truncate "$image" /small.txt 9000 &&
+    run rm "$image" /gone/gone.bin &&
+    run rmdir "$image" /gone &&
+    # Same clusters, only the entry changes : the index built before must not be used after
+    run index "$image" &&
+    run truncate "$image" /docs/r1.bin 100001 &&
+    run fsck "$image" || return 1
+    rm -f "$src/frag/a1.bin" "$src/frag/a3.bin" "$src/frag/a5.bin" "$src/frag/a7.bin"
+    truncate -s 100001 "$src/docs/r1.bin"
+    truncate -s 9000 "$src/small.txt"
+
+    run stat "$image" /docs/r1.bin &&
+    grep -q "Size *: 100001" "$WORK/output.txt" || { echo "  stat does not show the new size"; cat "$WORK/output.txt"; return 1; }
+
+    run hash "$image" || return 1
+    sed 's#  /#  #' "$WORK/output.txt" | sort > "$WORK/image.txt"
+    (cd "$src" && find . -type f -exec sha256sum {} +) | sed 's#  \./#  #' | sort > "$WORK/host.txt"
+    if ! diff "$WORK/host.txt" "$WORK/image.txt"; then
+        echo "  hash differs"
+        return 1
+    fi
+}
+
+for volume in "12 4M" "16 32M" "32 64M"; do
+    set -- $volume
+    if check "$1" "$2"; then
+        echo "fat$1 : ok"
+    else
+        echo "fat$1 : FAILED"
+        FAILED=1
+    fi
+done
+
+exit $FAILED
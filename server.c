@@ -0,0 +1,604 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "hal.h"
+#include "fatfs.h"
+#include "server.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Time the accept loop waits before it checks for a stop signal
+ */
+#define SERVER_POLL_MS (500)
+
+/*
+ *Size of the greeting sent with the descriptor of the image
+ */
+#define SERVER_GREETING_MAX (64u)
+
+/*
+ *File read by SERVER_ReadFile
+ */
+typedef struct
+{
+    int imageDescriptor;
+    uint8_t *buffer; /*SERVER_CHUNK_SIZE bytes*/
+    FATFS_DataCallback_t callback;
+    void *context;
+} SERVER_File_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static volatile sig_atomic_t s_IsStopping = 0;
+
+static pthread_mutex_t s_Lock = PTHREAD_MUTEX_INITIALIZER; /*Protects the clients*/
+static pthread_cond_t s_Left = PTHREAD_COND_INITIALIZER;   /*A client thread ended*/
+static int s_Clients[SERVER_MAX_CLIENT];                   /*Connection of each slot (-1 : free)*/
+static uint32_t s_SumClient = 0;
+
+static int s_ImageDescriptor = -1; /*Given to every client*/
+static FATFS_VolumeInfo_Struct_t s_Info;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  SERVER_Stop
+ * @brief Signal handler : ask the accept loop to stop
+ * @param[in] signalNumber   unused
+ * @return none
+ */
+static void SERVER_Stop(int signalNumber);
+
+/**  SERVER_Accept
+ * @brief Give a free slot and a thread to a new connection, or close it
+ * @param[in] connection   Descriptor of the connection
+ * @return none
+ */
+static void SERVER_Accept(const int connection);
+
+/**  SERVER_Serve
+ * @brief Thread : send the greeting and the image, then answer requests until the client leaves
+ * @param[in] argument   Slot of the client
+ * @return void* Returns NULL
+ */
+static void *SERVER_Serve(void *argument);
+
+/**  SERVER_Answer
+ * @brief Answer one request
+ * @param[in,out] line   Request without '\n' (changed)
+ * @param[in] output   Stream of the connection
+ * @return none
+ */
+static void SERVER_Answer(char *const line, FILE *const output);
+
+/**  SERVER_PrintEntry
+ * @brief Write the "ENTRY" line of an entry
+ * @param[in] entry   Entry
+ * @param[in] output   Stream of the connection
+ * @return none
+ */
+static void SERVER_PrintEntry(const FATFS_Entry_Struct_t *const entry, FILE *const output);
+
+/**  SERVER_ReadExtent
+ * @brief Read the run of an "EXTENT" line from the image (used as SERVER_LineCallback_t)
+ * @param[in] line   Reply line
+ * @param[in] context   File read (SERVER_File_Struct_t)
+ * @return bool Returns false if the line is not an extent, a read failed or the callback stopped
+ */
+static bool SERVER_ReadExtent(const char *const line, void *const context);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool SERVER_Run(const uint8_t *const imagePath, const uint8_t *const socketPath)
+{
+    bool status = true; /*return value */
+    struct sockaddr_un address;
+    struct sigaction action;
+    struct sigaction oldInterrupt;
+    struct sigaction oldTerminate;
+    struct sigaction oldPipe;
+    struct pollfd listening;
+    int listener = -1;
+    bool isMounted = false;
+    bool isBound = false;
+    uint32_t i = 0;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    status = (strlen((const char *)socketPath) < sizeof(address.sun_path));
+    if (true == status)
+    {
+        strcpy(address.sun_path, (const char *)socketPath);
+        isMounted = FATFS_Init(imagePath);
+        status = (true == isMounted) && (false == HAL_IsCompressed()); /*Clients read the runs from the file*/
+    }
+    if (true == status)
+    {
+        FATFS_GetVolumeInfo(&s_Info);
+        s_ImageDescriptor = open((const char *)imagePath, O_RDONLY | O_CLOEXEC);
+        listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        status = (0 <= s_ImageDescriptor) && (0 <= listener);
+    }
+    if (true == status)
+    {
+        (void)unlink((const char *)socketPath); /*Socket of a daemon that did not stop cleanly*/
+        isBound = (0 == bind(listener, (const struct sockaddr *)&address, sizeof(address)));
+        status = (true == isBound) && (0 == listen(listener, (int)SERVER_MAX_CLIENT));
+    }
+
+    if (true == status)
+    {
+        for (i = 0; i < SERVER_MAX_CLIENT; i++)
+        {
+            s_Clients[i] = -1;
+        }
+        s_IsStopping = 0;
+        memset(&action, 0, sizeof(action));
+        sigemptyset(&action.sa_mask);
+        action.sa_handler = SERVER_Stop;
+        (void)sigaction(SIGINT, &action, &oldInterrupt);
+        (void)sigaction(SIGTERM, &action, &oldTerminate);
+        action.sa_handler = SIG_IGN; /*A client leaving while it is answered must not stop the daemon*/
+        (void)sigaction(SIGPIPE, &action, &oldPipe);
+
+        listening.fd = listener;
+        listening.events = POLLIN;
+        while (0 == s_IsStopping)
+        {
+            if (0 < poll(&listening, 1, SERVER_POLL_MS))
+            {
+                SERVER_Accept(accept4(listener, NULL, NULL, SOCK_CLOEXEC));
+            }
+        }
+
+        /*Wake the clients waiting for a request and wait for their threads*/
+        pthread_mutex_lock(&s_Lock);
+        for (i = 0; i < SERVER_MAX_CLIENT; i++)
+        {
+            if (0 <= s_Clients[i])
+            {
+                (void)shutdown(s_Clients[i], SHUT_RDWR);
+            }
+        }
+        while (0 != s_SumClient)
+        {
+            pthread_cond_wait(&s_Left, &s_Lock);
+        }
+        pthread_mutex_unlock(&s_Lock);
+
+        (void)sigaction(SIGINT, &oldInterrupt, NULL);
+        (void)sigaction(SIGTERM, &oldTerminate, NULL);
+        (void)sigaction(SIGPIPE, &oldPipe, NULL);
+    }
+
+    if (0 <= listener)
+    {
+        close(listener);
+    }
+    if (true == isBound)
+    {
+        (void)unlink((const char *)socketPath);
+    }
+    if (0 <= s_ImageDescriptor)
+    {
+        close(s_ImageDescriptor);
+        s_ImageDescriptor = -1;
+    }
+    if (true == isMounted)
+    {
+        FATFS_DeInit();
+    }
+
+    return status;
+}
+
+int SERVER_Connect(const uint8_t *const socketPath, int *const imageDescriptor, uint32_t *const sizeOfCluster)
+{
+    int connection = -1; /*return value */
+    struct sockaddr_un address;
+    struct msghdr message;
+    struct iovec vector;
+    struct cmsghdr *control = NULL;
+    union
+    {
+        struct cmsghdr header; /*Aligns the buffer*/
+        uint8_t buffer[CMSG_SPACE(sizeof(int))];
+    } controlBuffer;
+    char greeting[SERVER_GREETING_MAX];
+    ssize_t sizeOfGreeting = 0;
+    unsigned int fatType = 0;
+    unsigned int cluster = 0;
+
+    *imageDescriptor = -1;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen((const char *)socketPath) < sizeof(address.sun_path))
+    {
+        strcpy(address.sun_path, (const char *)socketPath);
+        connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    }
+    if ((0 <= connection) && (0 != connect(connection, (const struct sockaddr *)&address, sizeof(address))))
+    {
+        close(connection);
+        connection = -1;
+    }
+
+    if (0 <= connection)
+    {
+        /*The greeting comes in one message with the descriptor*/
+        memset(&message, 0, sizeof(message));
+        memset(&controlBuffer, 0, sizeof(controlBuffer));
+        vector.iov_base = greeting;
+        vector.iov_len = sizeof(greeting) - 1u;
+        message.msg_iov = &vector;
+        message.msg_iovlen = 1;
+        message.msg_control = controlBuffer.buffer;
+        message.msg_controllen = sizeof(controlBuffer.buffer);
+        sizeOfGreeting = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+        control = CMSG_FIRSTHDR(&message);
+        if ((NULL != control) && (SOL_SOCKET == control->cmsg_level) && (SCM_RIGHTS == control->cmsg_type))
+        {
+            memcpy(imageDescriptor, CMSG_DATA(control), sizeof(int));
+        }
+        greeting[(0 < sizeOfGreeting) ? sizeOfGreeting : 0] = 0;
+        if ((0 > *imageDescriptor) || (2 != sscanf(greeting, "FAT %u %u", &fatType, &cluster)))
+        {
+            close(connection);
+            connection = -1;
+        }
+        else
+        {
+            *sizeOfCluster = cluster;
+        }
+    }
+    if ((0 > connection) && (0 <= *imageDescriptor))
+    {
+        close(*imageDescriptor);
+        *imageDescriptor = -1;
+    }
+
+    return connection;
+}
+
+bool SERVER_Request(const int connection, const char *const request, const SERVER_LineCallback_t callback, void *const context)
+{
+    bool status = true; /*return value */
+    char buffer[SERVER_LINE_MAX + 1u];
+    char *end = NULL;
+    size_t sizeOfRequest = strlen(request);
+    size_t sumByte = 0;
+    ssize_t sizeOfChunk = 0;
+    bool isDone = false;
+
+    /*Request*/
+    status = (sizeOfRequest < SERVER_LINE_MAX);
+    if (true == status)
+    {
+        memcpy(buffer, request, sizeOfRequest);
+        buffer[sizeOfRequest] = '\n';
+        sizeOfRequest++;
+    }
+    while ((true == status) && (sumByte < sizeOfRequest))
+    {
+        sizeOfChunk = send(connection, &buffer[sumByte], sizeOfRequest - sumByte, MSG_NOSIGNAL);
+        status = (0 < sizeOfChunk);
+        sumByte += (true == status) ? (size_t)sizeOfChunk : 0u;
+    }
+
+    /*Reply : nothing follows "END", so the buffer never holds bytes of the next reply*/
+    sumByte = 0;
+    while ((true == status) && (false == isDone))
+    {
+        buffer[sumByte] = 0;
+        end = strchr(buffer, '\n');
+        if (NULL == end)
+        {
+            sizeOfChunk = (sumByte < SERVER_LINE_MAX) ? recv(connection, &buffer[sumByte], SERVER_LINE_MAX - sumByte, 0) : 0;
+            status = (0 < sizeOfChunk);
+            sumByte += (true == status) ? (size_t)sizeOfChunk : 0u;
+        }
+        else
+        {
+            *end = 0;
+            if (0 == strcmp(buffer, "END"))
+            {
+                isDone = true;
+            }
+            else
+            {
+                status = (true == callback(buffer, context)) && (0 != strncmp(buffer, "ERROR", 5u));
+            }
+            sumByte -= (size_t)(end + 1 - buffer);
+            memmove(buffer, end + 1, sumByte);
+        }
+    }
+
+    return status;
+}
+
+bool SERVER_ReadFile(const int connection, const int imageDescriptor, const uint8_t *const path, const FATFS_DataCallback_t callback, void *const context)
+{
+    bool status = true; /*return value */
+    SERVER_File_Struct_t file;
+    char request[SERVER_LINE_MAX];
+
+    file.imageDescriptor = imageDescriptor;
+    file.buffer = (uint8_t *)malloc(SERVER_CHUNK_SIZE);
+    file.callback = callback;
+    file.context = context;
+    status = (NULL != file.buffer) && ((int)sizeof(request) > snprintf(request, sizeof(request), "READ %s", path));
+    if (true == status)
+    {
+        status = SERVER_Request(connection, request, SERVER_ReadExtent, &file);
+    }
+    free(file.buffer);
+
+    return status;
+}
+
+void SERVER_Disconnect(const int connection, const int imageDescriptor)
+{
+    if (0 <= connection)
+    {
+        close(connection);
+    }
+    if (0 <= imageDescriptor)
+    {
+        close(imageDescriptor);
+    }
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static void SERVER_Stop(int signalNumber)
+{
+    (void)signalNumber;
+    s_IsStopping = 1;
+}
+
+static void SERVER_Accept(const int connection)
+{
+    pthread_t thread;
+    pthread_attr_t attributes;
+    uint32_t slot = 0;
+    bool isStarted = false;
+
+    if (0 <= connection)
+    {
+        pthread_mutex_lock(&s_Lock);
+        while ((slot < SERVER_MAX_CLIENT) && (0 <= s_Clients[slot]))
+        {
+            slot++;
+        }
+        if (slot < SERVER_MAX_CLIENT)
+        {
+            s_Clients[slot] = connection;
+            pthread_attr_init(&attributes);
+            pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+            isStarted = (0 == pthread_create(&thread, &attributes, SERVER_Serve, (void *)(uintptr_t)slot));
+            pthread_attr_destroy(&attributes);
+            s_SumClient += (true == isStarted) ? 1u : 0u;
+            s_Clients[slot] = (true == isStarted) ? connection : -1;
+        }
+        pthread_mutex_unlock(&s_Lock);
+        if (false == isStarted)
+        {
+            close(connection); /*Too many clients*/
+        }
+    }
+}
+
+static void *SERVER_Serve(void *argument)
+{
+    const uint32_t slot = (uint32_t)(uintptr_t)argument;
+    int connection = -1;
+    struct msghdr message;
+    struct iovec vector;
+    struct cmsghdr *control = NULL;
+    union
+    {
+        struct cmsghdr header; /*Aligns the buffer*/
+        uint8_t buffer[CMSG_SPACE(sizeof(int))];
+    } controlBuffer;
+    char greeting[SERVER_GREETING_MAX];
+    char line[SERVER_LINE_MAX];
+    FILE *input = NULL;
+    FILE *output = NULL;
+    char *end = NULL;
+    bool status = true;
+
+    pthread_mutex_lock(&s_Lock);
+    connection = s_Clients[slot];
+    pthread_mutex_unlock(&s_Lock);
+
+    /*Greeting with the image : the client reads file data itself*/
+    memset(&message, 0, sizeof(message));
+    memset(&controlBuffer, 0, sizeof(controlBuffer));
+    vector.iov_base = greeting;
+    vector.iov_len = (size_t)snprintf(greeting, sizeof(greeting), "FAT %u %u\n", s_Info.fatType, (uint32_t)s_Info.bytePerSector * s_Info.sectorPerCluster);
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = controlBuffer.buffer;
+    message.msg_controllen = sizeof(controlBuffer.buffer);
+    control = CMSG_FIRSTHDR(&message);
+    control->cmsg_level = SOL_SOCKET;
+    control->cmsg_type = SCM_RIGHTS;
+    control->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(control), &s_ImageDescriptor, sizeof(int));
+    status = ((ssize_t)vector.iov_len == sendmsg(connection, &message, MSG_NOSIGNAL));
+
+    if (true == status)
+    {
+        input = fdopen(dup(connection), "r");
+        output = fdopen(dup(connection), "w");
+        status = (NULL != input) && (NULL != output);
+    }
+    while ((true == status) && (NULL != fgets(line, sizeof(line), input)))
+    {
+        end = strpbrk(line, "\r\n");
+        if (NULL != end)
+        {
+            *end = 0;
+        }
+        SERVER_Answer(line, output);
+        status = (0 == fflush(output));
+    }
+    if (NULL != input)
+    {
+        fclose(input);
+    }
+    if (NULL != output)
+    {
+        fclose(output);
+    }
+
+    pthread_mutex_lock(&s_Lock);
+    close(connection);
+    s_Clients[slot] = -1;
+    s_SumClient--;
+    pthread_cond_signal(&s_Left);
+    pthread_mutex_unlock(&s_Lock);
+
+    return NULL;
+}
+
+static void SERVER_Answer(char *const line, FILE *const output)
+{
+    FATFS_Entry_Struct_t entry;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *current = NULL;
+    char *path = strchr(line, ' ');
+    const uint32_t sizeOfCluster = (uint32_t)s_Info.bytePerSector * s_Info.sectorPerCluster;
+    uint32_t cluster = 0;
+    uint32_t nextCluster = 0;
+    uint32_t sumCluster = 0;
+    uint32_t sizeLeft = 0;
+    uint32_t sizeOfRun = 0;
+    uint32_t i = 0;
+
+    if (NULL != path)
+    {
+        *path = 0;
+        path++;
+    }
+    else
+    {
+        path = line + strlen(line); /*No path : root*/
+    }
+
+    if ((0 != strcmp(line, "LIST")) && (0 != strcmp(line, "STAT")) && (0 != strcmp(line, "READ")))
+    {
+        fprintf(output, "ERROR unknown request\n");
+    }
+    else if (false == FATFS_Lookup((const uint8_t *)path, &entry))
+    {
+        fprintf(output, "ERROR not found\n");
+    }
+    else if (0 == strcmp(line, "STAT"))
+    {
+        SERVER_PrintEntry(&entry, output);
+        fprintf(output, "END\n");
+    }
+    else if (0 == strcmp(line, "LIST"))
+    {
+        if (0 == (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY))
+        {
+            fprintf(output, "ERROR not a folder\n");
+        }
+        else if (false == FATFS_DirOpen(&dir, entry.firstCluster))
+        {
+            fprintf(output, "ERROR can not read the folder\n");
+        }
+        else
+        {
+            for (current = FATFS_DirNext(&dir); NULL != current; current = FATFS_DirNext(&dir))
+            {
+                if ((0xe5u != current->shortFileName[0]) && (0 == (current->attributes & 0x08u)))
+                {
+                    SERVER_PrintEntry(current, output);
+                }
+            }
+            FATFS_DirClose(&dir);
+            fprintf(output, "END\n");
+        }
+    }
+    else if (0 != (entry.attributes & FATFS_ATTRIBUTE_DIRECTORY))
+    {
+        fprintf(output, "ERROR not a file\n");
+    }
+    else
+    {
+        /*Runs of contiguous clusters, cut at the size of the file*/
+        cluster = entry.firstCluster;
+        sizeLeft = entry.fileSize;
+        while ((0 != sizeLeft) && (2u <= cluster) && (sumCluster < s_Info.totalClusters))
+        {
+            i = 1;
+            while (((uint64_t)i * sizeOfCluster < sizeLeft) && (true == FATFS_GetNextCluster(cluster, &nextCluster)) && ((cluster + 1u) == nextCluster))
+            {
+                cluster = nextCluster;
+                i++;
+            }
+            sizeOfRun = ((uint64_t)i * sizeOfCluster < sizeLeft) ? (i * sizeOfCluster) : sizeLeft;
+            fprintf(output, "EXTENT %llu %u\n",
+                    (unsigned long long)((uint64_t)s_Info.locationOfData + (uint64_t)(cluster + 1u - i - 2u) * s_Info.sectorPerCluster) * s_Info.bytePerSector, sizeOfRun);
+            sizeLeft -= sizeOfRun;
+            sumCluster += i;
+            cluster = (true == FATFS_GetNextCluster(cluster, &nextCluster)) ? nextCluster : 0;
+        }
+        fprintf(output, (0 == sizeLeft) ? "END\n" : "ERROR the chain is shorter than the file\n");
+    }
+}
+
+static void SERVER_PrintEntry(const FATFS_Entry_Struct_t *const entry, FILE *const output)
+{
+    uint8_t shortName[FATFS_SHORT_NAME_SIZE];
+
+    FATFS_GetShortName(entry, shortName);
+    fprintf(output, "ENTRY %02x %u %u %s\n", entry->attributes, entry->fileSize, entry->firstCluster, (0 != entry->longFileName[0]) ? entry->longFileName : shortName);
+}
+
+static bool SERVER_ReadExtent(const char *const line, void *const context)
+{
+    SERVER_File_Struct_t *const file = (SERVER_File_Struct_t *)context;
+    unsigned long long offset = 0;
+    unsigned int sizeLeft = 0;
+    uint32_t sizeOfChunk = 0;
+    ssize_t sizeOfRead = 0;
+    bool status = (2 == sscanf(line, "EXTENT %llu %u", &offset, &sizeLeft)); /*return value */
+
+    while ((true == status) && (0 != sizeLeft))
+    {
+        sizeOfChunk = (sizeLeft < SERVER_CHUNK_SIZE) ? sizeLeft : SERVER_CHUNK_SIZE;
+        sizeOfRead = pread(file->imageDescriptor, file->buffer, sizeOfChunk, (off_t)offset);
+        status = (0 < sizeOfRead) && (true == file->callback(file->buffer, (uint32_t)sizeOfRead, file->context));
+        offset += (true == status) ? (unsigned long long)sizeOfRead : 0u;
+        sizeLeft -= (true == status) ? (unsigned int)sizeOfRead : 0u;
+    }
+
+    return status;
+}
@@ -0,0 +1,89 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Protocol (text, one request line, reply lines ended by "END" or one "ERROR <reason>" line) :
+ *  on connect     "FAT <12|16|32> <bytes per cluster>" with the descriptor of the image (SCM_RIGHTS, read only)
+ *  LIST <path>    "ENTRY <attributes> <size> <first cluster> <name>" for each entry of the folder
+ *  STAT <path>    "ENTRY ..." of the entry
+ *  READ <path>    "EXTENT <offset in image> <bytes>" for each run of the file : the client reads the data itself
+ *                 with pread on the descriptor (no copy through the socket)
+ */
+
+/*
+ *Longest request or reply line (path or long file name included)
+ */
+#define SERVER_LINE_MAX (4096u)
+
+/*
+ *Size of the chunks read from the image by SERVER_ReadFile
+ */
+#define SERVER_CHUNK_SIZE (1024u * 1024u)
+
+/*
+ *Clients served at the same time (one thread each), others are refused
+ */
+#define SERVER_MAX_CLIENT (64u)
+
+/*
+ *Called by SERVER_Request for each reply line ("END" excluded, "ERROR ..." included, '\n' removed). Returns false
+ *to stop reading the reply : the connection can not be used after
+ */
+typedef bool (*SERVER_LineCallback_t)(const char *const line, void *const context);
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  SERVER_Run
+ * @brief Mount the image once and serve clients on a Unix socket until SIGINT or SIGTERM. The FAT stays in memory
+ *        for every client, file data is shared through the page cache
+ * @param[in] imagePath   Path of the image (opened read only)
+ * @param[in] socketPath   Path of the socket (an old socket file is replaced, the file is removed at the end)
+ * @return bool Returns false if the image could not be mounted, is compressed or the socket could not be created
+ */
+bool SERVER_Run(const uint8_t *const imagePath, const uint8_t *const socketPath);
+
+/**  SERVER_Connect
+ * @brief Connect to a daemon and receive the descriptor of its image
+ * @param[in] socketPath   Path of the socket
+ * @param[out] imageDescriptor   Descriptor of the image (closed by the caller)
+ * @param[out] sizeOfCluster   Bytes per cluster of the volume
+ * @return int Returns the descriptor of the connection or -1
+ */
+int SERVER_Connect(const uint8_t *const socketPath, int *const imageDescriptor, uint32_t *const sizeOfCluster);
+
+/**  SERVER_Request
+ * @brief Send one request and give each reply line to a callback
+ * @param[in] connection   Descriptor returned by SERVER_Connect
+ * @param[in] request   Request without '\n' ("LIST docs")
+ * @param[in] callback   Called for each reply line
+ * @param[in] context   Given to callback
+ * @return bool Returns false if the reply is an error, the connection failed or the callback stopped
+ */
+bool SERVER_Request(const int connection, const char *const request, const SERVER_LineCallback_t callback, void *const context);
+
+/**  SERVER_ReadFile
+ * @brief Ask the runs of a file and read them from the descriptor of the image, in chunks given to a callback
+ * @param[in] connection   Descriptor returned by SERVER_Connect
+ * @param[in] imageDescriptor   Descriptor of the image returned by SERVER_Connect
+ * @param[in] path   Path of the file in the image
+ * @param[in] callback   Called for each chunk (at most SERVER_CHUNK_SIZE bytes), in order
+ * @param[in] context   Given to callback
+ * @return bool Returns false if the file was not found, a read failed or the callback stopped
+ */
+bool SERVER_ReadFile(const int connection, const int imageDescriptor, const uint8_t *const path, const FATFS_DataCallback_t callback, void *const context);
+
+/**  SERVER_Disconnect
+ * @brief Close a connection and the descriptor of the image it gave
+ * @param[in] connection   Descriptor returned by SERVER_Connect
+ * @param[in] imageDescriptor   Descriptor of the image returned by SERVER_Connect
+ * @return none
+ */
+void SERVER_Disconnect(const int connection, const int imageDescriptor);
+
+#endif /*__SERVER_H__*/
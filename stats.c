@@ -0,0 +1,480 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "stats.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Each thread adds to its own shard with a relaxed load and store (no locked instruction). Threads after the
+ *first STATS_SUM_SHARD - 1 share the last shard, which uses atomic additions
+ */
+#define STATS_SUM_SHARD (64u)
+
+typedef struct
+{
+    uint64_t values[STATS_SUM_COUNTER];
+} __attribute__((aligned(64))) STATS_Shard_Struct_t; /*One cache line per thread at least : no false sharing*/
+
+/*
+ *Buckets of a histogram : values under 8 ns have their own bucket, then each power of 2 is split in 8
+ */
+#define STATS_SUB_BUCKET_BIT (3u)
+#define STATS_SUM_SUB_BUCKET (1u << STATS_SUB_BUCKET_BIT)
+#define STATS_SUM_BUCKET ((64u - STATS_SUB_BUCKET_BIT + 1u) * STATS_SUM_SUB_BUCKET)
+
+/*
+ *Histogram of an operation. Calls take microseconds at least (system calls), so atomic additions are cheap enough
+ */
+typedef struct
+{
+    uint64_t buckets[STATS_SUM_BUCKET];
+    uint64_t sumCall;
+    uint64_t sumTime; /*ns*/
+    uint64_t maxTime; /*ns*/
+} STATS_Histogram_Struct_t;
+
+/*
+ *Event of the trace. sequence (index of the event + 1) is written last : 0 or another value means the slot is
+ *being replaced
+ */
+typedef struct
+{
+    uint64_t sequence;
+    uint64_t begin;    /*ns*/
+    uint64_t duration; /*ns*/
+    uint32_t thread;
+    uint32_t operation;
+} STATS_Event_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static STATS_Shard_Struct_t s_Shards[STATS_SUM_SHARD]; /*Only changed with relaxed atomics*/
+
+static uint32_t s_SumShardUsed = 0;
+
+static __thread STATS_Shard_Struct_t *s_Shard = NULL; /*Shard of the calling thread (NULL until its first count)*/
+
+static uint64_t s_EndOfLastRead = 0; /*Offset following the previous read, to detect seeks*/
+
+static STATS_Histogram_Struct_t s_Histograms[STATS_SUM_OPERATION];
+
+static STATS_Event_Struct_t *s_Events = NULL; /*Ring buffer of the trace, NULL when it is stopped*/
+static uint32_t s_SumEvent = 0;
+static uint64_t s_NextEvent = 0;   /*Index of the next event (not wrapped)*/
+static uint64_t s_StartOfTrace = 0; /*ns*/
+static uint32_t s_SumWriter = 0;    /*Threads that may be writing an event : the ring buffer is freed when it drops to 0*/
+
+static __thread uint32_t s_Thread = 0; /*Id of the calling thread in the trace (0 until its first event)*/
+
+static const char *const s_NameOfCounter[STATS_SUM_COUNTER] = {
+    "read_sector_calls",
+    "read_multi_sector_calls",
+    "bytes_read",
+    "seeks",
+    "long_jumps",
+    "write_calls",
+    "bytes_written",
+    "fat_lookups",
+    "clusters_followed",
+    "entries_parsed",
+    "lfn_fragments",
+    "clusters_allocated",
+    "cache_hits",
+    "cache_misses",
+    "block_hits",
+    "blocks_decompressed",
+    "allocations",
+};
+
+static const char *const s_NameOfOperation[STATS_SUM_OPERATION] = {
+    "mount",
+    "read_directory",
+    "directory_block",
+    "lookup",
+    "file_read",
+    "hal_read",
+    "hal_write",
+};
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  STATS_GetShard
+ * @brief Get the shard of the calling thread, taking a new one on its first call
+ * @return STATS_Shard_Struct_t* Returns the shard
+ */
+static STATS_Shard_Struct_t *STATS_GetShard(void);
+
+/**  STATS_GetBucket
+ * @brief Find the bucket of a latency
+ * @param[in] value   Latency in ns
+ * @return uint32_t Returns the bucket
+ */
+static uint32_t STATS_GetBucket(const uint64_t value);
+
+/**  STATS_GetHighest
+ * @brief Get the highest latency of a bucket
+ * @param[in] bucket   Bucket
+ * @return uint64_t Returns the latency in ns
+ */
+static uint64_t STATS_GetHighest(const uint32_t bucket);
+
+/**  STATS_GetPercentile
+ * @brief Find a percentile in the buckets of a histogram
+ * @param[in] buckets   Copy of the buckets
+ * @param[in] sumCall   Sum of the buckets
+ * @param[in] perMille   Percentile in thousandths (990 : p99)
+ * @param[in] maxTime   Highest latency recorded (the result is not above it)
+ * @return uint64_t Returns the latency in ns
+ */
+static uint64_t STATS_GetPercentile(const uint64_t *const buckets, const uint64_t sumCall, const uint32_t perMille, const uint64_t maxTime);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+void STATS_Add(const STATS_Counter_t counter, const uint64_t value)
+{
+    STATS_Shard_Struct_t *const shard = (NULL != s_Shard) ? s_Shard : STATS_GetShard();
+
+    if (&s_Shards[STATS_SUM_SHARD - 1u] == shard)
+    {
+        __atomic_fetch_add(&shard->values[counter], value, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        /*Only this thread writes the shard : readers see either value*/
+        __atomic_store_n(&shard->values[counter], __atomic_load_n(&shard->values[counter], __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+    }
+}
+
+void STATS_AddRead(const uint64_t offset, const uint64_t size)
+{
+    const uint64_t endOfLastRead = __atomic_exchange_n(&s_EndOfLastRead, offset + size, __ATOMIC_RELAXED);
+
+    STATS_Add(STATS_BYTE_READ, size);
+    if (endOfLastRead != offset)
+    {
+        STATS_Add(STATS_SEEK, 1u);
+        if (((offset > endOfLastRead) ? (offset - endOfLastRead) : (endOfLastRead - offset)) > STATS_LONG_JUMP_BYTE)
+        {
+            STATS_Add(STATS_LONG_JUMP, 1u);
+        }
+    }
+}
+
+void STATS_Get(uint64_t *const values)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for (i = 0; i < STATS_SUM_COUNTER; i++)
+    {
+        values[i] = 0;
+        for (j = 0; j < STATS_SUM_SHARD; j++)
+        {
+            values[i] += __atomic_load_n(&s_Shards[j].values[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void *STATS_Malloc(const size_t size)
+{
+    void *memory = malloc(size); /*return value */
+
+    if (NULL != memory)
+    {
+        STATS_Add(STATS_ALLOCATION, 1u);
+    }
+
+    return memory;
+}
+
+void *STATS_Calloc(const size_t count, const size_t size)
+{
+    void *memory = calloc(count, size); /*return value */
+
+    if (NULL != memory)
+    {
+        STATS_Add(STATS_ALLOCATION, 1u);
+    }
+
+    return memory;
+}
+
+void *STATS_Realloc(void *const memory, const size_t size)
+{
+    void *newMemory = realloc(memory, size); /*return value */
+
+    if (NULL != newMemory)
+    {
+        STATS_Add(STATS_ALLOCATION, 1u);
+    }
+
+    return newMemory;
+}
+
+const char *STATS_GetName(const STATS_Counter_t counter)
+{
+    return s_NameOfCounter[counter];
+}
+
+void STATS_Reset(void)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for (j = 0; j < STATS_SUM_SHARD; j++)
+    {
+        for (i = 0; i < STATS_SUM_COUNTER; i++)
+        {
+            __atomic_store_n(&s_Shards[j].values[i], 0u, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&s_EndOfLastRead, 0u, __ATOMIC_RELAXED);
+}
+
+uint64_t STATS_Begin(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+void STATS_End(const STATS_Operation_t operation, const uint64_t begin)
+{
+    STATS_Histogram_Struct_t *const histogram = &s_Histograms[operation];
+    STATS_Event_Struct_t *events = NULL;
+    STATS_Event_Struct_t *event = NULL;
+    const uint64_t duration = STATS_Begin() - begin;
+    uint64_t maxTime = __atomic_load_n(&histogram->maxTime, __ATOMIC_RELAXED);
+    uint64_t index = 0;
+    bool isWriter = false;
+
+    __atomic_fetch_add(&histogram->buckets[STATS_GetBucket(duration)], 1u, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sumCall, 1u, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->sumTime, duration, __ATOMIC_RELAXED);
+    while ((duration > maxTime) && (false == __atomic_compare_exchange_n(&histogram->maxTime, &maxTime, duration, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)))
+    {
+        /*maxTime was reloaded : try again while this one is higher*/
+    }
+
+    /*Counted as a writer before the buffer is taken : STATS_WriteTrace sees the count, or this load sees the trace stopped*/
+    if (NULL != __atomic_load_n(&s_Events, __ATOMIC_RELAXED))
+    {
+        __atomic_fetch_add(&s_SumWriter, 1u, __ATOMIC_SEQ_CST);
+        isWriter = true;
+        events = __atomic_load_n(&s_Events, __ATOMIC_SEQ_CST);
+    }
+    if (NULL != events)
+    {
+        if (0 == s_Thread)
+        {
+            s_Thread = (uint32_t)syscall(SYS_gettid);
+        }
+        index = __atomic_fetch_add(&s_NextEvent, 1u, __ATOMIC_RELAXED);
+        event = &events[index % s_SumEvent];
+        __atomic_store_n(&event->sequence, 0u, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        event->begin = begin;
+        event->duration = duration;
+        event->thread = s_Thread;
+        event->operation = (uint32_t)operation;
+        __atomic_store_n(&event->sequence, index + 1u, __ATOMIC_RELEASE);
+    }
+    if (true == isWriter)
+    {
+        __atomic_fetch_sub(&s_SumWriter, 1u, __ATOMIC_RELEASE);
+    }
+}
+
+void STATS_GetLatency(const STATS_Operation_t operation, STATS_Latency_Struct_t *const latency)
+{
+    const STATS_Histogram_Struct_t *const histogram = &s_Histograms[operation];
+    uint64_t buckets[STATS_SUM_BUCKET];
+    uint64_t sumCall = 0;
+    uint32_t i = 0;
+
+    /*The sum of the copied buckets is used : calls recorded meanwhile do not break the percentiles*/
+    for (i = 0; i < STATS_SUM_BUCKET; i++)
+    {
+        buckets[i] = __atomic_load_n(&histogram->buckets[i], __ATOMIC_RELAXED);
+        sumCall += buckets[i];
+    }
+    latency->sumCall = sumCall;
+    latency->max = __atomic_load_n(&histogram->maxTime, __ATOMIC_RELAXED);
+    latency->mean = (0 != sumCall) ? (__atomic_load_n(&histogram->sumTime, __ATOMIC_RELAXED) / sumCall) : 0u;
+    latency->p50 = STATS_GetPercentile(buckets, sumCall, 500u, latency->max);
+    latency->p90 = STATS_GetPercentile(buckets, sumCall, 900u, latency->max);
+    latency->p99 = STATS_GetPercentile(buckets, sumCall, 990u, latency->max);
+    latency->p999 = STATS_GetPercentile(buckets, sumCall, 999u, latency->max);
+}
+
+const char *STATS_GetOperationName(const STATS_Operation_t operation)
+{
+    return s_NameOfOperation[operation];
+}
+
+void STATS_ResetLatency(void)
+{
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    for (i = 0; i < STATS_SUM_OPERATION; i++)
+    {
+        for (j = 0; j < STATS_SUM_BUCKET; j++)
+        {
+            __atomic_store_n(&s_Histograms[i].buckets[j], 0u, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&s_Histograms[i].sumCall, 0u, __ATOMIC_RELAXED);
+        __atomic_store_n(&s_Histograms[i].sumTime, 0u, __ATOMIC_RELAXED);
+        __atomic_store_n(&s_Histograms[i].maxTime, 0u, __ATOMIC_RELAXED);
+    }
+}
+
+bool STATS_StartTrace(const uint32_t sumEvent)
+{
+    bool status = (NULL == s_Events); /*return value */
+    STATS_Event_Struct_t *events = NULL;
+
+    if (true == status)
+    {
+        s_SumEvent = (0 != sumEvent) ? sumEvent : STATS_TRACE_DEFAULT_EVENT;
+        events = (STATS_Event_Struct_t *)calloc(s_SumEvent, sizeof(STATS_Event_Struct_t));
+        status = (NULL != events);
+    }
+    if (true == status)
+    {
+        s_NextEvent = 0;
+        s_StartOfTrace = STATS_Begin();
+        __atomic_store_n(&s_Events, events, __ATOMIC_RELEASE);
+    }
+
+    return status;
+}
+
+bool STATS_WriteTrace(const uint8_t *const path)
+{
+    bool status = true; /*return value */
+    STATS_Event_Struct_t *const events = __atomic_exchange_n(&s_Events, NULL, __ATOMIC_SEQ_CST);
+    const STATS_Event_Struct_t *event = NULL;
+    const int process = (int)getpid();
+    FILE *file = NULL;
+    uint64_t nextEvent = 0;
+    uint64_t index = 0;
+
+    /*Threads inside STATS_End may still write into the buffer : wait for them before reading and freeing it*/
+    while (0 != __atomic_load_n(&s_SumWriter, __ATOMIC_SEQ_CST))
+    {
+        sched_yield();
+    }
+    nextEvent = __atomic_load_n(&s_NextEvent, __ATOMIC_RELAXED);
+    status = (NULL != events);
+    if (true == status)
+    {
+        file = fopen((const char *)path, "w");
+        status = (NULL != file);
+    }
+    if (true == status)
+    {
+        /*Complete events ("X") : times in microseconds from the start of the trace*/
+        fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+        fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": 0, \"args\": {\"name\": \"fat %d\"}}", process, process);
+        for (index = (nextEvent > s_SumEvent) ? (nextEvent - s_SumEvent) : 0u; index < nextEvent; index++)
+        {
+            event = &events[index % s_SumEvent];
+            if ((index + 1u) == __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE))
+            {
+                fprintf(file, ",\n{\"name\": \"%s\", \"cat\": \"fatfs\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %u}",
+                        s_NameOfOperation[event->operation],
+                        (event->begin >= s_StartOfTrace) ? ((double)(event->begin - s_StartOfTrace) / 1000.0) : 0.0,
+                        (double)event->duration / 1000.0, process, event->thread);
+            }
+        }
+        fprintf(file, "\n]}\n");
+        status = (0 == fclose(file));
+    }
+    free(events);
+
+    return status;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static STATS_Shard_Struct_t *STATS_GetShard(void)
+{
+    uint32_t index = __atomic_fetch_add(&s_SumShardUsed, 1u, __ATOMIC_RELAXED);
+
+    s_Shard = &s_Shards[(index < (STATS_SUM_SHARD - 1u)) ? index : (STATS_SUM_SHARD - 1u)];
+
+    return s_Shard;
+}
+
+static uint32_t STATS_GetBucket(const uint64_t value)
+{
+    uint32_t bucket = (uint32_t)value; /*return value */
+    uint32_t exponent = 0;
+
+    if (value >= STATS_SUM_SUB_BUCKET)
+    {
+        /*Position of the highest bit, then the 3 bits following it*/
+        exponent = 63u - (uint32_t)__builtin_clzll(value);
+        bucket = (exponent - STATS_SUB_BUCKET_BIT + 1u) * STATS_SUM_SUB_BUCKET + (uint32_t)((value >> (exponent - STATS_SUB_BUCKET_BIT)) & (STATS_SUM_SUB_BUCKET - 1u));
+    }
+
+    return bucket;
+}
+
+static uint64_t STATS_GetHighest(const uint32_t bucket)
+{
+    uint64_t highest = bucket; /*return value */
+    uint32_t exponent = 0;
+
+    if (bucket >= STATS_SUM_SUB_BUCKET)
+    {
+        exponent = bucket / STATS_SUM_SUB_BUCKET + STATS_SUB_BUCKET_BIT - 1u;
+        highest = (((uint64_t)(STATS_SUM_SUB_BUCKET + bucket % STATS_SUM_SUB_BUCKET) + 1u) << (exponent - STATS_SUB_BUCKET_BIT)) - 1u;
+    }
+
+    return highest;
+}
+
+static uint64_t STATS_GetPercentile(const uint64_t *const buckets, const uint64_t sumCall, const uint32_t perMille, const uint64_t maxTime)
+{
+    uint64_t value = 0; /*return value */
+    uint64_t rank = (sumCall * perMille + 999u) / 1000u; /*Calls at or below the percentile*/
+    uint64_t sumBelow = 0;
+    uint32_t i = 0;
+
+    if (0 != sumCall)
+    {
+        rank = (0 != rank) ? rank : 1u;
+        for (i = 0; (i < STATS_SUM_BUCKET) && (sumBelow < rank); i++)
+        {
+            sumBelow += buckets[i];
+        }
+        value = STATS_GetHighest(i - 1u);
+        value = (value < maxTime) ? value : maxTime;
+    }
+
+    return value;
+}
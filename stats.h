@@ -0,0 +1,188 @@
+#ifndef __STATS_H__
+#define __STATS_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Counters of the process (only STATS_Reset sets them to 0, mounts do not)
+ */
+typedef enum
+{
+    STATS_READ_SECTOR = 0,      /*Calls of HAL_ReadSector*/
+    STATS_READ_MULTI_SECTOR,    /*Calls of HAL_ReadMultiSector*/
+    STATS_BYTE_READ,            /*Bytes read from the image*/
+    STATS_SEEK,                 /*Reads not starting where the previous read ended*/
+    STATS_LONG_JUMP,            /*Seeks of more than STATS_LONG_JUMP_BYTE, forward or backward*/
+    STATS_WRITE,                /*Calls of HAL_WriteMultiSector*/
+    STATS_BYTE_WRITTEN,         /*Bytes written to the image*/
+    STATS_FAT_LOOKUP,           /*Elements of the FAT read to follow or test a chain*/
+    STATS_CLUSTER_FOLLOWED,     /*Lookups that led to another cluster of the chain*/
+    STATS_ENTRY_PARSED,         /*Main entries returned by FATFS_DirNext*/
+    STATS_LFN_FRAGMENT,         /*Long file name sub entries assembled*/
+    STATS_CLUSTER_ALLOCATED,    /*Clusters given to files and folders*/
+    STATS_CACHE_HIT,            /*Sectors found in the write cache*/
+    STATS_CACHE_MISS,           /*Sectors read (or zeroed) into the write cache*/
+    STATS_BLOCK_HIT,            /*Blocks of a compressed image found decompressed in its cache*/
+    STATS_BLOCK_DECOMPRESSED,   /*Blocks of a compressed image decompressed*/
+    STATS_ALLOCATION,           /*Successful allocations of the volume modules (STATS_Malloc, STATS_Calloc, STATS_Realloc, HAL_AllocBuffer)*/
+    STATS_SUM_COUNTER
+} STATS_Counter_t;
+
+/*
+ *Distance from the end of the previous read counted as a long jump
+ */
+#define STATS_LONG_JUMP_BYTE (1024u * 1024u)
+
+/*
+ *Operations whose latency is recorded (histograms are kept for the whole process, mounts do not reset them)
+ */
+typedef enum
+{
+    STATS_OPERATION_MOUNT = 0,      /*FATFS_Init, FATFS_InitWritable, FATFS_InitMemory*/
+    STATS_OPERATION_READ_DIRECTORY, /*FATFS_ReadDirectory (whole folder)*/
+    STATS_OPERATION_DIRECTORY_BLOCK,/*Block of folder read by FATFS_DirNext*/
+    STATS_OPERATION_LOOKUP,         /*FATFS_Lookup (path to entry)*/
+    STATS_OPERATION_FILE_READ,      /*FATFS_ReadData, FATFS_StreamData (callback included)*/
+    STATS_OPERATION_HAL_READ,       /*HAL_ReadSector, HAL_ReadMultiSector*/
+    STATS_OPERATION_HAL_WRITE,      /*HAL_WriteMultiSector*/
+    STATS_SUM_OPERATION
+} STATS_Operation_t;
+
+/*
+ *Summary of the latencies of an operation, in nanoseconds. Percentiles are the highest value of their bucket
+ *(buckets are log2 ranges split in 8, values are within 12.5 %)
+ */
+typedef struct
+{
+    uint64_t sumCall;  /*Calls recorded*/
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+} STATS_Latency_Struct_t;
+
+/*
+ *Events kept by the tracer when no size is given
+ */
+#define STATS_TRACE_DEFAULT_EVENT (65536u)
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  STATS_Add
+ * @brief Add to a counter. Each thread counts in its own shard with relaxed atomics (no lock) : can be called
+ *        by several threads and stays cheap under load
+ * @param[in] counter   Counter
+ * @param[in] value   Value added
+ * @return none
+ */
+void STATS_Add(const STATS_Counter_t counter, const uint64_t value);
+
+/**  STATS_AddRead
+ * @brief Count a read of the image : bytes, and a seek (and maybe a long jump) if it does not start where the
+ *        previous read ended
+ * @param[in] offset   Offset in bytes of the read
+ * @param[in] size   Number of bytes read
+ * @return none
+ */
+void STATS_AddRead(const uint64_t offset, const uint64_t size);
+
+/**  STATS_Get
+ * @brief Read all counters (each one is read atomically, the set is not a single snapshot under load)
+ * @param[out] values   STATS_SUM_COUNTER values, in the order of STATS_Counter_t
+ * @return none
+ */
+void STATS_Get(uint64_t *const values);
+
+/**  STATS_Malloc
+ * @brief malloc that counts STATS_ALLOCATION when it succeeds. Used by the volume modules for every heap buffer
+ * @param[in] size   Size in bytes
+ * @return void* Returns the buffer (free it with free) or NULL
+ */
+void *STATS_Malloc(const size_t size);
+
+/**  STATS_Calloc
+ * @brief calloc that counts STATS_ALLOCATION when it succeeds
+ * @param[in] count   Number of elements
+ * @param[in] size   Size in bytes of an element
+ * @return void* Returns the zeroed buffer (free it with free) or NULL
+ */
+void *STATS_Calloc(const size_t count, const size_t size);
+
+/**  STATS_Realloc
+ * @brief realloc that counts STATS_ALLOCATION when it succeeds
+ * @param[in] memory   Buffer to resize (NULL : new buffer)
+ * @param[in] size   New size in bytes
+ * @return void* Returns the buffer (memory is still valid if NULL is returned)
+ */
+void *STATS_Realloc(void *const memory, const size_t size);
+
+/**  STATS_GetName
+ * @brief Get the name of a counter (snake case, used by --stats)
+ * @param[in] counter   Counter
+ * @return const char* Returns the name
+ */
+const char *STATS_GetName(const STATS_Counter_t counter);
+
+/**  STATS_Begin
+ * @brief Read the clock at the start of an operation
+ * @return uint64_t Returns the time in nanoseconds (monotonic clock), given to STATS_End
+ */
+uint64_t STATS_Begin(void);
+
+/**  STATS_End
+ * @brief Record the latency of an operation in its histogram, and in the trace when it is started
+ * @param[in] operation   Operation
+ * @param[in] begin   Value returned by STATS_Begin
+ * @return none
+ */
+void STATS_End(const STATS_Operation_t operation, const uint64_t begin);
+
+/**  STATS_GetLatency
+ * @brief Get the count, mean, percentiles and maximum of the latencies of an operation
+ * @param[in] operation   Operation
+ * @param[out] latency   Summary (all 0 when nothing was recorded)
+ * @return none
+ */
+void STATS_GetLatency(const STATS_Operation_t operation, STATS_Latency_Struct_t *const latency);
+
+/**  STATS_GetOperationName
+ * @brief Get the name of an operation (snake case, used by --stats and the trace)
+ * @param[in] operation   Operation
+ * @return const char* Returns the name
+ */
+const char *STATS_GetOperationName(const STATS_Operation_t operation);
+
+/**  STATS_ResetLatency
+ * @brief Empty all histograms. No other thread may record at the same time
+ * @return none
+ */
+void STATS_ResetLatency(void);
+
+/**  STATS_StartTrace
+ * @brief Start recording every operation in a ring buffer : when it is full the oldest events are replaced
+ * @param[in] sumEvent   Size of the ring buffer in events (0 : STATS_TRACE_DEFAULT_EVENT)
+ * @return bool Returns false if there is not enough memory or the trace is already started
+ */
+bool STATS_StartTrace(const uint32_t sumEvent);
+
+/**  STATS_WriteTrace
+ * @brief Stop the trace and write its events as Chrome trace event JSON (chrome://tracing, Perfetto). Threads
+ *        recording meanwhile are waited for before the ring buffer is freed
+ * @param[in] path   Path of the JSON file
+ * @return bool Returns false if the trace was not started or the file could not be written
+ */
+bool STATS_WriteTrace(const uint8_t *const path);
+
+/**  STATS_Reset
+ * @brief Set all counters to 0. No other thread may count at the same time (the command line calls it before each command)
+ * @return none
+ */
+void STATS_Reset(void);
+
+#endif /*__STATS_H__*/
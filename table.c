@@ -0,0 +1,432 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "mystring.h"
+#include "fatfs.h"
+#include "index.h"
+#include "stats.h"
+#include "table.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*
+ *Radix sort : 4 passes of 8 bits
+ */
+#define TABLE_RADIX_BIT (8u)
+#define TABLE_RADIX_SIZE (256u)
+#define TABLE_RADIX_PASS (4u)
+
+/*
+ *Maximum depth of a path built by TABLE_GetPath
+ */
+#define TABLE_MAX_DEPTH (256u)
+
+/*
+ *Volume label attribute
+ */
+#define TABLE_ATTRIBUTE_VOLUME_LABEL (0x08u)
+
+/*
+ *Pack date and time of an entry as stored in a directory entry
+ */
+#define TABLE_PACK_ENTRY_DATE(d) (((uint32_t)(d).year << 9u) | ((uint32_t)(d).month << 5u) | (uint32_t)(d).day)
+#define TABLE_PACK_ENTRY_TIME(t) (((uint32_t)(t).hours << 11u) | ((uint32_t)(t).minutes << 5u) | (uint32_t)(t).seconds)
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static const uint8_t *s_NamesToSort = NULL;          /*Names used by TABLE_CompareName while sorting*/
+static const uint32_t *s_NameOffsetToSort = NULL;    /*Name offsets used by TABLE_CompareName while sorting*/
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  TABLE_AddRow
+ * @brief Append a row
+ * @param[in,out] table   Table
+ * @param[in] name   Name of the row
+ * @param[in] size   Size of file
+ * @param[in] modified   Packed last modified
+ * @param[in] attributes   Attributes
+ * @param[in] firstCluster   First cluster
+ * @param[in] parent   Row of parent
+ * @return bool Returns true if success
+ */
+static bool TABLE_AddRow(TABLE_Table_Struct_t *const table, const uint8_t *const name, const uint32_t size, const uint32_t modified,
+                         const uint8_t attributes, const uint32_t firstCluster, const uint32_t parent);
+
+/**  TABLE_CompareName
+ * @brief Compare names of 2 rows for qsort
+ * @param[in] first   first row
+ * @param[in] second   second row
+ * @return int Returns the order of the names ignoring case
+ */
+static int TABLE_CompareName(const void *first, const void *second);
+
+/**  TABLE_IsSelected
+ * @brief Evaluate the filter on one row
+ * @param[in] table   Table
+ * @param[in] filter   Filter
+ * @param[in] row   Row
+ * @return uint32_t Returns 1 if selected, 0 otherwise
+ */
+static inline uint32_t TABLE_IsSelected(const TABLE_Table_Struct_t *const table, const TABLE_Filter_Struct_t *const filter, const uint32_t row);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool TABLE_Build(TABLE_Table_Struct_t *const table)
+{
+    bool status = true; /*return value */
+    FATFS_VolumeInfo_Struct_t info;
+    FATFS_Dir_Struct_t dir;
+    const FATFS_Entry_Struct_t *entry = NULL;
+    uint8_t shortName[FATFS_SHORT_NAME_SIZE];
+    uint8_t *visited = NULL; /*Bitmap of folders already read, to stop on a looping tree*/
+    uint32_t row = 0;
+    uint32_t cluster = 0;
+
+    memset(table, 0, sizeof(TABLE_Table_Struct_t));
+    FATFS_GetVolumeInfo(&info);
+    visited = (uint8_t *)STATS_Calloc((info.totalClusters + 2u) / 8u + 1u, sizeof(uint8_t));
+    status = (NULL != visited) && TABLE_AddRow(table, (const uint8_t *)"", 0, 0, FATFS_ATTRIBUTE_DIRECTORY, info.rootCluster, 0);
+
+    /*Breadth first, one pass over every folder*/
+    for (row = 0; (true == status) && (row < table->sumRow); row++)
+    {
+        cluster = table->firstCluster[row];
+        if ((0 == (table->attributes[row] & FATFS_ATTRIBUTE_DIRECTORY)) ||
+            ((0 != row) && ((0 == cluster) || (cluster >= (info.totalClusters + 2u)) || (0 != (visited[cluster / 8u] & (1u << (cluster % 8u)))))))
+        {
+            continue;
+        }
+        visited[cluster / 8u] |= (uint8_t)(1u << (cluster % 8u));
+
+        if (true == FATFS_DirOpen(&dir, (0 == row) ? 0 : cluster))
+        {
+            entry = FATFS_DirNext(&dir);
+            while ((true == status) && (NULL != entry))
+            {
+                /*Skip ".", "..", deleted entries and the volume label*/
+                if (('.' != entry->shortFileName[0]) && (0xe5u != entry->shortFileName[0]) && (0 == (entry->attributes & TABLE_ATTRIBUTE_VOLUME_LABEL)))
+                {
+                    FATFS_GetShortName(entry, shortName);
+                    status = TABLE_AddRow(table, (0 != entry->longFileName[0]) ? entry->longFileName : shortName, entry->fileSize,
+                                          (TABLE_PACK_ENTRY_DATE(entry->lastModDate) << 16u) | TABLE_PACK_ENTRY_TIME(entry->lastModTime),
+                                          entry->attributes, entry->firstCluster, row);
+                }
+                entry = FATFS_DirNext(&dir);
+            }
+            FATFS_DirClose(&dir);
+        }
+    }
+
+    free(visited);
+    if (false == status)
+    {
+        TABLE_Free(table);
+    }
+
+    return status;
+}
+
+bool TABLE_BuildFromIndex(TABLE_Table_Struct_t *const table, const INDEX_Handle_Struct_t *const handle)
+{
+    bool status = true; /*return value */
+    uint32_t row = 0;
+    const INDEX_Node_Struct_t *node = NULL;
+
+    memset(table, 0, sizeof(TABLE_Table_Struct_t));
+    for (row = 0; (true == status) && (row < handle->header->sumNode); row++)
+    {
+        node = &handle->node[row];
+        status = TABLE_AddRow(table, INDEX_GetName(handle, row), node->fileSize, node->lastModified, node->attributes, node->firstCluster, node->parent);
+    }
+    if (false == status)
+    {
+        TABLE_Free(table);
+    }
+
+    return status;
+}
+
+void TABLE_InitFilter(TABLE_Filter_Struct_t *const filter)
+{
+    filter->minSize = 0;
+    filter->maxSize = 0xffffffffu;
+    filter->modifiedAfter = 0;
+    filter->modifiedBefore = 0xffffffffu;
+    filter->attributesMask = 0;
+    filter->attributesValue = 0;
+}
+
+uint32_t TABLE_Select(const TABLE_Table_Struct_t *const table, const TABLE_Filter_Struct_t *const filter, uint32_t *const rows)
+{
+    uint32_t sumSelected = 0; /*return value */
+    uint32_t row = 0;
+#if defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi32((int32_t)0x80000000u); /*SSE2 only compares signed : move unsigned values to signed range*/
+    const __m128i minSize = _mm_set1_epi32((int32_t)(filter->minSize ^ 0x80000000u));
+    const __m128i maxSize = _mm_set1_epi32((int32_t)(filter->maxSize ^ 0x80000000u));
+    const __m128i after = _mm_set1_epi32((int32_t)(filter->modifiedAfter ^ 0x80000000u));
+    const __m128i before = _mm_set1_epi32((int32_t)(filter->modifiedBefore ^ 0x80000000u));
+    const __m128i attributesMask = _mm_set1_epi32(filter->attributesMask);
+    const __m128i attributesValue = _mm_set1_epi32(filter->attributesValue);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i size;
+    __m128i modified;
+    __m128i attributes;
+    __m128i reject;
+    int32_t packedAttributes = 0;
+    uint32_t bits = 0;
+
+    /*4 rows per step*/
+    for (row = 1; (row + 4u) <= table->sumRow; row += 4u)
+    {
+        size = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&table->size[row]), bias);
+        modified = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&table->modified[row]), bias);
+        memcpy(&packedAttributes, &table->attributes[row], sizeof(packedAttributes));
+        attributes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packedAttributes), zero), zero);
+        reject = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(size, minSize), _mm_cmpgt_epi32(size, maxSize)),
+                              _mm_or_si128(_mm_cmplt_epi32(modified, after), _mm_cmpgt_epi32(modified, before)));
+        reject = _mm_or_si128(reject, _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(attributes, attributesMask), attributesValue), _mm_set1_epi32(-1)));
+        bits = (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(reject)) ^ 0xfu;
+
+        /*Append selected rows without branch*/
+        rows[sumSelected] = row;
+        sumSelected += bits & 1u;
+        rows[sumSelected] = row + 1u;
+        sumSelected += (bits >> 1u) & 1u;
+        rows[sumSelected] = row + 2u;
+        sumSelected += (bits >> 2u) & 1u;
+        rows[sumSelected] = row + 3u;
+        sumSelected += (bits >> 3u) & 1u;
+    }
+#else
+    row = 1;
+#endif
+    /*Remaining rows (all rows without SSE2)*/
+    for (; row < table->sumRow; row++)
+    {
+        rows[sumSelected] = row;
+        sumSelected += TABLE_IsSelected(table, filter, row);
+    }
+
+    return sumSelected;
+}
+
+bool TABLE_Sort(const TABLE_Table_Struct_t *const table, uint32_t *const rows, const uint32_t sumRow, const TABLE_SortKey_t key, const bool descending)
+{
+    bool status = true; /*return value */
+    uint32_t *keys = NULL;
+    uint32_t *temporaryKeys = NULL;
+    uint32_t *temporaryRows = NULL;
+    uint32_t *swap = NULL;
+    uint32_t count[TABLE_RADIX_SIZE];
+    uint32_t pass = 0;
+    uint32_t i = 0;
+    uint32_t digit = 0;
+    uint32_t position = 0;
+    uint32_t sum = 0;
+    uint32_t *sourceRows = rows;
+
+    if (TABLE_SORT_NAME == key)
+    {
+        s_NamesToSort = table->names;
+        s_NameOffsetToSort = table->nameOffset;
+        qsort(rows, sumRow, sizeof(uint32_t), TABLE_CompareName);
+        for (i = 0; (true == descending) && (i < (sumRow / 2u)); i++)
+        {
+            position = rows[i];
+            rows[i] = rows[sumRow - 1u - i];
+            rows[sumRow - 1u - i] = position;
+        }
+    }
+    else
+    {
+        keys = (uint32_t *)STATS_Malloc((size_t)sumRow * sizeof(uint32_t));
+        temporaryKeys = (uint32_t *)STATS_Malloc((size_t)sumRow * sizeof(uint32_t));
+        temporaryRows = (uint32_t *)STATS_Malloc((size_t)sumRow * sizeof(uint32_t));
+        status = (NULL != keys) && (NULL != temporaryKeys) && (NULL != temporaryRows);
+
+        if (true == status)
+        {
+            /*Gather the keys, reverse them for descending order*/
+            for (i = 0; i < sumRow; i++)
+            {
+                keys[i] = (TABLE_SORT_SIZE == key) ? table->size[rows[i]] : table->modified[rows[i]];
+                keys[i] = (true == descending) ? ~keys[i] : keys[i];
+            }
+
+            /*Least significant digit first : each pass is stable*/
+            for (pass = 0; pass < TABLE_RADIX_PASS; pass++)
+            {
+                memset(count, 0, sizeof(count));
+                for (i = 0; i < sumRow; i++)
+                {
+                    count[(keys[i] >> (pass * TABLE_RADIX_BIT)) & (TABLE_RADIX_SIZE - 1u)]++;
+                }
+                sum = 0;
+                for (digit = 0; digit < TABLE_RADIX_SIZE; digit++)
+                {
+                    position = count[digit];
+                    count[digit] = sum;
+                    sum += position;
+                }
+                for (i = 0; i < sumRow; i++)
+                {
+                    digit = (keys[i] >> (pass * TABLE_RADIX_BIT)) & (TABLE_RADIX_SIZE - 1u);
+                    temporaryKeys[count[digit]] = keys[i];
+                    temporaryRows[count[digit]] = sourceRows[i];
+                    count[digit]++;
+                }
+                swap = keys;
+                keys = temporaryKeys;
+                temporaryKeys = swap;
+                swap = sourceRows;
+                sourceRows = temporaryRows;
+                temporaryRows = swap;
+            }
+            /*An even number of passes leaves the result in rows*/
+        }
+
+        free(keys);
+        free(temporaryKeys);
+        free((sourceRows == rows) ? temporaryRows : sourceRows);
+    }
+
+    return status;
+}
+
+void TABLE_GetPath(const TABLE_Table_Struct_t *const table, const uint32_t row, uint8_t *const path, const uint32_t sizeOfPath)
+{
+    uint32_t ancestor[TABLE_MAX_DEPTH];
+    uint32_t depth = 0;
+    uint32_t current = row;
+    uint32_t length = 0;
+
+    while ((0 != current) && (depth < TABLE_MAX_DEPTH))
+    {
+        ancestor[depth] = current;
+        depth++;
+        current = table->parent[current];
+    }
+
+    path[0] = 0;
+    if (0 == depth)
+    {
+        snprintf((char *)path, sizeOfPath, "/");
+    }
+    while ((0 != depth) && (length < sizeOfPath))
+    {
+        depth--;
+        length += snprintf((char *)&path[length], sizeOfPath - length, "/%s", &table->names[table->nameOffset[ancestor[depth]]]);
+    }
+}
+
+void TABLE_Free(TABLE_Table_Struct_t *const table)
+{
+    free(table->size);
+    free(table->modified);
+    free(table->attributes);
+    free(table->firstCluster);
+    free(table->parent);
+    free(table->nameOffset);
+    free(table->names);
+    memset(table, 0, sizeof(TABLE_Table_Struct_t));
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static bool TABLE_AddRow(TABLE_Table_Struct_t *const table, const uint8_t *const name, const uint32_t size, const uint32_t modified,
+                         const uint8_t attributes, const uint32_t firstCluster, const uint32_t parent)
+{
+    bool status = true; /*return value */
+    uint32_t sizeOfName = strlen((const char *)name) + 1u;
+    uint32_t newMax = 0;
+    void *column[6];
+    uint8_t *newNames = NULL;
+
+    /*Grow all columns together*/
+    if (table->sumRow == table->maxRow)
+    {
+        newMax = (0 == table->maxRow) ? 1024u : (table->maxRow * 2u);
+        column[0] = STATS_Realloc(table->size, (size_t)newMax * sizeof(uint32_t));
+        table->size = (NULL != column[0]) ? (uint32_t *)column[0] : table->size;
+        column[1] = STATS_Realloc(table->modified, (size_t)newMax * sizeof(uint32_t));
+        table->modified = (NULL != column[1]) ? (uint32_t *)column[1] : table->modified;
+        column[2] = STATS_Realloc(table->attributes, (size_t)newMax * sizeof(uint8_t));
+        table->attributes = (NULL != column[2]) ? (uint8_t *)column[2] : table->attributes;
+        column[3] = STATS_Realloc(table->firstCluster, (size_t)newMax * sizeof(uint32_t));
+        table->firstCluster = (NULL != column[3]) ? (uint32_t *)column[3] : table->firstCluster;
+        column[4] = STATS_Realloc(table->parent, (size_t)newMax * sizeof(uint32_t));
+        table->parent = (NULL != column[4]) ? (uint32_t *)column[4] : table->parent;
+        column[5] = STATS_Realloc(table->nameOffset, (size_t)newMax * sizeof(uint32_t));
+        table->nameOffset = (NULL != column[5]) ? (uint32_t *)column[5] : table->nameOffset;
+        status = (NULL != column[0]) && (NULL != column[1]) && (NULL != column[2]) && (NULL != column[3]) && (NULL != column[4]) && (NULL != column[5]);
+        if (true == status)
+        {
+            table->maxRow = newMax;
+        }
+    }
+    if ((true == status) && ((table->sizeOfNames + sizeOfName) > table->maxSizeOfNames))
+    {
+        newMax = (0 == table->maxSizeOfNames) ? 16384u : table->maxSizeOfNames;
+        while (newMax < (table->sizeOfNames + sizeOfName))
+        {
+            newMax *= 2u;
+        }
+        newNames = (uint8_t *)STATS_Realloc(table->names, newMax);
+        if (NULL != newNames)
+        {
+            table->names = newNames;
+            table->maxSizeOfNames = newMax;
+        }
+        else
+        {
+            status = false;
+        }
+    }
+
+    if (true == status)
+    {
+        table->size[table->sumRow] = size;
+        table->modified[table->sumRow] = modified;
+        table->attributes[table->sumRow] = attributes;
+        table->firstCluster[table->sumRow] = firstCluster;
+        table->parent[table->sumRow] = parent;
+        table->nameOffset[table->sumRow] = table->sizeOfNames;
+        memcpy(&table->names[table->sizeOfNames], name, sizeOfName);
+        table->sizeOfNames += sizeOfName;
+        table->sumRow++;
+    }
+
+    return status;
+}
+
+static int TABLE_CompareName(const void *first, const void *second)
+{
+    return MYSTRING_CompareNoCase(&s_NamesToSort[s_NameOffsetToSort[*(const uint32_t *)first]], &s_NamesToSort[s_NameOffsetToSort[*(const uint32_t *)second]]);
+}
+
+static inline uint32_t TABLE_IsSelected(const TABLE_Table_Struct_t *const table, const TABLE_Filter_Struct_t *const filter, const uint32_t row)
+{
+    return (uint32_t)((table->size[row] >= filter->minSize) & (table->size[row] <= filter->maxSize) &
+                      (table->modified[row] >= filter->modifiedAfter) & (table->modified[row] <= filter->modifiedBefore) &
+                      ((table->attributes[row] & filter->attributesMask) == filter->attributesValue));
+}
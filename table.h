@@ -0,0 +1,117 @@
+#ifndef __TABLE_H__
+#define __TABLE_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Columns used to sort a selection
+ */
+typedef enum
+{
+    TABLE_SORT_SIZE = 0,     /*Size of file*/
+    TABLE_SORT_MODIFIED = 1, /*Last modified date and time*/
+    TABLE_SORT_NAME = 2      /*Name, ignoring case*/
+} TABLE_SortKey_t;
+
+/*
+ *Filter applied to every row. A row is selected if all conditions are true
+ */
+typedef struct
+{
+    uint32_t minSize;        /*Size >= minSize*/
+    uint32_t maxSize;        /*Size <= maxSize*/
+    uint32_t modifiedAfter;  /*Packed last modified >= modifiedAfter (see TABLE_PACK_DATE)*/
+    uint32_t modifiedBefore; /*Packed last modified <= modifiedBefore*/
+    uint8_t attributesMask;  /*(attributes & attributesMask) == attributesValue*/
+    uint8_t attributesValue;
+} TABLE_Filter_Struct_t;
+
+/*
+ *Pack a date as the high 16 bits of the last modified column (year from 1980)
+ */
+#define TABLE_PACK_DATE(year, month, day) (((((uint32_t)(year) - 1980u) << 9u) | ((uint32_t)(month) << 5u) | (uint32_t)(day)) << 16u)
+
+/*
+ *Metadata of a whole volume stored by columns. Row 0 is the root directory
+ */
+typedef struct
+{
+    uint32_t sumRow;       /*Number of rows*/
+    uint32_t maxRow;       /*Capacity of the columns*/
+    uint32_t *size;        /*Size of file*/
+    uint32_t *modified;    /*Last modified date (high 16 bits) and time (low 16 bits) in FAT format*/
+    uint8_t *attributes;   /*Attributes*/
+    uint32_t *firstCluster;/*First cluster*/
+    uint32_t *parent;      /*Row of the parent folder*/
+    uint32_t *nameOffset;  /*Offset of the name in names*/
+    uint8_t *names;        /*Names, each one ends with '\0'*/
+    uint32_t sizeOfNames;  /*Size in bytes of names*/
+    uint32_t maxSizeOfNames;
+} TABLE_Table_Struct_t;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  TABLE_Build
+ * @brief Read every folder of the mounted volume once and fill the columns
+ * @param[out] table   Table
+ * @return bool Returns true if success
+ */
+bool TABLE_Build(TABLE_Table_Struct_t *const table);
+
+/**  TABLE_BuildFromIndex
+ * @brief Fill the columns from an index file (no access to the image)
+ * @param[out] table   Table
+ * @param[in] handle   Index opened with INDEX_Open
+ * @return bool Returns true if success
+ */
+bool TABLE_BuildFromIndex(TABLE_Table_Struct_t *const table, const INDEX_Handle_Struct_t *const handle);
+
+/**  TABLE_InitFilter
+ * @brief Set a filter that selects every row
+ * @param[out] filter   Filter
+ * @return none
+ */
+void TABLE_InitFilter(TABLE_Filter_Struct_t *const filter);
+
+/**  TABLE_Select
+ * @brief Evaluate a filter over all rows except the root (several rows per instruction when SSE2 is available)
+ * @param[in] table   Table
+ * @param[in] filter   Filter
+ * @param[out] rows   Receiver of selected rows, table->sumRow elements
+ * @return uint32_t Returns the number of selected rows
+ */
+uint32_t TABLE_Select(const TABLE_Table_Struct_t *const table, const TABLE_Filter_Struct_t *const filter, uint32_t *const rows);
+
+/**  TABLE_Sort
+ * @brief Sort selected rows (radix sort for numeric columns)
+ * @param[in] table   Table
+ * @param[in,out] rows   Selected rows
+ * @param[in] sumRow   Number of selected rows
+ * @param[in] key   Column
+ * @param[in] descending   true for descending order
+ * @return bool Returns true if success
+ */
+bool TABLE_Sort(const TABLE_Table_Struct_t *const table, uint32_t *const rows, const uint32_t sumRow, const TABLE_SortKey_t key, const bool descending);
+
+/**  TABLE_GetPath
+ * @brief Build the path of a row from its parents
+ * @param[in] table   Table
+ * @param[in] row   Row
+ * @param[out] path   Receiver
+ * @param[in] sizeOfPath   Size of receiver
+ * @return none
+ */
+void TABLE_GetPath(const TABLE_Table_Struct_t *const table, const uint32_t row, uint8_t *const path, const uint32_t sizeOfPath);
+
+/**  TABLE_Free
+ * @brief Release the columns
+ * @param[in,out] table   Table
+ * @return none
+ */
+void TABLE_Free(TABLE_Table_Struct_t *const table);
+
+#endif /*__TABLE_H__*/
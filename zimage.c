@@ -0,0 +1,349 @@
+/*******************************************************************************
+ * Includes
+ ******************************************************************************/
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "stats.h"
+#include "zimage.h"
+
+/*******************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define ZIMAGE_VERSION (1u)
+#define ZIMAGE_NO_BLOCK (UINT64_MAX) /*Slot of the cache not used*/
+
+/*
+ *Block held by the cache
+ */
+typedef struct
+{
+    uint64_t block;   /*Number of the block (ZIMAGE_NO_BLOCK : empty)*/
+    uint64_t lastUse; /*Value of s_Clock when it was last read*/
+    uint8_t *data;    /*sizeOfBlock bytes*/
+} ZIMAGE_Slot_Struct_t;
+
+/*******************************************************************************
+ * Variables
+ ******************************************************************************/
+
+static int s_FileDescriptor = -1;
+static ZIMAGE_Header_Struct_t s_Header;
+static uint64_t *s_Index = NULL; /*sumBlock + 1 offsets*/
+
+static pthread_mutex_t s_Lock = PTHREAD_MUTEX_INITIALIZER; /*Protects the cache*/
+static ZIMAGE_Slot_Struct_t s_Cache[ZIMAGE_CACHE_BLOCK];
+static uint64_t s_Clock = 0;
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  ZIMAGE_ReadFile
+ * @brief Read bytes of the compressed file, retrying short reads
+ * @param[in] offset   Offset in bytes
+ * @param[in] size   Number of bytes
+ * @param[out] buff   Receiver array
+ * @return bool Returns true if all bytes were read
+ */
+static bool ZIMAGE_ReadFile(const uint64_t offset, const uint32_t size, uint8_t *const buff);
+
+/**  ZIMAGE_ReadBlock
+ * @brief Copy a part of a block : from the cache, or decompressed then cached
+ * @param[in] block   Number of the block
+ * @param[in] start   First byte in the block
+ * @param[in] size   Number of bytes (within the block)
+ * @param[out] buff   Receiver array
+ * @return bool Returns false if the block could not be read or decompressed
+ */
+static bool ZIMAGE_ReadBlock(const uint64_t block, const uint32_t start, const uint32_t size, uint8_t *const buff);
+
+/*******************************************************************************
+ * Code
+ ******************************************************************************/
+
+bool ZIMAGE_Convert(const uint8_t *const imagePath, const uint8_t *const outputPath, const uint32_t sizeOfBlock, const int level)
+{
+    bool status = true; /*return value */
+    ZIMAGE_Header_Struct_t header;
+    struct stat information;
+    uint64_t *offsets = NULL;
+    uint8_t *data = NULL;
+    uint8_t *packed = NULL;
+    const uint8_t *stored = NULL;
+    uLongf sizeOfPacked = 0;
+    uint64_t sizeOfIndex = 0;
+    uint64_t position = 0;
+    uint64_t block = 0;
+    uint32_t sizeOfData = 0;
+    uint32_t sizeOfStored = 0;
+    uint32_t i = 0;
+    int input = -1;
+    int output = -1;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ZIMAGE_MAGIC, sizeof(header.magic));
+    header.version = ZIMAGE_VERSION;
+    header.sizeOfBlock = (0 != sizeOfBlock) ? sizeOfBlock : ZIMAGE_BLOCK_DEFAULT;
+    status = (ZIMAGE_BLOCK_MIN <= header.sizeOfBlock) && (header.sizeOfBlock <= ZIMAGE_BLOCK_MAX);
+    if (true == status)
+    {
+        input = open((const char *)imagePath, O_RDONLY);
+        status = (0 <= input) && (0 == fstat(input, &information));
+    }
+    if (true == status)
+    {
+        header.sizeOfImage = (uint64_t)information.st_size;
+        header.sumBlock = (header.sizeOfImage + header.sizeOfBlock - 1u) / header.sizeOfBlock;
+        sizeOfIndex = (header.sumBlock + 1u) * sizeof(uint64_t);
+        offsets = (uint64_t *)STATS_Malloc(sizeOfIndex);
+        data = (uint8_t *)STATS_Malloc(header.sizeOfBlock);
+        packed = (uint8_t *)STATS_Malloc(compressBound(header.sizeOfBlock));
+        output = open((const char *)outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        status = (NULL != offsets) && (NULL != data) && (NULL != packed) && (0 <= output);
+    }
+
+    /*Blocks after the header and the index, which are written at the end*/
+    position = sizeof(header) + sizeOfIndex;
+    for (block = 0; (true == status) && (block < header.sumBlock); block++)
+    {
+        offsets[block] = position;
+        sizeOfData = ((header.sizeOfImage - block * header.sizeOfBlock) < header.sizeOfBlock) ? (uint32_t)(header.sizeOfImage - block * header.sizeOfBlock) : header.sizeOfBlock;
+        status = ((ssize_t)sizeOfData == pread(input, data, sizeOfData, (off_t)(block * header.sizeOfBlock)));
+        for (i = 0; (true == status) && (i < sizeOfData) && (0 == data[i]); i++)
+        {
+        }
+        if ((true == status) && (i < sizeOfData))
+        {
+            /*Stored as is when zlib does not make it smaller*/
+            sizeOfPacked = compressBound(header.sizeOfBlock);
+            status = (Z_OK == compress2(packed, &sizeOfPacked, data, sizeOfData, level));
+            stored = (sizeOfPacked < sizeOfData) ? packed : data;
+            sizeOfStored = (sizeOfPacked < sizeOfData) ? (uint32_t)sizeOfPacked : sizeOfData;
+            status = (true == status) && ((ssize_t)sizeOfStored == pwrite(output, stored, sizeOfStored, (off_t)position));
+            position += sizeOfStored;
+        }
+        else
+        {
+            /*All zeros : nothing stored*/
+        }
+    }
+    if (true == status)
+    {
+        offsets[header.sumBlock] = position;
+        status = ((ssize_t)sizeof(header) == pwrite(output, &header, sizeof(header), 0)) &&
+                 ((ssize_t)sizeOfIndex == pwrite(output, offsets, sizeOfIndex, (off_t)sizeof(header)));
+    }
+
+    if (0 <= output)
+    {
+        status = (0 == close(output)) && (true == status);
+    }
+    if (0 <= input)
+    {
+        close(input);
+    }
+    free(offsets);
+    free(data);
+    free(packed);
+
+    return status;
+}
+
+bool ZIMAGE_IsImage(const int fileDescriptor)
+{
+    char magic[sizeof(s_Header.magic)];
+
+    return ((ssize_t)sizeof(magic) == pread(fileDescriptor, magic, sizeof(magic), 0)) && (0 == memcmp(magic, ZIMAGE_MAGIC, sizeof(magic)));
+}
+
+bool ZIMAGE_Open(const int fileDescriptor)
+{
+    bool status = true; /*return value */
+    struct stat information;
+    uint64_t sizeOfIndex = 0;
+    uint64_t i = 0;
+
+    s_FileDescriptor = fileDescriptor;
+    status = (0 == fstat(fileDescriptor, &information)) && (true == ZIMAGE_ReadFile(0, sizeof(s_Header), (uint8_t *)&s_Header)) &&
+             (0 == memcmp(s_Header.magic, ZIMAGE_MAGIC, sizeof(s_Header.magic))) && (ZIMAGE_VERSION == s_Header.version) &&
+             (ZIMAGE_BLOCK_MIN <= s_Header.sizeOfBlock) && (s_Header.sizeOfBlock <= ZIMAGE_BLOCK_MAX) &&
+             (s_Header.sumBlock == ((s_Header.sizeOfImage + s_Header.sizeOfBlock - 1u) / s_Header.sizeOfBlock)) &&
+             (s_Header.sumBlock < ((uint64_t)information.st_size / sizeof(uint64_t)));
+    if (true == status)
+    {
+        sizeOfIndex = (s_Header.sumBlock + 1u) * sizeof(uint64_t);
+        s_Index = (uint64_t *)STATS_Malloc(sizeOfIndex);
+        status = (NULL != s_Index) && (sizeOfIndex <= UINT32_MAX) && (true == ZIMAGE_ReadFile(sizeof(s_Header), (uint32_t)sizeOfIndex, (uint8_t *)s_Index));
+    }
+    for (i = 0; (true == status) && (i < s_Header.sumBlock); i++)
+    {
+        /*A block is never stored bigger than its data*/
+        status = (s_Index[i] <= s_Index[i + 1u]) && ((s_Index[i + 1u] - s_Index[i]) <= s_Header.sizeOfBlock) && (s_Index[i + 1u] <= (uint64_t)information.st_size);
+    }
+    for (i = 0; i < ZIMAGE_CACHE_BLOCK; i++)
+    {
+        s_Cache[i].block = ZIMAGE_NO_BLOCK;
+        s_Cache[i].lastUse = 0;
+        s_Cache[i].data = NULL;
+    }
+    s_Clock = 0;
+    if (false == status)
+    {
+        ZIMAGE_Close();
+    }
+
+    return status;
+}
+
+int32_t ZIMAGE_Read(const uint64_t offset, const uint32_t size, uint8_t *const buff)
+{
+    int32_t sumByte = 0; /*return value */
+    uint64_t position = offset;
+    uint64_t block = 0;
+    uint32_t start = 0;
+    uint32_t sizeOfPart = 0;
+    uint32_t sizeToRead = size;
+    bool status = true;
+
+    if (offset < s_Header.sizeOfImage)
+    {
+        sizeToRead = ((s_Header.sizeOfImage - offset) < size) ? (uint32_t)(s_Header.sizeOfImage - offset) : size;
+    }
+    else
+    {
+        sizeToRead = 0;
+    }
+    while ((true == status) && ((uint32_t)sumByte < sizeToRead))
+    {
+        block = position / s_Header.sizeOfBlock;
+        start = (uint32_t)(position % s_Header.sizeOfBlock);
+        sizeOfPart = ((s_Header.sizeOfBlock - start) < (sizeToRead - (uint32_t)sumByte)) ? (s_Header.sizeOfBlock - start) : (sizeToRead - (uint32_t)sumByte);
+        status = ZIMAGE_ReadBlock(block, start, sizeOfPart, &buff[sumByte]);
+        if (true == status)
+        {
+            sumByte += (int32_t)sizeOfPart;
+            position += sizeOfPart;
+        }
+    }
+
+    return sumByte;
+}
+
+void ZIMAGE_Close(void)
+{
+    uint32_t i = 0;
+
+    for (i = 0; i < ZIMAGE_CACHE_BLOCK; i++)
+    {
+        free(s_Cache[i].data);
+        s_Cache[i].data = NULL;
+        s_Cache[i].block = ZIMAGE_NO_BLOCK;
+    }
+    free(s_Index);
+    s_Index = NULL;
+    memset(&s_Header, 0, sizeof(s_Header));
+    s_FileDescriptor = -1;
+}
+
+/************************************************************************************
+ * Static function
+ *************************************************************************************/
+
+static bool ZIMAGE_ReadFile(const uint64_t offset, const uint32_t size, uint8_t *const buff)
+{
+    uint32_t sumByte = 0;
+    ssize_t sizeOfRead = 1;
+
+    while ((0 < sizeOfRead) && (sumByte < size))
+    {
+        sizeOfRead = pread(s_FileDescriptor, &buff[sumByte], size - sumByte, (off_t)(offset + sumByte));
+        sumByte += (0 < sizeOfRead) ? (uint32_t)sizeOfRead : 0u;
+    }
+
+    return (sumByte == size);
+}
+
+static bool ZIMAGE_ReadBlock(const uint64_t block, const uint32_t start, const uint32_t size, uint8_t *const buff)
+{
+    bool status = true; /*return value */
+    const uint32_t sizeOfStored = (uint32_t)(s_Index[block + 1u] - s_Index[block]);
+    const uint32_t sizeOfData = ((s_Header.sizeOfImage - block * s_Header.sizeOfBlock) < s_Header.sizeOfBlock) ? (uint32_t)(s_Header.sizeOfImage - block * s_Header.sizeOfBlock) : s_Header.sizeOfBlock;
+    ZIMAGE_Slot_Struct_t *slot = NULL;
+    uint8_t *packed = NULL;
+    uint8_t *data = NULL;
+    uLongf sizeOfUnpacked = sizeOfData;
+    uint32_t i = 0;
+
+    if (0 == sizeOfStored)
+    {
+        memset(buff, 0, size);
+    }
+    else if (sizeOfData == sizeOfStored)
+    {
+        /*Not compressed : read only the part*/
+        status = ZIMAGE_ReadFile(s_Index[block] + start, size, buff);
+    }
+    else
+    {
+        pthread_mutex_lock(&s_Lock);
+        for (i = 0; (NULL == slot) && (i < ZIMAGE_CACHE_BLOCK); i++)
+        {
+            slot = (block == s_Cache[i].block) ? &s_Cache[i] : NULL;
+        }
+        if (NULL != slot)
+        {
+            slot->lastUse = ++s_Clock;
+            memcpy(buff, &slot->data[start], size);
+        }
+        pthread_mutex_unlock(&s_Lock);
+
+        if (NULL != slot)
+        {
+            STATS_Add(STATS_BLOCK_HIT, 1u);
+        }
+        else
+        {
+            /*Decompressed without the lock : other threads keep reading the cache*/
+            packed = (uint8_t *)STATS_Malloc(sizeOfStored);
+            data = (uint8_t *)STATS_Malloc(s_Header.sizeOfBlock);
+            status = (NULL != packed) && (NULL != data) && (true == ZIMAGE_ReadFile(s_Index[block], sizeOfStored, packed)) &&
+                     (Z_OK == uncompress(data, &sizeOfUnpacked, packed, sizeOfStored)) && (sizeOfData == sizeOfUnpacked);
+            free(packed);
+            STATS_Add(STATS_BLOCK_DECOMPRESSED, 1u);
+            if (true == status)
+            {
+                memcpy(buff, &data[start], size);
+
+                /*Replace the least recently used block, unless another thread cached this one meanwhile*/
+                pthread_mutex_lock(&s_Lock);
+                slot = &s_Cache[0];
+                for (i = 0; (block != slot->block) && (i < ZIMAGE_CACHE_BLOCK); i++)
+                {
+                    slot = ((block == s_Cache[i].block) || (s_Cache[i].lastUse < slot->lastUse)) ? &s_Cache[i] : slot;
+                }
+                if (block != slot->block)
+                {
+                    free(slot->data);
+                    slot->data = data;
+                    slot->block = block;
+                    data = NULL;
+                }
+                slot->lastUse = ++s_Clock;
+                pthread_mutex_unlock(&s_Lock);
+            }
+            free(data);
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,80 @@
+#ifndef __ZIMAGE_H__
+#define __ZIMAGE_H__
+
+/*******************************************************************************
+ * Definitions
+ ******************************************************************************/
+
+/*
+ *Compressed image : header, index of sumBlock + 1 offsets (uint64_t, block i is stored from offset[i] to
+ *offset[i + 1]), then the blocks. Each block holds sizeOfBlock bytes of the image (the last one may hold less),
+ *compressed alone with zlib so any block can be read without the others. A block stored in 0 bytes is all
+ *zeros, a block stored in its own size is not compressed. Numbers are in the byte order of the host (little endian)
+ */
+#define ZIMAGE_MAGIC "FATZIMG1"
+
+typedef struct
+{
+    char magic[8];         /*ZIMAGE_MAGIC, not terminated*/
+    uint32_t version;      /*1*/
+    uint32_t sizeOfBlock;  /*Bytes of image per block*/
+    uint64_t sizeOfImage;  /*Bytes of the image*/
+    uint64_t sumBlock;     /*Number of blocks*/
+} ZIMAGE_Header_Struct_t;
+
+/*
+ *Size of the blocks when none is given, and the limits
+ */
+#define ZIMAGE_BLOCK_DEFAULT (64u * 1024u)
+#define ZIMAGE_BLOCK_MIN (4u * 1024u)
+#define ZIMAGE_BLOCK_MAX (4u * 1024u * 1024u)
+
+/*
+ *Decompressed blocks kept in memory (least recently used replaced)
+ */
+#define ZIMAGE_CACHE_BLOCK (64u)
+
+/*******************************************************************************
+ * Prototypes
+ ******************************************************************************/
+
+/**  ZIMAGE_Convert
+ * @brief Write the compressed image of an image
+ * @param[in] imagePath   Path of the image
+ * @param[in] outputPath   Path of the compressed image (replaced)
+ * @param[in] sizeOfBlock   Bytes per block (0 : ZIMAGE_BLOCK_DEFAULT), from ZIMAGE_BLOCK_MIN to ZIMAGE_BLOCK_MAX
+ * @param[in] level   zlib level, 1 (fast) to 9 (small)
+ * @return bool Returns false if the image could not be read or the output written
+ */
+bool ZIMAGE_Convert(const uint8_t *const imagePath, const uint8_t *const outputPath, const uint32_t sizeOfBlock, const int level);
+
+/**  ZIMAGE_IsImage
+ * @brief Tell if an opened file starts with ZIMAGE_MAGIC
+ * @param[in] fileDescriptor   Descriptor of the file
+ * @return bool Returns true for a compressed image (valid or not)
+ */
+bool ZIMAGE_IsImage(const int fileDescriptor);
+
+/**  ZIMAGE_Open
+ * @brief Use an opened file as compressed image : check the header and the index, load the index and empty the cache
+ * @param[in] fileDescriptor   Descriptor of the file (kept by the caller until ZIMAGE_Close)
+ * @return bool Returns false if the file is not a valid compressed image (ZIMAGE_Close is not needed)
+ */
+bool ZIMAGE_Open(const int fileDescriptor);
+
+/**  ZIMAGE_Read
+ * @brief Read bytes of the image : only the blocks touched are decompressed. Can be called by several threads
+ * @param[in] offset   Offset in bytes in the image
+ * @param[in] size   Number of bytes
+ * @param[out] buff   Receiver array
+ * @return int32_t Returns the number of bytes read (less at the end of the image or on error)
+ */
+int32_t ZIMAGE_Read(const uint64_t offset, const uint32_t size, uint8_t *const buff);
+
+/**  ZIMAGE_Close
+ * @brief Release the index and the cache
+ * @return none
+ */
+void ZIMAGE_Close(void);
+
+#endif /*__ZIMAGE_H__*/